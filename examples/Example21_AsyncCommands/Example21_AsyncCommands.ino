@@ -0,0 +1,183 @@
+/*!
+ * @file Example21_AsyncCommands.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Request the date and time asynchronously - without blocking loop()
+ *   Queue a binary message for transmission asynchronously
+ *   Drive the library from loop() with poll()
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+
+SWARM_M138 mySwarm;
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+
+// If you are using the Swarm Satellite Transceiver MicroMod Function Board:
+//
+// The Function Board has an onboard power switch which controls the power to the modem.
+// The power is disabled by default.
+// To enable the power, you need to pull the correct PWR_EN pin high.
+//
+// Uncomment and adapt a line to match your Main Board and Processor configuration:
+//#define swarmPowerEnablePin A1 // MicroMod Main Board Single (DEV-18575) : with a Processor Board that supports A1 as an output
+//#define swarmPowerEnablePin 39 // MicroMod Main Board Single (DEV-18575) : with e.g. the Teensy Processor Board using pin 39 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin 4  // MicroMod Main Board Single (DEV-18575) : with e.g. the Artemis Processor Board using pin 4 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin G5 // MicroMod Main Board Double (DEV-18576) : Slot 0 with the ALT_PWR_EN0 set to G5<->PWR_EN0
+//#define swarmPowerEnablePin G6 // MicroMod Main Board Double (DEV-18576) : Slot 1 with the ALT_PWR_EN1 set to G6<->PWR_EN1
+
+unsigned long lastRequest = 0; // Used to request the date and time every 10 seconds
+unsigned long loopCount = 0; // Count how many times loop() runs - to prove it is not blocked
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Callback: dateTimeDone will be called by poll() when the $DT response arrives - or the command times out
+// context is whatever was passed to getDateTimeAsync. Here it points to loopCount
+void dateTimeDone(Swarm_M138_Error_e err, const Swarm_M138_DateTimeData_t *dateTime, void *context)
+{
+  if (err != SWARM_M138_SUCCESS)
+  {
+    Serial.print(F("getDateTimeAsync failed: "));
+    Serial.println(mySwarm.modemErrorString(err)); // Convert the error into printable text
+    return;
+  }
+
+  Serial.print(F("Date/Time: "));
+  Serial.print(dateTime->YYYY);
+  Serial.print(F("/"));
+  if (dateTime->MM < 10) Serial.print(F("0")); Serial.print(dateTime->MM); // Print the month. Add a leading zero if required
+  Serial.print(F("/"));
+  if (dateTime->DD < 10) Serial.print(F("0")); Serial.print(dateTime->DD); // Print the day of month. Add a leading zero if required
+  Serial.print(F(" "));
+  if (dateTime->hh < 10) Serial.print(F("0")); Serial.print(dateTime->hh); // Print the hour. Add a leading zero if required
+  Serial.print(F(":"));
+  if (dateTime->mm < 10) Serial.print(F("0")); Serial.print(dateTime->mm); // Print the minute. Add a leading zero if required
+  Serial.print(F(":"));
+  if (dateTime->ss < 10) Serial.print(F("0")); Serial.print(dateTime->ss); // Print the second. Add a leading zero if required
+  Serial.print(F("  loop() has run "));
+  Serial.print(*((unsigned long *)context));
+  Serial.println(F(" times"));
+}
+
+// Callback: transmitDone will be called by poll() when the $TD OK response arrives
+void transmitDone(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context)
+{
+  if (err == SWARM_M138_SUCCESS)
+  {
+    Serial.print(F("Message queued. ID is "));
+    serialPrintUint64_t(*msg_id);
+    Serial.println();
+  }
+  else
+  {
+    Serial.print(F("transmitBinaryAsync failed: "));
+    Serial.println(mySwarm.modemErrorString(err)); // Convert the error into printable text
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  // Swarm Satellite Transceiver MicroMod Function Board PWR_EN
+  #ifdef swarmPowerEnablePin
+  pinMode(swarmPowerEnablePin, OUTPUT); // Enable modem power 
+  digitalWrite(swarmPowerEnablePin, HIGH);
+  #endif
+
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Swarm Satellite example"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  // Queue a short binary message. transmitBinaryAsync returns as soon as the command has been sent
+  const uint8_t message[] = { 0x48, 0x65, 0x6C, 0x6C, 0x6F }; // Hello
+  Swarm_M138_Error_e err = mySwarm.transmitBinaryAsync(message, sizeof(message), &transmitDone);
+  if (err != SWARM_M138_SUCCESS)
+  {
+    Serial.print(F("Swarm communication error: "));
+    Serial.println(mySwarm.modemErrorString(err)); // Convert the error into printable text
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  mySwarm.poll(); // Process any data from the modem. This never blocks
+
+  // Request the date and time every 10 seconds - unless a command is still in progress
+  if (((millis() - lastRequest) > 10000) && (mySwarm.isBusy() == false))
+  {
+    lastRequest = millis();
+    mySwarm.getDateTimeAsync(&dateTimeDone, &loopCount);
+  }
+
+  loopCount++; // The rest of your code can run here...
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void serialPrintUint64_t(uint64_t theNum)
+{
+  // Convert uint64_t to string
+  // Based on printLLNumber by robtillaart
+  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
+  
+  char rev[21]; // Char array to hold to theNum (reversed order)
+  char fwd[21]; // Char array to hold to theNum (correct order)
+  unsigned int i = 0;
+  if (theNum == 0ULL) // if theNum is zero, set fwd to "0"
+  {
+    fwd[0] = '0';
+    fwd[1] = 0; // mark the end with a NULL
+  }
+  else
+  {
+    while (theNum > 0)
+    {
+      rev[i++] = (theNum % 10) + '0'; // divide by 10, convert the remainder to char
+      theNum /= 10; // divide by 10
+    }
+    unsigned int j = 0;
+    while (i > 0)
+    {
+      fwd[j++] = rev[--i]; // reverse the order
+      fwd[j] = 0; // mark the end with a NULL
+    }
+  }
+
+  Serial.print(fwd);
+}
@@ -0,0 +1,136 @@
+/*!
+ * @file Example22_RingTransport.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Feed the library from a ring buffer filled by an interrupt, task or DMA - using SWARM_M138_Ring_Transport
+ *   Begin the library with a custom transport
+ * 
+ * This example is written for ESP32: the UART receive callback (onReceive) copies the serial data into the ring in bulk.
+ * On other boards, call ringTransport.push from your UART interrupt - or setHead from your DMA code.
+ * The producer must run in the background (interrupt, DMA or task): the blocking commands do not call it.
+ * Because the ring's available() is always up to date, commands are sent without the 12ms idle window.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+
+#if !defined(ARDUINO_ARCH_ESP32)
+#error This example is written for ESP32. On other boards, fill the ring from your UART interrupt or DMA
+#endif
+
+SWARM_M138 mySwarm;
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+
+uint8_t ring[1024]; // The ring buffer. Make it large enough to hold the data which arrives between calls to poll()
+SWARM_M138_Ring_Transport ringTransport(ring, sizeof(ring), &swarmSerial); // Commands are written to swarmSerial
+
+// If you are using the Swarm Satellite Transceiver MicroMod Function Board:
+//
+// The Function Board has an onboard power switch which controls the power to the modem.
+// The power is disabled by default.
+// To enable the power, you need to pull the correct PWR_EN pin high.
+//
+// Uncomment and adapt a line to match your Main Board and Processor configuration:
+//#define swarmPowerEnablePin A1 // MicroMod Main Board Single (DEV-18575) : with a Processor Board that supports A1 as an output
+//#define swarmPowerEnablePin 39 // MicroMod Main Board Single (DEV-18575) : with e.g. the Teensy Processor Board using pin 39 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin 4  // MicroMod Main Board Single (DEV-18575) : with e.g. the Artemis Processor Board using pin 4 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin G5 // MicroMod Main Board Double (DEV-18576) : Slot 0 with the ALT_PWR_EN0 set to G5<->PWR_EN0
+//#define swarmPowerEnablePin G6 // MicroMod Main Board Double (DEV-18576) : Slot 1 with the ALT_PWR_EN1 set to G6<->PWR_EN1
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// The producer: copy any serial data into the ring, in chunks. Called by the ESP32 UART event task
+void feedRing()
+{
+  uint8_t chunk[64];
+  int avail = swarmSerial.available();
+  while (avail > 0)
+  {
+    size_t toRead = (avail > (int)sizeof(chunk)) ? sizeof(chunk) : (size_t)avail;
+    size_t bytesRead = swarmSerial.readBytes(chunk, toRead);
+    ringTransport.push(chunk, bytesRead); // Copy the chunk into the ring
+    avail -= bytesRead;
+  }
+}
+
+// Callback: printGeospatial will be called when a $GN message arrives
+void printGeospatial(const Swarm_M138_GeospatialData_t *info)
+{
+  Serial.print(F("New $GN message received: Lat: "));
+  Serial.print(info->lat, 4);
+  Serial.print(F(" Lon: "));
+  Serial.print(info->lon, 4);
+  Serial.print(F(" Alt: "));
+  Serial.println(info->alt);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  // Swarm Satellite Transceiver MicroMod Function Board PWR_EN
+  #ifdef swarmPowerEnablePin
+  pinMode(swarmPowerEnablePin, OUTPUT); // Enable modem power 
+  digitalWrite(swarmPowerEnablePin, HIGH);
+  #endif
+
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Swarm Satellite example"));
+  Serial.println();
+
+  // The ring transport does not own the serial port. Begin it here
+  swarmSerial.begin(SWARM_M138_SERIAL_BAUD_RATE);
+  swarmSerial.onReceive(feedRing); // The UART event task calls feedRing as soon as data arrives
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(ringTransport); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(ringTransport);
+  }
+
+  // Set up the callback for the $GN message and request the message every 10 seconds
+  mySwarm.setGeospatialInfoCallback(&printGeospatial);
+  mySwarm.setGeospatialInfoRate(10);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  mySwarm.poll(); // Process any data from the modem. This never blocks
+
+  static uint32_t lastOverruns = 0;
+  if (ringTransport.getOverruns() != lastOverruns) // Report any data lost because the ring was full
+  {
+    lastOverruns = ringTransport.getOverruns();
+    Serial.print(F("Ring overruns: "));
+    Serial.println(lastOverruns);
+  }
+}
@@ -0,0 +1,316 @@
+/*!
+ * @file Example23_ReplayBenchmark.ino
+ *
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ *
+ * @section intro_sec Examples
+ *
+ * This example shows how to:
+ *   Benchmark the sentence framer, the URC parsers and the command engine - without a modem
+ *   Replay captured M138 traffic through a SWARM_M138_Ring_Transport
+ *   Answer the library's commands from a simulated modem (a Print which pushes the recorded responses into the ring)
+ *
+ * Four tests are run, and repeated every 10 seconds:
+ *   URC replay: interleaved $DT, $GN, $GS, $PW, $RT, $RD and $TD SENT messages, processed by checkUnsolicitedMsg
+ *   Stray responses: $SL OK/ERR and $TD OK/ERR lines (e.g. responses which arrive after a command has timed out).
+ *     These are not $SL WAKE or $TD SENT messages: no callback must be called and the event counts must not change
+ *   getDateTime: a command round-trip, with a $GN message arriving before each response
+ *   transmitText: a command round-trip, with a $TD SENT message arriving before each response
+ * The sentences per second, CPU cycles per sentence (if F_CPU is defined) and round-trip times are printed.
+ *
+ * Add -DSWARM_M138_ENABLE_STATISTICS to your build flags (or uncomment the define in SparkFun_Swarm_Satellite_Arduino_Library.h)
+ * and the heap allocations per call, the backlog high-water mark and the dropped and pruned URC counts are printed too.
+ * Try it with -DSWARM_M138_STATIC_BUFFERS and -DSWARM_M138_DEBUG_LEVEL=0 to compare the options.
+ *
+ * The library and the ring need approximately 2.5KB of RAM. This example will not run on an ATmega328P (Uno).
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ *
+ * @section author Author
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ *
+ * @section license License
+ *
+ * MIT: please see LICENSE.md for the full license information
+ *
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+
+SWARM_M138 mySwarm;
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Captured M138 traffic: the unsolicited messages
+const char *const urcTraffic[] = {
+  "$DT 20221014120000,V*4f\n",
+  "$GN 40.0901,-105.1852,1553,0,0*30\n",
+  "$GS 109,214,9,0,G3*46\n",
+  "$PW 3.30800,0.00000,0.00000,0.00000,32.0*30\n",
+  "$RT RSSI=-103*1f\n",
+  "$RD AI=65535,RSSI=-95,SNR=-9,FDEV=-6231,48656C6C6F*2a\n",
+  "$TD SENT RSSI=-96,SNR=7,FDEV=-1047,5414205580*7c\n"
+};
+#define NUM_URCS (sizeof(urcTraffic) / sizeof(urcTraffic[0]))
+
+// Captured M138 traffic: command responses with no command waiting for them
+const char *const strayTraffic[] = {
+  "$SL OK*3b\n",
+  "$SL ERR,NOTIME*42\n",
+  "$TD OK,5414205580*16\n",
+  "$TD ERR,HOLDTIMEEXPIRED*14\n"
+};
+#define NUM_STRAYS (sizeof(strayTraffic) / sizeof(strayTraffic[0]))
+
+// Captured M138 traffic: the command responses. Each response can be preceded by an unsolicited message
+typedef struct
+{
+  const char *commandStart; // The start of the command
+  const char *urc;          // The unsolicited message which arrives before the response. NULL if none
+  const char *response;     // The response
+} replay_response_t;
+
+const replay_response_t responseTraffic[] = {
+  { "$CS", NULL, "$CS DI=0x000e57,DN=M138*73\n" },
+  { "$DT @", "$GN 40.0901,-105.1852,1553,0,0*30\n", "$DT 20221014120000,V*4f\n" },
+  { "$TD \"", "$TD SENT RSSI=-96,SNR=7,FDEV=-1047,5414205580*7c\n", "$TD OK,5414205580*16\n" }
+};
+#define NUM_RESPONSES (sizeof(responseTraffic) / sizeof(responseTraffic[0]))
+
+#define NUM_ROUNDS 200   // Replay the unsolicited messages this many times
+#define NUM_COMMANDS 100 // Send each command this many times
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// The simulated modem: the library writes its commands here.
+// When a complete command has arrived, the recorded response is pushed into the ring
+class ReplayModem : public Print
+{
+public:
+  size_t write(uint8_t c);
+  using Print::write;
+
+private:
+  char _command[64]; // Only the start of each command is needed
+  size_t _length = 0;
+};
+
+ReplayModem replayModem;
+
+uint8_t ring[512]; // The ring buffer. Large enough to hold one round of the unsolicited messages
+SWARM_M138_Ring_Transport ringTransport(ring, sizeof(ring), &replayModem); // Commands are written to replayModem
+
+// Push a sentence into the ring. Return the number of bytes which did not fit
+size_t replay(const char *sentence)
+{
+  size_t len = strlen(sentence);
+  return (len - ringTransport.push((const uint8_t *)sentence, len));
+}
+
+size_t ReplayModem::write(uint8_t c)
+{
+  if (_length < (sizeof(_command) - 1))
+    _command[_length++] = (char)c;
+
+  if (c == '\n') // Command complete?
+  {
+    _command[_length] = 0;
+    for (size_t i = 0; i < NUM_RESPONSES; i++)
+    {
+      if (strncmp(_command, responseTraffic[i].commandStart, strlen(responseTraffic[i].commandStart)) == 0)
+      {
+        if (responseTraffic[i].urc != NULL)
+          replay(responseTraffic[i].urc);
+        replay(responseTraffic[i].response);
+        break;
+      }
+    }
+    _length = 0;
+  }
+  return (1);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Callbacks: count the unsolicited messages
+volatile uint32_t urcsSeen = 0;
+
+void countDateTime(const Swarm_M138_DateTimeData_t *dateTime) { urcsSeen++; }
+void countGeospatial(const Swarm_M138_GeospatialData_t *info) { urcsSeen++; }
+void countGpsFixQuality(const Swarm_M138_GPS_Fix_Quality_t *fixQuality) { urcsSeen++; }
+void countPowerStatus(const Swarm_M138_Power_Status_t *status) { urcsSeen++; }
+void countReceiveTest(const Swarm_M138_Receive_Test_t *rxTest) { urcsSeen++; }
+void countReceiveMessage(const uint16_t *appID, const int16_t *rssi, const int16_t *snr, const int16_t *fdev, const char *asciiHex) { urcsSeen++; }
+void countTransmitData(const int16_t *rssi_sat, const int16_t *snr, const int16_t *fdev, const uint64_t *msg_id) { urcsSeen++; }
+void countSleepWake(Swarm_M138_Wake_Cause_e cause) { urcsSeen++; }
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Print the throughput: per second and (if F_CPU is defined) CPU cycles per item
+void printThroughput(const __FlashStringHelper *what, uint32_t count, unsigned long elapsedMicros)
+{
+  Serial.print(what);
+  Serial.print(F(": "));
+  Serial.print(count);
+  Serial.print(F(" in "));
+  Serial.print(elapsedMicros);
+  Serial.print(F("us : "));
+  if (elapsedMicros > 0)
+    Serial.print(((float)count * 1000000.0) / (float)elapsedMicros, 1);
+  Serial.print(F(" per second : "));
+  if (count > 0)
+    Serial.print((float)elapsedMicros / (float)count, 1);
+  Serial.print(F("us each"));
+#ifdef F_CPU
+  Serial.print(F(" : "));
+  if (count > 0)
+    Serial.print(((float)elapsedMicros * ((float)F_CPU / 1000000.0)) / (float)count, 0);
+  Serial.print(F(" CPU cycles each"));
+#endif
+  Serial.println();
+}
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+// Print the statistics collected by the library
+void printStats(uint32_t calls)
+{
+  Swarm_M138_Stats_t stats;
+  mySwarm.getStats(&stats);
+  Serial.print(F("  Heap allocations per call: "));
+  Serial.println((float)stats.heapAllocations / (float)calls, 2);
+  Serial.print(F("  Backlog high-water mark: "));
+  Serial.print(stats.backlogHighWater);
+  Serial.print(F(" bytes : URCs dropped: "));
+  Serial.print(stats.urcsDropped);
+  Serial.print(F(" : URCs pruned: "));
+  Serial.print(stats.urcsPruned);
+  Serial.print(F(" : Invalid sentences: "));
+  Serial.println(stats.invalidSentences);
+}
+#endif
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Swarm Satellite example"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial. The benchmark will be much slower!
+
+  if (mySwarm.begin(ringTransport) == false) // Begin communication with the simulated modem
+  {
+    Serial.println(F("Could not communicate with the simulated modem! Freezing..."));
+    while (1)
+      ;
+  }
+
+  mySwarm.setDateTimeCallback(&countDateTime);
+  mySwarm.setGeospatialInfoCallback(&countGeospatial);
+  mySwarm.setGpsFixQualityCallback(&countGpsFixQuality);
+  mySwarm.setPowerStatusCallback(&countPowerStatus);
+  mySwarm.setReceiveTestCallback(&countReceiveTest);
+  mySwarm.setReceiveMessageCallback(&countReceiveMessage);
+  mySwarm.setTransmitDataCallback(&countTransmitData);
+  mySwarm.setSleepWakeCallback(&countSleepWake);
+  mySwarm.enableEventCounting(); // Count the $TD SENT and $SL WAKE messages
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  unsigned long startMicros;
+  uint32_t notPushed = 0;
+
+  // URC replay
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  mySwarm.resetStats();
+#endif
+  urcsSeen = 0;
+  startMicros = micros();
+  for (int round = 0; round < NUM_ROUNDS; round++)
+  {
+    for (size_t i = 0; i < NUM_URCS; i++)
+      notPushed += replay(urcTraffic[i]);
+    mySwarm.checkUnsolicitedMsg();
+  }
+  printThroughput(F("URC sentences"), urcsSeen, micros() - startMicros);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  printStats(NUM_ROUNDS);
+#endif
+  if ((urcsSeen != (NUM_ROUNDS * NUM_URCS)) || (notPushed > 0))
+  {
+    Serial.print(F("  Expected "));
+    Serial.print(NUM_ROUNDS * NUM_URCS);
+    Serial.print(F(" sentences. Bytes which did not fit in the ring: "));
+    Serial.println(notPushed);
+  }
+
+  // Stray responses: these must be ignored
+  urcsSeen = 0;
+  uint32_t sentCount = mySwarm.getTransmitSentCount();
+  uint32_t wakeCount = mySwarm.getSleepWakeCount();
+  for (size_t i = 0; i < NUM_STRAYS; i++)
+    replay(strayTraffic[i]);
+  mySwarm.checkUnsolicitedMsg();
+  Serial.print(F("Stray responses: "));
+  if ((urcsSeen == 0) && (mySwarm.getTransmitSentCount() == sentCount) && (mySwarm.getSleepWakeCount() == wakeCount))
+    Serial.println(F("ignored"));
+  else
+    Serial.println(F("NOT ignored!"));
+
+  // getDateTime round-trips
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  mySwarm.resetStats();
+#endif
+  uint32_t successes = 0;
+  startMicros = micros();
+  for (int i = 0; i < NUM_COMMANDS; i++)
+  {
+    Swarm_M138_DateTimeData_t dateTime;
+    if (mySwarm.getDateTime(&dateTime) == SWARM_M138_SUCCESS)
+      successes++;
+    mySwarm.checkUnsolicitedMsg(); // Process the $GN message
+  }
+  printThroughput(F("getDateTime round-trips"), successes, micros() - startMicros);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  printStats(NUM_COMMANDS);
+#endif
+
+  // transmitText round-trips
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  mySwarm.resetStats();
+#endif
+  successes = 0;
+  startMicros = micros();
+  for (int i = 0; i < NUM_COMMANDS; i++)
+  {
+    uint64_t id;
+    if (mySwarm.transmitText("Hello World!", &id) == SWARM_M138_SUCCESS)
+      successes++;
+    mySwarm.checkUnsolicitedMsg(); // Process the $TD SENT message
+  }
+  printThroughput(F("transmitText round-trips"), successes, micros() - startMicros);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  printStats(NUM_COMMANDS);
+#endif
+
+  Serial.print(F("Backlog bytes dropped: "));
+  Serial.print(mySwarm.getBacklogBytesDropped());
+  Serial.print(F(" : Ring overruns: "));
+  Serial.println(ringTransport.getOverruns());
+  Serial.println();
+
+  delay(10000);
+}
@@ -0,0 +1,292 @@
+/*!
+ * @file Example24_FaultInjection.ino
+ *
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ *
+ * @section intro_sec Examples
+ *
+ * This example shows how to:
+ *   Measure how the library behaves under faults - without a modem - using SWARM_M138_Fault_Transport
+ *   Wrap a transport with latency, ESP32-style available() updates, split reads, dropped bytes, corrupt checksums and URC floods
+ *
+ * The captured M138 traffic from Example23 is replayed through a SWARM_M138_Ring_Transport, wrapped by a SWARM_M138_Fault_Transport.
+ * Each scenario sends getDateTime commands with unsolicited messages arriving in between, and prints:
+ *   the number of successes, timeouts and checksum errors, the unsolicited messages processed, and the time taken
+ * Use the results to size the buffers and timeouts with data instead of guessing.
+ * The faults are pseudo-random but repeatable: change the seed to get a different (but repeatable) set of faults.
+ *
+ * Add -DSWARM_M138_ENABLE_STATISTICS to your build flags (or uncomment the define in SparkFun_Swarm_Satellite_Arduino_Library.h)
+ * and the longest round-trip time, the backlog high-water mark and the dropped and invalid sentence counts are printed too.
+ *
+ * You can wrap a real transport too, e.g.: SWARM_M138_HardwareSerial_Transport serialTransport(&Serial1);
+ * SWARM_M138_Fault_Transport faultTransport(&serialTransport); mySwarm.begin(faultTransport);
+ *
+ * The library and the ring need approximately 2.5KB of RAM. This example will not run on an ATmega328P (Uno).
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ *
+ * @section author Author
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ *
+ * @section license License
+ *
+ * MIT: please see LICENSE.md for the full license information
+ *
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Fault_Transport.h>
+
+SWARM_M138 mySwarm;
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Captured M138 traffic: the unsolicited messages which arrive between the commands
+const char *const urcTraffic[] = {
+  "$GN 40.0901,-105.1852,1553,0,0*30\n",
+  "$GS 109,214,9,0,G3*46\n",
+  "$PW 3.30800,0.00000,0.00000,0.00000,32.0*30\n",
+  "$RT RSSI=-103*1f\n"
+};
+#define NUM_URCS (sizeof(urcTraffic) / sizeof(urcTraffic[0]))
+
+// The flood: a $RD storm
+const char floodSentence[] = "$RD AI=65535,RSSI=-95,SNR=-9,FDEV=-6231,48656C6C6F*2a\n";
+
+// Captured M138 traffic: the command responses
+typedef struct
+{
+  const char *commandStart; // The start of the command
+  const char *response;     // The response
+} replay_response_t;
+
+const replay_response_t responseTraffic[] = {
+  { "$CS", "$CS DI=0x000e57,DN=M138*73\n" },
+  { "$DT @", "$DT 20221014120000,V*4f\n" }
+};
+#define NUM_RESPONSES (sizeof(responseTraffic) / sizeof(responseTraffic[0]))
+
+// The fault scenarios
+typedef struct
+{
+  const char *name;
+  unsigned long latency;     // setLatency
+  size_t granularity;        // setAvailableGranularity
+  unsigned long idleMillis;  // setAvailableGranularity
+  size_t maxRead;            // setMaxRead
+  uint16_t dropRate;         // setDropRate
+  uint16_t corruptRate;      // setCorruptRate
+  unsigned long floodPeriod; // setFlood. 0 == no flood
+} fault_scenario_t;
+
+const fault_scenario_t scenarios[] = {
+  // name                             latency gran idle maxRead drop corrupt flood
+  { "Baseline",                             0,   0,   0,      0,    0,     0,    0 },
+  { "Latency 100ms",                      100,   0,   0,      0,    0,     0,    0 },
+  { "ESP32 available (120 bytes)",          0, 120,   2,      0,    0,     0,    0 },
+  { "Split reads (1 to 7 bytes)",           0,   0,   0,      7,    0,     0,    0 },
+  { "Drop 1 byte in 1000",                  0,   0,   0,      0, 1000,     0,    0 },
+  { "Corrupt 1 checksum in 10",             0,   0,   0,      0,    0,    10,    0 },
+  { "$RD flood every 5ms",                  0,   0,   0,      0,    0,     0,    5 },
+  { "Everything",                          20, 120,   2,      7, 1000,    10,    5 }
+};
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+#define NUM_COMMANDS 50 // Send this many getDateTime commands per scenario
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// The simulated modem: the library writes its commands here.
+// When a complete command has arrived, the recorded response is pushed into the ring
+class ReplayModem : public Print
+{
+public:
+  size_t write(uint8_t c);
+  using Print::write;
+
+private:
+  char _command[64]; // Only the start of each command is needed
+  size_t _length = 0;
+};
+
+ReplayModem replayModem;
+
+uint8_t ring[512]; // The ring buffer
+SWARM_M138_Ring_Transport ringTransport(ring, sizeof(ring), &replayModem); // Commands are written to replayModem
+SWARM_M138_Fault_Transport faultTransport(&ringTransport); // Add the faults to the data from the ring
+
+// Push a sentence into the ring
+void replay(const char *sentence)
+{
+  ringTransport.push((const uint8_t *)sentence, strlen(sentence));
+}
+
+size_t ReplayModem::write(uint8_t c)
+{
+  if (_length < (sizeof(_command) - 1))
+    _command[_length++] = (char)c;
+
+  if (c == '\n') // Command complete?
+  {
+    _command[_length] = 0;
+    for (size_t i = 0; i < NUM_RESPONSES; i++)
+    {
+      if (strncmp(_command, responseTraffic[i].commandStart, strlen(responseTraffic[i].commandStart)) == 0)
+      {
+        replay(responseTraffic[i].response);
+        break;
+      }
+    }
+    _length = 0;
+  }
+  return (1);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Callbacks: count the unsolicited messages
+uint32_t urcsSeen = 0;
+
+void countGeospatial(const Swarm_M138_GeospatialData_t *info) { urcsSeen++; }
+void countGpsFixQuality(const Swarm_M138_GPS_Fix_Quality_t *fixQuality) { urcsSeen++; }
+void countPowerStatus(const Swarm_M138_Power_Status_t *status) { urcsSeen++; }
+void countReceiveTest(const Swarm_M138_Receive_Test_t *rxTest) { urcsSeen++; }
+void countReceiveMessage(const uint16_t *appID, const int16_t *rssi, const int16_t *snr, const int16_t *fdev, const char *asciiHex) { urcsSeen++; }
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Configure the faults for a scenario
+void setFaults(const fault_scenario_t *scenario)
+{
+  faultTransport.setLatency(scenario->latency);
+  faultTransport.setAvailableGranularity(scenario->granularity, scenario->idleMillis);
+  faultTransport.setMaxRead(scenario->maxRead);
+  faultTransport.setDropRate(scenario->dropRate);
+  faultTransport.setCorruptRate(scenario->corruptRate);
+  faultTransport.setFlood(scenario->floodPeriod > 0 ? floodSentence : NULL, scenario->floodPeriod);
+}
+
+// Run one scenario and print the results
+void runScenario(const fault_scenario_t *scenario)
+{
+  uint32_t successes = 0, timeouts = 0, checksumErrors = 0, otherErrors = 0;
+  uint32_t bytesDropped = faultTransport.getBytesDropped();
+  uint32_t checksumsCorrupted = faultTransport.getChecksumsCorrupted();
+  uint32_t sentencesInjected = faultTransport.getSentencesInjected();
+  uint32_t backlogDropped = mySwarm.getBacklogBytesDropped();
+
+  mySwarm.checkUnsolicitedMsg(); // Clear out anything left over from the previous scenario
+  setFaults(scenario);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  mySwarm.resetStats();
+#endif
+  urcsSeen = 0;
+
+  unsigned long startMillis = millis();
+  for (int i = 0; i < NUM_COMMANDS; i++)
+  {
+    for (size_t j = 0; j < NUM_URCS; j++) // The unsolicited messages arrive first
+      replay(urcTraffic[j]);
+
+    Swarm_M138_DateTimeData_t dateTime;
+    Swarm_M138_Error_e err = mySwarm.getDateTime(&dateTime);
+    if (err == SWARM_M138_SUCCESS)
+      successes++;
+    else if (err == SWARM_M138_ERROR_TIMEOUT)
+      timeouts++;
+    else if ((err == SWARM_M138_ERROR_INVALID_CHECKSUM) || (err == SWARM_M138_ERROR_INVALID_FORMAT))
+      checksumErrors++;
+    else
+      otherErrors++;
+
+    mySwarm.checkUnsolicitedMsg(); // Process the unsolicited messages
+  }
+  unsigned long elapsed = millis() - startMillis;
+
+  Serial.println(scenario->name);
+  Serial.print(F("  getDateTime: "));
+  Serial.print(successes);
+  Serial.print(F(" OK : "));
+  Serial.print(timeouts);
+  Serial.print(F(" timeouts : "));
+  Serial.print(checksumErrors);
+  Serial.print(F(" checksum errors : "));
+  Serial.print(otherErrors);
+  Serial.print(F(" other errors : "));
+  Serial.print(elapsed);
+  Serial.println(F("ms"));
+  Serial.print(F("  URCs processed: "));
+  Serial.print(urcsSeen);
+  Serial.print(F(" of "));
+  Serial.print((NUM_COMMANDS * NUM_URCS) + faultTransport.getSentencesInjected() - sentencesInjected);
+  Serial.print(F(" : Faults: "));
+  Serial.print(faultTransport.getBytesDropped() - bytesDropped);
+  Serial.print(F(" bytes dropped, "));
+  Serial.print(faultTransport.getChecksumsCorrupted() - checksumsCorrupted);
+  Serial.print(F(" checksums corrupted, "));
+  Serial.print(faultTransport.getSentencesInjected() - sentencesInjected);
+  Serial.println(F(" sentences injected"));
+  Serial.print(F("  Backlog bytes dropped: "));
+  Serial.print(mySwarm.getBacklogBytesDropped() - backlogDropped);
+  Serial.print(F(" : Ring overruns: "));
+  Serial.println(ringTransport.getOverruns());
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  Swarm_M138_Stats_t stats;
+  mySwarm.getStats(&stats);
+  Serial.print(F("  Longest round-trip: "));
+  Serial.print(stats.commands[SWARM_M138_SENTENCE_TAG_DT].maxMillis);
+  Serial.print(F("ms : Backlog high-water mark: "));
+  Serial.print(stats.backlogHighWater);
+  Serial.print(F(" bytes : URCs dropped: "));
+  Serial.print(stats.urcsDropped);
+  Serial.print(F(" : Invalid sentences: "));
+  Serial.println(stats.invalidSentences);
+#endif
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Swarm Satellite example"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  if (mySwarm.begin(faultTransport) == false) // Begin communication with the simulated modem. No faults yet
+  {
+    Serial.println(F("Could not communicate with the simulated modem! Freezing..."));
+    while (1)
+      ;
+  }
+
+  mySwarm.setGeospatialInfoCallback(&countGeospatial);
+  mySwarm.setGpsFixQualityCallback(&countGpsFixQuality);
+  mySwarm.setPowerStatusCallback(&countPowerStatus);
+  mySwarm.setReceiveTestCallback(&countReceiveTest);
+  mySwarm.setReceiveMessageCallback(&countReceiveMessage);
+
+  faultTransport.setSeed(12345); // Change the seed to get a different set of faults
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  for (size_t i = 0; i < NUM_SCENARIOS; i++)
+    runScenario(&scenarios[i]);
+
+  Serial.println();
+  delay(10000);
+}
@@ -0,0 +1,181 @@
+/*!
+ * @file Example25_Fleet.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Drive several modems together with a SWARM_M138_Fleet - e.g. on a gateway
+ *   Share one I2C bus between two Qwiic Swarm breakouts behind an I2C mux
+ *   Spread the messages across the modems: each goes via the idle modem with the fewest unsent messages
+ * 
+ * The example uses two modems on Serial1 and Serial2, plus two Qwiic Swarm breakouts on Wire,
+ * on channels 0 and 1 of a TCA9548A I2C mux. Remove or change the modems (and ports) to match your setup.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <Wire.h> //Needed for I2C to the mux and the Qwiic Swarm breakouts
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Fleet.h>
+
+SWARM_M138 serialSwarm1;
+SWARM_M138 serialSwarm2;
+SWARM_M138 qwiicSwarm1;
+SWARM_M138 qwiicSwarm2;
+
+SWARM_M138_Fleet fleet;
+
+#define muxAddress 0x70 // The default I2C address of the TCA9548A mux
+
+unsigned long lastTransmit = 0; // Used to queue a message every 10 seconds
+uint32_t messageCount = 0;
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// selectBus: the fleet calls this before it talks to a Qwiic Swarm. context holds the mux channel
+void selectMuxChannel(void *context)
+{
+  uint8_t channel = (uint8_t)(uintptr_t)context;
+  Wire.beginTransmission(muxAddress);
+  Wire.write(1 << channel);
+  Wire.endTransmission();
+}
+
+// Callback: transmitDone will be called by fleet.poll() when the $TD response arrives
+// modem is the index of the modem which has the message
+void transmitDone(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context)
+{
+  Serial.print(F("Modem "));
+  Serial.print(modem);
+  if (err != SWARM_M138_SUCCESS)
+  {
+    Serial.print(F(": transmit failed: "));
+    Serial.println(serialSwarm1.modemErrorString(err)); // Convert the error into printable text
+    return;
+  }
+
+  Serial.print(F(": message queued. ID: "));
+  serialPrintUint64_t(*msg_id); // Print the 64-bit message ID
+  Serial.println();
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm Fleet"));
+  Serial.println();
+
+  Wire.begin();
+
+  // Begin each modem. The fleet does not begin them
+  bool ok = serialSwarm1.begin(Serial1);
+  ok &= serialSwarm2.begin(Serial2);
+  selectMuxChannel((void *)0);
+  ok &= qwiicSwarm1.begin(SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS, Wire);
+  selectMuxChannel((void *)1);
+  ok &= qwiicSwarm2.begin(SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS, Wire);
+  if (!ok)
+  {
+    Serial.println(F("Could not communicate with all of the modems. Please check the serial and I2C connections. Freezing..."));
+    while (1)
+      ;
+  }
+
+  // Add the modems to the fleet. The two Qwiic Swarms share the bus and address, so they need the selectBus function
+  fleet.addModem(serialSwarm1);
+  fleet.addModem(serialSwarm2);
+  fleet.addModem(qwiicSwarm1, selectMuxChannel, (void *)0);
+  fleet.addModem(qwiicSwarm2, selectMuxChannel, (void *)1);
+
+  fleet.setUnsentRefreshInterval(60000); // Re-read the unsent message counts every minute
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  fleet.poll(); // Poll the modems. This never blocks. The callbacks are called from here
+
+  if (millis() > (lastTransmit + 10000)) // Queue a message every 10 seconds
+  {
+    char message[32];
+    sprintf(message, "Fleet message %lu", (unsigned long)messageCount);
+
+    uint8_t modem;
+    Swarm_M138_Error_e err = fleet.transmitText(message, transmitDone, NULL, &modem);
+
+    if (err == SWARM_M138_SUCCESS)
+    {
+      Serial.print(F("Sending \""));
+      Serial.print(message);
+      Serial.print(F("\" via modem "));
+      Serial.println(modem);
+      messageCount++;
+      lastTransmit = millis();
+
+      Serial.print(F("Unsent messages:"));
+      for (uint8_t i = 0; i < fleet.getModemCount(); i++)
+      {
+        Serial.print(F(" "));
+        Serial.print(fleet.getUnsentCount(i));
+      }
+      Serial.print(F("  Total: "));
+      Serial.println(fleet.getTotalUnsent());
+    }
+    // If err is SWARM_M138_ERROR_BUSY, every modem is busy. Try again next time around the loop
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void serialPrintUint64_t(uint64_t theNum)
+{
+  // Convert uint64_t to string
+  // Based on printLLNumber by robtillaart
+  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
+  
+  char rev[21]; // Char array to hold to theNum (reversed order)
+  char fwd[21]; // Char array to hold to theNum (correct order)
+  unsigned int i = 0;
+  if (theNum == 0ULL) // if theNum is zero, set fwd to "0"
+  {
+    fwd[0] = '0';
+    fwd[1] = 0; // mark the end with a NULL
+  }
+  else
+  {
+    while (theNum > 0)
+    {
+      rev[i++] = (theNum % 10) + '0'; // divide by 10, convert the remainder to char
+      theNum /= 10; // divide by 10
+    }
+    unsigned int j = 0;
+    while (i > 0)
+    {
+      fwd[j++] = rev[--i]; // reverse the order
+      fwd[j] = 0; // mark the end with a NULL
+    }
+  }
+
+  Serial.print(fwd);
+}
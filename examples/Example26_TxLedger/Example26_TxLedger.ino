@@ -0,0 +1,239 @@
+/*!
+ * @file Example26_TxLedger.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Track the queued messages by msg_id with a SWARM_M138_Tx_Ledger
+ *   See when each message was queued, when it was sent - and the RSSI, SNR and FDEV of the acknowledgement
+ *   Save the ledger to EEPROM - so it survives a reset - and load it again in setup
+ * 
+ * The ledger needs about 2.5kB of RAM and up to 2kB of EEPROM. It suits the ESP32, ESP8266 and Artemis -
+ * but not the ATmega328P. On the ESP32 and ESP8266 the EEPROM is emulated in flash: EEPROM.commit writes it.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <EEPROM.h>
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Tx_Ledger.h>
+
+SWARM_M138 mySwarm;
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+
+SWARM_M138_Tx_Ledger ledger;
+
+#define ledgerEEPROMSize (16 + (((SWARM_M138_TX_LEDGER_SLOTS / 4) * 3) * sizeof(Swarm_M138_Tx_Record_t))) // Enough for a full ledger
+
+unsigned long lastTransmit = 0; // Used to queue a message every 10 minutes
+unsigned long lastPrint = 0; // Used to print the ledger every minute
+uint32_t messageCount = 0;
+bool ledgerChanged = false; // Save the ledger when this is true
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// ledger.save calls this to write each record - and the header
+bool writeEEPROM(uint32_t offset, const uint8_t *data, uint16_t len, void *context)
+{
+  if ((offset + len) > ledgerEEPROMSize)
+    return (false);
+  for (uint16_t i = 0; i < len; i++)
+    EEPROM.write(offset + i, data[i]);
+  return (true);
+}
+
+// ledger.load calls this to read the header - and each record
+bool readEEPROM(uint32_t offset, uint8_t *data, uint16_t len, void *context)
+{
+  if ((offset + len) > ledgerEEPROMSize)
+    return (false);
+  for (uint16_t i = 0; i < len; i++)
+    data[i] = EEPROM.read(offset + i);
+  return (true);
+}
+
+// Callback: printMessageSent will be called when a $TD SENT message arrives - after the ledger has been updated
+void printMessageSent(const int16_t *rssi_sat, const int16_t *snr, const int16_t *fdev, const uint64_t *id)
+{
+  Swarm_M138_Tx_Record_t record;
+  if (ledger.find(*id, &record))
+  {
+    Serial.print(F("Message "));
+    serialPrintUint64_t(*id);
+    Serial.print(F(" was sent "));
+    Serial.print(record.sent - record.queued);
+    Serial.println(F(" seconds after it was queued"));
+  }
+  ledgerChanged = true;
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm TX Ledger"));
+  Serial.println();
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+  EEPROM.begin(ledgerEEPROMSize); // Emulate the EEPROM in flash
+#endif
+
+  // Load the ledger saved before the reset. load clears the ledger if the EEPROM does not hold one
+  if (ledger.load(readEEPROM))
+  {
+    Serial.print(F("Loaded "));
+    Serial.print(ledger.getCount());
+    Serial.println(F(" messages from EEPROM"));
+  }
+  else
+    Serial.println(F("There is no saved ledger. Starting a new one"));
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  mySwarm.setTxLedger(&ledger); // Record every message queued from now on
+
+  mySwarm.setTransmitDataCallback(&printMessageSent); // Print the delay when each message is sent
+
+  // The ledger takes the queue time from the $DT messages. Ask for one every minute
+  mySwarm.setDateTimeRate(60);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  mySwarm.checkUnsolicitedMsg(); // Process the $TD SENT messages. The ledger is updated from here
+
+  if ((lastTransmit == 0) || (millis() > (lastTransmit + 600000))) // Queue a message every 10 minutes
+  {
+    char message[32];
+    sprintf(message, "Ledger message %lu", (unsigned long)messageCount);
+
+    uint64_t id;
+    Swarm_M138_Error_e err = mySwarm.transmitTextHold(message, &id, 3600); // Hold the message for up to an hour
+
+    if (err == SWARM_M138_SUCCESS)
+    {
+      Serial.print(F("Queued \""));
+      Serial.print(message);
+      Serial.print(F("\" ID: "));
+      serialPrintUint64_t(id);
+      Serial.println();
+      messageCount++;
+      ledgerChanged = true;
+    }
+    else
+    {
+      Serial.print(F("Swarm communication error: "));
+      Serial.println(mySwarm.modemErrorString(err)); // Convert the error into printable text
+    }
+
+    lastTransmit = millis();
+  }
+
+  if (millis() > (lastPrint + 60000)) // Print the ledger every minute
+  {
+    Serial.print(F("Queued: "));
+    Serial.print(ledger.getCount(SWARM_M138_TX_STATE_QUEUED));
+    Serial.print(F("  Sent: "));
+    Serial.print(ledger.getCount(SWARM_M138_TX_STATE_SENT));
+    Serial.print(F("  Expired: "));
+    Serial.print(ledger.getCount(SWARM_M138_TX_STATE_EXPIRED));
+    Serial.print(F("  Deleted: "));
+    Serial.println(ledger.getCount(SWARM_M138_TX_STATE_DELETED));
+
+    for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++) // Walk the ledger
+    {
+      Swarm_M138_Tx_Record_t record;
+      if ((ledger.getRecord(slot, &record)) && (record.state == SWARM_M138_TX_STATE_SENT))
+      {
+        serialPrintUint64_t(record.msg_id);
+        Serial.print(F(" RSSI: "));
+        Serial.print(record.rssi_sat);
+        Serial.print(F(" SNR: "));
+        Serial.print(record.snr);
+        Serial.print(F(" FDEV: "));
+        Serial.println(record.fdev);
+      }
+    }
+
+    lastPrint = millis();
+  }
+
+  if (ledgerChanged) // Save the ledger when it changes
+  {
+    if (ledger.save(writeEEPROM))
+    {
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+      EEPROM.commit(); // Write the emulated EEPROM to flash
+#endif
+    }
+    else
+      Serial.println(F("Could not save the ledger"));
+    ledgerChanged = false;
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void serialPrintUint64_t(uint64_t theNum)
+{
+  // Convert uint64_t to string
+  // Based on printLLNumber by robtillaart
+  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
+  
+  char rev[21]; // Char array to hold to theNum (reversed order)
+  char fwd[21]; // Char array to hold to theNum (correct order)
+  unsigned int i = 0;
+  if (theNum == 0ULL) // if theNum is zero, set fwd to "0"
+  {
+    fwd[0] = '0';
+    fwd[1] = 0; // mark the end with a NULL
+  }
+  else
+  {
+    while (theNum > 0)
+    {
+      rev[i++] = (theNum % 10) + '0'; // divide by 10, convert the remainder to char
+      theNum /= 10; // divide by 10
+    }
+    unsigned int j = 0;
+    while (i > 0)
+    {
+      fwd[j++] = rev[--i]; // reverse the order
+      fwd[j] = 0; // mark the end with a NULL
+    }
+  }
+
+  Serial.print(fwd);
+}
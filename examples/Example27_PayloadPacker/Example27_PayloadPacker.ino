@@ -0,0 +1,170 @@
+/*!
+ * @file Example27_PayloadPacker.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Pack many small sensor readings into full 192-byte packets with a SWARM_M138_Payload_Packer
+ *   Timestamp each reading - for only a byte or two per reading
+ *   Queue a part-full packet when its first reading is an hour old - and still deliver it within the hold
+ * 
+ * Each reading is 8 bytes: the modem temperature and CPU voltage as floats. With timestamps, 17 readings fit in each packet.
+ * Sending each reading by itself would use 17 times as many packets.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Pass_Predictor.h>
+#include <SparkFun_Swarm_M138_Payload_Packer.h>
+
+SWARM_M138 mySwarm;
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+
+SWARM_M138_Payload_Packer packer;
+
+unsigned long lastReading = 0; // Used to take a reading every 5 minutes
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Callback: packetQueued will be called each time the packer queues a packet
+void packetQueued(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t records, uint16_t len, void *context)
+{
+  if (err != SWARM_M138_SUCCESS)
+  {
+    Serial.print(F("Could not queue the packet: "));
+    Serial.println(mySwarm.modemErrorString(err)); // Convert the error into printable text
+    if ((err == SWARM_M138_ERROR_EXPIRED) || (err == SWARM_M138_ERROR_ERR))
+      Serial.println(F("The readings have been dropped"));
+    else
+      Serial.println(F("The packer will try again"));
+    return;
+  }
+
+  Serial.print(F("Queued a packet of "));
+  Serial.print(records);
+  Serial.print(F(" readings ("));
+  Serial.print(len);
+  Serial.print(F(" bytes). ID: "));
+  serialPrintUint64_t(*msg_id); // Print the 64-bit message ID
+  Serial.println();
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm Payload Packer"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  packer.begin(mySwarm);
+  packer.setTimestamps();                // Timestamp each reading
+  packer.setMaximumAge(3600000);         // Queue a part-full packet when its first reading is an hour old
+  packer.setHold(21600);                 // Deliver each reading within six hours - or let the modem discard it
+  packer.setPacketCallback(&packetQueued);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  packer.poll(); // Queue the packet if its first reading is an hour old
+
+  if ((lastReading == 0) || (millis() > (lastReading + 300000))) // Take a reading every 5 minutes
+  {
+    lastReading = millis();
+
+    float reading[2]; // The reading: temperature and CPU voltage
+    Swarm_M138_DateTimeData_t dateTime;
+    if ((mySwarm.getTemperature(&reading[0]) != SWARM_M138_SUCCESS)
+        || (mySwarm.getCPUvoltage(&reading[1]) != SWARM_M138_SUCCESS)
+        || (mySwarm.getDateTime(&dateTime, 60000) != SWARM_M138_SUCCESS)) // Use the cached $DT if it is less than a minute old
+    {
+      Serial.println(F("Could not read the modem"));
+      return;
+    }
+
+    uint32_t timestamp = SWARM_M138_Pass_Predictor::dateTimeToUnix(&dateTime); // Convert the date and time into Unix time
+
+    Swarm_M138_Error_e err = packer.add((const uint8_t *)reading, sizeof(reading), timestamp); // This queues the packet first if it is full
+    if (err != SWARM_M138_SUCCESS)
+    {
+      Serial.print(F("Could not add the reading: "));
+      Serial.println(mySwarm.modemErrorString(err));
+      return;
+    }
+
+    Serial.print(F("Readings waiting: "));
+    Serial.print(packer.getPendingRecords());
+    Serial.print(F("  Packet: "));
+    Serial.print(packer.getPendingBytes());
+    Serial.print(F(" of "));
+    Serial.print(SWARM_M138_MAX_PACKET_LENGTH_BYTES);
+    Serial.println(F(" bytes"));
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void serialPrintUint64_t(uint64_t theNum)
+{
+  // Convert uint64_t to string
+  // Based on printLLNumber by robtillaart
+  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
+  
+  char rev[21]; // Char array to hold to theNum (reversed order)
+  char fwd[21]; // Char array to hold to theNum (correct order)
+  unsigned int i = 0;
+  if (theNum == 0ULL) // if theNum is zero, set fwd to "0"
+  {
+    fwd[0] = '0';
+    fwd[1] = 0; // mark the end with a NULL
+  }
+  else
+  {
+    while (theNum > 0)
+    {
+      rev[i++] = (theNum % 10) + '0'; // divide by 10, convert the remainder to char
+      theNum /= 10; // divide by 10
+    }
+    unsigned int j = 0;
+    while (i > 0)
+    {
+      fwd[j++] = rev[--i]; // reverse the order
+      fwd[j] = 0; // mark the end with a NULL
+    }
+  }
+
+  Serial.print(fwd);
+}
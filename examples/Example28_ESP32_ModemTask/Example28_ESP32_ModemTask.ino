@@ -0,0 +1,233 @@
+/*!
+ * @file Example28_ESP32_ModemTask.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Give the modem its own FreeRTOS task with a SWARM_M138_Modem_Task
+ *   Queue messages from two tasks at once - without mutexes - through the lock-free TX rings
+ *   Consume the $TD SENT, $RD and $M138 events in loop() - waking only when an event arrives
+ * 
+ * The sensor task queues a reading every 15 minutes. The status task queues the free heap every hour.
+ * Neither task ever waits for the modem: submit returns straight away.
+ * 
+ * This example is written for the SparkFun Thing Plus C but can be adapted for any ESP32 board.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Modem_Task.h>
+
+SWARM_M138 mySwarm;
+
+#if defined(ARDUINO_ESP32_DEV)
+// If you are using the ESP32 Dev Module board definition, you need to create the HardwareSerial manually:
+#pragma message "Using HardwareSerial for M138 communication - on ESP32 Dev Module"
+HardwareSerial swarmSerial(2); //TX on 17, RX on 16
+#else
+// Serial1 is supported by the new SparkFun ESP32 Thing Plus C board definition
+#pragma message "Using Serial1 for M138 communication"
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+#endif
+
+SWARM_M138_Modem_Task modemTask;
+
+#define sensorProducer 0 // Each task which submits messages needs its own producer index
+#define statusProducer 1
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// The sensor task: queue a reading every 15 minutes
+void sensorTask(void *parameter)
+{
+  uint32_t readingCount = 0;
+  for (;;)
+  {
+    uint8_t reading[4];
+    int16_t temperature = (int16_t)(temperatureRead() * 100.0); // Use the ESP32's internal temperature sensor as a stand-in for a real sensor
+    reading[0] = (uint8_t)(readingCount >> 8);
+    reading[1] = (uint8_t)readingCount;
+    reading[2] = (uint8_t)(temperature >> 8);
+    reading[3] = (uint8_t)temperature;
+
+    Swarm_M138_Tx_Descriptor_t message;
+    message.data = reading; // submit copies the data
+    message.len = sizeof(reading);
+    message.useAppID = true;
+    message.appID = 1;
+    message.hold = 0;
+    message.epoch = 0;
+
+    if (!modemTask.submit(sensorProducer, &message, readingCount)) // The tag is the reading count
+      Serial.println(F("Sensor task: the TX ring is full"));
+    readingCount++;
+
+    vTaskDelay(pdMS_TO_TICKS(15 * 60 * 1000));
+  }
+}
+
+// The status task: queue the free heap every hour
+void statusTask(void *parameter)
+{
+  for (;;)
+  {
+    char status[32];
+    snprintf(status, sizeof(status), "Free heap %u", (unsigned int)ESP.getFreeHeap());
+
+    Swarm_M138_Tx_Descriptor_t message;
+    message.data = (const uint8_t *)status;
+    message.len = strlen(status);
+    message.useAppID = true;
+    message.appID = 2;
+    message.hold = 0;
+    message.epoch = 0;
+
+    if (!modemTask.submit(statusProducer, &message, 0xFFFFFFFF)) // Tag the status messages differently
+      Serial.println(F("Status task: the TX ring is full"));
+
+    vTaskDelay(pdMS_TO_TICKS(60 * 60 * 1000));
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm Modem Task"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  modemTask.begin(mySwarm); // From now on, only the modem task talks to mySwarm
+  modemTask.setConsumerTask(xTaskGetCurrentTaskHandle()); // Wake loop() when an event arrives
+  if (!modemTask.start())
+  {
+    Serial.println(F("Could not start the modem task. Freezing..."));
+    while (1)
+      ;
+  }
+
+  xTaskCreate(sensorTask, "sensor", 4096, NULL, 1, NULL);
+  xTaskCreate(statusTask, "status", 4096, NULL, 1, NULL);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Sleep until the modem task adds an event
+
+  Swarm_M138_Task_Event_t event;
+  while (modemTask.getEvent(&event)) // Consume every waiting event
+  {
+    switch (event.type)
+    {
+    case SWARM_M138_TASK_EVENT_TX_QUEUED:
+      if (event.err == SWARM_M138_SUCCESS)
+      {
+        Serial.print(F("Queued message "));
+        Serial.print(event.tag);
+        Serial.print(F(". ID: "));
+        serialPrintUint64_t(event.msg_id);
+        Serial.println();
+      }
+      else
+      {
+        Serial.print(F("Could not queue message "));
+        Serial.print(event.tag);
+        Serial.print(F(": "));
+        Serial.println(mySwarm.modemErrorString(event.err)); // modemErrorString only converts the error: it is safe to call from any task
+      }
+      break;
+    case SWARM_M138_TASK_EVENT_TX_SENT:
+      Serial.print(F("Sent message ID: "));
+      serialPrintUint64_t(event.msg_id);
+      Serial.print(F(" RSSI: "));
+      Serial.println(event.rssi);
+      break;
+    case SWARM_M138_TASK_EVENT_RX_DATA:
+      Serial.print(F("Received "));
+      Serial.print(event.len);
+      Serial.println(F(" bytes"));
+      break;
+    case SWARM_M138_TASK_EVENT_MODEM_STATUS:
+      Serial.print(F("Modem status: "));
+      Serial.print(mySwarm.modemStatusString(event.modemStatus));
+      Serial.print(F(" "));
+      Serial.println((const char *)event.data);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (modemTask.getEventsDropped() > 0)
+  {
+    Serial.print(F("Events dropped: "));
+    Serial.println(modemTask.getEventsDropped());
+  }
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void serialPrintUint64_t(uint64_t theNum)
+{
+  // Convert uint64_t to string
+  // Based on printLLNumber by robtillaart
+  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
+  
+  char rev[21]; // Char array to hold to theNum (reversed order)
+  char fwd[21]; // Char array to hold to theNum (correct order)
+  unsigned int i = 0;
+  if (theNum == 0ULL) // if theNum is zero, set fwd to "0"
+  {
+    fwd[0] = '0';
+    fwd[1] = 0; // mark the end with a NULL
+  }
+  else
+  {
+    while (theNum > 0)
+    {
+      rev[i++] = (theNum % 10) + '0'; // divide by 10, convert the remainder to char
+      theNum /= 10; // divide by 10
+    }
+    unsigned int j = 0;
+    while (i > 0)
+    {
+      fwd[j++] = rev[--i]; // reverse the order
+      fwd[j] = 0; // mark the end with a NULL
+    }
+  }
+
+  Serial.print(fwd);
+}
@@ -0,0 +1,134 @@
+/*!
+ * @file Example29_ContextCallbacks.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Use the callbacks with a context - so one set of functions can serve several modems
+ *   Keep the state of each modem in its own object - with no globals and no per-modem trampolines
+ * 
+ * The example uses two modems on Serial1 and Serial2. Remove or change the modems (and ports) to match your setup.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+
+// Everything we want to know about one modem
+class ModemMonitor
+{
+public:
+  ModemMonitor(const char *name) { _name = name; }
+
+  SWARM_M138 modem;
+  const char *_name;
+  uint32_t sentCount = 0;
+  int16_t lastRSSI = 0;
+
+  void print(void)
+  {
+    Serial.print(_name);
+    Serial.print(F(": "));
+  }
+};
+
+ModemMonitor modem1("Modem 1");
+ModemMonitor modem2("Modem 2");
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Callback: messageSent will be called when a $TD SENT message arrives from either modem.
+// context points to the ModemMonitor of the modem which sent the message. The values are passed directly - no pointers
+void messageSent(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context)
+{
+  ModemMonitor *monitor = (ModemMonitor *)context;
+  monitor->sentCount++;
+  monitor->lastRSSI = rssi_sat;
+
+  monitor->print();
+  Serial.print(F("message sent. RSSI = "));
+  Serial.print(rssi_sat);
+  Serial.print(F("  SNR = "));
+  Serial.print(snr);
+  Serial.print(F("  Sent so far: "));
+  Serial.println(monitor->sentCount);
+}
+
+// Callback: dateTime will be called when a $DT message arrives from either modem. The struct is passed by const reference
+void dateTime(const Swarm_M138_DateTimeData_t &dateTime, void *context)
+{
+  ModemMonitor *monitor = (ModemMonitor *)context;
+  monitor->print();
+  Serial.print(F("the date and time is "));
+  Serial.print(dateTime.YYYY);
+  Serial.print(F("/"));
+  if (dateTime.MM < 10) Serial.print(F("0"));
+  Serial.print(dateTime.MM);
+  Serial.print(F("/"));
+  if (dateTime.DD < 10) Serial.print(F("0"));
+  Serial.print(dateTime.DD);
+  Serial.print(F(" "));
+  if (dateTime.hh < 10) Serial.print(F("0"));
+  Serial.print(dateTime.hh);
+  Serial.print(F(":"));
+  if (dateTime.mm < 10) Serial.print(F("0"));
+  Serial.print(dateTime.mm);
+  Serial.print(F(":"));
+  if (dateTime.ss < 10) Serial.print(F("0"));
+  Serial.println(dateTime.ss);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm Context Callbacks"));
+  Serial.println();
+
+  bool ok = modem1.modem.begin(Serial1);
+  ok &= modem2.modem.begin(Serial2);
+  if (!ok)
+  {
+    Serial.println(F("Could not communicate with both modems. Please check the serial connections. Freezing..."));
+    while (1)
+      ;
+  }
+
+  // The same functions serve both modems. The context tells them which modem called
+  modem1.modem.setTransmitDataCallback(&messageSent, &modem1);
+  modem2.modem.setTransmitDataCallback(&messageSent, &modem2);
+  modem1.modem.setDateTimeCallback(&dateTime, &modem1);
+  modem2.modem.setDateTimeCallback(&dateTime, &modem2);
+
+  // Ask each modem for the date and time every minute
+  modem1.modem.setDateTimeRate(60);
+  modem2.modem.setDateTimeRate(60);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  modem1.modem.checkUnsolicitedMsg(); // The callbacks are called from here
+  modem2.modem.checkUnsolicitedMsg();
+}
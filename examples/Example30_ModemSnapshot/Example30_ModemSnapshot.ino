@@ -0,0 +1,177 @@
+/*!
+ * @file Example30_ModemSnapshot.ino
+ * 
+ * @mainpage SparkFun Swarm Satellite Arduino Library
+ * 
+ * @section intro_sec Examples
+ * 
+ * This example shows how to:
+ *   Read the state of the modem - date/time, position, GPS fix quality, power status, GPS jamming, receive test and the message counts - in one call
+ *   Check which fields were read successfully
+ * 
+ * getModemSnapshot sends the queries back to back, sharing one response buffer. It is much quicker than calling the get methods one at a time.
+ * 
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * SparkX Swarm Serial Breakout : https://www.sparkfun.com/products/19236
+ * 
+ * @section author Author
+ * 
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * February 2022
+ * 
+ * @section license License
+ * 
+ * MIT: please see LICENSE.md for the full license information
+ * 
+ */
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+
+SWARM_M138 mySwarm;
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+
+void setup()
+{
+  delay(1000);
+  
+  Serial.begin(115200);
+  while (!Serial)
+    ; // Wait for the user to open the Serial console
+  Serial.println(F("Example : Swarm Modem Snapshot"));
+  Serial.println();
+
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+}
+
+void loop()
+{
+  Swarm_M138_Modem_Snapshot_t snapshot;
+
+  unsigned long startTime = millis();
+
+  // Read everything. Use (e.g.) SWARM_M138_SNAPSHOT_POWER_STATUS | SWARM_M138_SNAPSHOT_UNSENT_COUNT to read only some of the fields
+  Swarm_M138_Error_e err = mySwarm.getModemSnapshot(&snapshot);
+
+  Serial.print(F("getModemSnapshot took "));
+  Serial.print(millis() - startTime);
+  Serial.println(F(" ms"));
+
+  if (err != SWARM_M138_ERROR_SUCCESS)
+  {
+    Serial.print(F("getModemSnapshot returned: "));
+    Serial.print(err);
+    Serial.print(F(" : "));
+    Serial.print(mySwarm.modemErrorString(err)); // Convert the error into printable text
+    if (err == SWARM_M138_ERROR_ERR) // If we received a command error (ERR), print it
+    {
+      Serial.print(F(" : "));
+      Serial.print(mySwarm.commandError); 
+      Serial.print(F(" : "));
+      Serial.println(mySwarm.commandErrorString((const char *)mySwarm.commandError)); 
+    }
+    else
+      Serial.println();
+  }
+
+  // The fields which were read successfully have their bit set in snapshot.valid
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_DATE_TIME)
+  {
+    Serial.print(F("Date/time: "));
+    Serial.print(snapshot.dateTime.YYYY);
+    Serial.print(F("/"));
+    if (snapshot.dateTime.MM < 10) Serial.print(F("0"));
+    Serial.print(snapshot.dateTime.MM);
+    Serial.print(F("/"));
+    if (snapshot.dateTime.DD < 10) Serial.print(F("0"));
+    Serial.print(snapshot.dateTime.DD);
+    Serial.print(F(" "));
+    if (snapshot.dateTime.hh < 10) Serial.print(F("0"));
+    Serial.print(snapshot.dateTime.hh);
+    Serial.print(F(":"));
+    if (snapshot.dateTime.mm < 10) Serial.print(F("0"));
+    Serial.print(snapshot.dateTime.mm);
+    Serial.print(F(":"));
+    if (snapshot.dateTime.ss < 10) Serial.print(F("0"));
+    Serial.println(snapshot.dateTime.ss);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_GEOSPATIAL)
+  {
+    Serial.print(F("Latitude (degrees * 10^-6): "));
+    Serial.print(snapshot.geospatial.lat);
+    Serial.print(F("  Longitude (degrees * 10^-6): "));
+    Serial.print(snapshot.geospatial.lon);
+    Serial.print(F("  Altitude (m): "));
+    Serial.println(snapshot.geospatial.alt);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_GPS_FIX_QUALITY)
+  {
+    Serial.print(F("HDOP: "));
+    Serial.print(snapshot.gpsFixQuality.hdop);
+    Serial.print(F("  Satellites: "));
+    Serial.println(snapshot.gpsFixQuality.gnss_sats);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_POWER_STATUS)
+  {
+    Serial.print(F("CPU voltage (mV): "));
+    Serial.print(snapshot.powerStatus.cpu_millivolts);
+    Serial.print(F("  CPU temperature (C * 10^-3): "));
+    Serial.println(snapshot.powerStatus.temp_millidegrees);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_GPS_JAMMING)
+  {
+    Serial.print(F("GPS jamming level: "));
+    Serial.println(snapshot.gpsJamming.jamming_level);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_RECEIVE_TEST)
+  {
+    if (snapshot.receiveTest.background)
+    {
+      Serial.print(F("Background RSSI (dBm): "));
+      Serial.println(snapshot.receiveTest.rssi_background);
+    }
+    else
+    {
+      Serial.print(F("Satellite RSSI (dBm): "));
+      Serial.println(snapshot.receiveTest.rssi_sat);
+    }
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_RX_COUNT)
+  {
+    Serial.print(F("Received messages: "));
+    Serial.println(snapshot.rxCount);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_RX_UNREAD_COUNT)
+  {
+    Serial.print(F("Unread messages: "));
+    Serial.println(snapshot.rxUnreadCount);
+  }
+
+  if (snapshot.valid & SWARM_M138_SNAPSHOT_UNSENT_COUNT)
+  {
+    Serial.print(F("Unsent messages: "));
+    Serial.println(snapshot.unsentCount);
+  }
+
+  Serial.println();
+
+  delay(60000); // Take a snapshot once per minute
+}
@@ -0,0 +1,278 @@
+/*
+  Sleep the modem between satellite passes - and wake it just before the next one
+  By: SparkFun Electronics / Paul Clark
+  Date: August 1st, 2022
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  This example shows how to use the library's power scheduler: SWARM_M138_Power_Scheduler.
+  
+  It uses the CelesTrak Two-Line Element data collected by: Example2_ESP32_Get_My_Swarm_TLEs
+  The TLEs are parsed once, in setup. The pass predictor builds a table of the passes over the next six hours.
+  A message is queued every hour. The scheduler keeps the modem awake while there are unsent messages
+  and a pass is imminent. Otherwise it puts the modem to sleep until just before the next pass.
+  When there is nothing to send, the modem sleeps for up to an hour at a time.
+  The estimated energy per delivered message is printed when the modem wakes.
+  
+  ** If you have enjoyed this code, please consider making a donation to CelesTrak: https://celestrak.org/ **
+
+  This example is written for the SparkFun Thing Plus C but can be adapted for any ESP32 board.
+
+  If the SD card is not detected ("Card Mount Failed"), try adding a 10K pull-up resistor between 19/POCI and 3V3.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  SparkFun Thing Plus C - ESP32 WROOM
+
+*/
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Pass_Predictor.h>
+#include <SparkFun_Swarm_M138_Power_Scheduler.h>
+
+SWARM_M138 mySwarm;
+
+#if defined(ARDUINO_ESP32_DEV)
+// If you are using the ESP32 Dev Module board definition, you need to create the HardwareSerial manually:
+#pragma message "Using HardwareSerial for M138 communication - on ESP32 Dev Module"
+HardwareSerial swarmSerial(2); //TX on 17, RX on 16
+#else
+// Serial1 is supported by the new SparkFun ESP32 Thing Plus C board definition
+#pragma message "Using Serial1 for M138 communication"
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+#endif
+
+// If you are using the Swarm Satellite Transceiver MicroMod Function Board:
+//
+// The Function Board has an onboard power switch which controls the power to the modem.
+// The power is disabled by default.
+// To enable the power, you need to pull the correct PWR_EN pin high.
+//
+// Uncomment and adapt a line to match your Main Board and Processor configuration:
+//#define swarmPowerEnablePin A1 // MicroMod Main Board Single (DEV-18575) : with a Processor Board that supports A1 as an output
+//#define swarmPowerEnablePin 39 // MicroMod Main Board Single (DEV-18575) : with e.g. the Teensy Processor Board using pin 39 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin 4  // MicroMod Main Board Single (DEV-18575) : with e.g. the Artemis Processor Board using pin 4 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin G5 // MicroMod Main Board Double (DEV-18576) : Slot 0 with the ALT_PWR_EN0 set to G5<->PWR_EN0
+//#define swarmPowerEnablePin G6 // MicroMod Main Board Double (DEV-18576) : Slot 1 with the ALT_PWR_EN1 set to G6<->PWR_EN1
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+SWARM_M138_Pass_Predictor predictor;
+
+#define maxSatellites 200 // Storage for the orbital elements: 72 bytes each
+Swarm_M138_Orbital_Elements_t satellites[maxSatellites];
+uint16_t numSatellites = 0;
+
+#define tableDuration 21600 // Predict the passes over the next six hours
+
+SWARM_M138_Power_Scheduler scheduler;
+
+#define messageInterval 3600 // Queue a message every hour
+uint32_t lastMessage = 0;
+
+// Approximate modem supply current - check the M138 datasheet for your configuration
+#define awakeCurrent_mA 26.0 // Receiving. Transmit bursts are short and are not included
+#define sleepCurrent_mA 0.03
+#define supplyVoltage 3.3
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <FS.h>
+#include <SD.h>
+#include <SPI.h>
+
+#define sd_cs SS // microSD chip select - this should work on most boards
+//const int sd_cs = 5; //Uncomment this line to define a specific pin for the chip select (e.g. pin 5 on the Thing Plus C)
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  // Swarm Satellite Transceiver MicroMod Function Board PWR_EN
+  #ifdef swarmPowerEnablePin
+  pinMode(swarmPowerEnablePin, OUTPUT); // Enable modem power 
+  digitalWrite(swarmPowerEnablePin, HIGH);
+  #endif
+
+  delay(1000);
+
+  Serial.begin(115200);
+  Serial.println(F("Example : Swarm power scheduler"));
+
+  while (Serial.available()) Serial.read(); // Empty the serial buffer
+  Serial.println(F("Press any key to begin..."));
+  while (!Serial.available()); // Wait for a keypress
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Begin the SD card and parse the TLEs - once
+  
+  if (!SD.begin(sd_cs)) {
+    Serial.println("Card Mount Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  File tleFile = SD.open("/mySwmTLE.txt", FILE_READ);
+
+  if (!tleFile) {
+    Serial.println("File Open Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  while (numSatellites < maxSatellites)
+  {
+    char satelliteName[30]; // Read and discard the satellite name
+    int satNameLength = tleFile.readBytesUntil('\n', (char *)satelliteName, 29);
+
+    char lineOne[75]; // Read line one
+    int lineOneLength = tleFile.readBytesUntil('\n', (char *)lineOne, 74);
+    lineOne[lineOneLength] = 0; // Null-terminate the line
+
+    char lineTwo[75]; // Read line two
+    int lineTwoLength = tleFile.readBytesUntil('\n', (char *)lineTwo, 74);
+    lineTwo[lineTwoLength] = 0; // Null-terminate the line
+
+    if ((satNameLength == 0) || (lineOneLength < 69) || (lineTwoLength < 69))
+      break; // End of file
+
+    if (SWARM_M138_Pass_Predictor::parseTLE(lineOne, lineTwo, &satellites[numSatellites]))
+      numSatellites++;
+    else
+      Serial.println(F("Invalid TLE! Skipping..."));
+  }
+
+  tleFile.close();
+
+  Serial.print(F("Parsed the TLEs for "));
+  Serial.print(numSatellites);
+  Serial.println(F(" satellites"));
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Wait for the modem to get a GPS fix
+  
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  Swarm_M138_GeospatialData_t info;
+  while (mySwarm.getGeospatialInfo(&info) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS fix..."));
+    delay(2000);
+  }
+
+  predictor.setSite(&info); // Set the site latitude, longitude and altitude
+  predictor.setMinimumElevation(15.0); // Passes lower than 15 degrees are ignored
+
+  buildTable();
+
+  scheduler.begin(mySwarm, predictor);
+  scheduler.setWakeLead(60); // Wake one minute before AOS
+  scheduler.setMinimumSleep(120); // Do not sleep for less than two minutes
+  scheduler.setMaximumSleep(3600); // Wake at least once an hour
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  Swarm_M138_Scheduler_State_e previousState = scheduler.getState();
+
+  Swarm_M138_Scheduler_State_e state = scheduler.poll(); // Poll the modem and put it to sleep when it can
+
+  if (state == SWARM_M138_SCHEDULER_SLEEPING)
+  {
+    if (previousState != SWARM_M138_SCHEDULER_SLEEPING)
+    {
+      Serial.print(F("Modem is asleep. Unsent messages: "));
+      Serial.print(scheduler.getUnsentCount());
+      Serial.print(F(". Waking at: "));
+      Serial.println(scheduler.getWakeTime());
+    }
+  }
+  else if (state == SWARM_M138_SCHEDULER_AWAKE)
+  {
+    if (previousState == SWARM_M138_SCHEDULER_SLEEPING)
+    {
+      Serial.println(F("Modem is awake"));
+      printEnergy();
+    }
+
+    // The modem is awake: we can send it commands
+
+    Swarm_M138_DateTimeData_t dateTime;
+    if (mySwarm.getDateTime(&dateTime, 60000) == SWARM_M138_SUCCESS) // Use the cached $DT if it is less than 60 seconds old
+    {
+      uint32_t now = SWARM_M138_Pass_Predictor::dateTimeToUnix(&dateTime);
+
+      Swarm_M138_Pass_t pass;
+      if ((now >= predictor.getTableEnd()) || (!predictor.getNextPass(now, &pass))) // Has the table been used up?
+        buildTable();
+
+      if ((now - lastMessage) >= messageInterval)
+      {
+        uint64_t id;
+        if (mySwarm.transmitText("Hello from the power scheduler", &id) == SWARM_M138_SUCCESS)
+        {
+          Serial.println(F("Message queued"));
+          scheduler.messageQueued(); // Make sure the modem stays awake for the next pass
+          lastMessage = now;
+        }
+      }
+    }
+  }
+
+  delay(1000);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Build the pass table, starting now
+void buildTable()
+{
+  Swarm_M138_DateTimeData_t dateTime;
+  while (mySwarm.getDateTime(&dateTime) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS date/time reference..."));
+    delay(2000);
+  }
+
+  uint16_t numPasses = predictor.computePasses(satellites, numSatellites, &dateTime, tableDuration);
+
+  Serial.print(F("Found "));
+  Serial.print(numPasses);
+  Serial.println(F(" passes"));
+}
+
+// Print the estimated modem energy per delivered message
+void printEnergy()
+{
+  float awakeHours = ((float)scheduler.getAwakeSeconds()) / 3600.0;
+  float sleepHours = ((float)scheduler.getSleepSeconds()) / 3600.0;
+  float energy_mWh = ((awakeHours * awakeCurrent_mA) + (sleepHours * sleepCurrent_mA)) * supplyVoltage;
+  uint32_t delivered = scheduler.getMessagesDelivered();
+
+  Serial.print(F("Awake: "));
+  Serial.print(scheduler.getAwakeSeconds());
+  Serial.print(F("s  Asleep: "));
+  Serial.print(scheduler.getSleepSeconds());
+  Serial.print(F("s  Energy: "));
+  Serial.print(energy_mWh, 2);
+  Serial.print(F("mWh  Delivered: "));
+  Serial.print(delivered);
+  if (delivered > 0)
+  {
+    Serial.print(F("  Energy per message: "));
+    Serial.print(energy_mWh / (float)delivered, 3);
+    Serial.print(F("mWh"));
+  }
+  Serial.println();
+}
@@ -0,0 +1,314 @@
+/*
+  Convert the Swarm TLEs into a compact binary image - and predict the passes straight from it
+  By: SparkFun Electronics / Paul Clark
+  Date: August 2nd, 2022
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  This example shows how to use the library's binary TLE store: SWARM_M138_TLE_Store.
+  
+  It uses the CelesTrak Two-Line Element data collected by: Example2_ESP32_Get_My_Swarm_TLEs
+  The first time it runs, the text TLEs are parsed and converted into a binary image: /mySwmTLE.bin
+  After that, no text is parsed: the image is read straight from the SD card, one 40-byte record at a time.
+  A satellite can be looked up by NORAD ID without loading the whole constellation into RAM.
+  
+  The image can also be printed as a PROGMEM array - for boards without an SD card - or written
+  to an ESP32 data partition and read with SWARM_M138_TLE_Partition_Source.
+  Delete /mySwmTLE.bin (or set rebuildImage to true) after downloading new TLEs.
+  
+  ** If you have enjoyed this code, please consider making a donation to CelesTrak: https://celestrak.org/ **
+
+  This example is written for the SparkFun Thing Plus C but can be adapted for any ESP32 board.
+
+  If the SD card is not detected ("Card Mount Failed"), try adding a 10K pull-up resistor between 19/POCI and 3V3.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  SparkFun Thing Plus C - ESP32 WROOM
+
+*/
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Pass_Predictor.h>
+#include <SparkFun_Swarm_M138_TLE_Store.h>
+
+SWARM_M138 mySwarm;
+
+#if defined(ARDUINO_ESP32_DEV)
+// If you are using the ESP32 Dev Module board definition, you need to create the HardwareSerial manually:
+#pragma message "Using HardwareSerial for M138 communication - on ESP32 Dev Module"
+HardwareSerial swarmSerial(2); //TX on 17, RX on 16
+#else
+// Serial1 is supported by the new SparkFun ESP32 Thing Plus C board definition
+#pragma message "Using Serial1 for M138 communication"
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+#endif
+
+// If you are using the Swarm Satellite Transceiver MicroMod Function Board:
+//
+// The Function Board has an onboard power switch which controls the power to the modem.
+// The power is disabled by default.
+// To enable the power, you need to pull the correct PWR_EN pin high.
+//
+// Uncomment and adapt a line to match your Main Board and Processor configuration:
+//#define swarmPowerEnablePin A1 // MicroMod Main Board Single (DEV-18575) : with a Processor Board that supports A1 as an output
+//#define swarmPowerEnablePin 39 // MicroMod Main Board Single (DEV-18575) : with e.g. the Teensy Processor Board using pin 39 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin 4  // MicroMod Main Board Single (DEV-18575) : with e.g. the Artemis Processor Board using pin 4 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin G5 // MicroMod Main Board Double (DEV-18576) : Slot 0 with the ALT_PWR_EN0 set to G5<->PWR_EN0
+//#define swarmPowerEnablePin G6 // MicroMod Main Board Double (DEV-18576) : Slot 1 with the ALT_PWR_EN1 set to G6<->PWR_EN1
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+SWARM_M138_Pass_Predictor predictor;
+
+SWARM_M138_TLE_Store store;
+
+File imageFile; // The image file must stay open while the store is in use
+SWARM_M138_TLE_File_Source imageSource(&imageFile);
+
+#define maxSatellites 200 // Storage for the orbital elements - only needed while the image is being built
+
+#define rebuildImage false // Change this to true to rebuild the image from the text TLEs
+#define printProgmemArray false // Change this to true to print the image as a PROGMEM array
+
+#define tableDuration 7200 // Predict the passes over the next two hours
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <FS.h>
+#include <SD.h>
+#include <SPI.h>
+
+#define sd_cs SS // microSD chip select - this should work on most boards
+//const int sd_cs = 5; //Uncomment this line to define a specific pin for the chip select (e.g. pin 5 on the Thing Plus C)
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  // Swarm Satellite Transceiver MicroMod Function Board PWR_EN
+  #ifdef swarmPowerEnablePin
+  pinMode(swarmPowerEnablePin, OUTPUT); // Enable modem power 
+  digitalWrite(swarmPowerEnablePin, HIGH);
+  #endif
+
+  delay(1000);
+
+  Serial.begin(115200);
+  Serial.println(F("Example : Swarm binary TLE store"));
+
+  while (Serial.available()) Serial.read(); // Empty the serial buffer
+  Serial.println(F("Press any key to begin..."));
+  while (!Serial.available()); // Wait for a keypress
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Begin the SD card. Build the image if required
+
+  if (!SD.begin(sd_cs)) {
+    Serial.println("Card Mount Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  if (rebuildImage || !SD.exists("/mySwmTLE.bin"))
+    buildImage();
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Open the image. Only the header is read
+
+  unsigned long startMillis = millis();
+
+  imageFile = SD.open("/mySwmTLE.bin", FILE_READ);
+
+  if ((!imageFile) || (!store.begin(imageSource))) {
+    Serial.println("Image Open Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  Serial.print(F("Opened the image in "));
+  Serial.print(millis() - startMillis);
+  Serial.print(F(" ms. It holds "));
+  Serial.print(store.getCount());
+  Serial.println(F(" satellites"));
+
+  if (!store.verify()) // Optional: check the CRC. This reads the whole image
+    Serial.println(F("The image is corrupt! Set rebuildImage to true to rebuild it"));
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Look up the first satellite by NORAD ID
+
+  Swarm_M138_Orbital_Elements_t elements;
+  if (store.getElements(0, &elements))
+  {
+    uint32_t noradID = elements.noradID;
+
+    unsigned long startMicros = micros();
+    bool found = store.find(noradID, &elements);
+    unsigned long findMicros = micros() - startMicros;
+
+    Serial.print(F("Looked up NORAD "));
+    Serial.print(noradID);
+    Serial.print(found ? F(" in ") : F(" - not found - in "));
+    Serial.print(findMicros);
+    Serial.print(F(" us. Mean motion: "));
+    Serial.print(elements.meanMotion, 8);
+    Serial.println(F(" revs per day"));
+  }
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Wait for the modem to get a GPS fix
+  
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  Swarm_M138_GeospatialData_t info;
+  while (mySwarm.getGeospatialInfo(&info) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS fix..."));
+    delay(2000);
+  }
+
+  predictor.setSite(&info); // Set the site latitude, longitude and altitude
+  predictor.setMinimumElevation(15.0); // Passes lower than 15 degrees are ignored
+
+  buildTable();
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  Swarm_M138_DateTimeData_t dateTime;
+  if (mySwarm.getDateTime(&dateTime, 5000) == SWARM_M138_SUCCESS) // Use the cached $DT if it is less than 5 seconds old
+  {
+    uint32_t now = SWARM_M138_Pass_Predictor::dateTimeToUnix(&dateTime);
+    Swarm_M138_Pass_t pass;
+
+    if ((now >= predictor.getTableEnd()) || (!predictor.getNextPass(now, &pass))) // Has the table been used up?
+    {
+      buildTable();
+    }
+    else if (pass.aos > now)
+    {
+      Serial.print(F("Next pass: NORAD "));
+      Serial.print(pass.noradID);
+      Serial.print(F(". AOS in "));
+      Serial.print(pass.aos - now);
+      Serial.println(F(" seconds"));
+    }
+  }
+
+  delay(10000);
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Parse the text TLEs and write the binary image
+void buildImage()
+{
+  File tleFile = SD.open("/mySwmTLE.txt", FILE_READ);
+
+  if (!tleFile) {
+    Serial.println("File Open Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  Swarm_M138_Orbital_Elements_t *satellites = new Swarm_M138_Orbital_Elements_t[maxSatellites]; // 72 bytes each
+  uint16_t numSatellites = 0;
+
+  while (numSatellites < maxSatellites)
+  {
+    char satelliteName[30]; // Read and discard the satellite name
+    int satNameLength = tleFile.readBytesUntil('\n', (char *)satelliteName, 29);
+
+    char lineOne[75]; // Read line one
+    int lineOneLength = tleFile.readBytesUntil('\n', (char *)lineOne, 74);
+    lineOne[lineOneLength] = 0; // Null-terminate the line
+
+    char lineTwo[75]; // Read line two
+    int lineTwoLength = tleFile.readBytesUntil('\n', (char *)lineTwo, 74);
+    lineTwo[lineTwoLength] = 0; // Null-terminate the line
+
+    if ((satNameLength == 0) || (lineOneLength < 69) || (lineTwoLength < 69))
+      break; // End of file
+
+    if (SWARM_M138_Pass_Predictor::parseTLE(lineOne, lineTwo, &satellites[numSatellites]))
+      numSatellites++;
+    else
+      Serial.println(F("Invalid TLE! Skipping..."));
+  }
+
+  tleFile.close();
+
+  uint32_t imageSize = SWARM_M138_TLE_Store::getImageSize(numSatellites);
+  uint8_t *image = new uint8_t[imageSize];
+
+  SWARM_M138_TLE_Store::buildImage(satellites, numSatellites, image, imageSize);
+
+  delete[] satellites;
+
+  File binFile = SD.open("/mySwmTLE.bin", FILE_WRITE);
+  if (binFile)
+  {
+    binFile.write(image, imageSize);
+    binFile.close();
+  }
+
+  Serial.print(F("Converted "));
+  Serial.print(numSatellites);
+  Serial.print(F(" TLEs into a "));
+  Serial.print(imageSize);
+  Serial.println(F(" byte image"));
+
+  if (printProgmemArray) // Copy and paste this into your code. Use it with SWARM_M138_TLE_Memory_Source(swarmTLEImage, sizeof(swarmTLEImage), true)
+  {
+    Serial.println(F("const uint8_t swarmTLEImage[] PROGMEM = {"));
+    for (uint32_t i = 0; i < imageSize; i++)
+    {
+      if ((i % 16) == 0)
+        Serial.print(F("  "));
+      Serial.print(F("0x"));
+      if (image[i] < 0x10)
+        Serial.print(F("0"));
+      Serial.print(image[i], HEX);
+      if (i < (imageSize - 1))
+        Serial.print(F(","));
+      if (((i % 16) == 15) || (i == (imageSize - 1)))
+        Serial.println();
+    }
+    Serial.println(F("};"));
+  }
+
+  delete[] image;
+}
+
+// Build the pass table, starting now. The elements are read from the image one record at a time
+void buildTable()
+{
+  Swarm_M138_DateTimeData_t dateTime;
+  while (mySwarm.getDateTime(&dateTime) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS date/time reference..."));
+    delay(2000);
+  }
+
+  unsigned long startMillis = millis();
+  uint16_t numPasses = predictor.computePasses(store, &dateTime, tableDuration);
+  unsigned long computeMillis = millis() - startMillis;
+
+  Serial.print(F("Found "));
+  Serial.print(numPasses);
+  Serial.print(F(" passes in "));
+  Serial.print(computeMillis);
+  Serial.println(F(" ms"));
+}
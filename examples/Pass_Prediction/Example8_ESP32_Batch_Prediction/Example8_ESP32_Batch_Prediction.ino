@@ -0,0 +1,236 @@
+/*
+  Predict the passes of the whole Swarm constellation - stepping the satellites together
+  By: SparkFun Electronics / Paul Clark
+  Date: August 3rd, 2022
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  This example shows how to use the library's batch propagator: SWARM_M138_Batch_Propagator.
+  
+  It uses the CelesTrak Two-Line Element data collected by: Example2_ESP32_Get_My_Swarm_TLEs
+  The pass table is built twice: once one satellite at a time (as in Example5), and once with every
+  near-circular satellite stepped together in single precision. The two tables are compared.
+  On ESP32 the batch runs on the single-precision FPU: much faster than the double-precision (software) maths.
+  On a host with SSE2 or NEON, four satellites are stepped per instruction.
+  
+  ** If you have enjoyed this code, please consider making a donation to CelesTrak: https://celestrak.org/ **
+
+  This example is written for the SparkFun Thing Plus C but can be adapted for any ESP32 board.
+
+  If the SD card is not detected ("Card Mount Failed"), try adding a 10K pull-up resistor between 19/POCI and 3V3.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  SparkFun Thing Plus C - ESP32 WROOM
+
+*/
+
+#include <SparkFun_Swarm_Satellite_Arduino_Library.h> //Click here to get the library:  http://librarymanager/All#SparkFun_Swarm_Satellite
+#include <SparkFun_Swarm_M138_Pass_Predictor.h>
+#include <SparkFun_Swarm_M138_Batch_Propagator.h>
+
+SWARM_M138 mySwarm;
+
+#if defined(ARDUINO_ESP32_DEV)
+// If you are using the ESP32 Dev Module board definition, you need to create the HardwareSerial manually:
+#pragma message "Using HardwareSerial for M138 communication - on ESP32 Dev Module"
+HardwareSerial swarmSerial(2); //TX on 17, RX on 16
+#else
+// Serial1 is supported by the new SparkFun ESP32 Thing Plus C board definition
+#pragma message "Using Serial1 for M138 communication"
+#define swarmSerial Serial1 // Use Serial1 to communicate with the modem. Change this if required.
+#endif
+
+// If you are using the Swarm Satellite Transceiver MicroMod Function Board:
+//
+// The Function Board has an onboard power switch which controls the power to the modem.
+// The power is disabled by default.
+// To enable the power, you need to pull the correct PWR_EN pin high.
+//
+// Uncomment and adapt a line to match your Main Board and Processor configuration:
+//#define swarmPowerEnablePin A1 // MicroMod Main Board Single (DEV-18575) : with a Processor Board that supports A1 as an output
+//#define swarmPowerEnablePin 39 // MicroMod Main Board Single (DEV-18575) : with e.g. the Teensy Processor Board using pin 39 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin 4  // MicroMod Main Board Single (DEV-18575) : with e.g. the Artemis Processor Board using pin 4 (SDIO_DATA2) to control the power
+//#define swarmPowerEnablePin G5 // MicroMod Main Board Double (DEV-18576) : Slot 0 with the ALT_PWR_EN0 set to G5<->PWR_EN0
+//#define swarmPowerEnablePin G6 // MicroMod Main Board Double (DEV-18576) : Slot 1 with the ALT_PWR_EN1 set to G6<->PWR_EN1
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+SWARM_M138_Pass_Predictor predictor;
+
+#define maxSatellites 200 // Storage for the orbital elements: 72 bytes each
+Swarm_M138_Orbital_Elements_t satellites[maxSatellites];
+uint16_t numSatellites = 0;
+
+SWARM_M138_Batch_Propagator batch; // The batch workspace: about 16kB for SWARM_M138_BATCH_SIZE = 192 satellites
+
+#define tableDuration 7200 // Predict the passes over the next two hours
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <FS.h>
+#include <SD.h>
+#include <SPI.h>
+
+#define sd_cs SS // microSD chip select - this should work on most boards
+//const int sd_cs = 5; //Uncomment this line to define a specific pin for the chip select (e.g. pin 5 on the Thing Plus C)
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void setup()
+{
+  // Swarm Satellite Transceiver MicroMod Function Board PWR_EN
+  #ifdef swarmPowerEnablePin
+  pinMode(swarmPowerEnablePin, OUTPUT); // Enable modem power 
+  digitalWrite(swarmPowerEnablePin, HIGH);
+  #endif
+
+  delay(1000);
+
+  Serial.begin(115200);
+  Serial.println(F("Example : Swarm batch pass prediction"));
+
+  while (Serial.available()) Serial.read(); // Empty the serial buffer
+  Serial.println(F("Press any key to begin..."));
+  while (!Serial.available()); // Wait for a keypress
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Begin the SD card and parse the TLEs - once
+  
+  if (!SD.begin(sd_cs)) {
+    Serial.println("Card Mount Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  File tleFile = SD.open("/mySwmTLE.txt", FILE_READ);
+
+  if (!tleFile) {
+    Serial.println("File Open Failed! Freezing...");
+    while (1)
+      ;
+  }
+
+  while (numSatellites < maxSatellites)
+  {
+    char satelliteName[30]; // Read and discard the satellite name
+    int satNameLength = tleFile.readBytesUntil('\n', (char *)satelliteName, 29);
+
+    char lineOne[75]; // Read line one
+    int lineOneLength = tleFile.readBytesUntil('\n', (char *)lineOne, 74);
+    lineOne[lineOneLength] = 0; // Null-terminate the line
+
+    char lineTwo[75]; // Read line two
+    int lineTwoLength = tleFile.readBytesUntil('\n', (char *)lineTwo, 74);
+    lineTwo[lineTwoLength] = 0; // Null-terminate the line
+
+    if ((satNameLength == 0) || (lineOneLength < 69) || (lineTwoLength < 69))
+      break; // End of file
+
+    if (SWARM_M138_Pass_Predictor::parseTLE(lineOne, lineTwo, &satellites[numSatellites]))
+      numSatellites++;
+    else
+      Serial.println(F("Invalid TLE! Skipping..."));
+  }
+
+  tleFile.close();
+
+  Serial.print(F("Parsed the TLEs for "));
+  Serial.print(numSatellites);
+  Serial.println(F(" satellites"));
+
+  //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+  // Wait for the modem to get a GPS fix
+  
+  //mySwarm.enableDebugging(); // Uncomment this line to enable debug messages on Serial
+
+  bool modemBegun = mySwarm.begin(swarmSerial); // Begin communication with the modem
+  
+  while (!modemBegun) // If the begin failed, keep trying to begin communication with the modem
+  {
+    Serial.println(F("Could not communicate with the modem. It may still be booting..."));
+    delay(2000);
+    modemBegun = mySwarm.begin(swarmSerial);
+  }
+
+  Swarm_M138_GeospatialData_t info;
+  while (mySwarm.getGeospatialInfo(&info) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS fix..."));
+    delay(2000);
+  }
+
+  predictor.setSite(&info); // Set the site latitude, longitude and altitude
+  predictor.setMinimumElevation(15.0); // Passes lower than 15 degrees are ignored
+
+  buildTable();
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+void loop()
+{
+  delay(600000); // Rebuild the table every ten minutes
+
+  buildTable();
+}
+
+//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Build the pass table, starting now - one satellite at a time, and then as a batch
+void buildTable()
+{
+  Swarm_M138_DateTimeData_t dateTime;
+  while (mySwarm.getDateTime(&dateTime) != SWARM_M138_SUCCESS)
+  {
+    Serial.println(F("The modem may not have acquired a valid GPS date/time reference..."));
+    delay(2000);
+  }
+
+  uint32_t now = SWARM_M138_Pass_Predictor::dateTimeToUnix(&dateTime);
+
+  unsigned long startMillis = millis();
+  uint16_t numPasses = predictor.computePasses(satellites, numSatellites, now, tableDuration);
+  unsigned long scalarMillis = millis() - startMillis;
+
+  Swarm_M138_Pass_t firstPass;
+  bool haveFirstPass = predictor.getPass(0, &firstPass); // Keep the first pass - to compare
+
+  startMillis = millis();
+  uint16_t numBatchPasses = predictor.computePasses(batch, satellites, numSatellites, now, tableDuration);
+  unsigned long batchMillis = millis() - startMillis;
+
+  Serial.print(F("One at a time: "));
+  Serial.print(numPasses);
+  Serial.print(F(" passes in "));
+  Serial.print(scalarMillis);
+  Serial.println(F(" ms"));
+
+  Serial.print(F("Batch ("));
+  Serial.print(batch.getKernelName());
+  Serial.print(F(", "));
+  Serial.print(batch.getCount());
+  Serial.print(F(" of "));
+  Serial.print(numSatellites);
+  Serial.print(F(" satellites): "));
+  Serial.print(numBatchPasses);
+  Serial.print(F(" passes in "));
+  Serial.print(batchMillis);
+  Serial.println(F(" ms"));
+
+  Swarm_M138_Pass_t pass;
+  if (haveFirstPass && predictor.getPass(0, &pass))
+  {
+    Serial.print(F("First pass: NORAD "));
+    Serial.print(pass.noradID);
+    Serial.print(F(": AOS +"));
+    Serial.print((long)pass.aos - (long)now);
+    Serial.print(F("s (one at a time: +"));
+    Serial.print((long)firstPass.aos - (long)now);
+    Serial.print(F("s)  LOS +"));
+    Serial.print((long)pass.los - (long)now);
+    Serial.print(F("s (one at a time: +"));
+    Serial.print((long)firstPass.los - (long)now);
+    Serial.println(F("s)"));
+  }
+}
@@ -0,0 +1,213 @@
+/*!
+ * @file SparkFun_Swarm_M138_Batch_Propagator.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Batch_Propagator: step the near-circular satellites together.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Batch_Propagator.h"
+#include "SparkFun_Swarm_M138_TLE_Store.h"
+
+// The SWARM_M138_Batch_Propagator step kernel: four satellites at a time where the compiler provides the intrinsics.
+// Define SWARM_M138_BATCH_SCALAR to use the scalar kernel everywhere
+#if defined(SWARM_M138_BATCH_SCALAR)
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SWARM_M138_BATCH_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SWARM_M138_BATCH_NEON
+#endif
+
+// SWARM_M138_Batch_Propagator: the near-circular satellites - stepped together
+
+SWARM_M138_Batch_Propagator::SWARM_M138_Batch_Propagator(void)
+{
+  _satellites = NULL;
+  _store = NULL;
+  _count = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of satellites in the batch. Satellites with an eccentricity above
+            SWARM_M138_BATCH_MAX_ECCENTRICITY - or beyond SWARM_M138_BATCH_SIZE - are predicted one at a time
+    @return The number of satellites stepped together by the last computePasses
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Batch_Propagator::getCount(void)
+{
+  return (_count);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the name of the step kernel: chosen at compile time
+    @return "SSE2", "NEON" or "scalar"
+*/
+/**************************************************************************/
+const char *SWARM_M138_Batch_Propagator::getKernelName(void)
+{
+#if defined(SWARM_M138_BATCH_SSE2)
+  return ("SSE2");
+#elif defined(SWARM_M138_BATCH_NEON)
+  return ("NEON");
+#else
+  return ("scalar");
+#endif
+}
+
+// Read the elements of satellite index from the array or the TLE image
+bool SWARM_M138_Batch_Propagator::getElements(uint16_t index, Swarm_M138_Orbital_Elements_t *elements)
+{
+  if (_store != NULL)
+    return (_store->getElements(index, elements));
+
+  if (_satellites == NULL)
+    return (false);
+
+  memcpy(elements, &_satellites[index], sizeof(Swarm_M138_Orbital_Elements_t));
+  return (true);
+}
+
+// Calculate _sinEl for every satellite, then advance them all by one step.
+// The true anomaly and the radius are expanded to second order in the eccentricity:
+//   v - M = e.sin(M).(2 + 2.5.e.cos(M))   r / a = 1 - e.cos(M) + e^2.sin^2(M)
+// The lanes beyond _count (up to the next multiple of 4) hold a dummy satellite
+void SWARM_M138_Batch_Propagator::step(void)
+{
+  uint16_t i = 0;
+
+#if defined(SWARM_M138_BATCH_SSE2)
+  uint16_t lanes = (_count + 3) & ~3;
+  const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), two = _mm_set1_ps(2.0f), twoHalf = _mm_set1_ps(2.5f);
+  const __m128 site0 = _mm_set1_ps(_site[0]), site1 = _mm_set1_ps(_site[1]), site2 = _mm_set1_ps(_site[2]);
+  const __m128 up0 = _mm_set1_ps(_up[0]), up1 = _mm_set1_ps(_up[1]), up2 = _mm_set1_ps(_up[2]);
+
+  for (; i < lanes; i += 4)
+  {
+    __m128 cM = _mm_loadu_ps(&_cosM[i]), sM = _mm_loadu_ps(&_sinM[i]);
+    __m128 cW = _mm_loadu_ps(&_cosW[i]), sW = _mm_loadu_ps(&_sinW[i]);
+    __m128 cL = _mm_loadu_ps(&_cosL[i]), sL = _mm_loadu_ps(&_sinL[i]);
+    __m128 e = _mm_loadu_ps(&_e[i]);
+    __m128 cI = _mm_loadu_ps(&_cosI[i]);
+
+    __m128 eS = _mm_mul_ps(e, sM);
+    __m128 d = _mm_mul_ps(eS, _mm_add_ps(two, _mm_mul_ps(twoHalf, _mm_mul_ps(e, cM))));
+    __m128 d2 = _mm_mul_ps(half, _mm_mul_ps(d, d));
+    __m128 cU = _mm_sub_ps(_mm_sub_ps(cW, _mm_mul_ps(d, sW)), _mm_mul_ps(d2, cW));
+    __m128 sU = _mm_sub_ps(_mm_add_ps(sW, _mm_mul_ps(d, cW)), _mm_mul_ps(d2, sW));
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(&_a[i]), _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(e, cM)), _mm_mul_ps(eS, eS)));
+    __m128 rc = _mm_mul_ps(r, cU);
+    __m128 rs = _mm_mul_ps(r, sU);
+    __m128 rsI = _mm_mul_ps(rs, cI);
+
+    __m128 x = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(cL, rc), _mm_mul_ps(sL, rsI)), site0);
+    __m128 y = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(sL, rc), _mm_mul_ps(cL, rsI)), site1);
+    __m128 z = _mm_sub_ps(_mm_mul_ps(rs, _mm_loadu_ps(&_sinI[i])), site2);
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, up0), _mm_mul_ps(y, up1)), _mm_mul_ps(z, up2));
+    __m128 range = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    _mm_storeu_ps(&_sinEl[i], _mm_div_ps(dot, range));
+
+    __m128 c = _mm_loadu_ps(&_stepCosM[i]), s = _mm_loadu_ps(&_stepSinM[i]);
+    _mm_storeu_ps(&_cosM[i], _mm_sub_ps(_mm_mul_ps(cM, c), _mm_mul_ps(sM, s)));
+    _mm_storeu_ps(&_sinM[i], _mm_add_ps(_mm_mul_ps(sM, c), _mm_mul_ps(cM, s)));
+    c = _mm_loadu_ps(&_stepCosW[i]);
+    s = _mm_loadu_ps(&_stepSinW[i]);
+    _mm_storeu_ps(&_cosW[i], _mm_sub_ps(_mm_mul_ps(cW, c), _mm_mul_ps(sW, s)));
+    _mm_storeu_ps(&_sinW[i], _mm_add_ps(_mm_mul_ps(sW, c), _mm_mul_ps(cW, s)));
+    c = _mm_loadu_ps(&_stepCosL[i]);
+    s = _mm_loadu_ps(&_stepSinL[i]);
+    _mm_storeu_ps(&_cosL[i], _mm_sub_ps(_mm_mul_ps(cL, c), _mm_mul_ps(sL, s)));
+    _mm_storeu_ps(&_sinL[i], _mm_add_ps(_mm_mul_ps(sL, c), _mm_mul_ps(cL, s)));
+  }
+#elif defined(SWARM_M138_BATCH_NEON)
+  uint16_t lanes = (_count + 3) & ~3;
+  const float32x4_t one = vdupq_n_f32(1.0f), half = vdupq_n_f32(0.5f), two = vdupq_n_f32(2.0f), twoHalf = vdupq_n_f32(2.5f);
+  const float32x4_t site0 = vdupq_n_f32(_site[0]), site1 = vdupq_n_f32(_site[1]), site2 = vdupq_n_f32(_site[2]);
+  const float32x4_t up0 = vdupq_n_f32(_up[0]), up1 = vdupq_n_f32(_up[1]), up2 = vdupq_n_f32(_up[2]);
+
+  for (; i < lanes; i += 4)
+  {
+    float32x4_t cM = vld1q_f32(&_cosM[i]), sM = vld1q_f32(&_sinM[i]);
+    float32x4_t cW = vld1q_f32(&_cosW[i]), sW = vld1q_f32(&_sinW[i]);
+    float32x4_t cL = vld1q_f32(&_cosL[i]), sL = vld1q_f32(&_sinL[i]);
+    float32x4_t e = vld1q_f32(&_e[i]);
+    float32x4_t cI = vld1q_f32(&_cosI[i]);
+
+    float32x4_t eS = vmulq_f32(e, sM);
+    float32x4_t d = vmulq_f32(eS, vmlaq_f32(two, twoHalf, vmulq_f32(e, cM)));
+    float32x4_t d2 = vmulq_f32(half, vmulq_f32(d, d));
+    float32x4_t cU = vmlsq_f32(vmlsq_f32(cW, d, sW), d2, cW);
+    float32x4_t sU = vmlsq_f32(vmlaq_f32(sW, d, cW), d2, sW);
+    float32x4_t r = vmulq_f32(vld1q_f32(&_a[i]), vmlaq_f32(vmlsq_f32(one, e, cM), eS, eS));
+    float32x4_t rc = vmulq_f32(r, cU);
+    float32x4_t rs = vmulq_f32(r, sU);
+    float32x4_t rsI = vmulq_f32(rs, cI);
+
+    float32x4_t x = vsubq_f32(vmlsq_f32(vmulq_f32(cL, rc), sL, rsI), site0);
+    float32x4_t y = vsubq_f32(vmlaq_f32(vmulq_f32(sL, rc), cL, rsI), site1);
+    float32x4_t z = vsubq_f32(vmulq_f32(rs, vld1q_f32(&_sinI[i])), site2);
+    float32x4_t dot = vmlaq_f32(vmlaq_f32(vmulq_f32(x, up0), y, up1), z, up2);
+    float32x4_t range = vsqrtq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(x, x), y, y), z, z));
+    vst1q_f32(&_sinEl[i], vdivq_f32(dot, range));
+
+    float32x4_t c = vld1q_f32(&_stepCosM[i]), s = vld1q_f32(&_stepSinM[i]);
+    vst1q_f32(&_cosM[i], vmlsq_f32(vmulq_f32(cM, c), sM, s));
+    vst1q_f32(&_sinM[i], vmlaq_f32(vmulq_f32(sM, c), cM, s));
+    c = vld1q_f32(&_stepCosW[i]);
+    s = vld1q_f32(&_stepSinW[i]);
+    vst1q_f32(&_cosW[i], vmlsq_f32(vmulq_f32(cW, c), sW, s));
+    vst1q_f32(&_sinW[i], vmlaq_f32(vmulq_f32(sW, c), cW, s));
+    c = vld1q_f32(&_stepCosL[i]);
+    s = vld1q_f32(&_stepSinL[i]);
+    vst1q_f32(&_cosL[i], vmlsq_f32(vmulq_f32(cL, c), sL, s));
+    vst1q_f32(&_sinL[i], vmlaq_f32(vmulq_f32(sL, c), cL, s));
+  }
+#endif
+
+  for (; i < _count; i++) // The scalar kernel - or the satellites left over by the vector kernel
+  {
+    float cM = _cosM[i], sM = _sinM[i];
+    float cW = _cosW[i], sW = _sinW[i];
+    float cL = _cosL[i], sL = _sinL[i];
+    float e = _e[i];
+
+    float eS = e * sM;
+    float d = eS * (2.0f + (2.5f * e * cM));
+    float d2 = 0.5f * d * d;
+    float cU = cW - (d * sW) - (d2 * cW);
+    float sU = sW + (d * cW) - (d2 * sW);
+    float r = _a[i] * (1.0f - (e * cM) + (eS * eS));
+    float rc = r * cU;
+    float rs = r * sU;
+    float rsI = rs * _cosI[i];
+
+    float x = (cL * rc) - (sL * rsI) - _site[0];
+    float y = (sL * rc) + (cL * rsI) - _site[1];
+    float z = (rs * _sinI[i]) - _site[2];
+    float dot = (x * _up[0]) + (y * _up[1]) + (z * _up[2]);
+    _sinEl[i] = dot / sqrtf((x * x) + (y * y) + (z * z));
+
+    float c = _stepCosM[i], s = _stepSinM[i];
+    _cosM[i] = (cM * c) - (sM * s);
+    _sinM[i] = (sM * c) + (cM * s);
+    c = _stepCosW[i];
+    s = _stepSinW[i];
+    _cosW[i] = (cW * c) - (sW * s);
+    _sinW[i] = (sW * c) + (cW * s);
+    c = _stepCosL[i];
+    s = _stepSinL[i];
+    _cosL[i] = (cL * c) - (sL * s);
+    _sinL[i] = (sL * c) + (cL * s);
+  }
+}
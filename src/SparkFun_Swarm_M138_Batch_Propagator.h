@@ -0,0 +1,89 @@
+/*!
+ * @file SparkFun_Swarm_M138_Batch_Propagator.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Batch_Propagator: step the near-circular satellites together - for SWARM_M138_Pass_Predictor::computePasses.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h and SparkFun_Swarm_M138_Pass_Predictor.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_BATCH_PROPAGATOR_H
+#define SPARKFUN_SWARM_M138_BATCH_PROPAGATOR_H
+
+#include "SparkFun_Swarm_M138_Pass_Predictor.h"
+
+/** Batch propagation */
+#ifndef SWARM_M138_BATCH_SIZE
+#define SWARM_M138_BATCH_SIZE 192 ///< The maximum number of satellites in a SWARM_M138_Batch_Propagator - a multiple of 4. About 84 bytes each
+#endif
+#define SWARM_M138_BATCH_MAX_ECCENTRICITY 0.01 ///< Satellites with a higher eccentricity are predicted one at a time instead
+#define SWARM_M138_BATCH_RESEED 180            ///< Recalculate the batch exactly every this many SWARM_M138_PASS_FINE_STEPs
+
+#if ((SWARM_M138_BATCH_SIZE % 4) != 0)
+#error SWARM_M138_BATCH_SIZE must be a multiple of 4
+#endif
+
+/** The workspace for SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_Batch_Propagator &batch, ...)
+ *
+ *  The near-circular satellites are laid out as struct-of-arrays in single precision and stepped together:
+ *  every satellite is advanced by one SWARM_M138_PASS_FINE_STEP per pass through the arrays.
+ *  Each step is a rotation by a constant angle - plus a second-order eccentricity correction - so the arrays
+ *  are processed four at a time with SSE2 (x86) or NEON (AArch64). Elsewhere - including ESP32 and ESP32-S3 -
+ *  the same kernel runs as a scalar loop on the single-precision FPU.
+ *  The batch is recalculated exactly every SWARM_M138_BATCH_RESEED steps, and AOS and LOS are refined with the
+ *  full-precision propagator: the pass table matches the one-satellite-at-a-time computePasses.
+ */
+class SWARM_M138_Batch_Propagator
+{
+public:
+  SWARM_M138_Batch_Propagator(void);
+
+  uint16_t getCount(void);         // The number of satellites in the batch - after computePasses
+  const char *getKernelName(void); // "SSE2", "NEON" or "scalar"
+
+private:
+  friend class SWARM_M138_Pass_Predictor; // The predictor fills the batch and reads the elevations
+
+  const Swarm_M138_Orbital_Elements_t *_satellites; // Where the elements came from: an array...
+  SWARM_M138_TLE_Store *_store;                     // ... or a TLE image
+  uint16_t _count;
+  float _site[3]; // The site position: ECEF (km)
+  float _up[3];   // The unit vector of the local vertical
+
+  // The state of each satellite: the cosine and sine of the mean anomaly (M), the argument of latitude of the mean position (W)
+  // and the longitude of the ascending node relative to Greenwich (L)
+  float _cosM[SWARM_M138_BATCH_SIZE], _sinM[SWARM_M138_BATCH_SIZE];
+  float _cosW[SWARM_M138_BATCH_SIZE], _sinW[SWARM_M138_BATCH_SIZE];
+  float _cosL[SWARM_M138_BATCH_SIZE], _sinL[SWARM_M138_BATCH_SIZE];
+  // The rotation applied by each step
+  float _stepCosM[SWARM_M138_BATCH_SIZE], _stepSinM[SWARM_M138_BATCH_SIZE];
+  float _stepCosW[SWARM_M138_BATCH_SIZE], _stepSinW[SWARM_M138_BATCH_SIZE];
+  float _stepCosL[SWARM_M138_BATCH_SIZE], _stepSinL[SWARM_M138_BATCH_SIZE];
+  float _a[SWARM_M138_BATCH_SIZE]; // Semi-major axis (km)
+  float _e[SWARM_M138_BATCH_SIZE];
+  float _cosI[SWARM_M138_BATCH_SIZE], _sinI[SWARM_M138_BATCH_SIZE];
+  float _sinEl[SWARM_M138_BATCH_SIZE]; // The sine of the elevation - from the last step
+
+  // The pass search
+  uint16_t _index[SWARM_M138_BATCH_SIZE]; // The satellite's index in _satellites or _store
+  uint32_t _noradID[SWARM_M138_BATCH_SIZE];
+  uint32_t _aos[SWARM_M138_BATCH_SIZE];
+  float _maxSin[SWARM_M138_BATCH_SIZE];
+  bool _visible[SWARM_M138_BATCH_SIZE];
+
+  bool getElements(uint16_t index, Swarm_M138_Orbital_Elements_t *elements); // Read the elements from the array or the TLE image
+  void step(void); // Calculate _sinEl for every satellite - then advance them all by one step
+};
+
+#endif // SPARKFUN_SWARM_M138_BATCH_PROPAGATOR_H
@@ -0,0 +1,246 @@
+/*!
+ * @file SparkFun_Swarm_M138_Fault_Transport.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Fault_Transport: add deterministic faults to the data from the modem.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Fault_Transport.h"
+
+// SWARM_M138_Fault_Transport: add deterministic faults to the data from the modem
+
+SWARM_M138_Fault_Transport::SWARM_M138_Fault_Transport(SWARM_M138_Transport *transport)
+{
+  _transport = transport;
+  setSeed(0);
+  _latency = 0;
+  _granularity = 1;
+  _idleMillis = 0;
+  _maxRead = 0;
+  _dropRate = 0;
+  _corruptRate = 0;
+  _flood = NULL;
+  _floodInterval = 0;
+  _floodLast = 0;
+  _floodNext = NULL;
+  _innerAvailable = 0;
+  _arrived = 0;
+  _changed = 0;
+  _lineStart = true;
+  _checksumIndex = 0;
+  _corruptThis = false;
+  _bytesDropped = 0;
+  _checksumsCorrupted = 0;
+  _sentencesInjected = 0;
+}
+
+void SWARM_M138_Fault_Transport::setSeed(uint32_t seed)
+{
+  _random = (seed == 0) ? 0x2545F491 : seed; // The xorshift generator must not start at zero
+}
+
+void SWARM_M138_Fault_Transport::setLatency(unsigned long latency)
+{
+  _latency = latency;
+}
+
+void SWARM_M138_Fault_Transport::setAvailableGranularity(size_t bytes, unsigned long idleMillis)
+{
+  _granularity = (bytes == 0) ? 1 : bytes;
+  _idleMillis = idleMillis;
+}
+
+void SWARM_M138_Fault_Transport::setMaxRead(size_t bytes)
+{
+  _maxRead = bytes;
+}
+
+void SWARM_M138_Fault_Transport::setDropRate(uint16_t oneIn)
+{
+  _dropRate = oneIn;
+}
+
+void SWARM_M138_Fault_Transport::setCorruptRate(uint16_t oneIn)
+{
+  _corruptRate = oneIn;
+}
+
+void SWARM_M138_Fault_Transport::setFlood(const char *sentence, unsigned long interval)
+{
+  _flood = sentence;
+  _floodInterval = interval;
+  _floodLast = millis();
+}
+
+uint32_t SWARM_M138_Fault_Transport::getBytesDropped(void)
+{
+  return (_bytesDropped);
+}
+
+uint32_t SWARM_M138_Fault_Transport::getChecksumsCorrupted(void)
+{
+  return (_checksumsCorrupted);
+}
+
+uint32_t SWARM_M138_Fault_Transport::getSentencesInjected(void)
+{
+  return (_sentencesInjected);
+}
+
+// xorshift32: small, fast and repeatable
+uint32_t SWARM_M138_Fault_Transport::nextRandom(uint32_t range)
+{
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return ((range == 0) ? 0 : (_random % range));
+}
+
+void SWARM_M138_Fault_Transport::begin(unsigned long baud)
+{
+  if (_transport != NULL)
+    _transport->begin(baud);
+}
+
+int SWARM_M138_Fault_Transport::available(void)
+{
+  if (_transport == NULL)
+    return (-1);
+
+  unsigned long now = millis();
+
+  // Start injecting the flood sentence - but only between sentences
+  if ((_flood != NULL) && (_floodNext == NULL) && (_lineStart == true) && ((now - _floodLast) >= _floodInterval))
+  {
+    _floodLast = now;
+    _floodNext = _flood;
+  }
+  if (_floodNext != NULL)
+    return ((int)strlen(_floodNext));
+
+  int avail = _transport->available();
+  if (avail <= 0)
+  {
+    _innerAvailable = 0;
+    return (avail);
+  }
+
+  if (_innerAvailable == 0) // New data has arrived
+    _arrived = now;
+  if (avail > _innerAvailable)
+    _changed = now;
+  _innerAvailable = avail;
+
+  if ((now - _arrived) < _latency) // Hide the data until the latency has passed
+    return (0);
+
+  if ((_granularity > 1) && ((now - _changed) < _idleMillis)) // Only report whole chunks until the data goes idle
+    return ((int)((avail / _granularity) * _granularity));
+
+  return (avail);
+}
+
+// Add the faults to one byte: drop it, or corrupt it if it is the first checksum character. Copy it into dest
+void SWARM_M138_Fault_Transport::deliver(char c, char *dest, int *delivered)
+{
+  if ((_dropRate > 0) && (nextRandom(_dropRate) == 0))
+  {
+    _bytesDropped++;
+    return;
+  }
+
+  if (_checksumIndex == 1) // Is this the first checksum character?
+  {
+    if (_corruptThis == true)
+    {
+      c = (c == '0') ? '1' : '0';
+      _checksumsCorrupted++;
+      _corruptThis = false;
+    }
+    _checksumIndex = 0;
+  }
+
+  if (c == '$') // Decide if this sentence's checksum will be corrupted
+    _corruptThis = (_corruptRate > 0) && (nextRandom(_corruptRate) == 0);
+  else if (c == '*')
+    _checksumIndex = 1;
+
+  _lineStart = (c == '\n');
+  dest[(*delivered)++] = c;
+}
+
+int SWARM_M138_Fault_Transport::read(char *dest, int len)
+{
+  if (_transport == NULL)
+    return (-1);
+
+  if ((_maxRead > 0) && (len > 0)) // Split the data at a random point
+  {
+    int maxRead = (len < (int)_maxRead) ? len : (int)_maxRead;
+    len = 1 + (int)nextRandom((uint32_t)maxRead);
+  }
+
+  int delivered = 0;
+
+  if (_floodNext != NULL) // Inject the flood sentence
+  {
+    for (int i = 0; (i < len) && (*_floodNext != 0); i++)
+      deliver(*_floodNext++, dest, &delivered);
+    if (*_floodNext == 0)
+    {
+      _floodNext = NULL;
+      _sentencesInjected++;
+    }
+    return (delivered);
+  }
+
+  int bytesRead = _transport->read(dest, len);
+  if (bytesRead <= 0)
+    return (bytesRead);
+
+  _innerAvailable -= bytesRead;
+  if (_innerAvailable < 0)
+    _innerAvailable = 0;
+
+  for (int i = 0; i < bytesRead; i++) // Add the faults in place: delivered never overtakes i
+    deliver(dest[i], dest, &delivered);
+
+  return (delivered);
+}
+
+size_t SWARM_M138_Fault_Transport::write(const char *buff, size_t len)
+{
+  if (_transport == NULL)
+    return (0);
+  return (_transport->write(buff, len));
+}
+
+void SWARM_M138_Fault_Transport::writeBegin(size_t len)
+{
+  if (_transport != NULL)
+    _transport->writeBegin(len);
+}
+
+size_t SWARM_M138_Fault_Transport::writeStream(const char *buff, size_t len)
+{
+  if (_transport == NULL)
+    return (0);
+  return (_transport->writeStream(buff, len));
+}
+
+// The latency and granularity faults make the data arrive in bursts: the idle window is needed
+bool SWARM_M138_Fault_Transport::needsRxWindow(void)
+{
+  if ((_latency > 0) || (_granularity > 1) || (_transport == NULL))
+    return (true);
+  return (_transport->needsRxWindow());
+}
@@ -0,0 +1,83 @@
+/*!
+ * @file SparkFun_Swarm_M138_Fault_Transport.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Fault_Transport: add deterministic faults to the data from the modem.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_FAULT_TRANSPORT_H
+#define SPARKFUN_SWARM_M138_FAULT_TRANSPORT_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+/** Fault-injection transport: wraps another transport and adds deterministic faults to the data from the modem.
+ *  Use it to measure how waitForResponse and the backlog behave under load - and to size the buffers and timeouts.
+ *  The faults are driven by a pseudo-random generator: the same seed (and traffic) gives the same faults.
+ *  Commands are passed through to the wrapped transport unchanged.
+ */
+class SWARM_M138_Fault_Transport : public SWARM_M138_Transport
+{
+public:
+  SWARM_M138_Fault_Transport(SWARM_M138_Transport *transport);
+
+  void setSeed(uint32_t seed);                                          // Seed the pseudo-random generator
+  void setLatency(unsigned long latency);                               // New data only becomes available latency millis after it arrives
+  void setAvailableGranularity(size_t bytes, unsigned long idleMillis); // available only updates every bytes - or after idleMillis with no new data. ESP32: 120 bytes
+  void setMaxRead(size_t bytes);                                        // Split the data: each read returns a random 1 to bytes bytes. 0 == no limit
+  void setDropRate(uint16_t oneIn);                                     // Drop one byte in oneIn. 0 == never
+  void setCorruptRate(uint16_t oneIn);                                  // Corrupt the checksum of one sentence in oneIn. 0 == never
+  void setFlood(const char *sentence, unsigned long interval);          // Inject sentence (including its checksum and \n) every interval millis, between sentences. NULL == stop
+  uint32_t getBytesDropped(void);                                       // The number of bytes dropped
+  uint32_t getChecksumsCorrupted(void);                                 // The number of checksums corrupted
+  uint32_t getSentencesInjected(void);                                  // The number of flood sentences injected
+
+  void begin(unsigned long baud);
+  int available(void);
+  int read(char *dest, int len);
+  size_t write(const char *buff, size_t len);
+  void writeBegin(size_t len);
+  size_t writeStream(const char *buff, size_t len);
+  bool needsRxWindow(void);
+  TwoWire *getI2cPort(void) { return ((_transport == NULL) ? NULL : _transport->getI2cPort()); }
+  byte getI2cAddress(void) { return ((_transport == NULL) ? 0 : _transport->getI2cAddress()); }
+
+private:
+  uint32_t nextRandom(uint32_t range); // Return a pseudo-random number: 0 to range - 1
+  void deliver(char c, char *dest, int *delivered); // Add the faults to one byte and copy it into dest
+  SWARM_M138_Transport *_transport;
+  uint32_t _random;
+  unsigned long _latency;
+  size_t _granularity;
+  unsigned long _idleMillis;
+  size_t _maxRead;
+  uint16_t _dropRate;
+  uint16_t _corruptRate;
+  const char *_flood;
+  unsigned long _floodInterval;
+  unsigned long _floodLast;
+  const char *_floodNext;  // The next character of the flood sentence. NULL if not injecting
+  int _innerAvailable;     // The wrapped transport's available when it was last checked
+  unsigned long _arrived;  // millis when the wrapped transport's data last increased from zero
+  unsigned long _changed;  // millis when the wrapped transport's available last increased
+  bool _lineStart;         // True if the last byte delivered was a \n
+  uint8_t _checksumIndex;  // 1 or 2 while delivering the checksum characters. Otherwise 0
+  bool _corruptThis;       // True if the checksum of this sentence will be corrupted
+  uint32_t _bytesDropped;
+  uint32_t _checksumsCorrupted;
+  uint32_t _sentencesInjected;
+};
+
+#endif // SPARKFUN_SWARM_M138_FAULT_TRANSPORT_H
@@ -0,0 +1,401 @@
+/*!
+ * @file SparkFun_Swarm_M138_Fleet.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Fleet: drive several Swarm M138 modems together.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Fleet.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+
+// SWARM_M138_Fleet: drive several modems together
+
+SWARM_M138_Fleet::SWARM_M138_Fleet(void)
+{
+  memset(_modems, 0, sizeof(_modems));
+  _numModems = 0;
+  _nextTxModem = 0;
+  _pollRound = 0;
+  _unsentRefreshInterval = SWARM_M138_FLEET_UNSENT_REFRESH;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a modem to the fleet. The modem must have been begun. Its unsent message count is queued for reading
+    @param  modem
+            The modem
+    @param  selectBus
+            Optional: the function which selects the modem's I2C mux channel. Called before the fleet talks to the modem
+    @param  context
+            Passed to selectBus. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the modem was added
+            SWARM_M138_ERROR_QUEUE_FULL if the fleet already holds SWARM_M138_FLEET_MAX_MODEMS modems
+            SWARM_M138_ERROR_ERROR if the modem has not been begun - or it is already in the fleet,
+            or it would share an I2C bus and address with another modem without a selectBus function
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Fleet::addModem(SWARM_M138 &modem, void (*selectBus)(void *context), void *context)
+{
+  if (_numModems >= SWARM_M138_FLEET_MAX_MODEMS)
+    return (SWARM_M138_ERROR_QUEUE_FULL);
+
+  SWARM_M138_Transport *transport = modem.getTransport();
+  if (transport == NULL)
+    return (SWARM_M138_ERROR_ERROR);
+
+  TwoWire *i2cPort = transport->getI2cPort();
+  byte address = transport->getI2cAddress();
+
+  for (uint8_t i = 0; i < _numModems; i++)
+  {
+    if (_modems[i].modem == &modem)
+      return (SWARM_M138_ERROR_ERROR);
+    // Two modems can only share a bus and address if they are behind a mux
+    if ((i2cPort != NULL) && (_modems[i].i2cPort == i2cPort) && (_modems[i].address == address)
+        && ((selectBus == NULL) || (_modems[i].selectBus == NULL)))
+      return (SWARM_M138_ERROR_ERROR);
+  }
+
+  Swarm_M138_Fleet_Modem_t *entry = &_modems[_numModems];
+  memset(entry, 0, sizeof(Swarm_M138_Fleet_Modem_t));
+  entry->modem = &modem;
+  entry->i2cPort = i2cPort;
+  entry->address = address;
+  entry->selectBus = selectBus;
+  entry->selectContext = context;
+  entry->index = _numModems;
+  _numModems++;
+
+  queueUnsentRefresh(entry);
+
+  return (SWARM_M138_ERROR_SUCCESS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of modems in the fleet
+    @return The number of modems
+*/
+/**************************************************************************/
+uint8_t SWARM_M138_Fleet::getModemCount(void)
+{
+  return (_numModems);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get one of the modems. E.g. to set its callbacks
+    @param  index
+            The modem index: 0 to getModemCount() - 1
+    @return A pointer to the modem. NULL if index is invalid
+*/
+/**************************************************************************/
+SWARM_M138 *SWARM_M138_Fleet::getModem(uint8_t index)
+{
+  if (index >= _numModems)
+    return (NULL);
+  return (_modems[index].modem);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Poll the modems. Call this regularly from loop(). It never blocks.
+            Modems on their own port are polled every time. Modems which share an I2C bus take turns: one per call.
+            The unsent message counts are refreshed every setUnsentRefreshInterval millis - when each modem is idle.
+    @return true if any of the modems handled an unsolicited message or completed a command
+*/
+/**************************************************************************/
+bool SWARM_M138_Fleet::poll(void)
+{
+  bool handled = false;
+
+  for (uint8_t i = 0; i < _numModems; i++)
+  {
+    Swarm_M138_Fleet_Modem_t *entry = &_modems[i];
+
+    if (pollThisRound(i) == false)
+      continue;
+
+    selectModem(entry);
+
+    if (entry->modem->poll())
+      handled = true;
+
+    if ((_unsentRefreshInterval > 0) && (entry->refreshPending == false) && (entry->modem->isBusy() == false)
+        && ((millis() - entry->lastRefresh) >= _unsentRefreshInterval))
+      queueUnsentRefresh(entry);
+  }
+
+  _pollRound++;
+
+  return (handled);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue a text message for transmission via the idle modem which has the fewest unsent messages
+    @param  data
+            A pointer to the message, which is copied into the command before this method returns
+    @param  callback
+            Optional: the function to be called when the $TD response arrives. msg_id is only valid if err is
+            SWARM_M138_ERROR_SUCCESS. modem is the index of the modem which has the message
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  modem
+            Optional: the index of the modem which was chosen is returned here
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if none of the modems are idle. Try again after the next poll
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Fleet::transmitText(const char *data,
+                                                  void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context),
+                                                  void *context, uint8_t *modem)
+{
+  // The modem stores text and binary messages the same way. Sending the text as binary lets the command be streamed
+  return (transmit((const uint8_t *)data, strlen(data), false, 0, callback, context, modem));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue a binary message for transmission via the idle modem which has the fewest unsent messages
+    @param  data
+            A pointer to the binary data, which is copied into the command before this method returns
+    @param  len
+            The length of the data
+    @param  callback
+            Optional: the function to be called when the $TD response arrives. msg_id is only valid if err is
+            SWARM_M138_ERROR_SUCCESS. modem is the index of the modem which has the message
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  modem
+            Optional: the index of the modem which was chosen is returned here
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if none of the modems are idle. Try again after the next poll
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Fleet::transmitBinary(const uint8_t *data, size_t len,
+                                                    void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context),
+                                                    void *context, uint8_t *modem)
+{
+  return (transmit(data, len, false, 0, callback, context, modem));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue a binary message for transmission via the idle modem which has the fewest unsent messages
+    @param  data
+            A pointer to the binary data, which is copied into the command before this method returns
+    @param  len
+            The length of the data
+    @param  appID
+            The application ID
+    @param  callback
+            Optional: the function to be called when the $TD response arrives. msg_id is only valid if err is
+            SWARM_M138_ERROR_SUCCESS. modem is the index of the modem which has the message
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  modem
+            Optional: the index of the modem which was chosen is returned here
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if none of the modems are idle. Try again after the next poll
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Fleet::transmitBinary(const uint8_t *data, size_t len, uint16_t appID,
+                                                    void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context),
+                                                    void *context, uint8_t *modem)
+{
+  return (transmit(data, len, true, appID, callback, context, modem));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set how often each modem's unsent message count is re-read. The count only goes down when it is re-read
+    @param  interval
+            The interval in milliseconds. 0 disables the refresh: the counts are then only read by refreshUnsentCounts
+*/
+/**************************************************************************/
+void SWARM_M138_Fleet::setUnsentRefreshInterval(unsigned long interval)
+{
+  _unsentRefreshInterval = interval;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue a $MT C=U on each modem, so the unsent message counts are re-read as soon as each modem is free
+*/
+/**************************************************************************/
+void SWARM_M138_Fleet::refreshUnsentCounts(void)
+{
+  for (uint8_t i = 0; i < _numModems; i++)
+  {
+    if (_modems[i].refreshPending == false)
+      queueUnsentRefresh(&_modems[i]);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the unsent message count of a modem
+    @param  index
+            The modem index: 0 to getModemCount() - 1
+    @return The count as last read, plus the messages queued via the fleet since. 0 if index is invalid
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Fleet::getUnsentCount(uint8_t index)
+{
+  if (index >= _numModems)
+    return (0);
+  return (_modems[index].unsent);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the total unsent message count of the fleet
+    @return The total of the unsent counts
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Fleet::getTotalUnsent(void)
+{
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < _numModems; i++)
+    total += _modems[i].unsent;
+  return (total);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of modems which can accept a message now: no command is in progress or queued
+    @return The number of idle modems
+*/
+/**************************************************************************/
+uint8_t SWARM_M138_Fleet::getIdleCount(void)
+{
+  uint8_t idle = 0;
+  for (uint8_t i = 0; i < _numModems; i++)
+  {
+    if ((_modems[i].modem->isBusy() == false) && (_modems[i].modem->getCommandQueueCount() == 0))
+      idle++;
+  }
+  return (idle);
+}
+
+// Call the modem's selectBus function - if it has one
+void SWARM_M138_Fleet::selectModem(Swarm_M138_Fleet_Modem_t *entry)
+{
+  if (entry->selectBus != NULL)
+    entry->selectBus(entry->selectContext);
+}
+
+// Queue a $MT C=U. unsentCountComplete updates the count when the response arrives
+void SWARM_M138_Fleet::queueUnsentRefresh(Swarm_M138_Fleet_Modem_t *entry)
+{
+  char command[16]; // Use the stack, not the heap
+  swarm_m138_print_text(swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_TX_MGMT), " C=U");
+
+  selectModem(entry); // queueCommand sends the command straight away if the modem is free
+
+  entry->lastRefresh = millis(); // Do not retry straight away if the queue is full
+  if (entry->modem->queueCommand(command, "$MT ", &SWARM_M138_Fleet::unsentCountComplete, (void *)entry,
+                                 SWARM_M138_MESSAGE_READ_TIMEOUT) == SWARM_M138_ERROR_SUCCESS)
+    entry->refreshPending = true;
+}
+
+// Return true if it is this modem's turn on its I2C bus. Modems on their own port are polled every time
+bool SWARM_M138_Fleet::pollThisRound(uint8_t index)
+{
+  TwoWire *i2cPort = _modems[index].i2cPort;
+  if (i2cPort == NULL)
+    return (true);
+
+  uint8_t rank = 0;   // The position of this modem among the modems on its bus
+  uint8_t sharing = 0; // The number of modems on the bus
+  for (uint8_t i = 0; i < _numModems; i++)
+  {
+    if (_modems[i].i2cPort == i2cPort)
+    {
+      if (i < index)
+        rank++;
+      sharing++;
+    }
+  }
+
+  return ((_pollRound % sharing) == rank);
+}
+
+// Send the message via the idle modem which has the fewest unsent messages
+// The search starts after the last modem used, so equal modems are used in turn
+Swarm_M138_Error_e SWARM_M138_Fleet::transmit(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                                              void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context),
+                                              void *context, uint8_t *modem)
+{
+  Swarm_M138_Fleet_Modem_t *best = NULL;
+
+  for (uint8_t n = 0; n < _numModems; n++)
+  {
+    Swarm_M138_Fleet_Modem_t *entry = &_modems[(_nextTxModem + n) % _numModems];
+    if ((entry->modem->isBusy() == true) || (entry->modem->getCommandQueueCount() > 0))
+      continue;
+    if ((best == NULL) || (entry->unsent < best->unsent))
+      best = entry;
+  }
+
+  if (best == NULL)
+    return (SWARM_M138_ERROR_BUSY);
+
+  selectModem(best);
+
+  Swarm_M138_Error_e err;
+  if (useAppID)
+    err = best->modem->transmitBinaryAsync(data, len, appID, &SWARM_M138_Fleet::transmitComplete, (void *)best);
+  else
+    err = best->modem->transmitBinaryAsync(data, len, &SWARM_M138_Fleet::transmitComplete, (void *)best);
+
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    best->txCallback = callback;
+    best->txContext = context;
+    _nextTxModem = (best->index + 1) % _numModems;
+    if (modem != NULL)
+      *modem = best->index;
+  }
+
+  return (err);
+}
+
+// The $MT C=U response: "$MT <count>*xx". context points to the modem's entry
+void SWARM_M138_Fleet::unsentCountComplete(Swarm_M138_Error_e err, const char *response, void *context)
+{
+  Swarm_M138_Fleet_Modem_t *entry = (Swarm_M138_Fleet_Modem_t *)context;
+  entry->refreshPending = false;
+
+  if (err != SWARM_M138_ERROR_SUCCESS)
+    return; // Keep the old count
+
+  uint16_t theCount;
+  if (swarm_m138_parse_count(strstr(response, "$MT "), "$MT ", &theCount)) // The parser passes a NULL straight through
+    entry->unsent = theCount;
+}
+
+// The $TD response. context points to the modem's entry
+void SWARM_M138_Fleet::transmitComplete(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context)
+{
+  Swarm_M138_Fleet_Modem_t *entry = (Swarm_M138_Fleet_Modem_t *)context;
+
+  if ((err == SWARM_M138_ERROR_SUCCESS) && (entry->unsent < 0xFFFF))
+    entry->unsent++;
+
+  if (entry->txCallback != NULL)
+    entry->txCallback(err, msg_id, entry->index, entry->txContext);
+}
@@ -0,0 +1,104 @@
+/*!
+ * @file SparkFun_Swarm_M138_Fleet.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Fleet: drive several Swarm M138 modems together.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_FLEET_H
+#define SPARKFUN_SWARM_M138_FLEET_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+#ifndef SWARM_M138_FLEET_MAX_MODEMS
+#define SWARM_M138_FLEET_MAX_MODEMS 4 ///< The maximum number of modems in a SWARM_M138_Fleet
+#endif
+#ifndef SWARM_M138_FLEET_UNSENT_REFRESH
+#define SWARM_M138_FLEET_UNSENT_REFRESH 60000 ///< The default interval (millis) between unsent message count ($MT C=U) refreshes
+#endif
+
+/** Drive several Swarm M138 modems together - e.g. on a gateway
+ *
+ *  Each modem must be begun first - on its own serial port, or on I2C.
+ *  poll() pumps the non-blocking state machine of each modem in turn. Modems which share an I2C bus take turns:
+ *  only one of them is polled on each call, so the bus is polled no more often than it would be for a single modem.
+ *  Modems behind an I2C mux can share an address: pass a selectBus function which selects the modem's mux channel.
+ *  It is called before the fleet talks to that modem.
+ *  transmitText and transmitBinary send each message via the idle modem which has the fewest unsent messages.
+ *  The unsent count of each modem is read with a queued $MT C=U and then tracked as messages are queued.
+ *  Do not call the blocking methods of the modems while the fleet is in use.
+ */
+class SWARM_M138_Fleet
+{
+public:
+  SWARM_M138_Fleet(void);
+
+  Swarm_M138_Error_e addModem(SWARM_M138 &modem, void (*selectBus)(void *context) = NULL, void *context = NULL); // Add a modem. Its index is getModemCount() - 1
+  uint8_t getModemCount(void);
+  SWARM_M138 *getModem(uint8_t index); // Return the modem. NULL if index is invalid
+
+  bool poll(void); // Non-blocking: poll each modem - one modem per shared I2C bus. Return true if any modem handled something
+
+  Swarm_M138_Error_e transmitText(const char *data,
+                                  void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context) = NULL,
+                                  void *context = NULL, uint8_t *modem = NULL); // Send text via the least-loaded idle modem
+  Swarm_M138_Error_e transmitBinary(const uint8_t *data, size_t len,
+                                    void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context) = NULL,
+                                    void *context = NULL, uint8_t *modem = NULL); // Send binary data via the least-loaded idle modem
+  Swarm_M138_Error_e transmitBinary(const uint8_t *data, size_t len, uint16_t appID,
+                                    void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context) = NULL,
+                                    void *context = NULL, uint8_t *modem = NULL); // Send binary data with an application ID
+
+  void setUnsentRefreshInterval(unsigned long interval = SWARM_M138_FLEET_UNSENT_REFRESH); // How often to re-read each modem's unsent count. 0 == never
+  void refreshUnsentCounts(void);        // Re-read each modem's unsent count now
+  uint16_t getUnsentCount(uint8_t index); // The unsent count of a modem - as last read, plus the messages queued since
+  uint32_t getTotalUnsent(void);          // The total of the unsent counts
+  uint8_t getIdleCount(void);             // The number of modems which can accept a message now
+
+private:
+  // The fleet's view of each modem
+  typedef struct
+  {
+    SWARM_M138 *modem;
+    TwoWire *i2cPort;                 // NULL if the modem does not use I2C
+    byte address;
+    void (*selectBus)(void *context); // Called before the fleet talks to the modem. Can be NULL
+    void *selectContext;
+    uint16_t unsent;                  // The unsent count: as last read, plus the messages queued since
+    bool refreshPending;              // True while a $MT C=U is queued
+    unsigned long lastRefresh;        // millis when the last $MT C=U was queued
+    void (*txCallback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context);
+    void *txContext;
+    uint8_t index;
+  } Swarm_M138_Fleet_Modem_t;
+
+  Swarm_M138_Fleet_Modem_t _modems[SWARM_M138_FLEET_MAX_MODEMS];
+  uint8_t _numModems;
+  uint8_t _nextTxModem;     // Where the next search for the least-loaded modem starts. Spreads messages across equal modems
+  uint8_t _pollRound;       // Incremented on each poll. Selects which modem on each shared I2C bus is polled
+  unsigned long _unsentRefreshInterval;
+
+  void selectModem(Swarm_M138_Fleet_Modem_t *entry);       // Call the modem's selectBus function - if it has one
+  void queueUnsentRefresh(Swarm_M138_Fleet_Modem_t *entry); // Queue a $MT C=U
+  bool pollThisRound(uint8_t index);                        // Return true if it is this modem's turn on its I2C bus
+  Swarm_M138_Error_e transmit(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                              void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t modem, void *context),
+                              void *context, uint8_t *modem);
+  static void unsentCountComplete(Swarm_M138_Error_e err, const char *response, void *context);   // The $MT C=U response
+  static void transmitComplete(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context);      // The $TD response
+};
+
+#endif // SPARKFUN_SWARM_M138_FLEET_H
@@ -0,0 +1,160 @@
+/*!
+ * @file SparkFun_Swarm_M138_Helpers.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * Small helpers shared by the library source files. Sketches do not need to include this header.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_HELPERS_H
+#define SPARKFUN_SWARM_M138_HELPERS_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+// Convert an ASCII Hex character into its value. Return -1 if c is not a hex character
+static inline int swarm_m138_hex_value(char c)
+{
+  if ((c >= '0') && (c <= '9'))
+    return (c - '0');
+  if ((c >= 'a') && (c <= 'f'))
+    return (c + 10 - 'a');
+  if ((c >= 'A') && (c <= 'F'))
+    return (c + 10 - 'A');
+  return (-1);
+}
+
+// Copy text, plus a null
+static inline char *swarm_m138_print_text(char *dest, const char *text)
+{
+  while (*text != 0)
+    *dest++ = *text++;
+  *dest = 0;
+  return (dest);
+}
+
+// Little-endian helpers: the binary images are the same on every platform
+static inline void swarm_m138_put_u16(uint8_t *dest, uint16_t value)
+{
+  dest[0] = (uint8_t)(value & 0xFF);
+  dest[1] = (uint8_t)(value >> 8);
+}
+
+static inline void swarm_m138_put_u32(uint8_t *dest, uint32_t value)
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    dest[i] = (uint8_t)(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+static inline uint16_t swarm_m138_get_u16(const uint8_t *src)
+{
+  return ((uint16_t)src[0] | (((uint16_t)src[1]) << 8));
+}
+
+static inline uint32_t swarm_m138_get_u32(const uint8_t *src)
+{
+  return ((uint32_t)src[0] | (((uint32_t)src[1]) << 8) | (((uint32_t)src[2]) << 16) | (((uint32_t)src[3]) << 24));
+}
+
+// Update a CRC-32 (IEEE 802.3). Start with 0xFFFFFFFF and invert the result
+static inline uint32_t swarm_m138_crc32(uint32_t crc, const uint8_t *data, uint16_t len)
+{
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+  }
+  return (crc);
+}
+
+// Sentence field parsers, shared by the modem and Fleet parsers. Each returns a pointer to the first unparsed
+// character, or NULL if the text did not match, and passes a NULL straight through
+
+// Check that p starts with literal
+static inline const char *swarm_m138_parse_literal(const char *p, const char *literal)
+{
+  if (p == NULL)
+    return (NULL);
+  while (*literal != 0)
+  {
+    if (*p != *literal)
+      return (NULL);
+    p++;
+    literal++;
+  }
+  return (p);
+}
+
+// Parse an optionally-signed decimal number into an integer scaled by 10^decimals.
+// Surplus fractional digits are truncated and missing ones are zero-filled: "-0.5" is -500 when decimals is 3
+static inline const char *swarm_m138_parse_fixed(const char *p, uint8_t decimals, int32_t *value)
+{
+  if (p == NULL)
+    return (NULL);
+  bool negative = (*p == '-');
+  if ((*p == '-') || (*p == '+'))
+    p++;
+  if ((*p < '0') || (*p > '9'))
+    return (NULL); // No digits
+  int32_t result = 0;
+  while ((*p >= '0') && (*p <= '9'))
+  {
+    result = (result * 10) + (*p - '0');
+    p++;
+  }
+  uint8_t fractionDigits = 0;
+  if (*p == '.')
+  {
+    p++;
+    while ((*p >= '0') && (*p <= '9'))
+    {
+      if (fractionDigits < decimals)
+      {
+        result = (result * 10) + (*p - '0');
+        fractionDigits++;
+      }
+      p++;
+    }
+  }
+  for (; fractionDigits < decimals; fractionDigits++)
+    result *= 10;
+  *value = negative ? -result : result;
+  return (p);
+}
+
+// Parse an optionally-signed decimal integer. Any fractional part is ignored
+static inline const char *swarm_m138_parse_int(const char *p, int32_t *value)
+{
+  return (swarm_m138_parse_fixed(p, 0, value));
+}
+
+// Parse a message count: "$MM count*" or "$MT count*". prefix is "$MM " or "$MT "
+static inline bool swarm_m138_parse_count(const char *p, const char *prefix, uint16_t *count)
+{
+  int32_t theCount;
+
+  p = swarm_m138_parse_literal(p, prefix);
+  p = swarm_m138_parse_int(p, &theCount);
+  p = swarm_m138_parse_literal(p, "*");
+  if ((p == NULL) || (theCount < 0) || (theCount > 0xFFFF))
+    return (false);
+
+  *count = (uint16_t)theCount;
+  return (true);
+}
+
+#endif // SPARKFUN_SWARM_M138_HELPERS_H
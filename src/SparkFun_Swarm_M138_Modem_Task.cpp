@@ -0,0 +1,378 @@
+/*!
+ * @file SparkFun_Swarm_M138_Modem_Task.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Modem_Task: run the Swarm M138 modem in its own RTOS task.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Modem_Task.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+
+// SWARM_M138_Modem_Task: own the modem in one task - talk to it through lock-free rings
+
+// Order the slot writes before the index which publishes them - across cores too
+#define SWARM_M138_RING_BARRIER() __sync_synchronize()
+
+SWARM_M138_Modem_Task::SWARM_M138_Modem_Task(void)
+{
+  _modem = NULL;
+  for (uint8_t i = 0; i < SWARM_M138_TASK_PRODUCERS; i++)
+  {
+    _txRings[i].head = 0;
+    _txRings[i].tail = 0;
+  }
+  _nextProducer = 0;
+  _eventHead = 0;
+  _eventTail = 0;
+  _eventsDropped = 0;
+#ifdef ARDUINO_ARCH_ESP32
+  _task = NULL;
+  _consumer = NULL;
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take ownership of the modem. From now on, only the modem task may call it.
+            The modem's $DT, $RD, $SL WAKE, $M138 and $TD SENT context callbacks are set: they add events to the ring
+    @param  modem
+            The modem. It must have been begun
+*/
+/**************************************************************************/
+void SWARM_M138_Modem_Task::begin(SWARM_M138 &modem)
+{
+  _modem = &modem;
+  _modem->setDateTimeCallback(dateTimeCallback, this);
+  _modem->setReceiveMessageCallback(receiveMessageCallback, this);
+  _modem->setSleepWakeCallback(sleepWakeCallback, this);
+  _modem->setModemStatusCallback(modemStatusCallback, this);
+  _modem->setTransmitDataCallback(transmitDataCallback, this);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Modem task: queue one waiting request from each producer, then check for unsolicited messages.
+            Call this repeatedly from the modem task. Each request blocks (only) the modem task while the $TD is sent
+    @return true if there was anything to do - call service again straight away
+*/
+/**************************************************************************/
+bool SWARM_M138_Modem_Task::service(void)
+{
+  if (_modem == NULL)
+    return (false);
+
+  bool busy = false;
+
+  for (uint8_t i = 0; i < SWARM_M138_TASK_PRODUCERS; i++)
+  {
+    Swarm_M138_Task_Tx_Ring_t *ring = &_txRings[_nextProducer];
+    _nextProducer++;
+    if (_nextProducer >= SWARM_M138_TASK_PRODUCERS)
+      _nextProducer = 0;
+
+    uint8_t tail = ring->tail;
+    if (ring->head == tail) // Empty
+      continue;
+    SWARM_M138_RING_BARRIER(); // Read the slot after the head
+
+    Swarm_M138_Task_Request_t *request = &ring->slots[tail & (SWARM_M138_TASK_TX_SLOTS - 1)];
+    Swarm_M138_Tx_Descriptor_t message;
+    message.data = request->data; // Send straight from the slot: it is not released until afterwards
+    message.len = request->len;
+    message.useAppID = request->useAppID;
+    message.appID = request->appID;
+    message.hold = request->hold;
+    message.epoch = request->epoch;
+
+    uint64_t msg_id = 0;
+    Swarm_M138_Error_e err = _modem->transmitBatch(&message, 1, &msg_id);
+
+    Swarm_M138_Task_Event_t *event = eventSlot();
+    if (event != NULL)
+    {
+      event->type = SWARM_M138_TASK_EVENT_TX_QUEUED;
+      event->err = err;
+      event->tag = request->tag;
+      event->msg_id = msg_id;
+      publishEvent();
+    }
+
+    SWARM_M138_RING_BARRIER(); // Finish with the slot before releasing it
+    ring->tail = tail + 1;
+    busy = true;
+  }
+
+  if (_modem->checkUnsolicitedMsg())
+    busy = true;
+
+  return (busy);
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+/**************************************************************************/
+/*!
+    @brief  Create the modem task. It calls service - and sleeps for SWARM_M138_TASK_POLL_MILLIS
+            (or until a request is submitted) when there is nothing to do
+    @param  stackSize
+            The task stack size (bytes)
+    @param  priority
+            The task priority
+    @param  core
+            The core to run the task on. tskNO_AFFINITY == either
+    @return true if the task was created
+*/
+/**************************************************************************/
+bool SWARM_M138_Modem_Task::start(uint32_t stackSize, UBaseType_t priority, BaseType_t core)
+{
+  if ((_modem == NULL) || (_task != NULL))
+    return (false);
+
+  return (xTaskCreatePinnedToCore(taskLoop, "SWARM_M138", stackSize, this, priority, &_task, core) == pdPASS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Notify a consumer task when an event is added - so it can wait with ulTaskNotifyTake
+    @param  consumer
+            The consumer task. NULL == no notification
+*/
+/**************************************************************************/
+void SWARM_M138_Modem_Task::setConsumerTask(TaskHandle_t consumer)
+{
+  _consumer = consumer;
+}
+
+// The FreeRTOS task: service the modem. Sleep until a request is submitted - or the poll interval has passed
+void SWARM_M138_Modem_Task::taskLoop(void *parameter)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)parameter;
+  for (;;)
+  {
+    if (!modemTask->service())
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SWARM_M138_TASK_POLL_MILLIS));
+  }
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  Producer: copy a message into the producer's TX ring. Never blocks.
+            A SWARM_M138_TASK_EVENT_TX_QUEUED event - with the same tag - reports the msg_id (or the error)
+    @param  producer
+            The producer: 0 to SWARM_M138_TASK_PRODUCERS - 1. Each producer index must only be used by one task
+    @param  message
+            The message. The data is copied: it can be reused as soon as submit returns
+    @param  tag
+            Copied into the TX_QUEUED event - to match it to the message
+    @return true if the message was added. false if the ring is full - or the message is too long
+*/
+/**************************************************************************/
+bool SWARM_M138_Modem_Task::submit(uint8_t producer, const Swarm_M138_Tx_Descriptor_t *message, uint32_t tag)
+{
+  if ((producer >= SWARM_M138_TASK_PRODUCERS) || (message == NULL) || (message->len > SWARM_M138_MAX_PACKET_LENGTH_BYTES)
+      || ((message->data == NULL) && (message->len > 0)))
+    return (false);
+
+  Swarm_M138_Task_Tx_Ring_t *ring = &_txRings[producer];
+  uint8_t head = ring->head;
+  if ((uint8_t)(head - ring->tail) >= SWARM_M138_TASK_TX_SLOTS) // Full
+    return (false);
+  SWARM_M138_RING_BARRIER(); // Don't write the slot until the modem task has finished with it
+
+  Swarm_M138_Task_Request_t *request = &ring->slots[head & (SWARM_M138_TASK_TX_SLOTS - 1)];
+  if (message->len > 0)
+    memcpy(request->data, message->data, message->len);
+  request->len = (uint16_t)message->len;
+  request->useAppID = message->useAppID;
+  request->appID = message->appID;
+  request->hold = message->hold;
+  request->epoch = message->epoch;
+  request->tag = tag;
+
+  SWARM_M138_RING_BARRIER(); // Write the slot before publishing it
+  ring->head = head + 1;
+
+#ifdef ARDUINO_ARCH_ESP32
+  if (_task != NULL)
+    xTaskNotifyGive(_task); // Wake the modem task
+#endif
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Producer: get the number of free slots in the producer's TX ring
+    @param  producer
+            The producer: 0 to SWARM_M138_TASK_PRODUCERS - 1
+    @return The number of messages which can be submitted now
+*/
+/**************************************************************************/
+uint8_t SWARM_M138_Modem_Task::getFreeSlots(uint8_t producer)
+{
+  if (producer >= SWARM_M138_TASK_PRODUCERS)
+    return (0);
+  return (SWARM_M138_TASK_TX_SLOTS - (uint8_t)(_txRings[producer].head - _txRings[producer].tail));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Consumer: copy the oldest event out of the RX ring. Never blocks
+    @param  event
+            The event is copied into here
+    @return true if there was an event
+*/
+/**************************************************************************/
+bool SWARM_M138_Modem_Task::getEvent(Swarm_M138_Task_Event_t *event)
+{
+  if (event == NULL)
+    return (false);
+
+  uint8_t tail = _eventTail;
+  if (_eventHead == tail) // Empty
+    return (false);
+  SWARM_M138_RING_BARRIER(); // Read the slot after the head
+
+  memcpy(event, &_events[tail & (SWARM_M138_TASK_RX_SLOTS - 1)], sizeof(Swarm_M138_Task_Event_t));
+
+  SWARM_M138_RING_BARRIER(); // Finish with the slot before releasing it
+  _eventTail = tail + 1;
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Consumer: get the number of events waiting
+    @return The count
+*/
+/**************************************************************************/
+uint8_t SWARM_M138_Modem_Task::getEventCount(void)
+{
+  return ((uint8_t)(_eventHead - _eventTail));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of events lost because the RX ring was full.
+            Increase SWARM_M138_TASK_RX_SLOTS - or call getEvent more often - if this is not zero
+    @return The count
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Modem_Task::getEventsDropped(void)
+{
+  return (_eventsDropped);
+}
+
+// The next free event slot - cleared - or NULL if the ring is full. Only called by the modem task
+Swarm_M138_Task_Event_t *SWARM_M138_Modem_Task::eventSlot(void)
+{
+  uint8_t head = _eventHead;
+  if ((uint8_t)(head - _eventTail) >= SWARM_M138_TASK_RX_SLOTS) // Full
+  {
+    _eventsDropped++;
+    return (NULL);
+  }
+  SWARM_M138_RING_BARRIER(); // Don't write the slot until the consumer has finished with it
+
+  Swarm_M138_Task_Event_t *event = &_events[head & (SWARM_M138_TASK_RX_SLOTS - 1)];
+  memset(event, 0, sizeof(Swarm_M138_Task_Event_t));
+  return (event);
+}
+
+// Publish the event written into eventSlot
+void SWARM_M138_Modem_Task::publishEvent(void)
+{
+  SWARM_M138_RING_BARRIER(); // Write the slot before publishing it
+  _eventHead = _eventHead + 1;
+
+#ifdef ARDUINO_ARCH_ESP32
+  if (_consumer != NULL)
+    xTaskNotifyGive(_consumer);
+#endif
+}
+
+// $DT
+void SWARM_M138_Modem_Task::dateTimeCallback(const Swarm_M138_DateTimeData_t &dateTime, void *context)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)context;
+  Swarm_M138_Task_Event_t *event = modemTask->eventSlot();
+  if (event == NULL)
+    return;
+  event->type = SWARM_M138_TASK_EVENT_DATE_TIME;
+  memcpy(&event->dateTime, &dateTime, sizeof(Swarm_M138_DateTimeData_t));
+  modemTask->publishEvent();
+}
+
+// $RD. Convert the ASCII Hex into binary
+void SWARM_M138_Modem_Task::receiveMessageCallback(bool hasAppID, uint16_t appID, int16_t rssi, int16_t snr, int16_t fdev, const char *asciiHex, void *context)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)context;
+  Swarm_M138_Task_Event_t *event = modemTask->eventSlot();
+  if (event == NULL)
+    return;
+  event->type = SWARM_M138_TASK_EVENT_RX_DATA;
+  event->hasAppID = hasAppID;
+  event->appID = appID;
+  event->rssi = rssi;
+  event->snr = snr;
+  event->fdev = fdev;
+  while ((asciiHex != NULL) && (event->len < SWARM_M138_MAX_PACKET_LENGTH_BYTES)
+         && (swarm_m138_hex_value(asciiHex[0]) >= 0) && (swarm_m138_hex_value(asciiHex[1]) >= 0))
+  {
+    event->data[event->len++] = (uint8_t)((swarm_m138_hex_value(asciiHex[0]) << 4) | swarm_m138_hex_value(asciiHex[1]));
+    asciiHex += 2;
+  }
+  modemTask->publishEvent();
+}
+
+// $SL WAKE
+void SWARM_M138_Modem_Task::sleepWakeCallback(Swarm_M138_Wake_Cause_e cause, void *context)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)context;
+  Swarm_M138_Task_Event_t *event = modemTask->eventSlot();
+  if (event == NULL)
+    return;
+  event->type = SWARM_M138_TASK_EVENT_SLEEP_WAKE;
+  event->wakeCause = cause;
+  modemTask->publishEvent();
+}
+
+// $M138. Copy the text - if there is any
+void SWARM_M138_Modem_Task::modemStatusCallback(Swarm_M138_Modem_Status_e status, const char *data, void *context)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)context;
+  Swarm_M138_Task_Event_t *event = modemTask->eventSlot();
+  if (event == NULL)
+    return;
+  event->type = SWARM_M138_TASK_EVENT_MODEM_STATUS;
+  event->modemStatus = status;
+  if (data != NULL)
+  {
+    strncpy((char *)event->data, data, SWARM_M138_MAX_PACKET_LENGTH_BYTES - 1); // The slot was cleared: event->data is null-terminated
+    event->len = (uint16_t)strlen((const char *)event->data);
+  }
+  modemTask->publishEvent();
+}
+
+// $TD SENT
+void SWARM_M138_Modem_Task::transmitDataCallback(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context)
+{
+  SWARM_M138_Modem_Task *modemTask = (SWARM_M138_Modem_Task *)context;
+  Swarm_M138_Task_Event_t *event = modemTask->eventSlot();
+  if (event == NULL)
+    return;
+  event->type = SWARM_M138_TASK_EVENT_TX_SENT;
+  event->rssi = rssi_sat;
+  event->snr = snr;
+  event->fdev = fdev;
+  event->msg_id = msg_id;
+  modemTask->publishEvent();
+}
@@ -0,0 +1,149 @@
+/*!
+ * @file SparkFun_Swarm_M138_Modem_Task.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Modem_Task: run the Swarm M138 modem in its own RTOS task.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_MODEM_TASK_H
+#define SPARKFUN_SWARM_M138_MODEM_TASK_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+/** Multi-task (RTOS) modem task
+ *
+ *  SWARM_M138 is not thread-safe. SWARM_M138_Modem_Task owns the modem: after begin, only the modem task may call it.
+ *  Application tasks talk to the modem task through lock-free single-producer / single-consumer rings:
+ *    Each producer task has its own TX request ring - SWARM_M138_TASK_PRODUCERS of them. submit copies the message in.
+ *    One consumer task reads the events - TX queued, $TD SENT, $RD, $SL WAKE, $M138 and $DT - with getEvent.
+ *  Neither side ever blocks: the 1.5-5 s command waits only hold up the modem task.
+ *  On the ESP32, start creates the modem task. On other RTOS builds (e.g. STM32 FreeRTOS), create a task which calls
+ *  service() in a loop. begin sets the modem's context callbacks: run one modem task per modem.
+ */
+#ifndef SWARM_M138_TASK_PRODUCERS
+#define SWARM_M138_TASK_PRODUCERS 2 ///< The number of TX request rings: one per producer task
+#endif
+#ifndef SWARM_M138_TASK_TX_SLOTS
+#define SWARM_M138_TASK_TX_SLOTS 4 ///< The number of requests in each TX ring. A power of two: 2 to 128
+#endif
+#ifndef SWARM_M138_TASK_RX_SLOTS
+#define SWARM_M138_TASK_RX_SLOTS 8 ///< The number of events in the RX ring. A power of two: 2 to 128
+#endif
+#if ((SWARM_M138_TASK_TX_SLOTS & (SWARM_M138_TASK_TX_SLOTS - 1)) != 0) || (SWARM_M138_TASK_TX_SLOTS < 2) || (SWARM_M138_TASK_TX_SLOTS > 128)
+#error SWARM_M138_TASK_TX_SLOTS must be a power of two: 2 to 128
+#endif
+#if ((SWARM_M138_TASK_RX_SLOTS & (SWARM_M138_TASK_RX_SLOTS - 1)) != 0) || (SWARM_M138_TASK_RX_SLOTS < 2) || (SWARM_M138_TASK_RX_SLOTS > 128)
+#error SWARM_M138_TASK_RX_SLOTS must be a power of two: 2 to 128
+#endif
+#define SWARM_M138_TASK_POLL_MILLIS 50 ///< How often the ESP32 modem task checks for unsolicited messages when it has nothing else to do
+
+/** The modem task events */
+typedef enum
+{
+  SWARM_M138_TASK_EVENT_TX_QUEUED = 0, // A request has been queued by the modem (msg_id) - or rejected (err). tag is the request's tag
+  SWARM_M138_TASK_EVENT_TX_SENT,       // $TD SENT: msg_id, rssi, snr, fdev
+  SWARM_M138_TASK_EVENT_RX_DATA,       // $RD: appID (if hasAppID), rssi, snr, fdev, data and len
+  SWARM_M138_TASK_EVENT_SLEEP_WAKE,    // $SL WAKE: wakeCause
+  SWARM_M138_TASK_EVENT_MODEM_STATUS,  // $M138: modemStatus. data holds the text - null-terminated
+  SWARM_M138_TASK_EVENT_DATE_TIME      // $DT: dateTime
+} Swarm_M138_Task_Event_e;
+
+/** A struct to hold one modem task event */
+typedef struct
+{
+  Swarm_M138_Task_Event_e type;
+  Swarm_M138_Error_e err;
+  uint32_t tag;
+  uint64_t msg_id;
+  bool hasAppID;
+  uint16_t appID;
+  int16_t rssi;
+  int16_t snr;
+  int16_t fdev;
+  Swarm_M138_Wake_Cause_e wakeCause;
+  Swarm_M138_Modem_Status_e modemStatus;
+  Swarm_M138_DateTimeData_t dateTime;
+  uint16_t len;
+  uint8_t data[SWARM_M138_MAX_PACKET_LENGTH_BYTES];
+} Swarm_M138_Task_Event_t;
+
+class SWARM_M138_Modem_Task
+{
+public:
+  SWARM_M138_Modem_Task(void);
+
+  void begin(SWARM_M138 &modem); // Take ownership of the modem - and set its context callbacks. It must have been begun
+  bool service(void);            // Modem task: queue the waiting requests and check for unsolicited messages. Return true if there was anything to do
+#ifdef ARDUINO_ARCH_ESP32
+  bool start(uint32_t stackSize = 4096, UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY); // Create the modem task. It calls service
+  void setConsumerTask(TaskHandle_t consumer); // Notify this task (xTaskNotifyGive) when an event is added. NULL == no notification
+#endif
+
+  // Producers: one task per producer index
+  bool submit(uint8_t producer, const Swarm_M138_Tx_Descriptor_t *message, uint32_t tag = 0); // Copy the message into the producer's ring. Return false if it is full
+  uint8_t getFreeSlots(uint8_t producer); // The number of requests the producer can submit now
+
+  // Consumer: one task
+  bool getEvent(Swarm_M138_Task_Event_t *event); // Copy the oldest event out of the ring. Return false if there are none
+  uint8_t getEventCount(void);                   // The number of events waiting
+  uint32_t getEventsDropped(void);               // The number of events lost because the ring was full
+
+private:
+  // One TX request
+  typedef struct
+  {
+    uint8_t data[SWARM_M138_MAX_PACKET_LENGTH_BYTES];
+    uint16_t len;
+    bool useAppID;
+    uint16_t appID;
+    uint32_t hold;
+    uint32_t epoch;
+    uint32_t tag;
+  } Swarm_M138_Task_Request_t;
+
+  // A single-producer / single-consumer ring of TX requests. The indices run freely: head - tail is the count
+  typedef struct
+  {
+    Swarm_M138_Task_Request_t slots[SWARM_M138_TASK_TX_SLOTS];
+    volatile uint8_t head; // Written by the producer
+    volatile uint8_t tail; // Written by the modem task
+  } Swarm_M138_Task_Tx_Ring_t;
+
+  SWARM_M138 *_modem;
+  Swarm_M138_Task_Tx_Ring_t _txRings[SWARM_M138_TASK_PRODUCERS];
+  uint8_t _nextProducer; // Where the next search for a request starts. Shares the modem between the producers
+  Swarm_M138_Task_Event_t _events[SWARM_M138_TASK_RX_SLOTS];
+  volatile uint8_t _eventHead; // Written by the modem task
+  volatile uint8_t _eventTail; // Written by the consumer
+  volatile uint32_t _eventsDropped;
+#ifdef ARDUINO_ARCH_ESP32
+  TaskHandle_t _task;
+  TaskHandle_t _consumer;
+  static void taskLoop(void *parameter); // The FreeRTOS task
+#endif
+
+  Swarm_M138_Task_Event_t *eventSlot(void); // The next free event slot - or NULL if the ring is full
+  void publishEvent(void);                  // Publish the event written into eventSlot
+
+  // The modem callbacks. context is the modem task
+  static void dateTimeCallback(const Swarm_M138_DateTimeData_t &dateTime, void *context);
+  static void receiveMessageCallback(bool hasAppID, uint16_t appID, int16_t rssi, int16_t snr, int16_t fdev, const char *asciiHex, void *context);
+  static void sleepWakeCallback(Swarm_M138_Wake_Cause_e cause, void *context);
+  static void modemStatusCallback(Swarm_M138_Modem_Status_e status, const char *data, void *context);
+  static void transmitDataCallback(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context);
+};
+
+#endif // SPARKFUN_SWARM_M138_MODEM_TASK_H
@@ -0,0 +1,916 @@
+/*!
+ * @file SparkFun_Swarm_M138_Pass_Predictor.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Pass_Predictor: predict the passes of the Swarm satellites from their orbital elements.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Pass_Predictor.h"
+#include "SparkFun_Swarm_M138_TLE_Store.h"
+#include "SparkFun_Swarm_M138_Batch_Propagator.h"
+
+// SWARM_M138_Pass_Predictor: predict the passes of the Swarm satellites
+
+// The TLE mean elements are defined using the WGS72 gravity model
+static const double SWARM_M138_EARTH_RADIUS = 6378.135;       // km (WGS72)
+static const double SWARM_M138_EARTH_MU = 398600.8;           // km^3 / s^2 (WGS72)
+static const double SWARM_M138_EARTH_J2 = 0.001082616;        // (WGS72)
+static const double SWARM_M138_EARTH_ROTATION = 7.29211514670698e-5; // Radians per second
+// The site position uses WGS84: the same as the modem's GPS
+static const double SWARM_M138_WGS84_A = 6378.137;            // km
+static const double SWARM_M138_WGS84_F = 1.0 / 298.257223563;
+static const double SWARM_M138_TWO_PI = 6.283185307179586;
+static const double SWARM_M138_DEG_TO_RAD = 0.017453292519943295;
+static const double SWARM_M138_PASS_ANGLE_MARGIN = 0.0175;    // Add 1 degree to the visibility cone: the site is not on a sphere
+
+// The Greenwich mean sidereal time (IAU-82) in radians at time (Unix seconds)
+static double swarm_m138_gmst(double time)
+{
+  double tut1 = ((time / 86400.0) + 2440587.5 - 2451545.0) / 36525.0;
+  double gmst = (-6.2e-6 * tut1 * tut1 * tut1) + (0.093104 * tut1 * tut1) + (((876600.0 * 3600.0) + 8640184.812866) * tut1) + 67310.54841;
+  return (fmod(gmst * SWARM_M138_DEG_TO_RAD / 240.0, SWARM_M138_TWO_PI));
+}
+
+// Copy a fixed-width TLE field and convert it to a double. Add a leading "0." if impliedDecimal is true
+static double swarm_m138_tle_field(const char *line, size_t start, size_t len, bool impliedDecimal)
+{
+  char field[16]; // Use the stack, not the heap
+  size_t i = 0;
+  if (impliedDecimal)
+  {
+    field[i++] = '0';
+    field[i++] = '.';
+  }
+  for (size_t j = 0; (j < len) && (i < (sizeof(field) - 1)); j++)
+    field[i++] = line[start + j];
+  field[i] = 0;
+  return (atof(field));
+}
+
+// Check the TLE line checksum: the sum of the digits - counting each minus as one - modulo 10, in column 69
+static bool swarm_m138_tle_checksum(const char *line)
+{
+  int sum = 0;
+  for (size_t i = 0; i < 68; i++)
+  {
+    if (line[i] == 0)
+      return (false);
+    if ((line[i] >= '0') && (line[i] <= '9'))
+      sum += line[i] - '0';
+    else if (line[i] == '-')
+      sum += 1;
+  }
+  return ((line[68] >= '0') && (line[68] <= '9') && ((sum % 10) == (line[68] - '0')));
+}
+
+// The number of days from 1970-01-01 to year-month-day (proleptic Gregorian calendar)
+static int32_t swarm_m138_days_from_civil(int32_t year, uint8_t month, uint8_t day)
+{
+  year -= (month <= 2) ? 1 : 0;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yoe = year - era * 400;
+  int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (era * 146097 + doe - 719468);
+}
+
+SWARM_M138_Pass_Predictor::SWARM_M138_Pass_Predictor(void)
+{
+  setSite(0.0, 0.0, 0.0);
+  setMinimumElevation();
+  _numPasses = 0;
+  _nextPass = 0;
+  _lastQuery = 0;
+  _tableStart = 0;
+  _tableEnd = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the position of the site
+    @param  latitude
+            Degrees: +/- 90
+    @param  longitude
+            Degrees: +/- 180
+    @param  altitude
+            Metres above mean sea level
+*/
+/**************************************************************************/
+void SWARM_M138_Pass_Predictor::setSite(double latitude, double longitude, double altitude)
+{
+  double lat = latitude * SWARM_M138_DEG_TO_RAD;
+  double lon = longitude * SWARM_M138_DEG_TO_RAD;
+  double alt = altitude / 1000.0;
+  double e2 = SWARM_M138_WGS84_F * (2.0 - SWARM_M138_WGS84_F);
+  double sinLat = sin(lat);
+  double cosLat = cos(lat);
+  double N = SWARM_M138_WGS84_A / sqrt(1.0 - (e2 * sinLat * sinLat)); // The prime vertical radius of curvature
+
+  _siteECEF[0] = (N + alt) * cosLat * cos(lon);
+  _siteECEF[1] = (N + alt) * cosLat * sin(lon);
+  _siteECEF[2] = ((N * (1.0 - e2)) + alt) * sinLat;
+  _siteUp[0] = cosLat * cos(lon);
+  _siteUp[1] = cosLat * sin(lon);
+  _siteUp[2] = sinLat;
+  _siteRadius = sqrt((_siteECEF[0] * _siteECEF[0]) + (_siteECEF[1] * _siteECEF[1]) + (_siteECEF[2] * _siteECEF[2]));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the position of the site from the modem's $GN message
+    @param  info
+            A pointer to the geospatial information - from getGeospatialInfo or the $GN callback
+*/
+/**************************************************************************/
+void SWARM_M138_Pass_Predictor::setSite(const Swarm_M138_GeospatialData_t *info)
+{
+  setSite((double)info->lat, (double)info->lon, (double)info->alt);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the minimum elevation. Call computePasses again after changing it
+    @param  elevation
+            The minimum elevation in degrees. Passes lower than this are ignored
+*/
+/**************************************************************************/
+void SWARM_M138_Pass_Predictor::setMinimumElevation(double elevation)
+{
+  _minElevation = elevation * SWARM_M138_DEG_TO_RAD;
+  _sinMinElevation = sin(_minElevation);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Parse a Two-Line Element set
+    @param  lineOne
+            Line one of the TLE: "1 43142U ..."
+    @param  lineTwo
+            Line two of the TLE: "2 43142 ..."
+    @param  elements
+            The parsed orbital elements are copied into here
+    @return true if both lines are valid: the line numbers, NORAD IDs and checksums agree
+*/
+/**************************************************************************/
+bool SWARM_M138_Pass_Predictor::parseTLE(const char *lineOne, const char *lineTwo, Swarm_M138_Orbital_Elements_t *elements)
+{
+  if ((lineOne == NULL) || (lineTwo == NULL) || (elements == NULL))
+    return (false);
+
+  if ((lineOne[0] != '1') || (lineTwo[0] != '2'))
+    return (false);
+
+  if ((swarm_m138_tle_checksum(lineOne) == false) || (swarm_m138_tle_checksum(lineTwo) == false))
+    return (false);
+
+  if (strncmp(&lineOne[2], &lineTwo[2], 5) != 0) // Check the NORAD IDs match
+    return (false);
+
+  elements->noradID = (uint32_t)swarm_m138_tle_field(lineOne, 2, 5, false);
+
+  // The epoch: two-digit year (57-99 == 19xx) and the fractional day of the year (1.0 == midnight on January 1st)
+  int32_t year = (int32_t)swarm_m138_tle_field(lineOne, 18, 2, false);
+  year += (year < 57) ? 2000 : 1900;
+  double dayOfYear = swarm_m138_tle_field(lineOne, 20, 12, false);
+  elements->epoch = (((double)swarm_m138_days_from_civil(year, 1, 1)) + dayOfYear - 1.0) * 86400.0;
+
+  elements->meanMotionDot = swarm_m138_tle_field(lineOne, 33, 10, false);
+
+  elements->inclination = swarm_m138_tle_field(lineTwo, 8, 8, false) * SWARM_M138_DEG_TO_RAD;
+  elements->raan = swarm_m138_tle_field(lineTwo, 17, 8, false) * SWARM_M138_DEG_TO_RAD;
+  elements->eccentricity = swarm_m138_tle_field(lineTwo, 26, 7, true);
+  elements->argPerigee = swarm_m138_tle_field(lineTwo, 34, 8, false) * SWARM_M138_DEG_TO_RAD;
+  elements->meanAnomaly = swarm_m138_tle_field(lineTwo, 43, 8, false) * SWARM_M138_DEG_TO_RAD;
+  elements->meanMotion = swarm_m138_tle_field(lineTwo, 52, 11, false);
+
+  return (elements->meanMotion > 0.0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Convert the modem's date and time into Unix time
+    @param  dateTime
+            A pointer to the date and time - from getDateTime or the $DT callback
+    @return The number of seconds since 1970-01-01 00:00:00 UTC
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Pass_Predictor::dateTimeToUnix(const Swarm_M138_DateTimeData_t *dateTime)
+{
+  int32_t days = swarm_m138_days_from_civil((int32_t)dateTime->YYYY, dateTime->MM, dateTime->DD);
+  return (((uint32_t)days * 86400UL) + ((uint32_t)dateTime->hh * 3600UL) + ((uint32_t)dateTime->mm * 60UL) + (uint32_t)dateTime->ss);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table: find every pass of every satellite from start to start + duration.
+            The table holds the SWARM_M138_PASS_TABLE_SIZE earliest passes. If it fills up, getTableEnd
+            returns the AOS of the last pass: call computePasses again from there once the table is used up.
+    @param  satellites
+            The orbital elements of the satellites. E.g. from parseTLE. The elements must remain valid while the table is in use
+    @param  numSatellites
+            The number of satellites
+    @param  start
+            The start of the time range: Unix time (seconds)
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint32_t start, uint32_t duration)
+{
+  beginTable(start, duration);
+
+  for (uint16_t sat = 0; sat < numSatellites; sat++)
+    predictSatellite(&satellites[sat]);
+
+  return (endTable());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table: find every pass of every satellite from start to start + duration
+    @param  satellites
+            The orbital elements of the satellites. E.g. from parseTLE
+    @param  numSatellites
+            The number of satellites
+    @param  start
+            The start of the time range - from getDateTime
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, const Swarm_M138_DateTimeData_t *start, uint32_t duration)
+{
+  return (computePasses(satellites, numSatellites, dateTimeToUnix(start), duration));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table from a binary TLE image. The records are read one at a time:
+            the constellation is never loaded into RAM
+    @param  store
+            The TLE image - after SWARM_M138_TLE_Store::begin
+    @param  start
+            The start of the time range: Unix time (seconds)
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_TLE_Store &store, uint32_t start, uint32_t duration)
+{
+  beginTable(start, duration);
+
+  for (uint16_t sat = 0; sat < store.getCount(); sat++)
+  {
+    Swarm_M138_Orbital_Elements_t elements; // Use the stack, not the heap
+    if (store.getElements(sat, &elements))
+      predictSatellite(&elements);
+  }
+
+  return (endTable());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table from a binary TLE image
+    @param  store
+            The TLE image - after SWARM_M138_TLE_Store::begin
+    @param  start
+            The start of the time range - from getDateTime
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_TLE_Store &store, const Swarm_M138_DateTimeData_t *start, uint32_t duration)
+{
+  return (computePasses(store, dateTimeToUnix(start), duration));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table - stepping the near-circular satellites together. This is much faster than
+            the one-satellite-at-a-time computePasses on boards with a single-precision FPU (e.g. ESP32)
+            and on hosts with SSE2 or NEON
+    @param  batch
+            The workspace. It holds up to SWARM_M138_BATCH_SIZE satellites. Any others are predicted one at a time
+    @param  satellites
+            The orbital elements of the satellites. E.g. from parseTLE
+    @param  numSatellites
+            The number of satellites
+    @param  start
+            The start of the time range: Unix time (seconds)
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_Batch_Propagator &batch, const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint32_t start, uint32_t duration)
+{
+  batch._satellites = satellites;
+  batch._store = NULL;
+
+  beginTable(start, duration);
+  computeBatch(batch, numSatellites);
+  return (endTable());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table - stepping the near-circular satellites together
+    @param  batch
+            The workspace
+    @param  satellites
+            The orbital elements of the satellites. E.g. from parseTLE
+    @param  numSatellites
+            The number of satellites
+    @param  start
+            The start of the time range - from getDateTime
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_Batch_Propagator &batch, const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, const Swarm_M138_DateTimeData_t *start, uint32_t duration)
+{
+  return (computePasses(batch, satellites, numSatellites, dateTimeToUnix(start), duration));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table from a binary TLE image - stepping the near-circular satellites together.
+            Each record is read when the batch is recalculated, and when a pass is refined
+    @param  batch
+            The workspace
+    @param  store
+            The TLE image - after SWARM_M138_TLE_Store::begin
+    @param  start
+            The start of the time range: Unix time (seconds)
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_Batch_Propagator &batch, SWARM_M138_TLE_Store &store, uint32_t start, uint32_t duration)
+{
+  batch._satellites = NULL;
+  batch._store = &store;
+
+  beginTable(start, duration);
+  computeBatch(batch, store.getCount());
+  return (endTable());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build the pass table from a binary TLE image - stepping the near-circular satellites together
+    @param  batch
+            The workspace
+    @param  store
+            The TLE image - after SWARM_M138_TLE_Store::begin
+    @param  start
+            The start of the time range - from getDateTime
+    @param  duration
+            The length of the time range in seconds
+    @return The number of passes in the table
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::computePasses(SWARM_M138_Batch_Propagator &batch, SWARM_M138_TLE_Store &store, const Swarm_M138_DateTimeData_t *start, uint32_t duration)
+{
+  return (computePasses(batch, store, dateTimeToUnix(start), duration));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the pass which is in progress - or the next one. Nothing is recomputed:
+            the search starts where the last one finished, so calling this on every wake is cheap
+    @param  now
+            The current time: Unix time (seconds)
+    @param  pass
+            The pass is copied into here
+    @return true if a pass was found. false if the table holds no more passes: call computePasses
+*/
+/**************************************************************************/
+bool SWARM_M138_Pass_Predictor::getNextPass(uint32_t now, Swarm_M138_Pass_t *pass)
+{
+  if (now < _lastQuery) // Time has gone backwards. Start again
+    _nextPass = 0;
+  _lastQuery = now;
+
+  while ((_nextPass < _numPasses) && (_passes[_nextPass].los <= now))
+    _nextPass++;
+
+  if (_nextPass >= _numPasses)
+    return (false);
+
+  if (pass != NULL)
+    memcpy(pass, &_passes[_nextPass], sizeof(Swarm_M138_Pass_t));
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the pass which is in progress - or the next one
+    @param  now
+            The current time - from getDateTime
+    @param  pass
+            The pass is copied into here
+    @return true if a pass was found. false if the table holds no more passes: call computePasses
+*/
+/**************************************************************************/
+bool SWARM_M138_Pass_Predictor::getNextPass(const Swarm_M138_DateTimeData_t *now, Swarm_M138_Pass_t *pass)
+{
+  return (getNextPass(dateTimeToUnix(now), pass));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of passes in the table
+    @return The number of passes
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Pass_Predictor::getPassCount(void)
+{
+  return (_numPasses);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get a pass from the table. The passes are sorted by AOS
+    @param  index
+            0 to getPassCount() - 1
+    @param  pass
+            The pass is copied into here
+    @return true if index is valid
+*/
+/**************************************************************************/
+bool SWARM_M138_Pass_Predictor::getPass(uint16_t index, Swarm_M138_Pass_t *pass)
+{
+  if ((index >= _numPasses) || (pass == NULL))
+    return (false);
+  memcpy(pass, &_passes[index], sizeof(Swarm_M138_Pass_t));
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the start of the time range covered by the table
+    @return Unix time (seconds)
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Pass_Predictor::getTableStart(void)
+{
+  return (_tableStart);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the end of the time range covered by the table.
+            If the table is full, this is the AOS of the last pass in the table
+    @return Unix time (seconds)
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Pass_Predictor::getTableEnd(void)
+{
+  return (_tableEnd);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Calculate the elevation of a satellite
+    @param  satellite
+            The orbital elements of the satellite
+    @param  time
+            Unix time (seconds)
+    @return The elevation in degrees. Negative if the satellite is below the horizon
+*/
+/**************************************************************************/
+double SWARM_M138_Pass_Predictor::getElevation(const Swarm_M138_Orbital_Elements_t *satellite, uint32_t time)
+{
+  Swarm_M138_Propagator_t prop; // Use the stack, not the heap
+  initPropagator(satellite, &prop);
+  double ecef[3];
+  double cosAngle;
+  propagate(&prop, (double)time, ecef);
+  return (asin(sinElevation(ecef, &cosAngle)) / SWARM_M138_DEG_TO_RAD);
+}
+
+// Empty the table
+void SWARM_M138_Pass_Predictor::beginTable(uint32_t start, uint32_t duration)
+{
+  _numPasses = 0;
+  _nextPass = 0;
+  _lastQuery = start;
+  _tableStart = start;
+  _tableEnd = start + duration;
+}
+
+// Add the passes of one satellite from _tableStart to _tableEnd
+void SWARM_M138_Pass_Predictor::predictSatellite(const Swarm_M138_Orbital_Elements_t *satellite)
+{
+  uint32_t start = _tableStart;
+  double end = (double)_tableEnd;
+
+  Swarm_M138_Propagator_t prop; // Use the stack, not the heap
+  initPropagator(satellite, &prop);
+
+  Swarm_M138_Pass_t pass;
+  pass.noradID = satellite->noradID;
+  bool visible = false;
+  double aos = start;
+  double maxSin = -1.0;
+  double previous = start;
+  double t = start;
+
+  while (true)
+  {
+    double ecef[3];
+    double cosAngle;
+    propagate(&prop, t, ecef);
+    double sinEl = sinElevation(ecef, &cosAngle);
+
+    if (sinEl >= _sinMinElevation)
+    {
+      if (visible == false) // Rising
+      {
+        aos = (t == (double)start) ? t : findCrossing(&prop, previous, t);
+        maxSin = sinEl;
+        visible = true;
+      }
+      else if (sinEl > maxSin)
+        maxSin = sinEl;
+    }
+    else if (visible == true) // Setting
+    {
+      pass.aos = (uint32_t)(aos + 0.5);
+      pass.los = (uint32_t)(findCrossing(&prop, t, previous) + 0.5);
+      pass.maxElevation = (float)(asin(maxSin) / SWARM_M138_DEG_TO_RAD);
+      addPass(&pass);
+      visible = false;
+    }
+
+    if (t >= end)
+    {
+      if (visible == true) // The pass is still in progress at the end of the range
+      {
+        pass.aos = (uint32_t)(aos + 0.5);
+        pass.los = (uint32_t)end;
+        pass.maxElevation = (float)(asin(maxSin) / SWARM_M138_DEG_TO_RAD);
+        addPass(&pass);
+      }
+      break;
+    }
+
+    // While the satellite is outside its visibility cone, skip ahead by the shortest time it could take to enter it
+    double step = SWARM_M138_PASS_FINE_STEP;
+    if ((visible == false) && (cosAngle < prop.cosMaxAngle))
+    {
+      double skip = (acos(cosAngle) - prop.maxAngle) / prop.angularRate;
+      if (skip > step)
+        step = skip;
+    }
+
+    // Once the table is full, stop when this satellite can no longer rise before the last pass in the table
+    if ((visible == false) && (_numPasses >= SWARM_M138_PASS_TABLE_SIZE)
+        && ((t + step) >= (double)_passes[SWARM_M138_PASS_TABLE_SIZE - 1].aos))
+      break;
+
+    previous = t;
+    t += step;
+    if (t > end)
+      t = end;
+  }
+}
+
+// Trim the end of the range if the table is full. Return the number of passes
+uint16_t SWARM_M138_Pass_Predictor::endTable(void)
+{
+  if ((_numPasses >= SWARM_M138_PASS_TABLE_SIZE) && (_passes[_numPasses - 1].aos < _tableEnd))
+    _tableEnd = _passes[_numPasses - 1].aos; // Passes which start after this may be missing
+
+  return (_numPasses);
+}
+
+// Build the table for _tableStart to _tableEnd. The near-circular satellites are stepped together.
+// The others - and any beyond SWARM_M138_BATCH_SIZE - are predicted one at a time.
+// Return the number of satellites in the batch
+uint16_t SWARM_M138_Pass_Predictor::computeBatch(SWARM_M138_Batch_Propagator &batch, uint16_t numSatellites)
+{
+  uint32_t start = _tableStart;
+  double end = (double)_tableEnd;
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    batch._site[i] = (float)_siteECEF[i];
+    batch._up[i] = (float)_siteUp[i];
+  }
+
+  batch._count = 0;
+  for (uint16_t sat = 0; sat < numSatellites; sat++)
+  {
+    Swarm_M138_Orbital_Elements_t elements; // Use the stack, not the heap
+    if (!batch.getElements(sat, &elements))
+      continue;
+
+    if ((elements.eccentricity <= SWARM_M138_BATCH_MAX_ECCENTRICITY) && (batch._count < SWARM_M138_BATCH_SIZE))
+    {
+      batch._index[batch._count] = sat;
+      batch._noradID[batch._count] = elements.noradID;
+      batch._visible[batch._count] = false;
+      batch._count++;
+    }
+    else
+      predictSatellite(&elements);
+  }
+
+  // Fill the spare lanes with a dummy satellite, so the vector kernels can run over whole groups of four
+  for (uint16_t lane = batch._count; lane < ((batch._count + 3) & ~3); lane++)
+  {
+    batch._cosM[lane] = batch._cosW[lane] = batch._cosL[lane] = batch._cosI[lane] = 1.0f;
+    batch._sinM[lane] = batch._sinW[lane] = batch._sinL[lane] = batch._sinI[lane] = 0.0f;
+    batch._stepCosM[lane] = batch._stepCosW[lane] = batch._stepCosL[lane] = 1.0f;
+    batch._stepSinM[lane] = batch._stepSinW[lane] = batch._stepSinL[lane] = 0.0f;
+    batch._a[lane] = (float)(SWARM_M138_EARTH_RADIUS * 2.0);
+    batch._e[lane] = 0.0f;
+  }
+
+  uint16_t numVisible = 0;
+
+  for (uint32_t k = 0; batch._count > 0; k++)
+  {
+    double t = (double)start + ((double)k * SWARM_M138_PASS_FINE_STEP);
+
+    if ((k % SWARM_M138_BATCH_RESEED) == 0)
+      seedBatch(batch, t);
+
+    batch.step(); // Calculate the elevations at t - and advance the batch to the next step
+
+    bool full = (_numPasses >= SWARM_M138_PASS_TABLE_SIZE);
+
+    for (uint16_t lane = 0; lane < batch._count; lane++)
+    {
+      double sinEl = batch._sinEl[lane];
+
+      if (sinEl >= _sinMinElevation)
+      {
+        if (batch._visible[lane] == false) // Rising
+        {
+          double aos = (k == 0) ? t : refineBatch(batch, lane, t - SWARM_M138_PASS_FINE_STEP, t);
+          if ((aos <= end) && ((!full) || (aos < (double)_passes[SWARM_M138_PASS_TABLE_SIZE - 1].aos))) // Ignore passes which would not be in the table
+          {
+            batch._aos[lane] = (uint32_t)(aos + 0.5);
+            batch._maxSin[lane] = (float)sinEl;
+            batch._visible[lane] = true;
+            numVisible++;
+          }
+        }
+        else if (sinEl > batch._maxSin[lane])
+          batch._maxSin[lane] = (float)sinEl;
+      }
+      else if (batch._visible[lane] == true) // Setting
+      {
+        double los = refineBatch(batch, lane, t, t - SWARM_M138_PASS_FINE_STEP);
+        Swarm_M138_Pass_t pass;
+        pass.noradID = batch._noradID[lane];
+        pass.aos = batch._aos[lane];
+        pass.los = (los > end) ? (uint32_t)end : (uint32_t)(los + 0.5);
+        pass.maxElevation = (float)(asin(batch._maxSin[lane]) / SWARM_M138_DEG_TO_RAD);
+        addPass(&pass);
+        batch._visible[lane] = false;
+        numVisible--;
+      }
+    }
+
+    if (t >= end)
+      break;
+
+    // Once the table is full, stop when no pass is in progress and every later pass would start after the last one in the table
+    if ((numVisible == 0) && (_numPasses >= SWARM_M138_PASS_TABLE_SIZE) && (t >= (double)_passes[SWARM_M138_PASS_TABLE_SIZE - 1].aos))
+      break;
+  }
+
+  for (uint16_t lane = 0; lane < batch._count; lane++)
+  {
+    if (batch._visible[lane] == true) // The pass is still in progress at the end of the range
+    {
+      Swarm_M138_Pass_t pass;
+      pass.noradID = batch._noradID[lane];
+      pass.aos = batch._aos[lane];
+      pass.los = (uint32_t)end;
+      pass.maxElevation = (float)(asin(batch._maxSin[lane]) / SWARM_M138_DEG_TO_RAD);
+      addPass(&pass);
+      batch._visible[lane] = false;
+    }
+  }
+
+  return (batch._count);
+}
+
+// Calculate the state of every satellite in the batch exactly at time - in double precision.
+// The steps are linearised at the middle of the next SWARM_M138_BATCH_RESEED steps
+void SWARM_M138_Pass_Predictor::seedBatch(SWARM_M138_Batch_Propagator &batch, double time)
+{
+  double gmst = swarm_m138_gmst(time);
+  double middle = 0.5 * SWARM_M138_BATCH_RESEED * SWARM_M138_PASS_FINE_STEP;
+
+  for (uint16_t lane = 0; lane < batch._count; lane++)
+  {
+    Swarm_M138_Orbital_Elements_t elements; // Use the stack, not the heap
+    if (!batch.getElements(batch._index[lane], &elements))
+      continue;
+
+    Swarm_M138_Propagator_t prop;
+    initPropagator(&elements, &prop);
+
+    double dt = time - elements.epoch;
+    double M = fmod(elements.meanAnomaly + (prop.meanAnomalyRate * dt) + (prop.meanMotionDot * dt * dt), SWARM_M138_TWO_PI);
+    double W = fmod(elements.argPerigee + (prop.argPerigeeRate * dt) + M, SWARM_M138_TWO_PI);
+    double L = fmod(elements.raan + (prop.raanRate * dt) - gmst, SWARM_M138_TWO_PI);
+    double rateM = prop.meanAnomalyRate + (2.0 * prop.meanMotionDot * (dt + middle));
+    double stepM = rateM * SWARM_M138_PASS_FINE_STEP;
+    double stepW = (prop.argPerigeeRate + rateM) * SWARM_M138_PASS_FINE_STEP;
+    double stepL = (prop.raanRate - SWARM_M138_EARTH_ROTATION) * SWARM_M138_PASS_FINE_STEP;
+
+    batch._cosM[lane] = (float)cos(M);
+    batch._sinM[lane] = (float)sin(M);
+    batch._cosW[lane] = (float)cos(W);
+    batch._sinW[lane] = (float)sin(W);
+    batch._cosL[lane] = (float)cos(L);
+    batch._sinL[lane] = (float)sin(L);
+    batch._stepCosM[lane] = (float)cos(stepM);
+    batch._stepSinM[lane] = (float)sin(stepM);
+    batch._stepCosW[lane] = (float)cos(stepW);
+    batch._stepSinW[lane] = (float)sin(stepW);
+    batch._stepCosL[lane] = (float)cos(stepL);
+    batch._stepSinL[lane] = (float)sin(stepL);
+    batch._a[lane] = (float)prop.semiMajorAxis;
+    batch._e[lane] = (float)elements.eccentricity;
+    batch._cosI[lane] = (float)cos(elements.inclination);
+    batch._sinI[lane] = (float)sin(elements.inclination);
+  }
+}
+
+// Bisect - with the full-precision propagator - to find when this satellite in the batch crosses the minimum elevation
+double SWARM_M138_Pass_Predictor::refineBatch(SWARM_M138_Batch_Propagator &batch, uint16_t lane, double below, double above)
+{
+  Swarm_M138_Orbital_Elements_t elements; // Use the stack, not the heap
+  if (!batch.getElements(batch._index[lane], &elements))
+    return (above);
+
+  Swarm_M138_Propagator_t prop;
+  initPropagator(&elements, &prop);
+  return (findCrossing(&prop, below, above));
+}
+
+// Derive the rates from the elements. The Kozai mean motion in the TLE is converted to the Brouwer mean motion (as SGP4 does)
+void SWARM_M138_Pass_Predictor::initPropagator(const Swarm_M138_Orbital_Elements_t *satellite, Swarm_M138_Propagator_t *prop)
+{
+  prop->elements = satellite;
+
+  double e = satellite->eccentricity;
+  double cosI = cos(satellite->inclination);
+  double theta2 = cosI * cosI;
+  double x3thm1 = (3.0 * theta2) - 1.0;
+  double betao2 = 1.0 - (e * e);
+  double betao = sqrt(betao2);
+
+  // Work in Earth radii and seconds
+  double ke = sqrt(SWARM_M138_EARTH_MU / (SWARM_M138_EARTH_RADIUS * SWARM_M138_EARTH_RADIUS * SWARM_M138_EARTH_RADIUS));
+  double n0 = satellite->meanMotion * SWARM_M138_TWO_PI / 86400.0;
+  double a1 = pow(ke / n0, 2.0 / 3.0);
+  double d1 = 0.75 * SWARM_M138_EARTH_J2 * x3thm1 / (betao * betao2);
+  double del = d1 / (a1 * a1);
+  double adel = a1 * (1.0 - (del * del) - (del * ((1.0 / 3.0) + (134.0 * del * del / 81.0))));
+  del = d1 / (adel * adel);
+  double n = n0 / (1.0 + del);
+  double a = pow(ke / n, 2.0 / 3.0);
+
+  // The secular J2 rates
+  double p = a * betao2;
+  double temp1 = 1.5 * SWARM_M138_EARTH_J2 * n / (p * p);
+  prop->meanMotion = n;
+  prop->semiMajorAxis = a * SWARM_M138_EARTH_RADIUS;
+  prop->meanAnomalyRate = n + (0.5 * temp1 * betao * x3thm1);
+  prop->argPerigeeRate = -0.5 * temp1 * (1.0 - (5.0 * theta2));
+  prop->raanRate = -temp1 * cosI;
+  prop->meanMotionDot = satellite->meanMotionDot * SWARM_M138_TWO_PI / (86400.0 * 86400.0);
+
+  // The visibility cone: the angle at the centre of the Earth between the site and the satellite (at apogee) at the minimum elevation
+  double cosMin = cos(_minElevation);
+  double ratio = _siteRadius * cosMin / (prop->semiMajorAxis * (1.0 + e));
+  if (ratio > 1.0)
+    ratio = 1.0;
+  prop->maxAngle = acos(ratio) - _minElevation + SWARM_M138_PASS_ANGLE_MARGIN;
+  prop->cosMaxAngle = cos(prop->maxAngle);
+
+  // The fastest the sub-satellite point can move across the ground: at perigee - plus the rotation of the Earth
+  prop->angularRate = (prop->meanAnomalyRate * (1.0 + e) * (1.0 + e) / (betao2 * betao)) + SWARM_M138_EARTH_ROTATION;
+  prop->angularRate *= 1.01;
+}
+
+// Calculate the position of the satellite at time (Unix seconds): Earth-centred, Earth-fixed (km)
+void SWARM_M138_Pass_Predictor::propagate(const Swarm_M138_Propagator_t *prop, double time, double *ecef)
+{
+  const Swarm_M138_Orbital_Elements_t *el = prop->elements;
+  double dt = time - el->epoch;
+
+  double M = fmod(el->meanAnomaly + (prop->meanAnomalyRate * dt) + (prop->meanMotionDot * dt * dt), SWARM_M138_TWO_PI);
+  double raan = el->raan + (prop->raanRate * dt);
+  double argp = el->argPerigee + (prop->argPerigeeRate * dt);
+  double e = el->eccentricity;
+
+  // Solve Kepler's equation for the eccentric anomaly
+  double E = M + (e * sin(M));
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    double delta = (E - (e * sin(E)) - M) / (1.0 - (e * cos(E)));
+    E -= delta;
+    if (fabs(delta) < 1.0e-10)
+      break;
+  }
+
+  // The position in the orbital plane
+  double a = prop->semiMajorAxis;
+  double xo = a * (cos(E) - e);
+  double yo = a * sqrt(1.0 - (e * e)) * sin(E);
+
+  // Rotate into the inertial frame
+  double cosO = cos(raan), sinO = sin(raan);
+  double cosW = cos(argp), sinW = sin(argp);
+  double cosI = cos(el->inclination), sinI = sin(el->inclination);
+  double x = (xo * ((cosO * cosW) - (sinO * sinW * cosI))) - (yo * ((cosO * sinW) + (sinO * cosW * cosI)));
+  double y = (xo * ((sinO * cosW) + (cosO * sinW * cosI))) + (yo * ((cosO * cosW * cosI) - (sinO * sinW)));
+  double z = (xo * sinW * sinI) + (yo * cosW * sinI);
+
+  // Rotate by the Greenwich sidereal time into the Earth-fixed frame
+  double gmst = swarm_m138_gmst(time);
+  double cosG = cos(gmst), sinG = sin(gmst);
+  ecef[0] = (cosG * x) + (sinG * y);
+  ecef[1] = (cosG * y) - (sinG * x);
+  ecef[2] = z;
+}
+
+// Return the sine of the elevation of the satellite. cosAngle returns the cosine of the angle between the site
+// and the satellite at the centre of the Earth
+double SWARM_M138_Pass_Predictor::sinElevation(const double *ecef, double *cosAngle)
+{
+  double rho[3];
+  for (uint8_t i = 0; i < 3; i++)
+    rho[i] = ecef[i] - _siteECEF[i];
+  double range = sqrt((rho[0] * rho[0]) + (rho[1] * rho[1]) + (rho[2] * rho[2]));
+  double radius = sqrt((ecef[0] * ecef[0]) + (ecef[1] * ecef[1]) + (ecef[2] * ecef[2]));
+
+  *cosAngle = ((ecef[0] * _siteECEF[0]) + (ecef[1] * _siteECEF[1]) + (ecef[2] * _siteECEF[2])) / (radius * _siteRadius);
+
+  return (((rho[0] * _siteUp[0]) + (rho[1] * _siteUp[1]) + (rho[2] * _siteUp[2])) / range);
+}
+
+// Bisect to find when the satellite crosses the minimum elevation. below and above can be in either order
+// Return the time (within SWARM_M138_PASS_RESOLUTION) at which the satellite is just visible
+double SWARM_M138_Pass_Predictor::findCrossing(const Swarm_M138_Propagator_t *prop, double below, double above)
+{
+  while (fabs(above - below) > SWARM_M138_PASS_RESOLUTION)
+  {
+    double mid = (below + above) / 2.0;
+    double ecef[3];
+    double cosAngle;
+    propagate(prop, mid, ecef);
+    if (sinElevation(ecef, &cosAngle) >= _sinMinElevation)
+      above = mid;
+    else
+      below = mid;
+  }
+  return (above);
+}
+
+// Insert the pass into the table - in AOS order. If the table is full, the pass with the latest AOS is dropped
+void SWARM_M138_Pass_Predictor::addPass(const Swarm_M138_Pass_t *pass)
+{
+  uint16_t i = _numPasses;
+  if (_numPasses >= SWARM_M138_PASS_TABLE_SIZE)
+  {
+    if (pass->aos >= _passes[SWARM_M138_PASS_TABLE_SIZE - 1].aos)
+      return; // Too late
+    i = SWARM_M138_PASS_TABLE_SIZE - 1; // Drop the last pass
+  }
+  else
+    _numPasses++;
+
+  while ((i > 0) && (_passes[i - 1].aos > pass->aos))
+  {
+    _passes[i] = _passes[i - 1];
+    i--;
+  }
+  _passes[i] = *pass;
+}
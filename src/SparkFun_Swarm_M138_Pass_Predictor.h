@@ -0,0 +1,141 @@
+/*!
+ * @file SparkFun_Swarm_M138_Pass_Predictor.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Pass_Predictor: predict the passes of the Swarm satellites from their orbital elements.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_PASS_PREDICTOR_H
+#define SPARKFUN_SWARM_M138_PASS_PREDICTOR_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+/** Pass prediction */
+#ifndef SWARM_M138_PASS_TABLE_SIZE
+#define SWARM_M138_PASS_TABLE_SIZE 64 ///< The number of passes held in the pass table: 16 bytes each
+#endif
+#define SWARM_M138_PASS_FINE_STEP 20  ///< The time step (seconds) used when a satellite could be visible. Passes shorter than this may be missed
+#define SWARM_M138_PASS_RESOLUTION 1  ///< AOS and LOS are found to within this many seconds
+
+/** A struct to hold the orbital elements of one satellite - parsed from its Two-Line Element set */
+typedef struct
+{
+  uint32_t noradID;     // NORAD catalog number
+  double epoch;         // The epoch of the elements: Unix time (seconds)
+  double inclination;   // Inclination (radians)
+  double raan;          // Right ascension of the ascending node (radians)
+  double eccentricity;  // Eccentricity
+  double argPerigee;    // Argument of perigee (radians)
+  double meanAnomaly;   // Mean anomaly (radians)
+  double meanMotion;    // Mean motion (revolutions per day)
+  double meanMotionDot; // The first derivative of the mean motion divided by two (revolutions per day squared)
+} Swarm_M138_Orbital_Elements_t;
+
+/** A struct to hold one predicted pass */
+typedef struct
+{
+  uint32_t aos;       // Acquisition of signal: when the satellite rises above the minimum elevation. Unix time (seconds)
+  uint32_t los;       // Loss of signal: when the satellite falls below the minimum elevation. Unix time (seconds)
+  uint32_t noradID;   // The satellite
+  float maxElevation; // The highest elevation (degrees) during the pass
+} Swarm_M138_Pass_t;
+
+class SWARM_M138_TLE_Store; // See SparkFun_Swarm_M138_TLE_Store.h
+class SWARM_M138_Batch_Propagator; // See SparkFun_Swarm_M138_Batch_Propagator.h
+
+/** Predict the passes of the Swarm satellites from their orbital elements
+ *
+ *  computePasses builds a table of the passes in a time range, sorted by AOS. Call it once per TLE refresh
+ *  (or once the table is used up). getNextPass then finds the next pass without recomputing anything.
+ *  The satellites are propagated with the secular J2 and drag terms of the TLE mean elements (as SGP does).
+ *  Short-periodic terms are ignored: AOS and LOS are typically within a few seconds of a full SGP4 prediction
+ *  for the near-circular Swarm orbits - a few days either side of the TLE epoch.
+ *  While a satellite is far from view, the search skips ahead by the shortest time in which it could rise.
+ *  On 8-bit AVR, double is the same as float: the predictions will be much less accurate.
+ */
+class SWARM_M138_Pass_Predictor
+{
+public:
+  SWARM_M138_Pass_Predictor(void);
+
+  void setSite(double latitude, double longitude, double altitude); // Degrees, degrees, metres above mean sea level
+  void setSite(const Swarm_M138_GeospatialData_t *info);           // Use the modem's position: from getGeospatialInfo
+  void setMinimumElevation(double elevation = 15.0);                // Passes lower than this (degrees) are ignored
+
+  static bool parseTLE(const char *lineOne, const char *lineTwo, Swarm_M138_Orbital_Elements_t *elements); // Parse a Two-Line Element set. Return false if it is invalid
+  static uint32_t dateTimeToUnix(const Swarm_M138_DateTimeData_t *dateTime); // Convert the modem's date and time into Unix time (seconds)
+
+  uint16_t computePasses(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint32_t start, uint32_t duration = 7200); // Build the pass table. Return the number of passes
+  uint16_t computePasses(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, const Swarm_M138_DateTimeData_t *start, uint32_t duration = 7200);
+  uint16_t computePasses(SWARM_M138_TLE_Store &store, uint32_t start, uint32_t duration = 7200); // Build the pass table from a binary TLE image - one record at a time
+  uint16_t computePasses(SWARM_M138_TLE_Store &store, const Swarm_M138_DateTimeData_t *start, uint32_t duration = 7200);
+  uint16_t computePasses(SWARM_M138_Batch_Propagator &batch, const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint32_t start, uint32_t duration = 7200); // Step the satellites together
+  uint16_t computePasses(SWARM_M138_Batch_Propagator &batch, const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, const Swarm_M138_DateTimeData_t *start, uint32_t duration = 7200);
+  uint16_t computePasses(SWARM_M138_Batch_Propagator &batch, SWARM_M138_TLE_Store &store, uint32_t start, uint32_t duration = 7200);
+  uint16_t computePasses(SWARM_M138_Batch_Propagator &batch, SWARM_M138_TLE_Store &store, const Swarm_M138_DateTimeData_t *start, uint32_t duration = 7200);
+
+  bool getNextPass(uint32_t now, Swarm_M138_Pass_t *pass);                         // Get the pass which is in progress - or the next one. Return false if there is none in the table
+  bool getNextPass(const Swarm_M138_DateTimeData_t *now, Swarm_M138_Pass_t *pass); // Get the pass which is in progress - or the next one
+  uint16_t getPassCount(void);                                                     // The number of passes in the table
+  bool getPass(uint16_t index, Swarm_M138_Pass_t *pass);                           // Get a pass from the table
+  uint32_t getTableStart(void);                                                    // The table covers getTableStart to getTableEnd
+  uint32_t getTableEnd(void);                                                      // The end of the range - or the last AOS if the table is full
+
+  double getElevation(const Swarm_M138_Orbital_Elements_t *satellite, uint32_t time); // The elevation of the satellite (degrees) at time
+
+private:
+  // The values derived from each satellite's elements
+  typedef struct
+  {
+    const Swarm_M138_Orbital_Elements_t *elements;
+    double meanMotion; // Radians per second - recovered from the Kozai mean motion
+    double semiMajorAxis; // km
+    double meanAnomalyRate; // Radians per second
+    double raanRate;
+    double argPerigeeRate;
+    double meanMotionDot; // Radians per second squared
+    double cosMaxAngle; // The cosine of the largest angle between the site and the satellite at which the satellite can be visible
+    double maxAngle;
+    double angularRate; // The fastest the sub-satellite point can move relative to the site (radians per second)
+  } Swarm_M138_Propagator_t;
+
+  double _siteECEF[3]; // The site position: Earth-centred, Earth-fixed (km)
+  double _siteUp[3];   // The unit vector of the local vertical
+  double _siteRadius;
+  double _minElevation; // Radians
+  double _sinMinElevation;
+
+  Swarm_M138_Pass_t _passes[SWARM_M138_PASS_TABLE_SIZE];
+  uint16_t _numPasses;
+  uint16_t _nextPass; // getNextPass starts looking here
+  uint32_t _lastQuery; // The time passed to getNextPass last time. Used to detect time going backwards
+  uint32_t _tableStart;
+  uint32_t _tableEnd;
+
+  void initPropagator(const Swarm_M138_Orbital_Elements_t *satellite, Swarm_M138_Propagator_t *prop); // Derive the rates from the elements
+  void propagate(const Swarm_M138_Propagator_t *prop, double time, double *ecef);                   // Calculate the position at time: ECEF (km)
+  double sinElevation(const double *ecef, double *cosAngle);                                          // The sine of the elevation. cosAngle is the cosine of the angle at the centre of the Earth
+  double findCrossing(const Swarm_M138_Propagator_t *prop, double below, double above);              // Bisect to find when the satellite crosses the minimum elevation
+  void addPass(const Swarm_M138_Pass_t *pass);                                                       // Insert the pass into the table - in AOS order
+  void beginTable(uint32_t start, uint32_t duration);                                                 // Empty the table
+  void predictSatellite(const Swarm_M138_Orbital_Elements_t *satellite);                             // Add the passes of one satellite to the table
+  uint16_t endTable(void);                                                                            // Trim the end of the range if the table is full. Return the number of passes
+  uint16_t computeBatch(SWARM_M138_Batch_Propagator &batch, uint16_t numSatellites);                 // Build the table for _tableStart to _tableEnd with the batch
+  void seedBatch(SWARM_M138_Batch_Propagator &batch, double time);                                    // Calculate the batch state exactly at time
+  double refineBatch(SWARM_M138_Batch_Propagator &batch, uint16_t lane, double below, double above);  // findCrossing for one satellite in the batch
+};
+
+#endif // SPARKFUN_SWARM_M138_PASS_PREDICTOR_H
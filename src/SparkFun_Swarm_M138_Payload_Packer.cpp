@@ -0,0 +1,487 @@
+/*!
+ * @file SparkFun_Swarm_M138_Payload_Packer.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Payload_Packer: pack small records into full Swarm packets.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Payload_Packer.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+
+// SWARM_M138_Payload_Packer: aggregate small records into full packets
+
+// Write value as a varint: seven bits per byte, least significant first. Return the number of bytes
+static uint8_t swarm_m138_put_varint(uint8_t *dest, uint32_t value)
+{
+  uint8_t len = 0;
+  while (value >= 0x80)
+  {
+    dest[len++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  dest[len++] = (uint8_t)value;
+  return (len);
+}
+
+// Read a varint. Return the number of bytes. 0 if it runs past the end - or is longer than five bytes
+static uint8_t swarm_m138_get_varint(const uint8_t *src, size_t available, uint32_t *value)
+{
+  uint32_t result = 0;
+  for (uint8_t i = 0; (i < 5) && (i < available); i++)
+  {
+    result |= ((uint32_t)(src[i] & 0x7F)) << (7 * i);
+    if ((src[i] & 0x80) == 0)
+    {
+      *value = result;
+      return (i + 1);
+    }
+  }
+  return (0);
+}
+
+// Zigzag-encode a signed delta so small negative changes stay short
+static uint32_t swarm_m138_zigzag(int32_t value)
+{
+  return ((((uint32_t)value) << 1) ^ (uint32_t)(value >> 31));
+}
+
+static int32_t swarm_m138_unzigzag(uint32_t value)
+{
+  return ((int32_t)(value >> 1) ^ -((int32_t)(value & 1)));
+}
+
+SWARM_M138_Payload_Packer::SWARM_M138_Payload_Packer(void)
+{
+  _modem = NULL;
+  _used = 0;
+  _records = 0;
+  _lastTimestamp = 0;
+  _expires = 0;
+  _firstMillis = 0;
+  _retryMillis = 0;
+  _retryPending = false;
+  _useAppID = false;
+  _appID = 0;
+  _timestamps = false;
+  _maxAge = 0;
+  _hold = 0;
+  _packetCallback = NULL;
+  _packetContext = NULL;
+  _packetsQueued = 0;
+  _recordsQueued = 0;
+  _bytesQueued = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin the packer
+    @param  modem
+            The modem. It must have been begun
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::begin(SWARM_M138 &modem)
+{
+  _modem = &modem;
+  _used = 0;
+  _records = 0;
+  _retryPending = false;
+  _packetsQueued = 0;
+  _recordsQueued = 0;
+  _bytesQueued = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue the packets with an application ID
+    @param  appID
+            The application ID: 0 to 64999
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::setAppID(uint16_t appID)
+{
+  _useAppID = true;
+  _appID = appID;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue the packets without an application ID
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::clearAppID(void)
+{
+  _useAppID = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Timestamp each record. The first record carries its Unix time (4 bytes), the rest
+            carry the change from the record before - usually one or two bytes.
+            Takes effect from the next packet
+    @param  enable
+            true to timestamp the records
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::setTimestamps(bool enable)
+{
+  _timestamps = enable;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set how long a part-full packet can wait for more records
+    @param  maxAge
+            poll queues the packet when its first record is this many millis old. 0 == only queue full packets
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::setMaximumAge(unsigned long maxAge)
+{
+  _maxAge = maxAge;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Ask the modem to hold each packet. The hold is counted from when the first record was added:
+            the packet is queued with transmitBinaryHold - less the time it spent in the arena
+    @param  hold
+            The hold (seconds). 0 == no hold
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::setHold(uint32_t hold)
+{
+  _hold = hold;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the callback: it is called each time the packer tries to queue a packet - or drops an expired one
+    @param  callback
+            A pointer to the function:
+            void callback(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t records, uint16_t len, void *context)
+            SWARM_M138_ERROR_EXPIRED: the packet expired in the arena. Its records are dropped
+            SWARM_M138_ERROR_ERR: the modem rejected the packet ($TD ERR). Its records are dropped
+            Any other error: the records stay in the arena and are tried again
+    @param  context
+            Passed to the callback
+*/
+/**************************************************************************/
+void SWARM_M138_Payload_Packer::setPacketCallback(void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t records, uint16_t len, void *context),
+                                                  void *context)
+{
+  _packetCallback = callback;
+  _packetContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a record. If it will not fit, the packet is queued first. This blocks while the $TD is sent
+    @param  data
+            The record
+    @param  len
+            The length of the record
+    @param  timestamp
+            The Unix time (seconds) of the record - e.g. from getDateTime. Only used if setTimestamps is enabled.
+            0 == the same time as the record before
+    @param  expires
+            The record is not worth sending after this Unix time. 0 == no expiry.
+            The packet is queued with transmitBinaryExpire at the earliest expiry time of its records
+    @return SWARM_M138_ERROR_SUCCESS if the record was added. The full packet may have been dropped (expired or rejected)
+            SWARM_M138_ERROR_ERROR if the record is too long for a packet - or begin has not been called
+            Otherwise: the error from queueing the full packet. It stays in the arena and the record was not added
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Payload_Packer::add(const uint8_t *data, uint8_t len, uint32_t timestamp, uint32_t expires)
+{
+  if ((_modem == NULL) || ((data == NULL) && (len > 0)))
+    return (SWARM_M138_ERROR_ERROR);
+
+  if (append(data, len, timestamp, expires))
+    return (SWARM_M138_ERROR_SUCCESS);
+
+  if (_records == 0)
+    return (SWARM_M138_ERROR_ERROR); // The record would not fit in an empty packet
+
+  Swarm_M138_Error_e err = flush();
+  if (_records > 0)
+    return (err); // The packet is still in the arena: poll will try again
+
+  return (append(data, len, timestamp, expires) ? SWARM_M138_ERROR_SUCCESS : SWARM_M138_ERROR_ERROR);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue the part-full packet now - e.g. before a pass or before the host sleeps.
+            This blocks while the $TD is sent.
+            The packet is dropped if its hold has run out in the arena - or its expiry time (see getUnixTime) has passed
+    @return SWARM_M138_ERROR_SUCCESS if the packet was queued - or the arena was empty
+            SWARM_M138_ERROR_EXPIRED if the packet expired. The records are dropped
+            SWARM_M138_ERROR_ERR if the modem rejected the packet. The records are dropped
+            Otherwise: the error from transmitBatch. The records stay in the arena
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Payload_Packer::flush(void)
+{
+  if (_modem == NULL)
+    return (SWARM_M138_ERROR_ERROR);
+
+  if (_records == 0)
+    return (SWARM_M138_ERROR_SUCCESS);
+
+  Swarm_M138_Tx_Descriptor_t packet;
+  packet.data = _arena;
+  packet.len = _used;
+  packet.useAppID = _useAppID;
+  packet.appID = _appID;
+  packet.hold = 0;
+  packet.epoch = _expires;
+
+  bool expired = false;
+  if (_hold > 0)
+  {
+    uint32_t waited = (millis() - _firstMillis) / 1000; // The time already spent in the arena
+    if (waited >= _hold)
+      expired = true;
+    else
+      packet.hold = _hold - waited;
+    if (packet.hold < SWARM_M138_PACKER_MIN_HOLD) // The modem rejects a shorter hold
+      packet.hold = SWARM_M138_PACKER_MIN_HOLD;
+    else if (packet.hold > SWARM_M138_PACKER_MAX_HOLD)
+      packet.hold = SWARM_M138_PACKER_MAX_HOLD;
+  }
+
+  if (_expires > 0)
+  {
+    uint32_t now = _modem->getUnixTime(); // 0 if it is not known: the modem rejects an epoch in the past anyway
+    if ((now > 0) && (_expires <= now))
+      expired = true;
+  }
+
+  uint64_t msg_id = 0;
+  Swarm_M138_Error_e err = SWARM_M138_ERROR_EXPIRED;
+  if (!expired)
+    err = _modem->transmitBatch(&packet, 1, &msg_id);
+
+  if (_packetCallback != NULL)
+    _packetCallback(err, &msg_id, _records, _used, _packetContext);
+
+  if ((err != SWARM_M138_ERROR_SUCCESS) && (err != SWARM_M138_ERROR_EXPIRED) && (err != SWARM_M138_ERROR_ERR))
+  {
+    _retryPending = true; // Not sent (e.g. timeout or busy): try again later
+    _retryMillis = millis();
+    return (err);
+  }
+
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    _packetsQueued++;
+    _recordsQueued += _records;
+    _bytesQueued += _used;
+  }
+  _used = 0;
+  _records = 0;
+  _retryPending = false;
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue the packet if its first record has reached the maximum age. Call this from loop().
+            If the last attempt could not be sent (e.g. timeout), poll waits SWARM_M138_PACKER_RETRY_INTERVAL before trying again
+    @return SWARM_M138_ERROR_SUCCESS if nothing needed doing - or the packet was queued
+            Otherwise: the error from transmitBatch
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138_Payload_Packer::poll(void)
+{
+  if ((_records == 0) || (_maxAge == 0))
+    return (SWARM_M138_ERROR_SUCCESS);
+
+  if ((millis() - _firstMillis) < _maxAge)
+    return (SWARM_M138_ERROR_SUCCESS);
+
+  if ((_retryPending) && ((millis() - _retryMillis) < SWARM_M138_PACKER_RETRY_INTERVAL))
+    return (SWARM_M138_ERROR_SUCCESS);
+
+  return (flush());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of records waiting in the arena
+    @return The count
+*/
+/**************************************************************************/
+uint8_t SWARM_M138_Payload_Packer::getPendingRecords(void)
+{
+  return (_records);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the length of the packet so far - including the flags and timestamp
+    @return The length (bytes)
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Payload_Packer::getPendingBytes(void)
+{
+  return (_used);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of packets queued since begin
+    @return The count
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Payload_Packer::getPacketsQueued(void)
+{
+  return (_packetsQueued);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of records in the packets queued since begin
+    @return The count
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Payload_Packer::getRecordsQueued(void)
+{
+  return (_recordsQueued);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the total length of the packets queued since begin.
+            getBytesQueued / getPacketsQueued is the average fill
+    @return The length (bytes)
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Payload_Packer::getBytesQueued(void)
+{
+  return (_bytesQueued);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walk the records of a packet - e.g. one received from the Hive.
+            Start with offset = 0 and call unpack until it returns false
+    @param  packet
+            The packet
+    @param  len
+            The length of the packet
+    @param  offset
+            Where the next record starts. Set it to 0 for the first record: unpack updates it
+    @param  record
+            Set to point to the record data - inside packet
+    @param  recordLen
+            Set to the length of the record
+    @param  timestamp
+            Set to the Unix time of the record - if the packet is timestamped. Keep it between calls: the next timestamp is
+            worked out from it. Can be NULL
+    @return true if a record was found. false at the end of the packet - or if the packet is invalid
+*/
+/**************************************************************************/
+bool SWARM_M138_Payload_Packer::unpack(const uint8_t *packet, size_t len, size_t *offset, const uint8_t **record, uint8_t *recordLen, uint32_t *timestamp)
+{
+  if ((packet == NULL) || (offset == NULL) || (record == NULL) || (recordLen == NULL) || (len == 0))
+    return (false);
+
+  bool timestamped = (packet[0] & SWARM_M138_PACKER_TIMESTAMPS) != 0;
+  size_t pos = *offset;
+  uint32_t when = (timestamp != NULL) ? *timestamp : 0;
+
+  if (pos == 0) // Skip the flags - and read the first timestamp
+  {
+    pos = 1;
+    if (timestamped)
+    {
+      if (len < 5)
+        return (false);
+      when = swarm_m138_get_u32(&packet[1]);
+      pos = 5;
+    }
+  }
+
+  if (pos >= len)
+    return (false);
+
+  uint32_t value;
+  uint8_t bytes;
+  if (timestamped)
+  {
+    bytes = swarm_m138_get_varint(&packet[pos], len - pos, &value);
+    if (bytes == 0)
+      return (false);
+    when += (uint32_t)swarm_m138_unzigzag(value);
+    pos += bytes;
+  }
+
+  bytes = swarm_m138_get_varint(&packet[pos], len - pos, &value);
+  if ((bytes == 0) || (value > (len - pos - bytes)))
+    return (false);
+  pos += bytes;
+
+  *record = &packet[pos];
+  *recordLen = (uint8_t)value;
+  *offset = pos + value;
+  if (timestamp != NULL)
+    *timestamp = when;
+  return (true);
+}
+
+// Add the record to the arena. Return false if it will not fit
+bool SWARM_M138_Payload_Packer::append(const uint8_t *data, uint8_t len, uint32_t timestamp, uint32_t expires)
+{
+  uint8_t prefix[10]; // The timestamp delta and length varints. Use the stack, not the heap
+  uint8_t prefixLen = 0;
+  uint16_t header = 0;
+
+  bool timestamped = (_records == 0) ? _timestamps : ((_arena[0] & SWARM_M138_PACKER_TIMESTAMPS) != 0);
+  if (_records == 0)
+    header = timestamped ? 5 : 1; // The flags - and the first timestamp
+
+  if (timestamped)
+  {
+    if ((timestamp == 0) && (_records > 0))
+      timestamp = _lastTimestamp; // No timestamp: repeat the last one
+    int32_t delta = (_records == 0) ? 0 : (int32_t)(timestamp - _lastTimestamp);
+    prefixLen += swarm_m138_put_varint(&prefix[prefixLen], swarm_m138_zigzag(delta));
+  }
+  prefixLen += swarm_m138_put_varint(&prefix[prefixLen], len);
+
+  if (((_records == 0) ? 0 : _used) + header + prefixLen + len > SWARM_M138_MAX_PACKET_LENGTH_BYTES)
+    return (false);
+
+  if (_records == 0) // Start a new packet
+  {
+    _arena[0] = timestamped ? SWARM_M138_PACKER_TIMESTAMPS : 0;
+    if (timestamped)
+      swarm_m138_put_u32(&_arena[1], timestamp);
+    _used = header;
+    _expires = 0;
+    _firstMillis = millis();
+    _retryPending = false;
+  }
+
+  memcpy(&_arena[_used], prefix, prefixLen);
+  _used += prefixLen;
+  if (len > 0)
+    memcpy(&_arena[_used], data, len);
+  _used += len;
+  _records++;
+  _lastTimestamp = timestamp;
+
+  if ((expires > 0) && ((_expires == 0) || (expires < _expires)))
+    _expires = expires;
+
+  return (true);
+}
@@ -0,0 +1,98 @@
+/*!
+ * @file SparkFun_Swarm_M138_Payload_Packer.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Payload_Packer: pack small records into full Swarm packets.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_PAYLOAD_PACKER_H
+#define SPARKFUN_SWARM_M138_PAYLOAD_PACKER_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+/** Transmit payload packer
+ *
+ *  Sensor readings are often only a few bytes long - but each message costs a whole packet.
+ *  SWARM_M138_Payload_Packer collects the records in a SWARM_M138_MAX_PACKET_LENGTH_BYTES arena and queues the packet
+ *  when the next record will not fit, when flush is called - or when the first record reaches the maximum age.
+ *  The packet is:
+ *    A flags byte. SWARM_M138_PACKER_TIMESTAMPS: each record has a timestamp
+ *    If timestamped: the Unix time of the first record (4 bytes, little-endian)
+ *    Each record: the change in time from the previous record (zigzag varint - if timestamped), the length (varint), the data
+ *  unpack walks the records of a received packet.
+ *  The hold is counted from when the first record was added: the time spent in the arena is taken off the hold
+ *  passed to the modem. The packet expires at the earliest expiry time of its records.
+ *  A packet which expires in the arena - or which the modem rejects with $TD ERR - is dropped, not tried again.
+ */
+#define SWARM_M138_PACKER_TIMESTAMPS 0x01 ///< Packet flag: each record has a timestamp
+#define SWARM_M138_PACKER_MIN_HOLD 60     ///< The shortest hold the modem accepts (seconds)
+#define SWARM_M138_PACKER_MAX_HOLD 34819200 ///< The longest hold the modem accepts (seconds): 13 months
+#ifndef SWARM_M138_PACKER_RETRY_INTERVAL
+#define SWARM_M138_PACKER_RETRY_INTERVAL 10000 ///< poll waits this many millis before trying again to queue a packet which could not be sent (e.g. timeout)
+#endif
+
+class SWARM_M138_Payload_Packer
+{
+public:
+  SWARM_M138_Payload_Packer(void);
+
+  void begin(SWARM_M138 &modem); // Set the modem. It must have been begun
+
+  void setAppID(uint16_t appID);          // Queue the packets with this application ID
+  void clearAppID(void);                  // Queue the packets without an application ID
+  void setTimestamps(bool enable = true); // Timestamp each record. Takes effect from the next packet
+  void setMaximumAge(unsigned long maxAge); // Queue a part-full packet when its first record is maxAge millis old. 0 == only when it is full
+  void setHold(uint32_t hold);            // Ask the modem to hold each packet for up to hold seconds - from when its first record was added. 0 == no hold
+  void setPacketCallback(void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t records, uint16_t len, void *context),
+                         void *context = NULL); // Called each time the packer tries to queue a packet - or drops an expired one
+
+  Swarm_M138_Error_e add(const uint8_t *data, uint8_t len, uint32_t timestamp = 0, uint32_t expires = 0); // Add a record. If it will not fit, the packet is queued first
+  Swarm_M138_Error_e flush(void); // Queue the part-full packet now
+  Swarm_M138_Error_e poll(void);  // Queue the packet if its first record has reached the maximum age. Call this from loop()
+
+  uint8_t getPendingRecords(void);  // The number of records in the arena
+  uint16_t getPendingBytes(void);   // The length of the packet so far
+  uint32_t getPacketsQueued(void);  // The number of packets queued since begin
+  uint32_t getRecordsQueued(void);  // The number of records in those packets
+  uint32_t getBytesQueued(void);    // The total length of those packets
+
+  static bool unpack(const uint8_t *packet, size_t len, size_t *offset, const uint8_t **record, uint8_t *recordLen, uint32_t *timestamp = NULL); // Walk the records of a packet
+
+private:
+  SWARM_M138 *_modem;
+  uint8_t _arena[SWARM_M138_MAX_PACKET_LENGTH_BYTES];
+  uint16_t _used;                 // The length of the packet so far
+  uint8_t _records;               // The number of records in the arena
+  uint32_t _lastTimestamp;        // The timestamp of the last record - the deltas are from this
+  uint32_t _expires;              // The earliest expiry time of the records. 0 == none
+  unsigned long _firstMillis;     // millis when the first record was added
+  unsigned long _retryMillis;     // millis when the packet could not be sent
+  bool _retryPending;             // True if the packet could not be sent - poll will try again
+  bool _useAppID;
+  uint16_t _appID;
+  bool _timestamps;
+  unsigned long _maxAge;
+  uint32_t _hold;
+  void (*_packetCallback)(Swarm_M138_Error_e err, const uint64_t *msg_id, uint8_t records, uint16_t len, void *context);
+  void *_packetContext;
+  uint32_t _packetsQueued;
+  uint32_t _recordsQueued;
+  uint32_t _bytesQueued;
+
+  bool append(const uint8_t *data, uint8_t len, uint32_t timestamp, uint32_t expires); // Add the record to the arena. Return false if it will not fit
+};
+
+#endif // SPARKFUN_SWARM_M138_PAYLOAD_PACKER_H
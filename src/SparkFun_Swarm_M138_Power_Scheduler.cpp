@@ -0,0 +1,336 @@
+/*!
+ * @file SparkFun_Swarm_M138_Power_Scheduler.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Power_Scheduler: put the modem - and the host - to sleep between passes.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Power_Scheduler.h"
+
+// SWARM_M138_Power_Scheduler: put the modem - and the host - to sleep between passes
+
+SWARM_M138_Power_Scheduler::SWARM_M138_Power_Scheduler(void)
+{
+  _modem = NULL;
+  _predictor = NULL;
+  _state = SWARM_M138_SCHEDULER_IDLE;
+  _wakeLead = SWARM_M138_SCHEDULER_WAKE_LEAD;
+  _minSleep = SWARM_M138_SCHEDULER_MIN_SLEEP;
+  _maxSleep = SWARM_M138_SCHEDULER_MAX_SLEEP;
+  _sleepHost = NULL;
+  _sleepHostContext = NULL;
+  _timeBase = 0;
+  _timeBaseMillis = 0;
+  _unsent = 0;
+  _unsentValid = false;
+  _unsentMillis = 0;
+  _sentCount = 0;
+  _wakeCount = 0;
+  _wakeTime = 0;
+  _sleepStart = 0;
+  _awakeMillis = 0;
+  _awakeSince = 0;
+  _sleepSeconds = 0;
+  _delivered = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin the scheduler
+    @param  modem
+            The modem. It must have been begun
+    @param  predictor
+            The pass predictor. Call its computePasses before the table runs out
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::begin(SWARM_M138 &modem, SWARM_M138_Pass_Predictor &predictor)
+{
+  _modem = &modem;
+  _predictor = &predictor;
+  _modem->enableEventCounting(); // poll needs the $TD SENT and $SL WAKE counts
+  _state = SWARM_M138_SCHEDULER_IDLE;
+  _timeBase = 0;
+  _unsentValid = false;
+  _sentCount = modem.getTransmitSentCount();
+  _wakeTime = 0;
+  _awakeMillis = 0;
+  _awakeSince = millis();
+  _sleepSeconds = 0;
+  _delivered = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set how long before AOS the modem is woken
+    @param  seconds
+            The wake lead in seconds
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::setWakeLead(uint32_t seconds)
+{
+  _wakeLead = seconds;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the minimum sleep time. The modem stays awake if it would have to wake again sooner than this
+    @param  seconds
+            The minimum sleep time in seconds
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::setMinimumSleep(uint32_t seconds)
+{
+  _minSleep = seconds;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the maximum sleep time: how long the modem sleeps when there is nothing to send.
+            The modem is also woken after this time if the next pass is further away
+    @param  seconds
+            The maximum sleep time in seconds
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::setMaximumSleep(uint32_t seconds)
+{
+  _maxSleep = seconds;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the function which puts the host to sleep. It is called once the modem is asleep.
+            It should sleep for (up to) seconds and return when the host wakes. If the host wakes early,
+            the next poll will wake the modem too
+    @param  sleepHost
+            The function. NULL == the host stays awake
+    @param  context
+            Passed to sleepHost. Can be NULL.
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::setHostSleepCallback(void (*sleepHost)(uint32_t seconds, void *context), void *context)
+{
+  _sleepHost = sleepHost;
+  _sleepHostContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Poll the modem and put it to sleep when it can. Call this regularly from loop()
+    @return The state of the scheduler
+*/
+/**************************************************************************/
+Swarm_M138_Scheduler_State_e SWARM_M138_Power_Scheduler::poll(void)
+{
+  if ((_modem == NULL) || (_predictor == NULL))
+    return (SWARM_M138_SCHEDULER_IDLE);
+
+  _modem->poll(); // Process any unsolicited messages: $TD SENT and $SL WAKE
+
+  uint32_t sent = _modem->getTransmitSentCount();
+  if (sent != _sentCount) // A message has been delivered. Re-read the unsent count
+  {
+    _delivered += sent - _sentCount;
+    _sentCount = sent;
+    _unsentValid = false;
+  }
+
+  uint32_t t = now();
+
+  if (_state == SWARM_M138_SCHEDULER_SLEEPING)
+  {
+    if ((_modem->getSleepWakeCount() == _wakeCount) && ((t == 0) || (t < _wakeTime)))
+      return (_state); // Still asleep
+    wake(t);
+  }
+
+  if (t == 0) // Wait until the date and time are valid
+    return (_state);
+
+  if (_state == SWARM_M138_SCHEDULER_IDLE)
+    _state = SWARM_M138_SCHEDULER_AWAKE;
+
+  if (_modem->isBusy() || (_modem->getCommandQueueCount() > 0)) // Let the asynchronous commands finish first
+    return (_state);
+
+  if ((_unsentValid == false) || ((millis() - _unsentMillis) >= SWARM_M138_SCHEDULER_UNSENT_CHECK))
+  {
+    uint16_t count;
+    if (_modem->getUnsentMessageCount(&count) == SWARM_M138_ERROR_SUCCESS)
+      _unsent = count;
+    _unsentValid = true; // If the read failed, keep the old count and try again later
+    _unsentMillis = millis();
+  }
+
+  if (_unsent == 0) // Nothing to send
+  {
+    if (_maxSleep >= _minSleep)
+      sleepUntil(t + _maxSleep);
+    return (_state);
+  }
+
+  Swarm_M138_Pass_t pass;
+  if (_predictor->getNextPass(t, &pass) == false) // No pass is known. Stay awake and keep trying to send
+    return (_state);
+
+  if (pass.aos <= (t + _wakeLead)) // The pass is about to start - or is in progress. Stay awake until the queue is empty
+    return (_state);
+
+  uint32_t wakeTime = pass.aos - _wakeLead;
+  if ((wakeTime - t) > _maxSleep)
+    wakeTime = t + _maxSleep;
+  if ((wakeTime - t) >= _minSleep)
+    sleepUntil(wakeTime);
+
+  return (_state);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the state of the scheduler
+    @return The state
+*/
+/**************************************************************************/
+Swarm_M138_Scheduler_State_e SWARM_M138_Power_Scheduler::getState(void)
+{
+  return (_state);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tell the scheduler that a message has been queued. The unsent count is re-read at the next poll -
+            so the modem stays awake for the next pass
+*/
+/**************************************************************************/
+void SWARM_M138_Power_Scheduler::messageQueued(void)
+{
+  _unsentValid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the unsent message count
+    @return The count - as last read
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Power_Scheduler::getUnsentCount(void)
+{
+  return (_unsent);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the time the modem will wake
+    @return Unix time (seconds). 0 if the modem is awake
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Power_Scheduler::getWakeTime(void)
+{
+  return (_wakeTime);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the total time the modem has spent awake since begin
+    @return The time in seconds
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Power_Scheduler::getAwakeSeconds(void)
+{
+  unsigned long awake = _awakeMillis;
+  if (_state != SWARM_M138_SCHEDULER_SLEEPING)
+    awake += millis() - _awakeSince;
+  return ((uint32_t)(awake / 1000));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the total time the modem has spent asleep since begin
+    @return The time in seconds
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Power_Scheduler::getSleepSeconds(void)
+{
+  return (_sleepSeconds);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of messages delivered ($TD SENT) since begin. Divide the energy used by this
+            to get the energy per delivered message
+    @return The number of messages
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Power_Scheduler::getMessagesDelivered(void)
+{
+  return (_delivered);
+}
+
+// The current time: Unix time (seconds). 0 if it is not known
+// The modem's date and time are read when the modem is awake. While it is asleep, millis is used
+uint32_t SWARM_M138_Power_Scheduler::now(void)
+{
+  if ((_state != SWARM_M138_SCHEDULER_SLEEPING) && ((_timeBase == 0) || ((millis() - _timeBaseMillis) >= 600000UL)))
+  {
+    Swarm_M138_DateTimeData_t dateTime;
+    if ((_modem->getDateTime(&dateTime, 60000UL) == SWARM_M138_ERROR_SUCCESS) && (dateTime.valid))
+    {
+      _timeBase = SWARM_M138_Pass_Predictor::dateTimeToUnix(&dateTime);
+      _timeBaseMillis = millis();
+    }
+  }
+
+  if (_timeBase == 0)
+    return (0);
+
+  return (_timeBase + (uint32_t)((millis() - _timeBaseMillis) / 1000));
+}
+
+// Put the modem to sleep until wakeTime. Then call the host sleep function
+void SWARM_M138_Power_Scheduler::sleepUntil(uint32_t wakeTime)
+{
+  uint32_t t = now();
+  if ((t == 0) || (wakeTime <= t))
+    return;
+
+  _wakeCount = _modem->getSleepWakeCount();
+
+  if (_modem->sleepMode(wakeTime - t) != SWARM_M138_ERROR_SUCCESS)
+    return; // Try again at the next poll
+
+  _awakeMillis += millis() - _awakeSince;
+  _state = SWARM_M138_SCHEDULER_SLEEPING;
+  _wakeTime = wakeTime;
+  _sleepStart = t;
+
+  if (_sleepHost != NULL)
+  {
+    _sleepHost(wakeTime - t, _sleepHostContext);
+    // millis may have stopped while the host was asleep. Assume the sleep is over: the date and time are re-read
+    // (which wakes the modem if the host woke early)
+    _timeBase = 0;
+    wake(0);
+  }
+}
+
+// The modem has woken up. time is the current time - or 0 if it is not known
+void SWARM_M138_Power_Scheduler::wake(uint32_t time)
+{
+  if ((time != 0) && (time > _sleepStart) && (time < _wakeTime))
+    _sleepSeconds += time - _sleepStart; // Woken early
+  else
+    _sleepSeconds += _wakeTime - _sleepStart;
+
+  _state = SWARM_M138_SCHEDULER_AWAKE;
+  _awakeSince = millis();
+  _wakeTime = 0;
+  _unsentValid = false;
+}
@@ -0,0 +1,103 @@
+/*!
+ * @file SparkFun_Swarm_M138_Power_Scheduler.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Power_Scheduler: put the modem - and the host - to sleep between passes.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h and SparkFun_Swarm_M138_Pass_Predictor.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_POWER_SCHEDULER_H
+#define SPARKFUN_SWARM_M138_POWER_SCHEDULER_H
+
+#include "SparkFun_Swarm_M138_Pass_Predictor.h"
+
+/** Power scheduling */
+#define SWARM_M138_SCHEDULER_WAKE_LEAD 60      ///< The default: wake the modem this many seconds before AOS
+#define SWARM_M138_SCHEDULER_MIN_SLEEP 120     ///< The default: do not sleep for less than this many seconds
+#define SWARM_M138_SCHEDULER_MAX_SLEEP 3600    ///< The default: sleep for this many seconds when there is nothing to send
+#define SWARM_M138_SCHEDULER_UNSENT_CHECK 30000 ///< Re-read the unsent message count this often (millis) while flushing the queue
+
+/** The state of the power scheduler */
+typedef enum
+{
+  SWARM_M138_SCHEDULER_IDLE = 0, ///< begin has not been called - or the date and time are not yet valid
+  SWARM_M138_SCHEDULER_AWAKE,    ///< The modem is awake: waiting for the next pass - or flushing the queue during a pass
+  SWARM_M138_SCHEDULER_SLEEPING  ///< The modem is asleep until the next wake time
+} Swarm_M138_Scheduler_State_e;
+
+/** Put the modem - and the host - to sleep between passes
+ *
+ *  Call poll() from loop(). It polls the modem and decides when to sleep:
+ *    If no messages are waiting, the modem sleeps for the maximum sleep time.
+ *    If messages are waiting, the modem sleeps until the wake lead before the next pass (from the pass predictor).
+ *    During the pass it stays awake until the $TD SENT messages have emptied the queue - then it sleeps again.
+ *  The modem is woken by its sleep timer ($SL WAKE). While the modem is asleep, no commands are sent: serial activity would wake it.
+ *  If a host sleep function is set, it is called after the modem has gone to sleep. It should put the host to sleep
+ *  for (up to) the given number of seconds and return when the host wakes up.
+ *  The scheduler only sends blocking commands when it is deciding whether to sleep. Queue messages with the blocking
+ *  transmit methods - or call poll() until isBusy returns false before using the asynchronous ones.
+ */
+class SWARM_M138_Power_Scheduler
+{
+public:
+  SWARM_M138_Power_Scheduler(void);
+
+  void begin(SWARM_M138 &modem, SWARM_M138_Pass_Predictor &predictor); // Set the modem and the predictor. The predictor must already hold a pass table
+
+  void setWakeLead(uint32_t seconds = SWARM_M138_SCHEDULER_WAKE_LEAD);     // Wake this many seconds before AOS
+  void setMinimumSleep(uint32_t seconds = SWARM_M138_SCHEDULER_MIN_SLEEP); // Do not sleep if the modem would have to wake again sooner than this
+  void setMaximumSleep(uint32_t seconds = SWARM_M138_SCHEDULER_MAX_SLEEP); // Sleep for this long when there is nothing to send
+  void setHostSleepCallback(void (*sleepHost)(uint32_t seconds, void *context), void *context = NULL); // Called once the modem is asleep. NULL == the host stays awake
+
+  Swarm_M138_Scheduler_State_e poll(void); // Poll the modem and sleep when it can. Call this from loop()
+  Swarm_M138_Scheduler_State_e getState(void);
+  void messageQueued(void);                // Tell the scheduler a message has been queued: the unsent count is re-read at the next poll
+  uint16_t getUnsentCount(void);           // The unsent message count - as last read
+  uint32_t getWakeTime(void);              // When the modem will wake: Unix time (seconds). 0 if it is awake
+
+  uint32_t getAwakeSeconds(void);          // The total time the modem has spent awake since begin
+  uint32_t getSleepSeconds(void);          // The total time the modem has spent asleep since begin
+  uint32_t getMessagesDelivered(void);     // The number of $TD SENT messages since begin
+
+private:
+  SWARM_M138 *_modem;
+  SWARM_M138_Pass_Predictor *_predictor;
+  Swarm_M138_Scheduler_State_e _state;
+  uint32_t _wakeLead;
+  uint32_t _minSleep;
+  uint32_t _maxSleep;
+  void (*_sleepHost)(uint32_t seconds, void *context);
+  void *_sleepHostContext;
+
+  uint32_t _timeBase;             // The modem's date and time when it was last read: Unix time (seconds). 0 if not valid
+  unsigned long _timeBaseMillis;  // millis when _timeBase was read
+  uint16_t _unsent;
+  bool _unsentValid;              // False once the unsent count needs to be re-read
+  unsigned long _unsentMillis;    // millis when _unsent was read
+  uint32_t _sentCount;            // The modem's getTransmitSentCount when it was last checked
+  uint32_t _wakeCount;            // The modem's getSleepWakeCount when the modem went to sleep
+  uint32_t _wakeTime;             // When the modem will wake: Unix time (seconds)
+  uint32_t _sleepStart;           // When the modem went to sleep: Unix time (seconds)
+  unsigned long _awakeMillis;     // The total time spent awake - before _awakeSince
+  unsigned long _awakeSince;      // millis when the modem last woke
+  uint32_t _sleepSeconds;
+  uint32_t _delivered;
+
+  uint32_t now(void);                  // The current time: Unix time (seconds). 0 if it is not known
+  void sleepUntil(uint32_t wakeTime);  // Put the modem to sleep. Call the host sleep function
+  void wake(uint32_t time);            // The modem has woken up
+};
+
+#endif // SPARKFUN_SWARM_M138_POWER_SCHEDULER_H
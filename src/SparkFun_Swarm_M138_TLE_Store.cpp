@@ -0,0 +1,403 @@
+/*!
+ * @file SparkFun_Swarm_M138_TLE_Store.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_TLE_Store and its sources: a compact binary image of the orbital elements.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_TLE_Store.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_partition.h> // Needed for SWARM_M138_TLE_Partition_Source
+#include <esp_idf_version.h>
+#endif
+
+// SWARM_M138_TLE_Store: a compact binary image of the orbital elements
+
+static const double SWARM_M138_TWO_PI = 6.283185307179586; // The angles are stored as fractions of a turn
+
+// Convert a fraction (0 <= fraction < 1) to 1/2^32 units. Fractions outside the range wrap
+static uint32_t swarm_m138_pack_fraction(double fraction)
+{
+  fraction -= floor(fraction);
+  double units = (fraction * 4294967296.0) + 0.5;
+  if (units >= 4294967296.0)
+    units -= 4294967296.0;
+  return ((uint32_t)units);
+}
+
+// Copy len bytes from offset. Return false if they are not all in the image
+bool SWARM_M138_TLE_Memory_Source::read(uint32_t offset, uint8_t *dest, uint16_t len)
+{
+  if ((_image == NULL) || (dest == NULL) || (offset > _size) || (len > (_size - offset)))
+    return (false);
+
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_ESP8266)
+  if (_progmem) // PROGMEM is a separate address space on AVR - and flash which must be read in words on ESP8266
+  {
+    memcpy_P(dest, _image + offset, len);
+    return (true);
+  }
+#endif
+
+  memcpy(dest, _image + offset, len); // PROGMEM is ordinary (readable) memory on the other platforms
+  return (true);
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+/**************************************************************************/
+/*!
+    @brief  Memory-map a data partition which holds a TLE image - written with e.g. esptool or esp_partition_write
+    @param  label
+            The label of the partition - in the partition table
+    @return true if the partition was found and mapped
+*/
+/**************************************************************************/
+bool SWARM_M138_TLE_Partition_Source::begin(const char *label)
+{
+  end();
+
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (partition == NULL)
+    return (false);
+
+  const void *image = NULL;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_partition_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &image, &handle) != ESP_OK)
+    return (false);
+#else
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &image, &handle) != ESP_OK)
+    return (false);
+#endif
+
+  _mmapHandle = (uint32_t)handle;
+  _mapped = true;
+  setImage((const uint8_t *)image, partition->size);
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Unmap the partition
+*/
+/**************************************************************************/
+void SWARM_M138_TLE_Partition_Source::end(void)
+{
+  if (_mapped)
+  {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_partition_munmap((esp_partition_mmap_handle_t)_mmapHandle);
+#else
+    spi_flash_munmap((spi_flash_mmap_handle_t)_mmapHandle);
+#endif
+    _mapped = false;
+  }
+  setImage(NULL, 0);
+}
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+// Seek to offset and read len bytes
+bool SWARM_M138_TLE_File_Source::read(uint32_t offset, uint8_t *dest, uint16_t len)
+{
+  if ((_file == NULL) || (!(*_file)) || (dest == NULL))
+    return (false);
+
+  if (!_file->seek(offset))
+    return (false);
+
+  return (_file->read(dest, len) == len);
+}
+#endif
+
+SWARM_M138_TLE_Store::SWARM_M138_TLE_Store(void)
+{
+  _source = NULL;
+  _count = 0;
+  _indexSlots = 0;
+  _checksum = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin using a TLE image. Only the header is read: call verify to check the whole image
+    @param  source
+            Where to read the image from. It must remain valid while the store is in use
+    @return true if the header is valid
+*/
+/**************************************************************************/
+bool SWARM_M138_TLE_Store::begin(SWARM_M138_TLE_Source &source)
+{
+  _source = NULL;
+  _count = 0;
+  _indexSlots = 0;
+
+  uint8_t header[SWARM_M138_TLE_HEADER_SIZE]; // Use the stack, not the heap
+  if (!source.read(0, header, SWARM_M138_TLE_HEADER_SIZE))
+    return (false);
+
+  uint16_t count = swarm_m138_get_u16(&header[4]);
+  uint16_t slots = swarm_m138_get_u16(&header[6]);
+
+  if ((swarm_m138_get_u32(&header[0]) != SWARM_M138_TLE_IMAGE_MAGIC)
+      || (swarm_m138_get_u16(&header[8]) != SWARM_M138_TLE_RECORD_SIZE)
+      || (slots <= count) || ((slots & (slots - 1)) != 0)) // The index must be a power of two - with at least one empty slot
+    return (false);
+
+  _source = &source;
+  _count = count;
+  _indexSlots = slots;
+  _checksum = swarm_m138_get_u32(&header[12]);
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check the CRC-32 of the index and the records. This reads the whole image - one record at a time
+    @return true if the image is intact
+*/
+/**************************************************************************/
+bool SWARM_M138_TLE_Store::verify(void)
+{
+  if (_source == NULL)
+    return (false);
+
+  uint32_t offset = SWARM_M138_TLE_HEADER_SIZE;
+  uint32_t remaining = ((uint32_t)_indexSlots * 2) + ((uint32_t)_count * SWARM_M138_TLE_RECORD_SIZE);
+  uint32_t crc = 0xFFFFFFFF;
+
+  while (remaining > 0)
+  {
+    uint8_t chunk[SWARM_M138_TLE_RECORD_SIZE]; // Use the stack, not the heap
+    uint16_t len = (remaining < SWARM_M138_TLE_RECORD_SIZE) ? (uint16_t)remaining : SWARM_M138_TLE_RECORD_SIZE;
+    if (!_source->read(offset, chunk, len))
+      return (false);
+    crc = swarm_m138_crc32(crc, chunk, len);
+    offset += len;
+    remaining -= len;
+  }
+
+  return ((crc ^ 0xFFFFFFFF) == _checksum);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of satellites in the image
+    @return The number of satellites. 0 if begin failed
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_TLE_Store::getCount(void)
+{
+  return (_count);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the orbital elements of one satellite
+    @param  index
+            The satellite: 0 to getCount() - 1
+    @param  elements
+            The elements are copied into here
+    @return true if the record was read
+*/
+/**************************************************************************/
+bool SWARM_M138_TLE_Store::getElements(uint16_t index, Swarm_M138_Orbital_Elements_t *elements)
+{
+  if ((_source == NULL) || (index >= _count) || (elements == NULL))
+    return (false);
+
+  uint8_t record[SWARM_M138_TLE_RECORD_SIZE]; // Use the stack, not the heap
+  uint32_t offset = SWARM_M138_TLE_HEADER_SIZE + ((uint32_t)_indexSlots * 2) + ((uint32_t)index * SWARM_M138_TLE_RECORD_SIZE);
+  if (!_source->read(offset, record, SWARM_M138_TLE_RECORD_SIZE))
+    return (false);
+
+  unpackRecord(record, elements);
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Look up a satellite by NORAD ID. The hash index is at most half full:
+            the satellite is usually found in the first slot
+    @param  noradID
+            The NORAD catalog number
+    @param  elements
+            The elements are copied into here. Can be NULL - to check if the satellite is in the image
+    @return true if the satellite was found
+*/
+/**************************************************************************/
+bool SWARM_M138_TLE_Store::find(uint32_t noradID, Swarm_M138_Orbital_Elements_t *elements)
+{
+  if (_source == NULL)
+    return (false);
+
+  uint16_t mask = _indexSlots - 1;
+  uint16_t slot = (uint16_t)(noradID & mask); // NORAD IDs are allocated sequentially: the low bits spread well
+
+  for (uint16_t probe = 0; probe < _indexSlots; probe++)
+  {
+    uint8_t entry[2];
+    if (!_source->read(SWARM_M138_TLE_HEADER_SIZE + ((uint32_t)slot * 2), entry, 2))
+      return (false);
+
+    uint16_t index = swarm_m138_get_u16(entry);
+    if (index == 0) // An empty slot: the satellite is not in the image
+      return (false);
+
+    Swarm_M138_Orbital_Elements_t candidate; // Use the stack, not the heap
+    if (getElements(index - 1, &candidate) && (candidate.noradID == noradID))
+    {
+      if (elements != NULL)
+        memcpy(elements, &candidate, sizeof(Swarm_M138_Orbital_Elements_t));
+      return (true);
+    }
+
+    slot = (slot + 1) & mask; // Linear probing
+  }
+
+  return (false);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the size of the image for this many satellites
+    @param  numSatellites
+            The number of satellites
+    @return The size in bytes
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_TLE_Store::getImageSize(uint16_t numSatellites)
+{
+  return (SWARM_M138_TLE_HEADER_SIZE + ((uint32_t)indexSlots(numSatellites) * 2) + ((uint32_t)numSatellites * SWARM_M138_TLE_RECORD_SIZE));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Build a TLE image. If a NORAD ID appears more than once, find returns the first
+    @param  satellites
+            The orbital elements of the satellites. E.g. from SWARM_M138_Pass_Predictor::parseTLE
+    @param  numSatellites
+            The number of satellites: up to 16384
+    @param  image
+            The image is written into here
+    @param  imageSize
+            The size of image. It must be at least getImageSize(numSatellites)
+    @return The size of the image in bytes. 0 if there was an error
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_TLE_Store::buildImage(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint8_t *image, uint32_t imageSize)
+{
+  uint32_t size = getImageSize(numSatellites);
+
+  if ((image == NULL) || ((satellites == NULL) && (numSatellites > 0)) || (numSatellites > 0x4000) || (imageSize < size))
+    return (0);
+
+  uint16_t slots = indexSlots(numSatellites);
+  uint16_t mask = slots - 1;
+  uint8_t *index = &image[SWARM_M138_TLE_HEADER_SIZE];
+  uint8_t *records = &index[(uint32_t)slots * 2];
+
+  memset(image, 0, size);
+  swarm_m138_put_u32(&image[0], SWARM_M138_TLE_IMAGE_MAGIC);
+  swarm_m138_put_u16(&image[4], numSatellites);
+  swarm_m138_put_u16(&image[6], slots);
+  swarm_m138_put_u16(&image[8], SWARM_M138_TLE_RECORD_SIZE);
+
+  for (uint16_t i = 0; i < numSatellites; i++)
+  {
+    packRecord(&satellites[i], &records[(uint32_t)i * SWARM_M138_TLE_RECORD_SIZE]);
+
+    uint16_t slot = (uint16_t)(satellites[i].noradID & mask);
+    while (swarm_m138_get_u16(&index[(uint32_t)slot * 2]) != 0)
+      slot = (slot + 1) & mask;
+    swarm_m138_put_u16(&index[(uint32_t)slot * 2], i + 1);
+  }
+
+  uint32_t crc = 0xFFFFFFFF;
+  uint32_t offset = SWARM_M138_TLE_HEADER_SIZE;
+  while (offset < size) // swarm_m138_crc32 takes a uint16_t length
+  {
+    uint16_t len = ((size - offset) < 0x8000) ? (uint16_t)(size - offset) : 0x8000;
+    crc = swarm_m138_crc32(crc, &image[offset], len);
+    offset += len;
+  }
+  swarm_m138_put_u32(&image[12], crc ^ 0xFFFFFFFF);
+
+  return (size);
+}
+
+// The size of the hash index: a power of two, at least twice the number of satellites
+uint16_t SWARM_M138_TLE_Store::indexSlots(uint16_t numSatellites)
+{
+  uint16_t slots = 2;
+  while ((slots < 0x8000) && (slots < ((uint32_t)numSatellites * 2)))
+    slots <<= 1;
+  return (slots);
+}
+
+// Convert the elements to the fixed-point record
+void SWARM_M138_TLE_Store::packRecord(const Swarm_M138_Orbital_Elements_t *elements, uint8_t *record)
+{
+  double seconds = floor(elements->epoch);
+  double micros = floor(((elements->epoch - seconds) * 1000000.0) + 0.5);
+  if (micros >= 1000000.0)
+  {
+    seconds += 1.0;
+    micros -= 1000000.0;
+  }
+
+  double meanMotion = floor((elements->meanMotion * 1.0e8) + 0.5);
+  if (meanMotion > 4294967295.0)
+    meanMotion = 4294967295.0;
+  if (meanMotion < 0.0)
+    meanMotion = 0.0;
+
+  double meanMotionDot = floor((elements->meanMotionDot * 1.0e10) + 0.5);
+  if (meanMotionDot > 2147483647.0)
+    meanMotionDot = 2147483647.0;
+  if (meanMotionDot < -2147483647.0)
+    meanMotionDot = -2147483647.0;
+
+  double eccentricity = elements->eccentricity;
+  if (eccentricity > 0.9999999)
+    eccentricity = 0.9999999;
+
+  swarm_m138_put_u32(&record[0], elements->noradID);
+  swarm_m138_put_u32(&record[4], (uint32_t)seconds);
+  swarm_m138_put_u32(&record[8], (uint32_t)micros);
+  swarm_m138_put_u32(&record[12], swarm_m138_pack_fraction(elements->inclination / SWARM_M138_TWO_PI));
+  swarm_m138_put_u32(&record[16], swarm_m138_pack_fraction(elements->raan / SWARM_M138_TWO_PI));
+  swarm_m138_put_u32(&record[20], swarm_m138_pack_fraction(eccentricity));
+  swarm_m138_put_u32(&record[24], swarm_m138_pack_fraction(elements->argPerigee / SWARM_M138_TWO_PI));
+  swarm_m138_put_u32(&record[28], swarm_m138_pack_fraction(elements->meanAnomaly / SWARM_M138_TWO_PI));
+  swarm_m138_put_u32(&record[32], (uint32_t)meanMotion);
+  swarm_m138_put_u32(&record[36], (uint32_t)((int32_t)meanMotionDot));
+}
+
+// Convert the fixed-point record to elements
+void SWARM_M138_TLE_Store::unpackRecord(const uint8_t *record, Swarm_M138_Orbital_Elements_t *elements)
+{
+  const double turn = SWARM_M138_TWO_PI / 4294967296.0; // Radians per unit
+
+  elements->noradID = swarm_m138_get_u32(&record[0]);
+  elements->epoch = ((double)swarm_m138_get_u32(&record[4])) + (((double)swarm_m138_get_u32(&record[8])) * 1.0e-6);
+  elements->inclination = ((double)swarm_m138_get_u32(&record[12])) * turn;
+  elements->raan = ((double)swarm_m138_get_u32(&record[16])) * turn;
+  elements->eccentricity = ((double)swarm_m138_get_u32(&record[20])) / 4294967296.0;
+  elements->argPerigee = ((double)swarm_m138_get_u32(&record[24])) * turn;
+  elements->meanAnomaly = ((double)swarm_m138_get_u32(&record[28])) * turn;
+  elements->meanMotion = ((double)swarm_m138_get_u32(&record[32])) * 1.0e-8;
+  elements->meanMotionDot = ((double)((int32_t)swarm_m138_get_u32(&record[36]))) * 1.0e-10;
+}
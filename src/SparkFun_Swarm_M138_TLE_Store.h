@@ -0,0 +1,126 @@
+/*!
+ * @file SparkFun_Swarm_M138_TLE_Store.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_TLE_Store and its sources: a compact binary image of the orbital elements.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h and SparkFun_Swarm_M138_Pass_Predictor.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_TLE_STORE_H
+#define SPARKFUN_SWARM_M138_TLE_STORE_H
+
+#include "SparkFun_Swarm_M138_Pass_Predictor.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#include <FS.h> // Needed for SWARM_M138_TLE_File_Source
+#endif
+
+/** Compact binary TLE store
+ *
+ *  SWARM_M138_TLE_Store::buildImage packs parsed orbital elements into a binary image: a 16-byte header,
+ *  a hash index by NORAD ID and one 40-byte record per satellite. The records hold little-endian fixed-point
+ *  integers, so an image built on one board can be read on any other. Build the image once per TLE refresh
+ *  and write it to a file, to a flash partition - or into a PROGMEM array.
+ *  SWARM_M138_TLE_Store then reads the records straight from the image through a SWARM_M138_TLE_Source:
+ *  no text is parsed at startup, and only one record at a time is held in RAM. find is O(1).
+ */
+#define SWARM_M138_TLE_IMAGE_MAGIC 0x31455753 ///< "SWE1" - the first four bytes of the image
+#define SWARM_M138_TLE_HEADER_SIZE 16         ///< Magic (4), record count (2), index slots (2), record size (2), reserved (2), CRC-32 of the index and records (4)
+#define SWARM_M138_TLE_RECORD_SIZE 40         ///< NORAD ID, epoch seconds, epoch microseconds, five angles and eccentricity (1/2^32), mean motion (1e-8 rev/day), mean motion dot (1e-10 rev/day^2)
+
+/** Where SWARM_M138_TLE_Store reads the image from */
+class SWARM_M138_TLE_Source
+{
+public:
+  virtual ~SWARM_M138_TLE_Source(void) {}
+
+  virtual bool read(uint32_t offset, uint8_t *dest, uint16_t len) = 0; // Read len bytes from offset into dest. Return false if they could not all be read
+};
+
+/** TLE image in RAM or PROGMEM */
+class SWARM_M138_TLE_Memory_Source : public SWARM_M138_TLE_Source
+{
+public:
+  SWARM_M138_TLE_Memory_Source(const uint8_t *image = NULL, uint32_t size = 0, bool progmem = false) { setImage(image, size, progmem); }
+  void setImage(const uint8_t *image, uint32_t size, bool progmem = false) { _image = image; _size = size; _progmem = progmem; } // Set progmem if the image is a PROGMEM array
+
+  bool read(uint32_t offset, uint8_t *dest, uint16_t len);
+
+protected:
+  const uint8_t *_image;
+  uint32_t _size;
+  bool _progmem;
+};
+
+#ifdef ARDUINO_ARCH_ESP32
+/** TLE image in an ESP32 data partition - memory-mapped, so it is read straight from flash */
+class SWARM_M138_TLE_Partition_Source : public SWARM_M138_TLE_Memory_Source
+{
+public:
+  SWARM_M138_TLE_Partition_Source(void) { _mapped = false; _mmapHandle = 0; }
+  ~SWARM_M138_TLE_Partition_Source(void) { end(); }
+
+  bool begin(const char *label); // Map the data partition with this label. Return false if it was not found or could not be mapped
+  void end(void);                // Unmap the partition
+
+private:
+  bool _mapped;
+  uint32_t _mmapHandle;
+};
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+/** TLE image in a file: SPIFFS, LittleFS or SD */
+class SWARM_M138_TLE_File_Source : public SWARM_M138_TLE_Source
+{
+public:
+  SWARM_M138_TLE_File_Source(fs::File *file = NULL) { _file = file; }
+  void setFile(fs::File *file) { _file = file; } // The file must stay open while the store is in use
+
+  bool read(uint32_t offset, uint8_t *dest, uint16_t len);
+
+private:
+  fs::File *_file;
+};
+#endif
+
+/** Look up orbital elements in a binary TLE image */
+class SWARM_M138_TLE_Store
+{
+public:
+  SWARM_M138_TLE_Store(void);
+
+  bool begin(SWARM_M138_TLE_Source &source); // Read and check the image header. Return false if the image is invalid
+  bool verify(void);                         // Check the CRC-32 of the index and the records. Return false if the image is corrupt
+
+  uint16_t getCount(void);                                                    // The number of satellites in the image
+  bool getElements(uint16_t index, Swarm_M138_Orbital_Elements_t *elements); // Read the elements of satellite index (0 to getCount - 1)
+  bool find(uint32_t noradID, Swarm_M138_Orbital_Elements_t *elements);      // Look up a satellite by NORAD ID. Return false if it is not in the image
+
+  static uint32_t getImageSize(uint16_t numSatellites); // The size of the image in bytes
+  static uint32_t buildImage(const Swarm_M138_Orbital_Elements_t *satellites, uint16_t numSatellites, uint8_t *image, uint32_t imageSize); // Build the image. Return its size. 0 if imageSize is too small
+
+private:
+  SWARM_M138_TLE_Source *_source;
+  uint16_t _count;
+  uint16_t _indexSlots; // A power of two: at least twice _count. The index holds record index + 1 in each slot. 0 is empty
+  uint32_t _checksum;
+
+  static uint16_t indexSlots(uint16_t numSatellites);                                        // The size of the hash index
+  static void packRecord(const Swarm_M138_Orbital_Elements_t *elements, uint8_t *record);    // Elements to fixed-point
+  static void unpackRecord(const uint8_t *record, Swarm_M138_Orbital_Elements_t *elements);  // Fixed-point to elements
+};
+
+#endif // SPARKFUN_SWARM_M138_TLE_STORE_H
@@ -0,0 +1,466 @@
+/*!
+ * @file SparkFun_Swarm_M138_Tx_Ledger.cpp
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Tx_Ledger: track the queued messages by msg_id.
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#include "SparkFun_Swarm_M138_Tx_Ledger.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+
+// SWARM_M138_Tx_Ledger: track the queued messages by msg_id
+
+SWARM_M138_Tx_Ledger::SWARM_M138_Tx_Ledger(void)
+{
+  clear();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record a queued message. If msg_id is already in the ledger, its record is replaced
+    @param  msg_id
+            The message ID - from $TD OK
+    @param  queued
+            When the message was queued: Unix time (seconds). 0 if not known
+    @param  hasAppID
+            true if the message has an application ID
+    @param  appID
+            The application ID
+    @param  expires
+            When the modem will discard the message: Unix time (seconds). 0 if not known
+    @return true if the message was recorded. false if the ledger is full of queued messages
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::add(uint64_t msg_id, uint32_t queued, bool hasAppID, uint16_t appID, uint32_t expires)
+{
+  Swarm_M138_Tx_Record_t record;
+  memset(&record, 0, sizeof(record));
+  record.msg_id = msg_id;
+  record.queued = queued;
+  record.expires = expires;
+  record.sequence = _sequence++;
+  record.appID = appID;
+  record.hasAppID = hasAppID;
+  record.state = SWARM_M138_TX_STATE_QUEUED;
+
+  uint16_t slot = findSlot(msg_id);
+  if (slot < SWARM_M138_TX_LEDGER_SLOTS)
+  {
+    memcpy(&_records[slot], &record, sizeof(record));
+    return (true);
+  }
+
+  return (insert(&record));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record a $TD SENT
+    @param  msg_id
+            The message ID
+    @param  rssi_sat
+            The RSSI of the satellite's acknowledgement
+    @param  snr
+            The signal to noise ratio
+    @param  fdev
+            The frequency deviation
+    @param  sent
+            When the message was sent: Unix time (seconds). 0 if not known
+    @return true if the message is in the ledger
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::markSent(uint64_t msg_id, int16_t rssi_sat, int16_t snr, int16_t fdev, uint32_t sent)
+{
+  uint16_t slot = findSlot(msg_id);
+  if (slot >= SWARM_M138_TX_LEDGER_SLOTS)
+    return (false);
+
+  _records[slot].state = SWARM_M138_TX_STATE_SENT;
+  _records[slot].sent = sent;
+  _records[slot].rssi_sat = rssi_sat;
+  _records[slot].snr = snr;
+  _records[slot].fdev = fdev;
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record that a queued message has been deleted
+    @param  msg_id
+            The message ID
+    @return true if the message is in the ledger
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::markDeleted(uint64_t msg_id)
+{
+  uint16_t slot = findSlot(msg_id);
+  if (slot >= SWARM_M138_TX_LEDGER_SLOTS)
+    return (false);
+
+  if (_records[slot].state == SWARM_M138_TX_STATE_QUEUED)
+    _records[slot].state = SWARM_M138_TX_STATE_DELETED;
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record that every queued message has been deleted
+    @return The number of messages marked
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Tx_Ledger::markAllDeleted(void)
+{
+  uint16_t marked = 0;
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+  {
+    if (_records[slot].state == SWARM_M138_TX_STATE_QUEUED)
+    {
+      _records[slot].state = SWARM_M138_TX_STATE_DELETED;
+      marked++;
+    }
+  }
+  return (marked);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Mark the queued messages whose expiry time has passed
+    @param  now
+            The current time: Unix time (seconds)
+    @return The number of messages marked
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Tx_Ledger::expire(uint32_t now)
+{
+  uint16_t marked = 0;
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+  {
+    if ((_records[slot].state == SWARM_M138_TX_STATE_QUEUED) && (_records[slot].expires > 0) && (now >= _records[slot].expires))
+    {
+      _records[slot].state = SWARM_M138_TX_STATE_EXPIRED;
+      marked++;
+    }
+  }
+  return (marked);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Look up a message
+    @param  msg_id
+            The message ID
+    @param  record
+            The record is copied into here. Can be NULL - to check if the message is in the ledger
+    @return true if the message is in the ledger
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::find(uint64_t msg_id, Swarm_M138_Tx_Record_t *record)
+{
+  uint16_t slot = findSlot(msg_id);
+  if (slot >= SWARM_M138_TX_LEDGER_SLOTS)
+    return (false);
+
+  if (record != NULL)
+    memcpy(record, &_records[slot], sizeof(Swarm_M138_Tx_Record_t));
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forget a message - e.g. once the backend has confirmed it
+    @param  msg_id
+            The message ID
+    @return true if the message was in the ledger
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::remove(uint64_t msg_id)
+{
+  uint16_t slot = findSlot(msg_id);
+  if (slot >= SWARM_M138_TX_LEDGER_SLOTS)
+    return (false);
+
+  removeSlot(slot);
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forget every message
+*/
+/**************************************************************************/
+void SWARM_M138_Tx_Ledger::clear(void)
+{
+  memset(_records, 0, sizeof(_records));
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+    _records[slot].state = SWARM_M138_TX_STATE_EMPTY;
+  _count = 0;
+  _sequence = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of messages in the ledger
+    @return The count
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Tx_Ledger::getCount(void)
+{
+  return (_count);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of messages in one state
+    @param  state
+            The state. E.g. SWARM_M138_TX_STATE_QUEUED
+    @return The count
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Tx_Ledger::getCount(Swarm_M138_Tx_State_e state)
+{
+  uint16_t count = 0;
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+  {
+    if (_records[slot].state == state)
+      count++;
+  }
+  return (count);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the maximum number of messages. The table is kept at most three-quarters full
+            so find stays fast
+    @return The capacity
+*/
+/**************************************************************************/
+uint16_t SWARM_M138_Tx_Ledger::getCapacity(void)
+{
+  return ((SWARM_M138_TX_LEDGER_SLOTS / 4) * 3);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walk the ledger
+    @param  slot
+            The slot: 0 to SWARM_M138_TX_LEDGER_SLOTS - 1
+    @param  record
+            The record is copied into here
+    @return true if the slot holds a message
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::getRecord(uint16_t slot, Swarm_M138_Tx_Record_t *record)
+{
+  if ((slot >= SWARM_M138_TX_LEDGER_SLOTS) || (record == NULL) || (_records[slot].state == SWARM_M138_TX_STATE_EMPTY))
+    return (false);
+
+  memcpy(record, &_records[slot], sizeof(Swarm_M138_Tx_Record_t));
+  return (true);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of bytes save will write: a 16-byte header plus the records
+    @return The size
+*/
+/**************************************************************************/
+uint32_t SWARM_M138_Tx_Ledger::getSaveSize(void)
+{
+  return (SWARM_M138_TX_LEDGER_HEADER_SIZE + ((uint32_t)_count * sizeof(Swarm_M138_Tx_Record_t)));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Save the ledger - e.g. to EEPROM or a file. The records are written one at a time
+            and the header last, so an interrupted save is rejected by load.
+            The records are written in the host's own byte order: load them on the same platform
+    @param  write
+            A pointer to the function which writes the data: bool write(uint32_t offset, const uint8_t *data, uint16_t len, void *context)
+    @param  context
+            Passed to write
+    @return true if every write succeeded
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::save(bool (*write)(uint32_t offset, const uint8_t *data, uint16_t len, void *context), void *context)
+{
+  if (write == NULL)
+    return (false);
+
+  uint32_t offset = SWARM_M138_TX_LEDGER_HEADER_SIZE;
+  uint32_t crc = 0xFFFFFFFF;
+  uint16_t count = 0;
+
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+  {
+    if (_records[slot].state == SWARM_M138_TX_STATE_EMPTY)
+      continue;
+    const uint8_t *data = (const uint8_t *)&_records[slot];
+    if (!write(offset, data, sizeof(Swarm_M138_Tx_Record_t), context))
+      return (false);
+    crc = swarm_m138_crc32(crc, data, sizeof(Swarm_M138_Tx_Record_t));
+    offset += sizeof(Swarm_M138_Tx_Record_t);
+    count++;
+  }
+
+  uint8_t header[SWARM_M138_TX_LEDGER_HEADER_SIZE]; // Use the stack, not the heap
+  swarm_m138_put_u32(&header[0], SWARM_M138_TX_LEDGER_MAGIC);
+  swarm_m138_put_u16(&header[4], count);
+  swarm_m138_put_u16(&header[6], SWARM_M138_TX_LEDGER_SLOTS);
+  swarm_m138_put_u16(&header[8], sizeof(Swarm_M138_Tx_Record_t));
+  swarm_m138_put_u16(&header[10], 0); // Reserved
+  swarm_m138_put_u32(&header[12], crc ^ 0xFFFFFFFF);
+  return (write(0, header, SWARM_M138_TX_LEDGER_HEADER_SIZE, context));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Load a saved ledger. The records are re-hashed: the saved ledger can have a different
+            SWARM_M138_TX_LEDGER_SLOTS - so long as its records fit
+    @param  read
+            A pointer to the function which reads the data: bool read(uint32_t offset, uint8_t *data, uint16_t len, void *context)
+    @param  context
+            Passed to read
+    @return true if the ledger was loaded. false - and the ledger is cleared - if the data is invalid
+*/
+/**************************************************************************/
+bool SWARM_M138_Tx_Ledger::load(bool (*read)(uint32_t offset, uint8_t *data, uint16_t len, void *context), void *context)
+{
+  clear();
+
+  if (read == NULL)
+    return (false);
+
+  uint8_t header[SWARM_M138_TX_LEDGER_HEADER_SIZE]; // Use the stack, not the heap
+  if (!read(0, header, SWARM_M138_TX_LEDGER_HEADER_SIZE, context))
+    return (false);
+
+  uint16_t count = swarm_m138_get_u16(&header[4]);
+  if ((swarm_m138_get_u32(&header[0]) != SWARM_M138_TX_LEDGER_MAGIC)
+      || (swarm_m138_get_u16(&header[8]) != sizeof(Swarm_M138_Tx_Record_t))
+      || (count > getCapacity()))
+    return (false);
+
+  uint32_t offset = SWARM_M138_TX_LEDGER_HEADER_SIZE;
+  uint32_t crc = 0xFFFFFFFF;
+  uint32_t sequence = 0;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    Swarm_M138_Tx_Record_t record; // Use the stack, not the heap
+    if (!read(offset, (uint8_t *)&record, sizeof(Swarm_M138_Tx_Record_t), context))
+    {
+      clear();
+      return (false);
+    }
+    crc = swarm_m138_crc32(crc, (const uint8_t *)&record, sizeof(Swarm_M138_Tx_Record_t));
+    offset += sizeof(Swarm_M138_Tx_Record_t);
+
+    if ((record.state > SWARM_M138_TX_STATE_EXPIRED) || (findSlot(record.msg_id) < SWARM_M138_TX_LEDGER_SLOTS) || (!insert(&record)))
+    {
+      clear();
+      return (false);
+    }
+    if (record.sequence >= sequence)
+      sequence = record.sequence + 1;
+  }
+
+  if ((crc ^ 0xFFFFFFFF) != swarm_m138_get_u32(&header[12]))
+  {
+    clear();
+    return (false);
+  }
+
+  _sequence = sequence;
+  return (true);
+}
+
+// Return the slot holding msg_id. SWARM_M138_TX_LEDGER_SLOTS if it is not in the ledger
+uint16_t SWARM_M138_Tx_Ledger::findSlot(uint64_t msg_id)
+{
+  uint16_t slot = homeSlot(msg_id);
+  for (uint16_t probe = 0; probe < SWARM_M138_TX_LEDGER_SLOTS; probe++)
+  {
+    if (_records[slot].state == SWARM_M138_TX_STATE_EMPTY)
+      break; // The table is never full: every search ends at an empty slot
+    if (_records[slot].msg_id == msg_id)
+      return (slot);
+    slot = (slot + 1) & (SWARM_M138_TX_LEDGER_SLOTS - 1);
+  }
+  return (SWARM_M138_TX_LEDGER_SLOTS);
+}
+
+// The slot at which the search for msg_id starts
+// The msg_ids share their high bits: fold them and use a multiplicative hash so the low bits spread
+uint16_t SWARM_M138_Tx_Ledger::homeSlot(uint64_t msg_id)
+{
+  uint32_t folded = (uint32_t)(msg_id ^ (msg_id >> 32));
+  return ((uint16_t)((((uint32_t)(folded * 2654435761UL)) >> 16) & (SWARM_M138_TX_LEDGER_SLOTS - 1)));
+}
+
+// Empty the slot - and shift the records after it back, so no search is broken
+void SWARM_M138_Tx_Ledger::removeSlot(uint16_t slot)
+{
+  const uint16_t mask = SWARM_M138_TX_LEDGER_SLOTS - 1;
+  uint16_t hole = slot;
+  uint16_t next = slot;
+
+  while (true)
+  {
+    next = (next + 1) & mask;
+    if (_records[next].state == SWARM_M138_TX_STATE_EMPTY)
+      break;
+    uint16_t home = homeSlot(_records[next].msg_id);
+    if (((next - home) & mask) >= ((next - hole) & mask)) // Can the record move back into the hole?
+    {
+      memcpy(&_records[hole], &_records[next], sizeof(Swarm_M138_Tx_Record_t));
+      hole = next;
+    }
+  }
+
+  memset(&_records[hole], 0, sizeof(Swarm_M138_Tx_Record_t));
+  _records[hole].state = SWARM_M138_TX_STATE_EMPTY;
+  _count--;
+}
+
+// Forget the oldest record which is no longer queued. Return false if every record is queued
+bool SWARM_M138_Tx_Ledger::evict(void)
+{
+  uint16_t oldest = SWARM_M138_TX_LEDGER_SLOTS;
+  for (uint16_t slot = 0; slot < SWARM_M138_TX_LEDGER_SLOTS; slot++)
+  {
+    if ((_records[slot].state == SWARM_M138_TX_STATE_EMPTY) || (_records[slot].state == SWARM_M138_TX_STATE_QUEUED))
+      continue;
+    if ((oldest == SWARM_M138_TX_LEDGER_SLOTS) || (_records[slot].sequence < _records[oldest].sequence))
+      oldest = slot;
+  }
+
+  if (oldest == SWARM_M138_TX_LEDGER_SLOTS)
+    return (false);
+
+  removeSlot(oldest);
+  return (true);
+}
+
+// Copy the record into the first empty slot after its home - making room if needed
+bool SWARM_M138_Tx_Ledger::insert(const Swarm_M138_Tx_Record_t *record)
+{
+  if ((_count >= getCapacity()) && (!evict()))
+    return (false);
+
+  uint16_t slot = homeSlot(record->msg_id);
+  while (_records[slot].state != SWARM_M138_TX_STATE_EMPTY)
+    slot = (slot + 1) & (SWARM_M138_TX_LEDGER_SLOTS - 1);
+
+  memcpy(&_records[slot], record, sizeof(Swarm_M138_Tx_Record_t));
+  _count++;
+  return (true);
+}
@@ -0,0 +1,109 @@
+/*!
+ * @file SparkFun_Swarm_M138_Tx_Ledger.h
+ *
+ * SparkFun Swarm Satellite Arduino Library
+ *
+ * SWARM_M138_Tx_Ledger: track the queued messages by msg_id.
+ * Include this header as well as SparkFun_Swarm_Satellite_Arduino_Library.h to use it.
+ *
+ * Want to support open source hardware? Buy a board from SparkFun!
+ * <br>SparkX Swarm Serial Breakout (SPX-19236): https://www.sparkfun.com/products/19236
+ *
+ * This library was written by:
+ * Paul Clark
+ * SparkFun Electronics
+ * January 2022
+ *
+ * Please see LICENSE.md for the license information
+ *
+ */
+
+#ifndef SPARKFUN_SWARM_M138_TX_LEDGER_H
+#define SPARKFUN_SWARM_M138_TX_LEDGER_H
+
+#include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+
+/** TX message ledger */
+#ifndef SWARM_M138_TX_LEDGER_SLOTS
+#define SWARM_M138_TX_LEDGER_SLOTS 64 ///< The size of the ledger hash table - a power of two. Up to three quarters of the slots are used. 40 bytes each
+#endif
+#define SWARM_M138_TX_DEFAULT_HOLD 172800 ///< The modem holds a message for 48 hours if no hold duration or expiry time is given
+#define SWARM_M138_TX_LEDGER_MAGIC 0x314C5753 ///< "SWL1" - the first four bytes of a saved ledger
+#define SWARM_M138_TX_LEDGER_HEADER_SIZE 16 ///< Magic (4), record count (2), slots (2), record size (2), reserved (2), CRC-32 of the records (4)
+
+#if ((SWARM_M138_TX_LEDGER_SLOTS & (SWARM_M138_TX_LEDGER_SLOTS - 1)) != 0) || (SWARM_M138_TX_LEDGER_SLOTS < 4)
+#error SWARM_M138_TX_LEDGER_SLOTS must be a power of two - and at least 4
+#endif
+
+/** An enum for the state of a message in the ledger */
+typedef enum
+{
+  SWARM_M138_TX_STATE_QUEUED = 0, // In the modem's queue
+  SWARM_M138_TX_STATE_SENT,       // $TD SENT: delivered to a satellite
+  SWARM_M138_TX_STATE_DELETED,    // Deleted with deleteTxMessage or deleteAllTxMessages
+  SWARM_M138_TX_STATE_EXPIRED,    // Not sent before its expiry time - see SWARM_M138_Tx_Ledger::expire
+  SWARM_M138_TX_STATE_EMPTY = 0xFF
+} Swarm_M138_Tx_State_e;
+
+/** A struct to hold one message in the ledger */
+typedef struct
+{
+  uint64_t msg_id;             // The message ID - from $TD OK
+  uint32_t queued;             // When the message was queued: Unix time (seconds). 0 if the modem's date and time were not known
+  uint32_t expires;            // When the modem will discard the message if it has not been sent. 0 if not known
+  uint32_t sent;               // When $TD SENT arrived. 0 if the message has not been sent - or the time was not known
+  uint32_t sequence;           // Increases with every message added to the ledger
+  uint16_t appID;              // The application ID - if hasAppID is true
+  bool hasAppID;
+  Swarm_M138_Tx_State_e state;
+  int16_t rssi_sat;            // From $TD SENT
+  int16_t snr;
+  int16_t fdev;
+} Swarm_M138_Tx_Record_t;
+
+/** A ledger of the messages queued for transmission
+ *
+ *  Attach it with SWARM_M138::setTxLedger. Every message queued by transmitText, transmitBinary, transmitBatch
+ *  or transmitBinaryAsync is then recorded - keyed by its msg_id - and updated by $TD SENT and the delete commands.
+ *  No extra commands are sent: the queue time is extrapolated from the last $DT.
+ *  The records are held in a fixed-size open-addressing hash table: find is O(1).
+ *  When the ledger is full, the oldest record which is no longer queued is forgotten to make room.
+ *  save and load copy the ledger to and from EEPROM, flash or a file - e.g. across restartDevice or a host reset.
+ */
+class SWARM_M138_Tx_Ledger
+{
+public:
+  SWARM_M138_Tx_Ledger(void);
+
+  bool add(uint64_t msg_id, uint32_t queued, bool hasAppID, uint16_t appID, uint32_t expires); // Record a queued message. Return false if there is no room
+  bool markSent(uint64_t msg_id, int16_t rssi_sat, int16_t snr, int16_t fdev, uint32_t sent);  // Record a $TD SENT. Return false if the message is not in the ledger
+  bool markDeleted(uint64_t msg_id);                                                           // Return false if the message is not in the ledger
+  uint16_t markAllDeleted(void);                                                               // Mark every queued message as deleted. Return how many
+  uint16_t expire(uint32_t now);                                                               // Mark the queued messages whose expiry time has passed. Return how many
+
+  bool find(uint64_t msg_id, Swarm_M138_Tx_Record_t *record); // Look up a message. Return false if it is not in the ledger
+  bool remove(uint64_t msg_id);                               // Forget a message - e.g. once the backend has confirmed it
+  void clear(void);                                           // Forget every message
+
+  uint16_t getCount(void);                                          // The number of messages in the ledger
+  uint16_t getCount(Swarm_M138_Tx_State_e state);                   // The number of messages in this state
+  uint16_t getCapacity(void);                                       // The maximum number of messages
+  bool getRecord(uint16_t slot, Swarm_M138_Tx_Record_t *record);    // Walk the ledger: slot 0 to SWARM_M138_TX_LEDGER_SLOTS - 1. Return false if the slot is empty
+
+  uint32_t getSaveSize(void); // The number of bytes written by save
+  bool save(bool (*write)(uint32_t offset, const uint8_t *data, uint16_t len, void *context), void *context = NULL); // Write the ledger - one record at a time
+  bool load(bool (*read)(uint32_t offset, uint8_t *data, uint16_t len, void *context), void *context = NULL);       // Read a saved ledger. Return false - and clear the ledger - if it is invalid
+
+private:
+  Swarm_M138_Tx_Record_t _records[SWARM_M138_TX_LEDGER_SLOTS];
+  uint16_t _count;
+  uint32_t _sequence;
+
+  uint16_t findSlot(uint64_t msg_id); // Return the slot holding msg_id. SWARM_M138_TX_LEDGER_SLOTS if it is not in the ledger
+  uint16_t homeSlot(uint64_t msg_id); // The slot at which the search for msg_id starts
+  void removeSlot(uint16_t slot);     // Empty the slot - and shift the records after it back, so no search is broken
+  bool evict(void);                   // Forget the oldest record which is no longer queued. Return false if every record is queued
+  bool insert(const Swarm_M138_Tx_Record_t *record); // Copy the record into the table - making room if needed
+};
+
+#endif // SPARKFUN_SWARM_M138_TX_LEDGER_H
@@ -24,38 +24,568 @@
  */
 
 #include "SparkFun_Swarm_Satellite_Arduino_Library.h"
+#include "SparkFun_Swarm_M138_Helpers.h"
+#include "SparkFun_Swarm_M138_Tx_Ledger.h"
+#include "SparkFun_Swarm_M138_Pass_Predictor.h" // getUnixTime uses dateTimeToUnix
+
+// Debug messages up to SWARM_M138_DEBUG_LEVEL are compiled in. Above it, the condition is a constant false
+// so the message - and its F() string - is optimised away completely
+#define SWARM_M138_DEBUG(level) ((SWARM_M138_DEBUG_LEVEL >= (level)) && (_printDebug == true))
+
+// Constant commands: complete with their checksums and line feeds, so there is nothing to format at run time.
+// The checksums are checked by the compiler (below). On AVR and ESP8266, the commands are stored in PROGMEM
+// and swarm_m138_const_command copies them onto the stack before they are sent
+#define SWARM_M138_CONST_COMMAND_SIZE 20 // The longest constant command ($RS deletedb*3e\n) plus the null, rounded up
+
+static constexpr char SWARM_M138_CMD_CONFIGURATION[] PROGMEM = "$CS*10\n";
+static constexpr char SWARM_M138_CMD_DATE_TIME_STAT_GET[] PROGMEM = "$DT @*70\n";
+static constexpr char SWARM_M138_CMD_DATE_TIME_STAT_GET_RATE[] PROGMEM = "$DT ?*0f\n";
+static constexpr char SWARM_M138_CMD_FIRMWARE_VER[] PROGMEM = "$FV*10\n";
+static constexpr char SWARM_M138_CMD_GPS_JAMMING_GET[] PROGMEM = "$GJ @*6d\n";
+static constexpr char SWARM_M138_CMD_GPS_JAMMING_GET_RATE[] PROGMEM = "$GJ ?*12\n";
+static constexpr char SWARM_M138_CMD_GEOSPATIAL_INFO_GET[] PROGMEM = "$GN @*69\n";
+static constexpr char SWARM_M138_CMD_GEOSPATIAL_INFO_GET_RATE[] PROGMEM = "$GN ?*16\n";
+static constexpr char SWARM_M138_CMD_GPIO1_CONTROL_GET_MODE[] PROGMEM = "$GP ?*08\n";
+static constexpr char SWARM_M138_CMD_GPIO1_CONTROL_GET_VOLTAGE[] PROGMEM = "$GP @*77\n";
+static constexpr char SWARM_M138_CMD_GPS_FIX_QUAL_GET[] PROGMEM = "$GS @*74\n";
+static constexpr char SWARM_M138_CMD_GPS_FIX_QUAL_GET_RATE[] PROGMEM = "$GS ?*0b\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_COUNT_ALL[] PROGMEM = "$MM C=**74\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_COUNT_UNREAD[] PROGMEM = "$MM C=U*0b\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_DELETE_ALL[] PROGMEM = "$MM D=**73\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_DELETE_READ[] PROGMEM = "$MM D=R*0b\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_MARK_ALL[] PROGMEM = "$MM M=**7a\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_GET[] PROGMEM = "$MM N=?*6c\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_ENABLE[] PROGMEM = "$MM N=E*16\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_DISABLE[] PROGMEM = "$MM N=D*17\n";
+static constexpr char SWARM_M138_CMD_MSG_RX_MGMT_READ_OLDEST[] PROGMEM = "$MM R=O*00\n";
+static constexpr char SWARM_M138_CMD_MSG_TX_MGMT_COUNT_UNSENT[] PROGMEM = "$MT C=U*12\n";
+static constexpr char SWARM_M138_CMD_MSG_TX_MGMT_DELETE_UNSENT[] PROGMEM = "$MT D=U*15\n";
+static constexpr char SWARM_M138_CMD_POWER_OFF[] PROGMEM = "$PO*1f\n";
+static constexpr char SWARM_M138_CMD_POWER_STAT_GET[] PROGMEM = "$PW @*67\n";
+static constexpr char SWARM_M138_CMD_POWER_STAT_GET_RATE[] PROGMEM = "$PW ?*18\n";
+static constexpr char SWARM_M138_CMD_RESTART[] PROGMEM = "$RS*01\n";
+static constexpr char SWARM_M138_CMD_RESTART_DELETEDB[] PROGMEM = "$RS deletedb*3e\n";
+static constexpr char SWARM_M138_CMD_RX_TEST_GET[] PROGMEM = "$RT @*66\n";
+static constexpr char SWARM_M138_CMD_RX_TEST_GET_RATE[] PROGMEM = "$RT ?*19\n";
+
+// Compile-time versions of addChecksumLF. The checksum covers everything between the $ and the checksum asterix.
+// The first asterix of a double asterix ($MM C=**) is part of the command
+constexpr const char *swarm_m138_const_asterix(const char *p)
+{
+  return (((*p == '*') && (*(p + 1) != '*')) ? p : swarm_m138_const_asterix(p + 1));
+}
+constexpr uint8_t swarm_m138_const_checksum(const char *p, const char *asterix, uint8_t checksum)
+{
+  return ((p == asterix) ? checksum : swarm_m138_const_checksum(p + 1, asterix, checksum ^ (uint8_t)*p));
+}
+constexpr char swarm_m138_const_hex(uint8_t nibble)
+{
+  return ((nibble < 10) ? (char)('0' + nibble) : (char)('a' + nibble - 10));
+}
+constexpr bool swarm_m138_const_checksum_ok(const char *asterix, uint8_t checksum)
+{
+  return ((*(asterix + 1) == swarm_m138_const_hex(checksum >> 4)) && (*(asterix + 2) == swarm_m138_const_hex(checksum & 0x0F))
+          && (*(asterix + 3) == '\n') && (*(asterix + 4) == 0));
+}
+#define SWARM_M138_CHECK_CONST_COMMAND(command) \
+  static_assert((sizeof(command) <= SWARM_M138_CONST_COMMAND_SIZE) && (*(command) == '$') && \
+                swarm_m138_const_checksum_ok(swarm_m138_const_asterix(command), \
+                                             swarm_m138_const_checksum((command) + 1, swarm_m138_const_asterix(command), 0)), \
+                #command " is too long or its checksum is wrong")
+
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_CONFIGURATION);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_DATE_TIME_STAT_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_DATE_TIME_STAT_GET_RATE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_FIRMWARE_VER);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPS_JAMMING_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPS_JAMMING_GET_RATE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GEOSPATIAL_INFO_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GEOSPATIAL_INFO_GET_RATE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPIO1_CONTROL_GET_MODE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPIO1_CONTROL_GET_VOLTAGE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPS_FIX_QUAL_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_GPS_FIX_QUAL_GET_RATE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_COUNT_ALL);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_COUNT_UNREAD);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_DELETE_ALL);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_DELETE_READ);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_MARK_ALL);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_ENABLE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_DISABLE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_RX_MGMT_READ_OLDEST);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_TX_MGMT_COUNT_UNSENT);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_MSG_TX_MGMT_DELETE_UNSENT);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_POWER_OFF);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_POWER_STAT_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_POWER_STAT_GET_RATE);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_RESTART);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_RESTART_DELETEDB);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_RX_TEST_GET);
+SWARM_M138_CHECK_CONST_COMMAND(SWARM_M138_CMD_RX_TEST_GET_RATE);
+
+// Return a constant command, ready to send. On AVR and ESP8266, it is copied from PROGMEM into buffer first
+// buffer must hold SWARM_M138_CONST_COMMAND_SIZE chars
+static const char *swarm_m138_const_command(const char *command, char *buffer)
+{
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_ESP8266) // ESP8266 PROGMEM is flash: it must be read in words
+  strcpy_P(buffer, command);
+  return (buffer);
+#else
+  (void)buffer;
+  return (command); // PROGMEM is ordinary memory on the other platforms
+#endif
+}
+
+// Sentence parsers: shared by the process...Event URC handlers and the get... methods.
+// Each walks the sentence once using integer arithmetic only - no sscanf, atol or pow.
+// The field helpers return a pointer to the first unparsed character, or NULL if the text did not match.
+// They pass a NULL straight through, so a sentence can be parsed as a chain with a single check at the end.
+// parse_literal, parse_fixed, parse_int and parse_count are in SparkFun_Swarm_M138_Helpers.h: the Fleet uses them too.
+
+// The ASCII Hex digits: upper case for message data; lower case for checksums (as used by addChecksumLF)
+static const char swarm_m138_hex_upper[] = "0123456789ABCDEF";
+static const char swarm_m138_hex_lower[] = "0123456789abcdef";
+
+// Parse exactly numDigits decimal digits
+static const char *swarm_m138_parse_digits(const char *p, uint8_t numDigits, uint32_t *value)
+{
+  if (p == NULL)
+    return (NULL);
+  uint32_t result = 0;
+  for (uint8_t i = 0; i < numDigits; i++)
+  {
+    if ((*p < '0') || (*p > '9'))
+      return (NULL);
+    result = (result * 10) + (*p - '0');
+    p++;
+  }
+  *value = result;
+  return (p);
+}
+
+// Parse a hexadecimal number (without the 0x)
+static const char *swarm_m138_parse_hex(const char *p, uint32_t *value)
+{
+  if ((p == NULL) || (swarm_m138_hex_value(*p) < 0))
+    return (NULL);
+  uint32_t result = 0;
+  while (swarm_m138_hex_value(*p) >= 0)
+  {
+    result = (result << 4) | (uint32_t)swarm_m138_hex_value(*p);
+    p++;
+  }
+  *value = result;
+  return (p);
+}
+
+// Parse an unsigned 64-bit decimal number. E.g. a message ID
+static const char *swarm_m138_parse_uint64(const char *p, uint64_t *value)
+{
+  if ((p == NULL) || (*p < '0') || (*p > '9'))
+    return (NULL);
+  uint64_t result = 0;
+  while ((*p >= '0') && (*p <= '9'))
+  {
+    result = (result * 10) + (uint64_t)(*p - '0');
+    p++;
+  }
+  *value = result;
+  return (p);
+}
+
+// Parse "$TD OK,msg_id*"
+static bool swarm_m138_parse_transmit_ok(const char *p, uint64_t *msg_id)
+{
+  uint64_t theID;
+
+  p = swarm_m138_parse_literal(p, "$TD OK,");
+  p = swarm_m138_parse_uint64(p, &theID);
+  p = swarm_m138_parse_literal(p, "*");
+  if (p == NULL)
+    return (false);
+
+  *msg_id = theID;
+  return (true);
+}
+
+// Parse "$MM AI=appID,asciiHex,msg_id,epoch*" and decode the ASCII Hex to binary in place:
+// the binary data overwrites the start of the ASCII Hex. *data points to it
+static bool swarm_m138_decode_rx_message(char *p, uint16_t *appID, const uint8_t **data, size_t *len, uint64_t *msg_id, uint32_t *epoch)
+{
+  int32_t theAppID;
+  uint64_t theID;
+  uint64_t theEpoch;
+
+  const char *hex = swarm_m138_parse_int(swarm_m138_parse_literal(p, "$MM AI="), &theAppID);
+  hex = swarm_m138_parse_literal(hex, ",");
+  if (hex == NULL)
+    return (false);
+
+  uint8_t *dest = (uint8_t *)p + (hex - p); // The binary data overwrites the ASCII Hex as we go
+  size_t bytes = 0;
+  while ((swarm_m138_hex_value(hex[0]) >= 0) && (swarm_m138_hex_value(hex[1]) >= 0))
+  {
+    uint8_t b = (uint8_t)((swarm_m138_hex_value(hex[0]) << 4) | swarm_m138_hex_value(hex[1]));
+    hex += 2;
+    dest[bytes++] = b;
+  }
+
+  const char *q = swarm_m138_parse_literal(hex, ",");
+  q = swarm_m138_parse_uint64(q, &theID);
+  q = swarm_m138_parse_literal(q, ",");
+  q = swarm_m138_parse_uint64(q, &theEpoch);
+  q = swarm_m138_parse_literal(q, "*");
+  if (q == NULL)
+    return (false);
+
+  *appID = (uint16_t)theAppID;
+  *data = dest;
+  *len = bytes;
+  *msg_id = theID;
+  *epoch = (uint32_t)theEpoch;
+  return (true);
+}
+
+// Number and text formatters for the commands: quicker than sprintf, with no format strings in RAM
+// and the same on every platform (no %d / %ld #ifdefs). Each writes a null and returns a pointer to it,
+// so a command can be built as a chain
+
+// Write an unsigned 32-bit number as decimal digits, plus a null
+// dest must have room for up to 10 digits plus the null
+static char *swarm_m138_print_uint32(char *dest, uint32_t value)
+{
+  char digits[10]; // Use the stack, not the heap
+  int i = 0;
+  do
+  {
+    digits[i++] = (value % 10) + '0'; // divide by 10, convert the remainder to char
+    value /= 10;
+  } while (value > 0);
+  while (i > 0)
+    *dest++ = digits[--i]; // reverse the order
+  *dest = 0;
+  return (dest);
+}
+
+// Write an unsigned 64-bit number as decimal digits, plus a null
+// dest must have room for up to 20 digits plus the null
+// 64-bit division is slow on 8-bit and 32-bit processors: split off nine digits at a time and use 32-bit division for those
+static char *swarm_m138_print_uint64(char *dest, uint64_t value)
+{
+  if ((value >> 32) == 0)
+    return (swarm_m138_print_uint32(dest, (uint32_t)value));
+
+  dest = swarm_m138_print_uint64(dest, value / 1000000000ULL); // The upper digits. At most two levels of recursion
+  uint32_t lower = (uint32_t)(value % 1000000000ULL);
+  for (int i = 8; i >= 0; i--) // The lower nine digits, including any leading zeros
+  {
+    dest[i] = (lower % 10) + '0';
+    lower /= 10;
+  }
+  dest += 9;
+  *dest = 0;
+  return (dest);
+}
+
+// Parse "$DT YYYYMMDDhhmmss,V*"
+static bool swarm_m138_parse_date_time(const char *p, Swarm_M138_DateTimeData_t *dateTime)
+{
+  uint32_t year, month, day, hour, minute, second;
+
+  p = swarm_m138_parse_literal(p, "$DT ");
+  p = swarm_m138_parse_digits(p, 4, &year);
+  p = swarm_m138_parse_digits(p, 2, &month);
+  p = swarm_m138_parse_digits(p, 2, &day);
+  p = swarm_m138_parse_digits(p, 2, &hour);
+  p = swarm_m138_parse_digits(p, 2, &minute);
+  p = swarm_m138_parse_digits(p, 2, &second);
+  p = swarm_m138_parse_literal(p, ",");
+  if ((p == NULL) || (*p == 0) || (swarm_m138_parse_literal(p + 1, "*") == NULL))
+    return (false);
+
+  dateTime->YYYY = (uint16_t)year;
+  dateTime->MM = (uint8_t)month;
+  dateTime->DD = (uint8_t)day;
+  dateTime->hh = (uint8_t)hour;
+  dateTime->mm = (uint8_t)minute;
+  dateTime->ss = (uint8_t)second;
+  dateTime->valid = *p == 'V' ? 1 : 0;
+  return (true);
+}
+
+// Parse "$GJ spoof_state,jamming_level*"
+static bool swarm_m138_parse_gps_jamming(const char *p, Swarm_M138_GPS_Jamming_Indication_t *jamming)
+{
+  int32_t spoof_state, jamming_level;
+
+  p = swarm_m138_parse_literal(p, "$GJ ");
+  p = swarm_m138_parse_int(p, &spoof_state);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &jamming_level);
+  p = swarm_m138_parse_literal(p, "*");
+  if (p == NULL)
+    return (false);
+
+  jamming->spoof_state = (uint8_t)spoof_state;
+  jamming->jamming_level = (uint8_t)jamming_level;
+  return (true);
+}
+
+// Parse "$GN lat,lon,alt,course,speed*"
+static bool swarm_m138_parse_geospatial(const char *p, Swarm_M138_GeospatialData_Fixed_t *info)
+{
+  int32_t lat, lon, alt, course, speed;
+
+  p = swarm_m138_parse_literal(p, "$GN ");
+  p = swarm_m138_parse_fixed(p, 6, &lat);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_fixed(p, 6, &lon);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &alt);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &course);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &speed);
+  p = swarm_m138_parse_literal(p, "*");
+  if (p == NULL)
+    return (false);
+
+  info->lat = lat;
+  info->lon = lon;
+  info->alt = alt;
+  info->course = course;
+  info->speed = speed;
+  return (true);
+}
+
+// Convert fixed-point geospatial data to float
+static void swarm_m138_geospatial_to_float(const Swarm_M138_GeospatialData_Fixed_t *fixed, Swarm_M138_GeospatialData_t *info)
+{
+  info->lat = (float)fixed->lat / 1000000.0;
+  info->lon = (float)fixed->lon / 1000000.0;
+  info->alt = (float)fixed->alt;
+  info->course = (float)fixed->course;
+  info->speed = (float)fixed->speed;
+}
+
+// Parse "$GS hdop,vdop,gnss_sats,unused,fix_type*"
+static bool swarm_m138_parse_gps_fix_quality(const char *p, Swarm_M138_GPS_Fix_Quality_t *fixQuality)
+{
+  // The two-character fix types, in Swarm_M138_GPS_Fix_Type_e order
+  static const char fixTypes[SWARM_M138_GPS_FIX_TYPE_INVALID][2] = {
+    {'N', 'F'}, {'D', 'R'}, {'G', '2'}, {'G', '3'}, {'D', '2'}, {'D', '3'}, {'R', 'K'}, {'T', 'T'}};
+  int32_t hdop, vdop, gnss_sats, unused;
+
+  p = swarm_m138_parse_literal(p, "$GS ");
+  p = swarm_m138_parse_int(p, &hdop);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &vdop);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &gnss_sats);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_int(p, &unused);
+  p = swarm_m138_parse_literal(p, ",");
+  if ((p == NULL) || (p[0] == 0) || (p[1] == 0))
+    return (false);
+
+  fixQuality->hdop = (uint16_t)hdop;
+  fixQuality->vdop = (uint16_t)vdop;
+  fixQuality->gnss_sats = (uint8_t)gnss_sats;
+  fixQuality->unused = (uint8_t)unused;
+
+  int fixType = 0;
+  while ((fixType < SWARM_M138_GPS_FIX_TYPE_INVALID) && ((fixTypes[fixType][0] != p[0]) || (fixTypes[fixType][1] != p[1])))
+    fixType++;
+  fixQuality->fix_type = (Swarm_M138_GPS_Fix_Type_e)fixType;
+  return (true);
+}
+
+// Parse "$PW cpu_volts,unused1,unused2,unused3,temp*" into thousandths
+static bool swarm_m138_parse_power_status(const char *p, Swarm_M138_Power_Status_Fixed_t *powerStatus)
+{
+  int32_t cpu_volts, unused1, unused2, unused3, temp;
+
+  p = swarm_m138_parse_literal(p, "$PW ");
+  p = swarm_m138_parse_fixed(p, 3, &cpu_volts);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_fixed(p, 3, &unused1);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_fixed(p, 3, &unused2);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_fixed(p, 3, &unused3);
+  p = swarm_m138_parse_literal(p, ",");
+  p = swarm_m138_parse_fixed(p, 3, &temp);
+  p = swarm_m138_parse_literal(p, "*");
+  if (p == NULL)
+    return (false);
+
+  powerStatus->cpu_millivolts = cpu_volts;
+  powerStatus->unused1 = unused1;
+  powerStatus->unused2 = unused2;
+  powerStatus->unused3 = unused3;
+  powerStatus->temp_millidegrees = temp;
+  return (true);
+}
+
+// Convert fixed-point power status to float
+static void swarm_m138_power_status_to_float(const Swarm_M138_Power_Status_Fixed_t *fixed, Swarm_M138_Power_Status_t *powerStatus)
+{
+  powerStatus->cpu_volts = (float)fixed->cpu_millivolts / 1000.0;
+  powerStatus->unused1 = (float)fixed->unused1 / 1000.0;
+  powerStatus->unused2 = (float)fixed->unused2 / 1000.0;
+  powerStatus->unused3 = (float)fixed->unused3 / 1000.0;
+  powerStatus->temp = (float)fixed->temp_millidegrees / 1000.0;
+}
+
+// Parse "$RT RSSI=rssi_background*" or "$RT RSSI=rssi_sat,SNR=snr,FDEV=fdev,TS=YYYY-MM-DDThh:mm:ss,DI=0xsat_id*"
+static bool swarm_m138_parse_receive_test(const char *p, Swarm_M138_Receive_Test_t *rxTest)
+{
+  int32_t rssi, snr, fdev, YYYY, MM, DD, hh, mm, ss;
+  uint32_t sat_ID;
+
+  p = swarm_m138_parse_literal(p, "$RT RSSI=");
+  p = swarm_m138_parse_int(p, &rssi);
+  if (p == NULL)
+    return (false);
+
+  if (*p == '*') // Background RSSI only
+  {
+    memset(rxTest, 0, sizeof(Swarm_M138_Receive_Test_t));
+    rxTest->background = true;
+    rxTest->rssi_background = (int16_t)rssi;
+    return (true);
+  }
+
+  p = swarm_m138_parse_literal(p, ",SNR=");
+  p = swarm_m138_parse_int(p, &snr);
+  p = swarm_m138_parse_literal(p, ",FDEV=");
+  p = swarm_m138_parse_int(p, &fdev);
+  p = swarm_m138_parse_literal(p, ",TS=");
+  p = swarm_m138_parse_int(p, &YYYY);
+  p = swarm_m138_parse_literal(p, "-");
+  p = swarm_m138_parse_int(p, &MM);
+  p = swarm_m138_parse_literal(p, "-");
+  p = swarm_m138_parse_int(p, &DD);
+  p = swarm_m138_parse_literal(p, "T");
+  p = swarm_m138_parse_int(p, &hh);
+  p = swarm_m138_parse_literal(p, ":");
+  p = swarm_m138_parse_int(p, &mm);
+  p = swarm_m138_parse_literal(p, ":");
+  p = swarm_m138_parse_int(p, &ss);
+  p = swarm_m138_parse_literal(p, ",DI=0x");
+  p = swarm_m138_parse_hex(p, &sat_ID);
+  p = swarm_m138_parse_literal(p, "*");
+  if (p == NULL)
+    return (false);
+
+  rxTest->background = false;
+  rxTest->rssi_background = 0;
+  rxTest->rssi_sat = (int16_t)rssi;
+  rxTest->snr = (int16_t)snr;
+  rxTest->fdev = (int16_t)fdev;
+  rxTest->time.YYYY = (uint16_t)YYYY;
+  rxTest->time.MM = (uint8_t)MM;
+  rxTest->time.DD = (uint8_t)DD;
+  rxTest->time.hh = (uint8_t)hh;
+  rxTest->time.mm = (uint8_t)mm;
+  rxTest->time.ss = (uint8_t)ss;
+  rxTest->time.valid = true;
+  rxTest->sat_id = sat_ID;
+  return (true);
+}
 
 SWARM_M138::SWARM_M138(void)
 {
-#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  _softSerial = NULL;
-#endif
-  _hardSerial = NULL;
+  _transport = NULL;
   _baud = SWARM_M138_SERIAL_BAUD_RATE;
-  _i2cPort = NULL;
-  _address = SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS;
+  _rxWindowMillis = SWARM_M138_RX_WINDOW_MILLIS;
   _debugPort = NULL;
   _printDebug = false;
   _checkUnsolicitedMsgReentrant = false;
-  _lastI2cCheck = millis();
   _swarmBacklog = NULL;
+  backlogClear();
+  _backlogBytesDropped = 0;
+  _backlogPrune = false;
+  _telemetryValid = 0;
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  resetStats();
+#endif
+  _expectedResponseStart = NULL;
+  _expectedErrorStart = NULL;
+  _responseDest = NULL;
+  _responseDestSize = 0;
+  _responseFound = false;
+  _responseIsError = false;
+  _asyncPending = false;
+  _asyncComplete = NULL;
+  _asyncContext = NULL;
+  _asyncCommandCallback = NULL;
+  _asyncDateTimeCallback = NULL;
+  _asyncMsgIdCallback = NULL;
+  _asyncStatusCallback = NULL;
+  _asyncTxHasAppID = false;
+  _asyncTxAppID = 0;
+  _commandQueueHead = 0;
+  _commandQueueCount = 0;
+  _commandQueueSending = false;
+  _commandQueueError = SWARM_M138_ERROR_SUCCESS;
   commandError = NULL;
+#ifdef SWARM_M138_STATIC_BUFFERS
+  _commandArenaInUse = false;
+  _responseArenaInUse = false;
+  _scratchInUse = 0;
+  _commandQueue = _commandQueueArena;
+#else
+  _commandQueue = NULL; // Allocated on first use by queueCommand
+#endif
 
   _swarmDateTimeCallback = NULL;
   _swarmGpsJammingCallback = NULL;
   _swarmGeospatialCallback = NULL;
+  _swarmGeospatialFixedCallback = NULL;
   _swarmGpsFixQualityCallback = NULL;
   _swarmPowerStatusCallback = NULL;
+  _swarmPowerStatusFixedCallback = NULL;
   _swarmReceiveMessageCallback = NULL;
   _swarmReceiveTestCallback = NULL;
   _swarmSleepWakeCallback = NULL;
   _swarmModemStatusCallback = NULL;
   _swarmTransmitDataCallback = NULL;
+  _swarmDateTimeContextCallback = NULL;
+  _swarmDateTimeContext = NULL;
+  _swarmGpsJammingContextCallback = NULL;
+  _swarmGpsJammingContext = NULL;
+  _swarmGeospatialContextCallback = NULL;
+  _swarmGeospatialContext = NULL;
+  _swarmGeospatialFixedContextCallback = NULL;
+  _swarmGeospatialFixedContext = NULL;
+  _swarmGpsFixQualityContextCallback = NULL;
+  _swarmGpsFixQualityContext = NULL;
+  _swarmPowerStatusContextCallback = NULL;
+  _swarmPowerStatusContext = NULL;
+  _swarmPowerStatusFixedContextCallback = NULL;
+  _swarmPowerStatusFixedContext = NULL;
+  _swarmReceiveMessageContextCallback = NULL;
+  _swarmReceiveMessageContext = NULL;
+  _swarmReceiveTestContextCallback = NULL;
+  _swarmReceiveTestContext = NULL;
+  _swarmSleepWakeContextCallback = NULL;
+  _swarmSleepWakeContext = NULL;
+  _swarmModemStatusContextCallback = NULL;
+  _swarmModemStatusContext = NULL;
+  _swarmTransmitDataContextCallback = NULL;
+  _swarmTransmitDataContext = NULL;
+  _transmitSentCount = 0;
+  _sleepWakeCount = 0;
+  _eventCounting = false;
+  _txLedger = NULL;
 
 }
 
 SWARM_M138::~SWARM_M138(void)
 {
+#ifndef SWARM_M138_STATIC_BUFFERS // In zero-heap mode, the buffers are owned by the class. There is nothing to delete
   if (_swarmBacklog != NULL)
   {
     delete[] _swarmBacklog;
@@ -67,6 +597,13 @@ SWARM_M138::~SWARM_M138(void)
     delete[] commandError;
     commandError = NULL;
   }
+
+  if (_commandQueue != NULL)
+  {
+    delete[] _commandQueue;
+    _commandQueue = NULL;
+  }
+#endif
 }
 
 #ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
@@ -83,7 +620,8 @@ bool SWARM_M138::begin(SoftwareSerial &softSerial)
   if (!initializeBuffers())
     return false;
     
-  _softSerial = &softSerial;
+  _softSerialTransport.setPort(&softSerial);
+  attachTransport(&_softSerialTransport);
 
   // There's no 'easy' way to tell if the serial port has already been begun for us.
   // We have to assume it has not been begun and so do it here.
@@ -108,7 +646,8 @@ bool SWARM_M138::begin(HardwareSerial &hardSerial)
   if (!initializeBuffers())
     return false;
     
-  _hardSerial = &hardSerial;
+  _hardSerialTransport.setPort(&hardSerial);
+  attachTransport(&_hardSerialTransport);
 
   // There's no 'easy' way to tell if the serial port has already been begun for us.
   // We have to assume it has not been begun and so do it here.
@@ -136,8 +675,28 @@ bool SWARM_M138::begin(byte deviceAddress, TwoWire &wirePort)
   if (!initializeBuffers())
     return false;
 
-  _i2cPort = &wirePort;
-  _address = deviceAddress;
+  _qwiicTransport.setPort(&wirePort, deviceAddress);
+  attachTransport(&_qwiicTransport);
+
+  return (isConnected());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Begin communication with the Swarm M138 modem
+    @param  transport
+            The transport to be used to communicate with the modem. E.g. a SWARM_M138_Ring_Transport.
+            transport.begin is called with the default baud rate.
+    @return True if communication with the modem was successful, otherwise false
+*/
+/**************************************************************************/
+bool SWARM_M138::begin(SWARM_M138_Transport &transport)
+{
+  if (!initializeBuffers())
+    return false;
+
+  attachTransport(&transport);
+  beginSerial(_baud);
 
   return (isConnected());
 }
@@ -159,21 +718,28 @@ bool SWARM_M138::isConnected(void)
 // Private: allocate memory for the serial buffers and clear it
 bool SWARM_M138::initializeBuffers()
 {
+#ifdef SWARM_M138_STATIC_BUFFERS
+  // Zero-heap mode: point at the buffers owned by the class
+  _swarmBacklog = _swarmBacklogArena;
+  commandError = _commandErrorArena;
+#endif
+
   if (_swarmBacklog == NULL)
-    _swarmBacklog = new char[_RxBuffSize];
+    _swarmBacklog = new char[SWARM_M138_BACKLOG_SIZE];
   if (_swarmBacklog == NULL)
   {
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
       _debugPort->println(F("begin: not enough memory for _swarmBacklog!"));
     return false;
   }
-  memset(_swarmBacklog, 0, _RxBuffSize);
+  memset(_swarmBacklog, 0, SWARM_M138_BACKLOG_SIZE);
+  backlogClear();
 
   if (commandError == NULL)
     commandError = new char[SWARM_M138_MAX_CMD_ERROR_LEN];
   if (commandError == NULL)
   {
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
       _debugPort->println(F("begin: not enough memory for commandError!"));
     swarm_m138_free_char(_swarmBacklog);
     return false;
@@ -196,6 +762,8 @@ void SWARM_M138::enableDebugging(Stream &debugPort)
 {
   _debugPort = &debugPort;
   _printDebug = true;
+  if (_transport != NULL)
+    _transport->setDebugPort(_debugPort);
 }
 
 /**************************************************************************/
@@ -206,6 +774,74 @@ void SWARM_M138::enableDebugging(Stream &debugPort)
 void SWARM_M138::disableDebugging(void)
 {
   _printDebug = false;
+  if (_transport != NULL)
+    _transport->setDebugPort(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enable or disable Qwiic burst mode.
+            In burst mode, serial data is read from the Qwiic Swarm in chunks of QWIIC_SWARM_BURST_PACKET_SIZE bytes:
+            the largest the host Wire buffer and the ATtiny841 I2C buffer can both handle - instead of 8 bytes.
+            The length register is polled adaptively: the polling interval doubles (up to QWIIC_SWARM_I2C_POLLING_WAIT_MAX_MS)
+            each time no data is waiting, and returns to QWIIC_SWARM_I2C_POLLING_WAIT_MS when data arrives or a command is sent.
+            Burst mode is disabled by default. It has no effect on Serial.
+    @param  enable
+            If true (default): enable burst mode
+            If false: disable burst mode
+*/
+/**************************************************************************/
+void SWARM_M138::setQwiicBurstMode(bool enable)
+{
+  _qwiicTransport.setBurstMode(enable);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the idle window: how long checkUnsolicitedMsg and sendCommand will wait for the rest
+            of a part-received sentence. They return immediately when only complete sentences have arrived.
+            On ESP32, Serial.available only updates every ~120 bytes, so the window needs to be slightly
+            longer than 120 * 10 / 115200 seconds. The default is SWARM_M138_RX_WINDOW_MILLIS (12ms).
+    @param  window
+            The idle window in milliseconds
+*/
+/**************************************************************************/
+void SWARM_M138::setRxWindowMillis(unsigned long window)
+{
+  _rxWindowMillis = window;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the idle window
+    @return The idle window in milliseconds
+*/
+/**************************************************************************/
+unsigned long SWARM_M138::getRxWindowMillis(void)
+{
+  return (_rxWindowMillis);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the transport - e.g. to find which I2C bus the modem is on
+    @return A pointer to the transport. NULL if begin has not been called
+*/
+/**************************************************************************/
+SWARM_M138_Transport *SWARM_M138::getTransport(void)
+{
+  return (_transport);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forget the cached $DT, $GJ, $GN, $GS, $PW and $RT messages.
+            The next get with a maxAge will query the modem
+*/
+/**************************************************************************/
+void SWARM_M138::clearTelemetryCache(void)
+{
+  _telemetryValid = 0;
 }
 
 /**************************************************************************/
@@ -222,741 +858,1270 @@ bool SWARM_M138::checkUnsolicitedMsg(void)
 
   _checkUnsolicitedMsgReentrant = true;
 
-  size_t avail = 0; // The number of available serial bytes
   bool handled = false; // Flag if any unsolicited messages were handled
   unsigned long timeIn = millis(); // Record the time so we can timeout
-  char *event; // Each unsolicited messages is an 'event'
+  bool printedEvents = false;
 
-  char *_swarmRxBuffer = swarm_m138_alloc_char(_RxBuffSize);
-  if (_swarmRxBuffer == NULL)
+#ifdef SWARM_M138_STATIC_BUFFERS
+  char *event = _swarmRxArena; // Zero-heap mode: use the buffer owned by the class
+#else
+  char *event = swarm_m138_alloc_char(SWARM_M138_EVENT_SIZE); // Each unsolicited message is an 'event'
+  if (event == NULL)
   {
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
       _debugPort->println(F("checkUnsolicitedMsg: not enough memory for _swarmRxBuffer!"));
+    _checkUnsolicitedMsgReentrant = false;
     return false;
   }
-  memset(_swarmRxBuffer, 0, _RxBuffSize); // Clear _swarmRxBuffer
+#endif
 
-  // Does the backlog contain any data? If it does, copy it into _swarmRxBuffer and then clear the backlog
-  // All of the serial data from the modem is 'printable'. It should never contain a \0. So it is OK to use strlen.
-  size_t backlogLength = strlen((const char *)_swarmBacklog);
-  if (backlogLength > 0)
+  if (_backlogLines > 0)
   {
     //The backlog also logs reads from other tasks like transmitting.
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
     {
       _debugPort->print(F("checkUnsolicitedMsg: backlog found! backlog length is "));
-      _debugPort->println(backlogLength);
+      _debugPort->println(_backlogUsed);
     }
-    memcpy(_swarmRxBuffer + avail, _swarmBacklog, backlogLength); // avail is zero
-    avail += backlogLength;
-    memset(_swarmBacklog, 0, _RxBuffSize); // Clear the backlog making sure it is NULL-terminated
   }
 
   int hwAvail = hwAvailable();
-  if ((hwAvail > 0) || (backlogLength > 0)) // If either new data is available, or backlog had data.
+  if ((hwAvail > 0) || (_backlogLines > 0)) // If either new data is available, or backlog had data.
   {
-    // Wait for up to _rxWindowMillis for new serial data to arrive. 
-    while (((millis() - timeIn) < _rxWindowMillis) && ((avail + hwAvail) < _RxBuffSize))
+    // Process each complete event as soon as it is in the backlog, so a burst of events can't overflow it.
+    // Return as soon as the backlog holds only complete sentences. Wait for up to _rxWindowMillis
+    // only while a sentence is part-received: the rest of it is on its way. A partial line stays in the backlog
+    unsigned long window = rxWindow();
+    do
     {
       if (hwAvail > 0) //hwAvailable can return -1 if the serial port is NULL
       {
-        avail += hwReadChars((char *)&_swarmRxBuffer[avail], hwAvail);
+        backlogFill();
         timeIn = millis();
       }
-      else
-        delay(1);
+
+      if (processBacklogEvents(event, &printedEvents))
+        handled = true; // handled will be true if any event has ever been handled
+
       hwAvail = hwAvailable();
-    }
+      if ((hwAvail <= 0) && (_backlogLines == 0) && backlogMidSentence() && ((millis() - timeIn) < window))
+        swarmDelay(1);
+    } while ((hwAvail > 0) || (_backlogLines > 0) || (backlogMidSentence() && ((millis() - timeIn) < window)));
 
-    // _swarmRxBuffer now contains the backlog (if any) and the new serial data (if any)
+    if ((printedEvents == true) && SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+      _debugPort->println(F("checkUnsolicitedMsg: <=== end of event(s)!"));
+  }
 
-    // A health warning about strtok:
-    //
-    // strtok will convert any delimiters it finds ("\n" in our case) into NULL characters.
-    //
-    // Also, be very careful that you do not use strtok within an strtok while loop.
-    // The next call of strtok(NULL, ...) in the outer loop will use the pointer saved from the inner loop!
-    // In our case, strtok is also used in pruneBacklog, which is called by waitForResponse or sendCommandWithResponse,
-    // which is called by the parse functions called by processUnsolicitedEvent...
-    // The solution is to use strtok_r - the reentrant version of strtok
-    //
-    // Also, if the string does not contain any delimiters, strtok will still return a pointer to the start of the string.
-    // The entire string is considered the first token.
+  if (pollAsyncCommand()) // Complete the asynchronous command - if its response has arrived
+    handled = true;
 
-    char *preservedEvent;
-    event = strtok_r(_swarmRxBuffer, "\n", &preservedEvent); // Look for an 'event' (_swarmRxBuffer contains something ending in \n)
+#ifndef SWARM_M138_STATIC_BUFFERS
+  swarm_m138_free_char(event);
+#endif
 
-    if (event != NULL)
-      if (_printDebug == true)
-        _debugPort->println(F("checkUnsolicitedMsg: event(s) found! ===>"));
+  _checkUnsolicitedMsgReentrant = false;
 
-    while (event != NULL) // Keep going until all events have been processed
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("checkUnsolicitedMsg: start of event: "));
-        _debugPort->println(event);
-      }
+  return handled;
+} // /checkUnsolicitedMsg
 
-      if (checkChecksum(event) == SWARM_M138_ERROR_SUCCESS) // Check the checksum
-      {
-        //Process the event
-        bool latestHandled = processUnsolicitedEvent((const char *)event);
-        if (latestHandled)
-          handled = true; // handled will be true if latestHandled has ever been true
-      }
-      else
-      {
-        if (_printDebug == true)
-          _debugPort->println(F("checkUnsolicitedMsg: event is invalid!"));
-      }
+/**************************************************************************/
+/*!
+    @brief  Get the number of bytes which have been dropped because they did not fit in the backlog
+    @return The number of bytes dropped since begin() was called
+*/
+/**************************************************************************/
+uint32_t SWARM_M138::getBacklogBytesDropped(void)
+{
+  return (_backlogBytesDropped);
+}
 
-      backlogLength = strlen((const char *)_swarmBacklog);
-      if ((backlogLength > 0) && ((avail + backlogLength) < _RxBuffSize)) // Has any new data been added to the backlog?
-      {
-        if (_printDebug == true)
-        {
-          _debugPort->println(F("checkUnsolicitedMsg: new backlog added!"));
-        }
-        memcpy(_swarmRxBuffer + avail, _swarmBacklog, backlogLength);
-        avail += backlogLength;
-        memset(_swarmBacklog, 0, _RxBuffSize); //Clear out the backlog buffer again.
-      }
+#ifdef SWARM_M138_ENABLE_STATISTICS
+/**************************************************************************/
+/*!
+    @brief  Get the statistics: per-command round-trip times and results, plus the backlog and delay() activity.
+            Only available if SWARM_M138_ENABLE_STATISTICS is defined
+    @param  stats
+            A pointer to a Swarm_M138_Stats_t struct which will hold the statistics
+*/
+/**************************************************************************/
+void SWARM_M138::getStats(Swarm_M138_Stats_t *stats)
+{
+  memcpy(stats, &_stats, sizeof(Swarm_M138_Stats_t));
+  stats->backlogBytesDropped = _backlogBytesDropped - _statsBytesDroppedBase;
+}
 
-      //Walk through any remaining events
-      event = strtok_r(NULL, "\n", &preservedEvent);
+/**************************************************************************/
+/*!
+    @brief  Clear the statistics. Only available if SWARM_M138_ENABLE_STATISTICS is defined
+*/
+/**************************************************************************/
+void SWARM_M138::resetStats(void)
+{
+  memset(&_stats, 0, sizeof(Swarm_M138_Stats_t));
+  _statsBytesDroppedBase = _backlogBytesDropped;
+}
 
-      if (_printDebug == true)
-        _debugPort->println(F("checkUnsolicitedMsg: end of event")); //Just to denote end of processing event.
+// Record a completed command: its result and round-trip time
+void SWARM_M138::statsRecordCommand(Swarm_M138_Sentence_Tag_e tag, Swarm_M138_Error_e err, unsigned long elapsed)
+{
+  Swarm_M138_Command_Stats_t *cmd = &_stats.commands[tag];
 
-      if (event == NULL)
-        if (_printDebug == true)
-          _debugPort->println(F("checkUnsolicitedMsg: <=== end of event(s)!"));
-    }
+  cmd->count++;
+  if (err == SWARM_M138_ERROR_TIMEOUT)
+  {
+    cmd->timeouts++;
+    return;
   }
 
-  swarm_m138_free_char(_swarmRxBuffer);
-  delete event;
-
-  _checkUnsolicitedMsgReentrant = false;
+  if ((err == SWARM_M138_ERROR_INVALID_CHECKSUM) || (err == SWARM_M138_ERROR_INVALID_FORMAT))
+    cmd->checksumErrors++;
+  else if (err == SWARM_M138_ERROR_ERR)
+    cmd->errors++;
 
-  return handled;
-} // /checkUnsolicitedMsg
+  if ((cmd->count == (cmd->timeouts + 1)) || (elapsed < cmd->minMillis)) // First response?
+    cmd->minMillis = elapsed;
+  if (elapsed > cmd->maxMillis)
+    cmd->maxMillis = elapsed;
+  cmd->totalMillis += elapsed;
+}
+#endif
 
-// Parse incoming unsolicited messages - pass the data to the user via the callbacks (if defined)
-bool SWARM_M138::processUnsolicitedEvent(const char *event)
+// delay - and count the time spent blocked in the statistics
+void SWARM_M138::swarmDelay(unsigned long ms)
 {
-  { // $DT - Date/Time
-    Swarm_M138_DateTimeData_t *dateTime = new Swarm_M138_DateTimeData_t;
-    if (dateTime != NULL) // Check memory allocation was successful
-    {
-      char *eventStart;
-      char *eventEnd;
+  delay(ms);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  _stats.delayMillis += ms;
+#endif
+}
 
-      eventStart = strstr(event, "$DT ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 20)) // Check we have enough data
-          {
-            // Extract the Date, Time and flag
-            int year, month, day, hour, minute, second;
-            char valid;
+/**************************************************************************/
+/*!
+    @brief  Send a command asynchronously: return as soon as the command has been sent.
+            poll() (or checkUnsolicitedMsg) calls the callback when the response or error arrives, or the command times out.
+            Only one asynchronous command can be in progress at a time.
+    @param  command
+            The command - without the asterix and checksum. E.g. "$RT @". The asterix, checksum and line feed are added.
+    @param  expectedResponseStart
+            The start of the expected response. E.g. "$RT ". Must remain valid until the command completes.
+    @param  expectedErrorStart
+            The start of the expected error. E.g. "$RT ERR". Must remain valid until the command completes.
+    @param  callback
+            The function to be called when the command completes. response is the full response - or error - sentence.
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  responseDest
+            Optional storage for the response. If NULL, a small internal buffer (SWARM_M138_ASYNC_RESPONSE_SIZE) is used.
+            Must remain valid until the command completes.
+    @param  destSize
+            The size of responseDest
+    @param  timeout
+            The command timeout in milliseconds
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if a command is already in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::sendCommandAsync(const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
+                                                void (*callback)(Swarm_M138_Error_e err, const char *response, void *context), void *context,
+                                                char *responseDest, size_t destSize, unsigned long timeout)
+{
+  char *asyncCommand;
+  Swarm_M138_Error_e err;
 
-            int ret = sscanf(eventStart, "$DT %4d%2d%2d%2d%2d%2d,%c*", &year, &month, &day, &hour, &minute, &second, &valid);
+  if (_asyncPending == true)
+    return (SWARM_M138_ERROR_BUSY);
 
-            if (ret == 7)
-            {
-              dateTime->YYYY = (uint16_t)year;
-              dateTime->MM = (uint8_t)month;
-              dateTime->DD = (uint8_t)day;
-              dateTime->hh = (uint8_t)hour;
-              dateTime->mm = (uint8_t)minute;
-              dateTime->ss = (uint8_t)second;
-              dateTime->valid = valid == 'V' ? 1 : 0;
-
-              if (_swarmDateTimeCallback != NULL)
-              {
-                _swarmDateTimeCallback((const Swarm_M138_DateTimeData_t *)dateTime); // Call the callback
-              }
+  // Allocate memory for the command, asterix, checksum bytes, \n and \0
+  asyncCommand = swarm_m138_alloc_command(strlen(command) + 5);
+  if (asyncCommand == NULL)
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(asyncCommand, 0, strlen(command) + 5); // Clear it
+  char *p = swarm_m138_print_text(asyncCommand, command); // Copy the command
+  *p = '*'; // Append the asterix
+  addChecksumLF(asyncCommand); // Add the checksum bytes and line feed
 
-              delete dateTime;
-              return (true);
-            }
-          }
-        }
-      }
-      delete dateTime;
-    }
+  err = startAsyncCommand(asyncCommand, expectedResponseStart, expectedErrorStart, responseDest, destSize, timeout,
+                          &SWARM_M138::completeAsyncCommand);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    _asyncCommandCallback = callback;
+    _asyncContext = context;
   }
-  { // $GJ - jamming indication
-    Swarm_M138_GPS_Jamming_Indication_t *jamming = new Swarm_M138_GPS_Jamming_Indication_t;
-    if (jamming != NULL) // Check memory allocation was successful
-    {
-      char *eventStart;
-      char *eventEnd;
 
-      eventStart = strstr(event, "$GJ ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 3)) // Check we have enough data
-          {
-            // Extract the spoof_state and jamming_level
-            int spoof_state, jamming_level;
+  swarm_m138_free_command(asyncCommand);
+  return (err);
+}
 
-            int ret = sscanf(eventStart, "$GJ %d,%d*", &spoof_state, &jamming_level);
+/**************************************************************************/
+/*!
+    @brief  Get the most recent $DT message asynchronously
+    @param  callback
+            The function to be called when the command completes. dateTime is only valid if err is SWARM_M138_ERROR_SUCCESS
+    @param  context
+            Passed to the callback. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if a command is already in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getDateTimeAsync(void (*callback)(Swarm_M138_Error_e err, const Swarm_M138_DateTimeData_t *dateTime, void *context),
+                                                void *context)
+{
+  Swarm_M138_Error_e err;
 
-            if (ret == 2)
-            {
-              jamming->spoof_state = (uint8_t)spoof_state;
-              jamming->jamming_level = (uint8_t)jamming_level;
+  if (_asyncPending == true)
+    return (SWARM_M138_ERROR_BUSY);
 
-              if (_swarmGpsJammingCallback != NULL)
-              {
-                _swarmGpsJammingCallback((const Swarm_M138_GPS_Jamming_Indication_t *)jamming); // Call the callback
-              }
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_DATE_TIME_STAT_GET, buffer);
 
-              delete jamming;
-              return (true);
-            }
-          }
-        }
-      }
-      delete jamming;
-    }
+  err = startAsyncCommand(command, "$DT ", "$DT ERR", NULL, 0, SWARM_M138_STANDARD_RESPONSE_TIMEOUT,
+                          &SWARM_M138::completeAsyncDateTime);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    _asyncDateTimeCallback = callback;
+    _asyncContext = context;
   }
-  { // $GN - geospatial information
-    Swarm_M138_GeospatialData_t *info = new Swarm_M138_GeospatialData_t;
-    if (info != NULL) // Check memory allocation was successful
-    {
-      char *eventStart;
-      char *eventEnd;
 
-      eventStart = strstr(event, "$GN ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 10)) // Check we have enough data
-          {
-            // Extract the geospatial info
-            int latH, lonH, alt, course, speed;
-            char latL[8], lonL[8];
+  return (err);
+}
 
-            int ret = sscanf(eventStart, "$GN %d.%[^,],%d.%[^,],%d,%d,%d*",
-                             &latH, latL, &lonH, lonL, &alt, &course, &speed);
+/**************************************************************************/
+/*!
+    @brief  Delete the RX message with the specified ID asynchronously
+    @param  msg_id
+            The ID of the message to be deleted
+    @param  callback
+            The function to be called when the command completes
+    @param  context
+            Passed to the callback. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if a command is already in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::deleteRxMessageAsync(uint64_t msg_id, void (*callback)(Swarm_M138_Error_e err, void *context), void *context)
+{
+  char *command;
+  Swarm_M138_Error_e err;
 
-            if (ret == 7)
-            {
-              if (latH >= 0)
-                info->lat = (float)latH + ((float)atol(latL) / pow(10, strlen(latL)));
-              else
-                info->lat = (float)latH - ((float)atol(latL) / pow(10, strlen(latL)));
-              if (lonH >= 0)
-                info->lon = (float)lonH + ((float)atol(lonL) / pow(10, strlen(lonL)));
-              else
-                info->lon = (float)lonH - ((float)atol(lonL) / pow(10, strlen(lonL)));
-              info->alt = (float)alt;
-              info->course = (float)course;
-              info->speed = (float)speed;
-
-              if (_swarmGeospatialCallback != NULL)
-              {
-                _swarmGeospatialCallback((const Swarm_M138_GeospatialData_t *)info); // Call the callback
-              }
+  if (_asyncPending == true)
+    return (SWARM_M138_ERROR_BUSY);
 
-              delete info;
-              return (true);
-            }
-          }
-        }
-      }
-      delete info;
-    }
+  // Allocate memory for the command, D=, the 64-bit ID, asterix, checksum bytes, \n and \0
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
+  if (command == NULL)
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5); // Clear it
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, " D=");
+  p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+  *p = '*'; // Append the asterix
+  addChecksumLF(command); // Add the checksum bytes and line feed
+
+  err = startAsyncCommand(command, "$MM DELETED", "$MM ERR", NULL, 0, SWARM_M138_MESSAGE_DELETE_TIMEOUT,
+                          &SWARM_M138::completeAsyncStatus);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    _asyncStatusCallback = callback;
+    _asyncContext = context;
   }
-  { // $GS - GPS fix quality
-    Swarm_M138_GPS_Fix_Quality_t *fixQuality = new Swarm_M138_GPS_Fix_Quality_t;
-    if (fixQuality != NULL) // Check memory allocation was successful
-    {
-      char *eventStart;
-      char *eventEnd;
 
-      eventStart = strstr(event, "$GS ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 11)) // Check we have enough data
-          {
-            // Extract the GPS fix quality
-            int hdop, vdop, gnss_sats, unused;
-            char fix_type[3];
+  swarm_m138_free_command(command);
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Queue a binary message for transmission asynchronously
+    @param  data
+            A pointer to the binary data, which is copied into the command before this method returns
+    @param  len
+            The length of the data
+    @param  callback
+            The function to be called when the command completes. msg_id is only valid if err is SWARM_M138_ERROR_SUCCESS
+    @param  context
+            Passed to the callback. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if a command is already in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::transmitBinaryAsync(const uint8_t *data, size_t len,
+                                                   void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context), void *context)
+{
+  return (transmitBinaryAsync(data, len, false, 0, callback, context));
+}
 
-            int ret = sscanf(eventStart, "$GS %d,%d,%d,%d,%c%c*", &hdop, &vdop, &gnss_sats, &unused, &fix_type[0], &fix_type[1]);
+/**************************************************************************/
+/*!
+    @brief  Queue a binary message for transmission asynchronously
+    @param  data
+            A pointer to the binary data, which is copied into the command before this method returns
+    @param  len
+            The length of the data
+    @param  appID
+            The application ID
+    @param  callback
+            The function to be called when the command completes. msg_id is only valid if err is SWARM_M138_ERROR_SUCCESS
+    @param  context
+            Passed to the callback. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the command was sent
+            SWARM_M138_ERROR_BUSY if a command is already in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::transmitBinaryAsync(const uint8_t *data, size_t len, uint16_t appID,
+                                                   void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context), void *context)
+{
+  return (transmitBinaryAsync(data, len, true, appID, callback, context));
+}
 
-            if (ret == 6)
-            {
-              fixQuality->hdop = (uint16_t)hdop;
-              fixQuality->vdop = (uint16_t)vdop;
-              fixQuality->gnss_sats = (uint8_t)gnss_sats;
-              fixQuality->unused = (uint8_t)unused;
-
-              fix_type[2] = 0; // Null-terminate the fix type
-              if (strstr(fix_type, "NF") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_NF;
-              else if (strstr(fix_type, "DR") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_DR;
-              else if (strstr(fix_type, "G2") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_G2;
-              else if (strstr(fix_type, "G3") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_G3;
-              else if (strstr(fix_type, "D2") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_D2;
-              else if (strstr(fix_type, "D3") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_D3;
-              else if (strstr(fix_type, "RK") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_RK;
-              else if (strstr(fix_type, "TT") != NULL)
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_TT;
-              else
-                fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_INVALID;
-
-              if (_swarmGpsFixQualityCallback != NULL)
-              {
-                _swarmGpsFixQualityCallback((const Swarm_M138_GPS_Fix_Quality_t *)fixQuality); // Call the callback
-              }
+Swarm_M138_Error_e SWARM_M138::transmitBinaryAsync(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                                                   void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context), void *context)
+{
+  Swarm_M138_Error_e err;
 
-              delete fixQuality;
-              return (true);
-            }
-          }
-        }
-      }
-      delete fixQuality;
-    }
+  // The command is streamed, so no command buffer is needed
+  err = startAsyncResponse("$TD OK,", "$TD ERR", NULL, 0, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT,
+                           &SWARM_M138::completeAsyncMsgId);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    _asyncMsgIdCallback = callback;
+    _asyncContext = context;
+    _asyncTxHasAppID = useAppID;
+    _asyncTxAppID = appID;
+    sendTransmitBinaryCommand(data, len, useAppID, appID, false, 0, false, 0);
   }
-  { // $PW - Power Status
-    Swarm_M138_Power_Status_t *powerStatus = new Swarm_M138_Power_Status_t;
-    if (powerStatus != NULL) // Check memory allocation was successful
-    {
-      char *eventStart;
-      char *eventEnd;
 
-      eventStart = strstr(event, "$PW ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 10)) // Check we have enough data
-          {
-            // Extract the power status
-            int unused1H, unused2H, unused3H, cpu_voltsH, tempH;
-            char unused1L[8], unused2L[8], unused3L[8], cpu_voltsL[8], tempL[8];
+  return (err);
+}
 
-            int ret = sscanf(eventStart, "$PW %d.%[^,],%d.%[^,],%d.%[^,],%d.%[^,],%d.%[^,]*",
-                            &cpu_voltsH, cpu_voltsL, &unused1H, unused1L,
-                            &unused2H, unused2L, &unused3H, unused3L,
-                            &tempH, tempL);
+/**************************************************************************/
+/*!
+    @brief  Process any serial data which has already arrived - without waiting for more.
+            Complete the asynchronous command (if any) and call the callbacks for any unsolicited messages.
+            Call this regularly from loop(). It never blocks.
+    @return true if an unsolicited message was handled or the asynchronous command completed
+*/
+/**************************************************************************/
+bool SWARM_M138::poll(void)
+{
+  if (_checkUnsolicitedMsgReentrant == true) // Check for reentry (i.e. poll has been called from inside a callback)
+    return false;
 
-            if (ret == 10)
-            {
-              if (cpu_voltsH >= 0)
-                powerStatus->cpu_volts = (float)cpu_voltsH + ((float)atol(cpu_voltsL) / pow(10, strlen(cpu_voltsL)));
-              else
-                powerStatus->cpu_volts = (float)cpu_voltsH - ((float)atol(cpu_voltsL) / pow(10, strlen(cpu_voltsL)));
-              if (unused1H >= 0)
-                powerStatus->unused1 = (float)unused1H + ((float)atol(unused1L) / pow(10, strlen(unused1L)));
-              else
-                powerStatus->unused1 = (float)unused1H - ((float)atol(unused1L) / pow(10, strlen(unused1L)));
-              if (unused2H >= 0)
-                powerStatus->unused2 = (float)unused2H + ((float)atol(unused2L) / pow(10, strlen(unused2L)));
-              else
-                powerStatus->unused2 = (float)unused2H - ((float)atol(unused2L) / pow(10, strlen(unused2L)));
-              if (unused3H >= 0)
-                powerStatus->unused3 = (float)unused3H + ((float)atol(unused3L) / pow(10, strlen(unused3L)));
-              else
-                powerStatus->unused3 = (float)unused3H - ((float)atol(unused3L) / pow(10, strlen(unused3L)));
-              if (tempH >= 0)
-                powerStatus->temp = (float)tempH + ((float)atol(tempL) / pow(10, strlen(tempL)));
-              else
-                powerStatus->temp = (float)tempH - ((float)atol(tempL) / pow(10, strlen(tempL)));
-
-              if (_swarmPowerStatusCallback != NULL)
-              {
-                _swarmPowerStatusCallback((const Swarm_M138_Power_Status_t *)powerStatus); // Call the callback
-              }
+  _checkUnsolicitedMsgReentrant = true;
 
-              delete powerStatus;
-              return (true);
-            }
-          }
-        }
-      }
-      delete powerStatus;
+  bool handled = false;
+  bool printedEvents = false;
+
+  backlogFill(); // Only reads what has already arrived
+
+  pollCommandQueue(); // Send the next queued command - if nothing is in progress
+
+  if (_backlogLines > 0)
+  {
+#ifdef SWARM_M138_STATIC_BUFFERS
+    handled = processBacklogEvents(_swarmRxArena, &printedEvents); // Zero-heap mode: use the buffer owned by the class
+#else
+    char *event = swarm_m138_alloc_char(SWARM_M138_EVENT_SIZE); // Each unsolicited message is an 'event'
+    if (event != NULL)
+    {
+      handled = processBacklogEvents(event, &printedEvents);
+      swarm_m138_free_char(event);
     }
+    else if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
+      _debugPort->println(F("poll: not enough memory for the event!"));
+#endif
   }
-  { // $RT - Receive Test
-    Swarm_M138_Receive_Test_t *rxTest = new Swarm_M138_Receive_Test_t;
-    if (rxTest != NULL) // Check memory allocation was successful
+
+  if ((printedEvents == true) && SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("poll: <=== end of event(s)!"));
+
+  if (pollAsyncCommand())
+    handled = true;
+
+  _checkUnsolicitedMsgReentrant = false;
+
+  return handled;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check if an asynchronous command is in progress
+    @return true if an asynchronous command is in progress
+*/
+/**************************************************************************/
+bool SWARM_M138::isBusy(void)
+{
+  return (_asyncPending);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a command to the command queue. The command is formatted and checksummed now.
+            poll() sends the queued commands one at a time - each as soon as the previous one completes.
+            The error is expected to be the command tag followed by ERR. E.g. $FV ERR
+    @param  command
+            The command - without the asterix and checksum. E.g. "$FV". The asterix, checksum and line feed are added.
+    @param  expectedResponseStart
+            The start of the expected response. E.g. "$FV ". It is copied into the queue.
+    @param  callback
+            Optional: the function to be called when the command completes. response is the full response - or error - sentence.
+            The response is stored in a SWARM_M138_ASYNC_RESPONSE_SIZE buffer and will be truncated if it is longer.
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  timeout
+            The command timeout in milliseconds
+    @return SWARM_M138_ERROR_SUCCESS if the command was queued
+            SWARM_M138_ERROR_QUEUE_FULL if the queue is full, or the command is too long for the queue
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::queueCommand(const char *command, const char *expectedResponseStart,
+                                            void (*callback)(Swarm_M138_Error_e err, const char *response, void *context), void *context,
+                                            unsigned long timeout)
+{
+  size_t tagLen = strcspn(command, " "); // The command tag. E.g. $MM
+
+  // Check the command, asterix, checksum bytes, \n and \0 - and the expected strings - will fit
+  if (((strlen(command) + 5) > SWARM_M138_QUEUED_COMMAND_SIZE) || ((tagLen + 5) > SWARM_M138_QUEUED_RESPONSE_START_SIZE)
+      || (strlen(expectedResponseStart) >= SWARM_M138_QUEUED_RESPONSE_START_SIZE))
+    return (SWARM_M138_ERROR_QUEUE_FULL);
+
+  if (_commandQueueCount >= SWARM_M138_COMMAND_QUEUE_LENGTH)
+    return (SWARM_M138_ERROR_QUEUE_FULL);
+
+#ifndef SWARM_M138_STATIC_BUFFERS // In zero-heap mode, _commandQueue points to the arena owned by the class
+  if (_commandQueue == NULL)
+  {
+    _commandQueue = new Swarm_M138_Queued_Command_t[SWARM_M138_COMMAND_QUEUE_LENGTH];
+    if (_commandQueue == NULL)
     {
-      char *eventStart;
-      char *eventEnd;
+      if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
+        _debugPort->println(F("queueCommand: not enough memory for the command queue!"));
+      return (SWARM_M138_ERROR_MEM_ALLOC);
+    }
+  }
+#endif
 
-      eventStart = strstr(event, "$RT ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 9)) // Check we have enough data
-          {
-            // Extract the receive test info
-            int rssi_bg = 0, rssi_sat = 0, snr = 0, fdev = 0;
-            int YYYY = 0, MM = 0, DD = 0, hh = 0, mm = 0, ss = 0;
-            uint32_t sat_ID = 0;
+  if (_commandQueueCount == 0)
+    _commandQueueError = SWARM_M138_ERROR_SUCCESS; // The queue was empty. Start collecting errors again
 
-            int ret = sscanf(eventStart, "$RT RSSI=%d,SNR=%d,FDEV=%d,TS=%d-%d-%dT%d:%d:%d,DI=0x",
-                            &rssi_sat, &snr, &fdev, &YYYY, &MM, &DD, &hh, &mm, &ss);
+  uint8_t tail = (_commandQueueHead + _commandQueueCount) % SWARM_M138_COMMAND_QUEUE_LENGTH;
+  Swarm_M138_Queued_Command_t *queued = &_commandQueue[tail];
 
-            if (ret == 9)
-            {
-              eventStart = strstr(eventStart, "DI=0x"); // Find the start of the satellite ID
+  memset(queued->command, 0, SWARM_M138_QUEUED_COMMAND_SIZE); // Clear it
+  char *p = swarm_m138_print_text(queued->command, command); // Copy the command
+  *p = '*'; // Append the asterix
+  addChecksumLF(queued->command); // Add the checksum bytes and line feed
 
-              // Extract the ID
-              eventStart += 5; // Point at the first digit
-              while (eventStart < eventEnd)
-              {
-                sat_ID <<= 4; // Shuffle the existing value along by 4 bits
-                char c = *eventStart; // Get the digit
-                if ((c >= '0') && (c <= '9'))
-                  sat_ID |= c - '0';
-                else if ((c >= 'a') && (c <= 'f'))
-                  sat_ID |= c + 10 - 'a';
-                else if ((c >= 'A') && (c <= 'F'))
-                  sat_ID |= c + 10 - 'A';
-                eventStart++;
-              }
-            }
-            else // Try to extract just rssi_background
-            {
-              ret = sscanf(eventStart, "$RT RSSI=%d*", &rssi_bg);
-            }
+  strcpy(queued->expectedResponseStart, expectedResponseStart);
+  memcpy(queued->expectedErrorStart, command, tagLen); // Copy the tag
+  strcpy(&queued->expectedErrorStart[tagLen], " ERR"); // Add the ERR
 
-            if ((ret == 9) || (ret == 1)) // Check if we got valid data
-            {
-              rxTest->background = ret == 1;
-              rxTest->rssi_background = (int16_t)rssi_bg;
-              rxTest->rssi_sat = (int16_t)rssi_sat;
-              rxTest->snr = (int16_t)snr;
-              rxTest->fdev = (int16_t)fdev;
-              rxTest->time.YYYY = YYYY;
-              rxTest->time.MM = MM;
-              rxTest->time.DD = DD;
-              rxTest->time.hh = hh;
-              rxTest->time.mm = mm;
-              rxTest->time.ss = ss;
-              rxTest->sat_id = sat_ID;
-
-              if (_swarmReceiveTestCallback != NULL)
-              {
-                _swarmReceiveTestCallback((const Swarm_M138_Receive_Test_t *)rxTest); // Call the callback
-              }
+  queued->timeout = timeout;
+  queued->callback = callback;
+  queued->context = context;
 
-              delete rxTest;
-              return (true);
-            }
-          }
-        }
-      }
-      delete rxTest;
+  _commandQueueCount++;
+
+  pollCommandQueue(); // Send it now if nothing else is in progress
+
+  return (SWARM_M138_ERROR_SUCCESS);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a message rate command to the command queue
+    @param  command
+            The command for the message. E.g. SWARM_M138_COMMAND_DATE_TIME_STAT for $DT
+    @param  rate
+            The interval between messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
+    @param  callback
+            Optional: the function to be called when the command completes
+    @param  context
+            Passed to the callback. Can be NULL.
+    @return SWARM_M138_ERROR_SUCCESS if the command was queued
+            SWARM_M138_ERROR_INVALID_RATE if the rate is invalid
+            SWARM_M138_ERROR_QUEUE_FULL if the queue is full
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::queueSetRate(const char *command, uint32_t rate,
+                                            void (*callback)(Swarm_M138_Error_e err, const char *response, void *context), void *context)
+{
+  char rateCommand[SWARM_M138_QUEUED_COMMAND_SIZE]; // Use the stack, not the heap
+  char expectedResponseStart[SWARM_M138_QUEUED_RESPONSE_START_SIZE];
+
+  // Check rate is within bounds
+  if (rate > SWARM_M138_MAX_MESSAGE_RATE)
+    return (SWARM_M138_ERROR_INVALID_RATE);
+
+  if ((strlen(command) + 5) > SWARM_M138_QUEUED_RESPONSE_START_SIZE) // Check " OK*" will fit
+    return (SWARM_M138_ERROR_QUEUE_FULL);
+
+  char *p = swarm_m138_print_text(rateCommand, command); // Copy the command
+  *p++ = ' ';
+  swarm_m138_print_uint32(p, rate); // Add the rate
+  swarm_m138_print_text(swarm_m138_print_text(expectedResponseStart, command), " OK*");
+
+  return (queueCommand(rateCommand, expectedResponseStart, callback, context));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Wait until every queued command has completed. This method blocks
+    @return SWARM_M138_ERROR_SUCCESS if every command was successful - otherwise the first error
+            SWARM_M138_ERROR_BUSY if called from inside a callback
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::flushCommandQueue(void)
+{
+  if (_checkUnsolicitedMsgReentrant == true) // poll does nothing when called from inside a callback
+    return (SWARM_M138_ERROR_BUSY);
+
+  while (_commandQueueCount > 0) // Each command has a timeout, so this will always end
+  {
+    poll();
+    if (hwAvailable() <= 0)
+      swarmDelay(1);
+  }
+
+  Swarm_M138_Error_e err = _commandQueueError;
+  _commandQueueError = SWARM_M138_ERROR_SUCCESS;
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of commands in the command queue
+    @return The number of queued commands - including the one in progress
+*/
+/**************************************************************************/
+uint8_t SWARM_M138::getCommandQueueCount(void)
+{
+  return (_commandQueueCount);
+}
+
+// Send the oldest queued command - if the asynchronous command engine is free
+// Return true if a command was sent
+bool SWARM_M138::pollCommandQueue(void)
+{
+  if ((_commandQueueCount == 0) || (_commandQueueSending == true) || (_asyncPending == true))
+    return (false);
+
+  Swarm_M138_Queued_Command_t *queued = &_commandQueue[_commandQueueHead];
+
+  if (startAsyncCommand(queued->command, queued->expectedResponseStart, queued->expectedErrorStart, NULL, 0, queued->timeout,
+                        &SWARM_M138::completeQueuedCommand) != SWARM_M138_ERROR_SUCCESS)
+    return (false);
+
+  _commandQueueSending = true;
+  return (true);
+}
+
+// Completion for the queued commands: remove the command from the queue and call its callback
+void SWARM_M138::completeQueuedCommand(Swarm_M138_Error_e err, const char *response)
+{
+  Swarm_M138_Queued_Command_t *queued = &_commandQueue[_commandQueueHead];
+  void (*callback)(Swarm_M138_Error_e err, const char *response, void *context) = queued->callback;
+  void *context = queued->context;
+
+  // Remove the command before calling the callback, so the callback can queue more commands
+  _commandQueueHead = (_commandQueueHead + 1) % SWARM_M138_COMMAND_QUEUE_LENGTH;
+  _commandQueueCount--;
+  _commandQueueSending = false;
+
+  if ((err != SWARM_M138_ERROR_SUCCESS) && (_commandQueueError == SWARM_M138_ERROR_SUCCESS))
+    _commandQueueError = err; // Record the first error
+
+  if (callback != NULL)
+    callback(err, response, context);
+}
+
+// Send an already-formatted command. Tell backlogLineComplete to look for the response. Don't wait for it
+Swarm_M138_Error_e SWARM_M138::startAsyncCommand(const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
+                                                 char *responseDest, size_t destSize, unsigned long timeout,
+                                                 void (SWARM_M138::*complete)(Swarm_M138_Error_e err, const char *response))
+{
+  Swarm_M138_Error_e err = startAsyncResponse(expectedResponseStart, expectedErrorStart, responseDest, destSize, timeout, complete);
+
+  if (err == SWARM_M138_ERROR_SUCCESS)
+  {
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    {
+      _debugPort->print(F("startAsyncCommand: Command: "));
+      _debugPort->println(command);
     }
+
+    hwPrint(command);
+  }
+
+  return (err);
+}
+
+// Tell backlogLineComplete to look for the response to an asynchronous command.
+// The caller must send the command immediately afterwards
+Swarm_M138_Error_e SWARM_M138::startAsyncResponse(const char *expectedResponseStart, const char *expectedErrorStart,
+                                                  char *responseDest, size_t destSize, unsigned long timeout,
+                                                  void (SWARM_M138::*complete)(Swarm_M138_Error_e err, const char *response))
+{
+  if ((_asyncPending == true) || (_responseDest != NULL))
+    return (SWARM_M138_ERROR_BUSY);
+
+  if (responseDest == NULL)
+  {
+    responseDest = _asyncResponse;
+    destSize = SWARM_M138_ASYNC_RESPONSE_SIZE;
+  }
+  memset(responseDest, 0, destSize); // Clear it
+
+  backlogFill(); // Anything which has already arrived belongs to earlier traffic
+
+  responseExpect(expectedResponseStart, expectedErrorStart, responseDest, destSize);
+  _asyncComplete = complete;
+  _asyncStart = millis();
+  _asyncTimeout = timeout;
+  _asyncPending = true;
+
+  return (SWARM_M138_ERROR_SUCCESS);
+}
+
+// Complete the asynchronous command if its response has arrived - or it has timed out
+// Return true if the command completed
+bool SWARM_M138::pollAsyncCommand(void)
+{
+  if (_asyncPending == false)
+    return (false);
+
+  Swarm_M138_Error_e err;
+  if (_responseFound == true)
+    err = responseResult();
+  else if ((millis() - _asyncStart) >= _asyncTimeout)
+    err = SWARM_M138_ERROR_TIMEOUT;
+  else
+    return (false); // Keep waiting
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  statsRecordCommand(_expectedTag, err, millis() - _asyncStart);
+#endif
+
+  const char *response = _responseDest;
+  responseClear();
+  _asyncPending = false; // Clear the flag before calling the callback, so the callback can start the next command
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+  {
+    _debugPort->print(F("pollAsyncCommand: "));
+    _debugPort->println(modemErrorString(err));
   }
-  { // $M138 - Modem Status
-    char *data = swarm_m138_alloc_char(SWARM_M138_MEM_ALLOC_MS);
-    if (data != NULL) // Check memory allocation was successful
+
+  (this->*_asyncComplete)(err, response);
+
+  pollCommandQueue(); // Send the next queued command straight away - no need to wait for the modem to go quiet
+
+  return (true);
+}
+
+// Completion for sendCommandAsync: pass the response straight to the user
+void SWARM_M138::completeAsyncCommand(Swarm_M138_Error_e err, const char *response)
+{
+  if (_asyncCommandCallback != NULL)
+    _asyncCommandCallback(err, response, _asyncContext);
+}
+
+// Completion for getDateTimeAsync: parse the $DT response
+void SWARM_M138::completeAsyncDateTime(Swarm_M138_Error_e err, const char *response)
+{
+  Swarm_M138_DateTimeData_t dateTime; // Use the stack, not the heap
+  memset(&dateTime, 0, sizeof(Swarm_M138_DateTimeData_t));
+
+  if ((err == SWARM_M138_ERROR_SUCCESS) && (swarm_m138_parse_date_time(response, &dateTime) == false))
+    err = SWARM_M138_ERROR_ERROR;
+
+  if (_asyncDateTimeCallback != NULL)
+    _asyncDateTimeCallback(err, (const Swarm_M138_DateTimeData_t *)&dateTime, _asyncContext);
+}
+
+// Completion for transmitBinaryAsync: extract the message ID from the $TD OK response
+void SWARM_M138::completeAsyncMsgId(Swarm_M138_Error_e err, const char *response)
+{
+  uint64_t msg_id = 0;
+
+  if ((err == SWARM_M138_ERROR_SUCCESS) && (swarm_m138_parse_transmit_ok(response, &msg_id) == false))
+    err = SWARM_M138_ERROR_ERROR;
+
+  if (err == SWARM_M138_ERROR_SUCCESS)
+    ledgerQueued(msg_id, _asyncTxHasAppID, _asyncTxAppID, false, 0, false, 0);
+
+  if (_asyncMsgIdCallback != NULL)
+    _asyncMsgIdCallback(err, (const uint64_t *)&msg_id, _asyncContext);
+}
+
+// Completion for commands which only return OK or ERR
+void SWARM_M138::completeAsyncStatus(Swarm_M138_Error_e err, const char *response)
+{
+  (void)response; // OK has no payload. ERR is already in commandError
+
+  if (_asyncStatusCallback != NULL)
+    _asyncStatusCallback(err, _asyncContext);
+}
+
+// Pop and process each complete event in the backlog. event must be SWARM_M138_EVENT_SIZE bytes
+// Return true if any event was handled
+bool SWARM_M138::processBacklogEvents(char *event, bool *printedEvents)
+{
+  bool handled = false;
+  Swarm_M138_Sentence_Tag_e tag;
+
+  while (backlogPopLine(event, SWARM_M138_EVENT_SIZE, &tag) > 0) // Pop and process each complete event
+  {
+    if ((*printedEvents == false) && SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
     {
-      Swarm_M138_Modem_Status_e status = SWARM_M138_MODEM_STATUS_INVALID;
-      char *eventStart;
-      char *eventEnd;
+      _debugPort->println(F("processBacklogEvents: event(s) found! ===>"));
+      *printedEvents = true;
+    }
 
-      memset(data, 0, SWARM_M138_MEM_ALLOC_MS); // Clear the data
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    {
+      _debugPort->print(F("processBacklogEvents: start of event: "));
+      _debugPort->println(event);
+    }
 
-      eventStart = strstr(event, "$M138 ");
-      if (eventStart != NULL)
-      {
-        eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-        if (eventEnd != NULL)
-        {
-          if (eventEnd >= (eventStart + 6)) // Check we have enough data
-          {
-            // Extract the modem status
+    //Process the event. The framer has already checked the format and checksum
+    // Note: the callbacks can send commands. Any actionable events which arrive while the command is in progress
+    // are added to the backlog and are processed by this loop too.
+    if (processUnsolicitedEvent((const char *)event, tag))
+      handled = true; // handled will be true if any event has ever been handled
 
-            eventStart += 6; // Point at the first character of the msg
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+      _debugPort->println(F("processBacklogEvents: end of event")); //Just to denote end of processing event.
+  }
 
-            if (strstr(eventStart, "BOOT,ABORT") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_ABORT;
-              eventStart += strlen("BOOT,ABORT"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,DEVICEID") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_DEVICEID;
-              eventStart += strlen("BOOT,DEVICEID"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,POWERON") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_POWERON;
-              eventStart += strlen("BOOT,POWERON"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,RUNNING") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_RUNNING;
-              eventStart += strlen("BOOT,RUNNING"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,UPDATED") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_UPDATED;
-              eventStart += strlen("BOOT,UPDATED"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,VERSION") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_VERSION;
-              eventStart += strlen("BOOT,VERSION"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,RESTART") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_RESTART;
-              eventStart += strlen("BOOT,RESTART"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "BOOT,SHUTDOWN") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_BOOT_SHUTDOWN;
-              eventStart += strlen("BOOT,SHUTDOWN"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "DATETIME") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_DATETIME;
-              eventStart += strlen("DATETIME"); // Point at the asterix
-            }
-            else if (strstr(eventStart, "POSITION") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_POSITION;
-              eventStart += strlen("POSITION"); // Point at the asterix
-            }
-            else if (strstr(eventStart, "DEBUG") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_DEBUG;
-              eventStart += strlen("DEBUG"); // Point at the comma (or asterix)
-            }
-            else if (strstr(eventStart, "ERROR") != NULL)
-            {
-              status = SWARM_M138_MODEM_STATUS_ERROR;
-              eventStart += strlen("ERROR"); // Point at the comma (or asterix)
-            }
+  return (handled);
+}
 
-            if (*eventStart == ',') // Is eventStart pointing at a comma?
-              eventStart++; // Point at the next character
+// Parse incoming unsolicited messages - pass the data to the user via the callbacks (if defined)
+// The URC dispatch table. One entry per Swarm_M138_Sentence_Tag_e.
+// registered returns true if a callback is registered for that event. parse parses the event and calls the callback.
+// If new actionable events are added, you must add them here.
+const SWARM_M138::Swarm_M138_URC_Dispatch_t SWARM_M138::_urcDispatch[SWARM_M138_SENTENCE_TAG_MAX] = {
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_UNKNOWN
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_CS
+    {&SWARM_M138::dateTimeCallbackRegistered, &SWARM_M138::processDateTimeEvent},              // SWARM_M138_SENTENCE_TAG_DT
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_FV
+    {&SWARM_M138::gpsJammingCallbackRegistered, &SWARM_M138::processGpsJammingEvent},          // SWARM_M138_SENTENCE_TAG_GJ
+    {&SWARM_M138::geospatialCallbackRegistered, &SWARM_M138::processGeospatialEvent},          // SWARM_M138_SENTENCE_TAG_GN
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_GP
+    {&SWARM_M138::gpsFixQualityCallbackRegistered, &SWARM_M138::processGpsFixQualityEvent},    // SWARM_M138_SENTENCE_TAG_GS
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_MM
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_MT
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_PO
+    {&SWARM_M138::powerStatusCallbackRegistered, &SWARM_M138::processPowerStatusEvent},        // SWARM_M138_SENTENCE_TAG_PW
+    {&SWARM_M138::receiveMessageCallbackRegistered, &SWARM_M138::processReceiveMessageEvent},  // SWARM_M138_SENTENCE_TAG_RD
+    {NULL, NULL},                                                                              // SWARM_M138_SENTENCE_TAG_RS
+    {&SWARM_M138::receiveTestCallbackRegistered, &SWARM_M138::processReceiveTestEvent},        // SWARM_M138_SENTENCE_TAG_RT
+    {&SWARM_M138::sleepWakeCallbackRegistered, &SWARM_M138::processSleepWakeEvent},            // SWARM_M138_SENTENCE_TAG_SL
+    {&SWARM_M138::modemStatusCallbackRegistered, &SWARM_M138::processModemStatusEvent},        // SWARM_M138_SENTENCE_TAG_M138
+    {&SWARM_M138::transmitDataCallbackRegistered, &SWARM_M138::processTransmitDataEvent}       // SWARM_M138_SENTENCE_TAG_TD
+};
+
+// Return true if a callback is registered for this event tag. Used by backlogLineComplete to prune the backlog
+bool SWARM_M138::urcCallbackRegistered(Swarm_M138_Sentence_Tag_e tag)
+{
+  if ((tag >= SWARM_M138_SENTENCE_TAG_MAX) || (_urcDispatch[tag].registered == NULL))
+    return (false);
+  return ((this->*_urcDispatch[tag].registered)());
+}
 
-            if (eventStart < eventEnd) // Check if we have reached the asterix
-            {
-              if (status == SWARM_M138_MODEM_STATUS_INVALID) // If status is still INVALID, this must be an unknown / undocumented message
-                status = SWARM_M138_MODEM_STATUS_UNKNOWN;
+bool SWARM_M138::dateTimeCallbackRegistered(void) { return ((_swarmDateTimeCallback != NULL) || (_swarmDateTimeContextCallback != NULL)); }
+bool SWARM_M138::gpsJammingCallbackRegistered(void) { return ((_swarmGpsJammingCallback != NULL) || (_swarmGpsJammingContextCallback != NULL)); }
+bool SWARM_M138::geospatialCallbackRegistered(void)
+{
+  return ((_swarmGeospatialCallback != NULL) || (_swarmGeospatialFixedCallback != NULL)
+          || (_swarmGeospatialContextCallback != NULL) || (_swarmGeospatialFixedContextCallback != NULL));
+}
+bool SWARM_M138::gpsFixQualityCallbackRegistered(void) { return ((_swarmGpsFixQualityCallback != NULL) || (_swarmGpsFixQualityContextCallback != NULL)); }
+bool SWARM_M138::powerStatusCallbackRegistered(void)
+{
+  return ((_swarmPowerStatusCallback != NULL) || (_swarmPowerStatusFixedCallback != NULL)
+          || (_swarmPowerStatusContextCallback != NULL) || (_swarmPowerStatusFixedContextCallback != NULL));
+}
+bool SWARM_M138::receiveMessageCallbackRegistered(void) { return ((_swarmReceiveMessageCallback != NULL) || (_swarmReceiveMessageContextCallback != NULL)); }
+bool SWARM_M138::receiveTestCallbackRegistered(void) { return ((_swarmReceiveTestCallback != NULL) || (_swarmReceiveTestContextCallback != NULL)); }
+bool SWARM_M138::sleepWakeCallbackRegistered(void)
+{
+  return ((_swarmSleepWakeCallback != NULL) || (_swarmSleepWakeContextCallback != NULL) || _eventCounting);
+}
+bool SWARM_M138::modemStatusCallbackRegistered(void) { return ((_swarmModemStatusCallback != NULL) || (_swarmModemStatusContextCallback != NULL)); }
+bool SWARM_M138::transmitDataCallbackRegistered(void)
+{
+  return ((_swarmTransmitDataCallback != NULL) || (_swarmTransmitDataContextCallback != NULL)
+          || _eventCounting || (_txLedger != NULL)); // The ledger needs $TD SENT too
+}
 
-              // Keep going until we hit the asterix or the data buffer is full
-              // Leave a NULL on the end of data!
-              size_t dataLen = 0;
-              while ((eventStart < eventEnd) && (dataLen < (SWARM_M138_MEM_ALLOC_MS - 1)))
-              {
-                data[dataLen] = *eventStart; // Copy the message data into data
-                dataLen++;
-                eventStart++;
-              }
-            }
+// Process an unsolicited event: jump straight to the parser for this tag.
+// The event is not parsed if no callback is registered.
+// Return true if the event was valid and the callback was called
+bool SWARM_M138::processUnsolicitedEvent(const char *event, Swarm_M138_Sentence_Tag_e tag)
+{
+  if (urcCallbackRegistered(tag) == false)
+    return (false);
 
-            if (status < SWARM_M138_MODEM_STATUS_INVALID) // Check if we got valid data
-            {
-              if (_swarmModemStatusCallback != NULL)
-              {
-                _swarmModemStatusCallback(status, data); // Call the callback
-              }
+  return ((this->*_urcDispatch[tag].parse)(event));
+} // /processUnsolicitedEvent
 
-              swarm_m138_free_char(data);
-              return (true);
-            }
+// Parse a $DT Date/Time event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processDateTimeEvent(const char *event)
+{
+  Swarm_M138_DateTimeData_t dateTime; // Use the stack, not the heap
+
+  if (swarm_m138_parse_date_time(event, &dateTime) == false)
+    return (false);
+
+  if (_swarmDateTimeCallback != NULL)
+  {
+    _swarmDateTimeCallback((const Swarm_M138_DateTimeData_t *)&dateTime); // Call the callback
+  }
+
+  if (_swarmDateTimeContextCallback != NULL)
+    _swarmDateTimeContextCallback(dateTime, _swarmDateTimeContext);
+
+  return (true);
+}
+
+// Parse a $GJ Jamming indication event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processGpsJammingEvent(const char *event)
+{
+  Swarm_M138_GPS_Jamming_Indication_t jamming; // Use the stack, not the heap
+
+  if (swarm_m138_parse_gps_jamming(event, &jamming) == false)
+    return (false);
+
+  if (_swarmGpsJammingCallback != NULL)
+  {
+    _swarmGpsJammingCallback((const Swarm_M138_GPS_Jamming_Indication_t *)&jamming); // Call the callback
+  }
+
+  if (_swarmGpsJammingContextCallback != NULL)
+    _swarmGpsJammingContextCallback(jamming, _swarmGpsJammingContext);
+
+  return (true);
+}
+
+// Parse a $GN Geospatial event. Call the fixed-point and/or float callbacks
+// Return true if the event was valid
+bool SWARM_M138::processGeospatialEvent(const char *event)
+{
+  Swarm_M138_GeospatialData_Fixed_t fixed; // Use the stack, not the heap
+
+  if (swarm_m138_parse_geospatial(event, &fixed) == false)
+    return (false);
+
+  if (_swarmGeospatialFixedCallback != NULL)
+  {
+    _swarmGeospatialFixedCallback((const Swarm_M138_GeospatialData_Fixed_t *)&fixed); // Call the callback
+  }
+
+  if (_swarmGeospatialFixedContextCallback != NULL)
+    _swarmGeospatialFixedContextCallback(fixed, _swarmGeospatialFixedContext);
+
+  if ((_swarmGeospatialCallback != NULL) || (_swarmGeospatialContextCallback != NULL))
+  {
+    Swarm_M138_GeospatialData_t info;
+    swarm_m138_geospatial_to_float(&fixed, &info);
+    if (_swarmGeospatialCallback != NULL)
+      _swarmGeospatialCallback((const Swarm_M138_GeospatialData_t *)&info); // Call the callback
+    if (_swarmGeospatialContextCallback != NULL)
+      _swarmGeospatialContextCallback(info, _swarmGeospatialContext);
+  }
+
+  return (true);
+}
+
+// Parse a $GS GPS fix quality event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processGpsFixQualityEvent(const char *event)
+{
+  Swarm_M138_GPS_Fix_Quality_t fixQuality; // Use the stack, not the heap
+
+  if (swarm_m138_parse_gps_fix_quality(event, &fixQuality) == false)
+    return (false);
+
+  if (_swarmGpsFixQualityCallback != NULL)
+  {
+    _swarmGpsFixQualityCallback((const Swarm_M138_GPS_Fix_Quality_t *)&fixQuality); // Call the callback
+  }
+
+  if (_swarmGpsFixQualityContextCallback != NULL)
+    _swarmGpsFixQualityContextCallback(fixQuality, _swarmGpsFixQualityContext);
+
+  return (true);
+}
+
+// Parse a $PW Power Status event. Call the fixed-point and/or float callbacks
+// Return true if the event was valid
+bool SWARM_M138::processPowerStatusEvent(const char *event)
+{
+  Swarm_M138_Power_Status_Fixed_t fixed; // Use the stack, not the heap
+
+  if (swarm_m138_parse_power_status(event, &fixed) == false)
+    return (false);
+
+  if (_swarmPowerStatusFixedCallback != NULL)
+  {
+    _swarmPowerStatusFixedCallback((const Swarm_M138_Power_Status_Fixed_t *)&fixed); // Call the callback
+  }
+
+  if (_swarmPowerStatusFixedContextCallback != NULL)
+    _swarmPowerStatusFixedContextCallback(fixed, _swarmPowerStatusFixedContext);
+
+  if ((_swarmPowerStatusCallback != NULL) || (_swarmPowerStatusContextCallback != NULL))
+  {
+    Swarm_M138_Power_Status_t powerStatus;
+    swarm_m138_power_status_to_float(&fixed, &powerStatus);
+    if (_swarmPowerStatusCallback != NULL)
+      _swarmPowerStatusCallback((const Swarm_M138_Power_Status_t *)&powerStatus); // Call the callback
+    if (_swarmPowerStatusContextCallback != NULL)
+      _swarmPowerStatusContextCallback(powerStatus, _swarmPowerStatusContext);
+  }
+
+  return (true);
+}
+
+// Parse a $RT Receive Test event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processReceiveTestEvent(const char *event)
+{
+  Swarm_M138_Receive_Test_t rxTest; // Use the stack, not the heap
+
+  if (swarm_m138_parse_receive_test(event, &rxTest) == false)
+    return (false);
+
+  if (_swarmReceiveTestCallback != NULL)
+  {
+    _swarmReceiveTestCallback((const Swarm_M138_Receive_Test_t *)&rxTest); // Call the callback
+  }
+
+  if (_swarmReceiveTestContextCallback != NULL)
+    _swarmReceiveTestContextCallback(rxTest, _swarmReceiveTestContext);
+
+  return (true);
+}
+
+// Parse a $M138 Modem Status event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processModemStatusEvent(const char *event)
+{
+  char data[SWARM_M138_MEM_ALLOC_MS]; // Use the stack, not the heap
+  Swarm_M138_Modem_Status_e status = SWARM_M138_MODEM_STATUS_INVALID;
+  char *eventStart;
+  char *eventEnd;
+
+  memset(data, 0, SWARM_M138_MEM_ALLOC_MS); // Clear the data
+
+  eventStart = strstr(event, "$M138 ");
+  if (eventStart != NULL)
+  {
+    eventEnd = strchr(eventStart, '*'); // Stop at the asterix
+    if (eventEnd != NULL)
+    {
+      if (eventEnd >= (eventStart + 6)) // Check we have enough data
+      {
+        // Extract the modem status
+
+        eventStart += 6; // Point at the first character of the msg
+
+        if (strstr(eventStart, "BOOT,ABORT") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_ABORT;
+          eventStart += strlen("BOOT,ABORT"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,DEVICEID") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_DEVICEID;
+          eventStart += strlen("BOOT,DEVICEID"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,POWERON") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_POWERON;
+          eventStart += strlen("BOOT,POWERON"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,RUNNING") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_RUNNING;
+          eventStart += strlen("BOOT,RUNNING"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,UPDATED") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_UPDATED;
+          eventStart += strlen("BOOT,UPDATED"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,VERSION") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_VERSION;
+          eventStart += strlen("BOOT,VERSION"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,RESTART") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_RESTART;
+          eventStart += strlen("BOOT,RESTART"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "BOOT,SHUTDOWN") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_BOOT_SHUTDOWN;
+          eventStart += strlen("BOOT,SHUTDOWN"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "DATETIME") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_DATETIME;
+          eventStart += strlen("DATETIME"); // Point at the asterix
+        }
+        else if (strstr(eventStart, "POSITION") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_POSITION;
+          eventStart += strlen("POSITION"); // Point at the asterix
+        }
+        else if (strstr(eventStart, "DEBUG") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_DEBUG;
+          eventStart += strlen("DEBUG"); // Point at the comma (or asterix)
+        }
+        else if (strstr(eventStart, "ERROR") != NULL)
+        {
+          status = SWARM_M138_MODEM_STATUS_ERROR;
+          eventStart += strlen("ERROR"); // Point at the comma (or asterix)
+        }
+
+        if (*eventStart == ',') // Is eventStart pointing at a comma?
+          eventStart++; // Point at the next character
+
+        if (eventStart < eventEnd) // Check if we have reached the asterix
+        {
+          if (status == SWARM_M138_MODEM_STATUS_INVALID) // If status is still INVALID, this must be an unknown / undocumented message
+            status = SWARM_M138_MODEM_STATUS_UNKNOWN;
+
+          // Keep going until we hit the asterix or the data buffer is full
+          // Leave a NULL on the end of data!
+          size_t dataLen = 0;
+          while ((eventStart < eventEnd) && (dataLen < (SWARM_M138_MEM_ALLOC_MS - 1)))
+          {
+            data[dataLen] = *eventStart; // Copy the message data into data
+            dataLen++;
+            eventStart++;
+          }
+        }
+
+        if (status < SWARM_M138_MODEM_STATUS_INVALID) // Check if we got valid data
+        {
+          if (_swarmModemStatusCallback != NULL)
+          {
+            _swarmModemStatusCallback(status, data); // Call the callback
           }
+
+          if (_swarmModemStatusContextCallback != NULL)
+            _swarmModemStatusContextCallback(status, data, _swarmModemStatusContext);
+
+          return (true);
         }
       }
-      swarm_m138_free_char(data);
     }
   }
-  { // $SL - Sleep Mode
-    Swarm_M138_Wake_Cause_e cause = SWARM_M138_WAKE_CAUSE_INVALID;
-    char *eventStart;
-    char *eventEnd;
+  return (false);
+}
+
+// Parse a $SL Sleep Mode event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processSleepWakeEvent(const char *event)
+{
+  Swarm_M138_Wake_Cause_e cause = SWARM_M138_WAKE_CAUSE_INVALID;
+  char *eventStart;
+  char *eventEnd;
 
-    eventStart = strstr(event, "$SL WAKE,");
-    if (eventStart != NULL)
+  eventStart = strstr(event, "$SL WAKE,");
+  if (eventStart != NULL)
+  {
+    eventEnd = strchr(eventStart, '*'); // Stop at the asterix
+    if (eventEnd != NULL)
     {
-      eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-      if (eventEnd != NULL)
+      // Check for the wake cause
+      if (strstr(eventStart, "WAKE,GPIO") != NULL)
+        cause = SWARM_M138_WAKE_CAUSE_GPIO;
+      else if (strstr(eventStart, "WAKE,SERIAL") != NULL)
+        cause = SWARM_M138_WAKE_CAUSE_SERIAL;
+      else if (strstr(eventStart, "WAKE,TIME") != NULL)
+        cause = SWARM_M138_WAKE_CAUSE_TIME;
+
+      if (cause < SWARM_M138_WAKE_CAUSE_INVALID)
       {
-        // Check for the wake cause
-        if (strstr(eventStart, "WAKE,GPIO") != NULL)
-          cause = SWARM_M138_WAKE_CAUSE_GPIO;
-        else if (strstr(eventStart, "WAKE,SERIAL") != NULL)
-          cause = SWARM_M138_WAKE_CAUSE_SERIAL;
-        else if (strstr(eventStart, "WAKE,TIME") != NULL)
-          cause = SWARM_M138_WAKE_CAUSE_TIME;
-
-        if (cause < SWARM_M138_WAKE_CAUSE_INVALID)
-        {
-          if (_swarmSleepWakeCallback != NULL)
-          {
-            _swarmSleepWakeCallback(cause); // Call the callback
-          }
+        _sleepWakeCount++;
 
-          return (true);
+        if (_swarmSleepWakeCallback != NULL)
+        {
+          _swarmSleepWakeCallback(cause); // Call the callback
         }
+
+        if (_swarmSleepWakeContextCallback != NULL)
+          _swarmSleepWakeContextCallback(cause, _swarmSleepWakeContext);
+
+        return (true);
       }
     }
   }
-  { // $RD - Receive Data Message
-    char *eventStart;
-    char *eventEnd;
-    bool appIDseen = false;
-    int appID_i, rssi_i = 0, snr_i = 0, fdev_i = 0;
-    uint16_t appID = 0;
-    int16_t rssi = 0, snr = 0, fdev = 0;
-    char *paramPtr;
-    int ret = 0;
-
-    eventStart = strstr(event, "$RD ");
-    if (eventStart != NULL)
+  return (false);
+}
+
+// Parse a $RD Receive Data Message event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processReceiveMessageEvent(const char *event)
+{
+  char *eventStart;
+  char *eventEnd;
+  bool appIDseen = false;
+  int appID_i, rssi_i = 0, snr_i = 0, fdev_i = 0;
+  uint16_t appID = 0;
+  int16_t rssi = 0, snr = 0, fdev = 0;
+  char *paramPtr;
+  int ret = 0;
+
+  eventStart = strstr(event, "$RD ");
+  if (eventStart != NULL)
+  {
+    eventEnd = strchr(eventStart, '*'); // Stop at the asterix
+    if (eventEnd != NULL)
     {
-      eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-      if (eventEnd != NULL)
+      // Check for the appID (shows only with firmware version v1.1.0+)
+      paramPtr = strstr(eventStart, "AI="); // Look for the AI=
+      if (paramPtr != NULL)
       {
-        // Check for the appID (shows only with firmware version v1.1.0+)
-        paramPtr = strstr(eventStart, "AI="); // Look for the AI=
-        if (paramPtr != NULL)
+        ret = sscanf(paramPtr, "AI=%d,", &appID_i);
+        if (ret == 1)
         {
-          ret = sscanf(paramPtr, "AI=%d,", &appID_i);
-          if (ret == 1)
-          {
-            appID = (uint16_t)appID_i;
-            appIDseen = true; // Flag that the appID has been seen and extracted correctly
-          }
+          appID = (uint16_t)appID_i;
+          appIDseen = true; // Flag that the appID has been seen and extracted correctly
         }
+      }
+
+      // Extract the rssi, snt and fdev
+      paramPtr = strstr(eventStart, "RSSI=");
+      if (paramPtr != NULL)
+      {
+        ret = sscanf(paramPtr, "RSSI=%d,SNR=%d,FDEV=%d,", &rssi_i, &snr_i, &fdev_i);
 
-        // Extract the rssi, snt and fdev
-        paramPtr = strstr(eventStart, "RSSI=");
-        if (paramPtr != NULL)
+        if (ret == 3)
         {
-          ret = sscanf(paramPtr, "RSSI=%d,SNR=%d,FDEV=%d,", &rssi_i, &snr_i, &fdev_i);
+          rssi = (int16_t)rssi_i;
+          snr = (int16_t)snr_i;
+          fdev = (int16_t)fdev_i;
 
-          if (ret == 3)
+          // Extract the data (ASCII Hex)
+          paramPtr = strstr(paramPtr, "FDEV="); // Find the FDEV
+          if (paramPtr != NULL)
           {
-            rssi = (int16_t)rssi_i;
-            snr = (int16_t)snr_i;
-            fdev = (int16_t)fdev_i;
-
-            // Extract the data (ASCII Hex)
-            paramPtr = strstr(paramPtr, "FDEV="); // Find the FDEV
+            paramPtr = strchr(paramPtr, ','); // Find the comma after the FDEV
             if (paramPtr != NULL)
             {
-              paramPtr = strchr(paramPtr, ','); // Find the comma after the FDEV
-              if (paramPtr != NULL)
+              paramPtr++; // Point to the first ASCII Hex character
+              *eventEnd = 0; // Change the asterix into NULL
+
+              if (_swarmReceiveMessageCallback != NULL)
               {
-                paramPtr++; // Point to the first ASCII Hex character
-                *eventEnd = 0; // Change the asterix into NULL
-
-                if (_swarmReceiveMessageCallback != NULL)
-                {
-                  if (appIDseen)
-                    _swarmReceiveMessageCallback((const uint16_t *)&appID, (const int16_t *)&rssi,
-                                                 (const int16_t *)&snr, (const int16_t *)&fdev, (const char *)paramPtr); // Call the callback
-                  else
-                    _swarmReceiveMessageCallback(NULL, (const int16_t *)&rssi,
-                                                 (const int16_t *)&snr, (const int16_t *)&fdev, (const char *)paramPtr); // Call the callback
-                }
-
-                *eventEnd = '*'; // Be nice. Restore the asterix
-
-                return (true);
+                if (appIDseen)
+                  _swarmReceiveMessageCallback((const uint16_t *)&appID, (const int16_t *)&rssi,
+                                               (const int16_t *)&snr, (const int16_t *)&fdev, (const char *)paramPtr); // Call the callback
+                else
+                  _swarmReceiveMessageCallback(NULL, (const int16_t *)&rssi,
+                                               (const int16_t *)&snr, (const int16_t *)&fdev, (const char *)paramPtr); // Call the callback
               }
+
+              if (_swarmReceiveMessageContextCallback != NULL)
+                _swarmReceiveMessageContextCallback(appIDseen, appID, rssi, snr, fdev, (const char *)paramPtr, _swarmReceiveMessageContext);
+
+              *eventEnd = '*'; // Be nice. Restore the asterix
+
+              return (true);
             }
           }
         }
       }
     }
   }
-  { // $TD - Transmit Data Message
-    char *eventStart;
-    char *eventEnd;
-    int rssi_i = 0, snr_i = 0, fdev_i = 0;
-    uint64_t msg_id = 0;
-    int16_t rssi = 0, snr = 0, fdev = 0;
-    char *paramPtr;
-    int ret = 0;
-
-    eventStart = strstr(event, "$TD SENT");
-    if (eventStart != NULL)
+  return (false);
+}
+
+// Parse a $TD Transmit Data Message event. Call the callback
+// Return true if the event was valid
+bool SWARM_M138::processTransmitDataEvent(const char *event)
+{
+  char *eventStart;
+  char *eventEnd;
+  int rssi_i = 0, snr_i = 0, fdev_i = 0;
+  uint64_t msg_id = 0;
+  int16_t rssi = 0, snr = 0, fdev = 0;
+  char *paramPtr;
+  int ret = 0;
+
+  eventStart = strstr(event, "$TD SENT");
+  if (eventStart != NULL)
+  {
+    eventEnd = strchr(eventStart, '*'); // Stop at the asterix
+    if (eventEnd != NULL)
     {
-      eventEnd = strchr(eventStart, '*'); // Stop at the asterix
-      if (eventEnd != NULL)
+      // Extract the rssi, snt and fdev
+      paramPtr = strstr(eventStart, "RSSI=");
+      if (paramPtr != NULL)
       {
-        // Extract the rssi, snt and fdev
-        paramPtr = strstr(eventStart, "RSSI=");
-        if (paramPtr != NULL)
+        ret = sscanf(paramPtr, "RSSI=%d,SNR=%d,FDEV=%d,", &rssi_i, &snr_i, &fdev_i);
+
+        if (ret == 3)
         {
-          ret = sscanf(paramPtr, "RSSI=%d,SNR=%d,FDEV=%d,", &rssi_i, &snr_i, &fdev_i);
+          rssi = (int16_t)rssi_i;
+          snr = (int16_t)snr_i;
+          fdev = (int16_t)fdev_i;
 
-          if (ret == 3)
+          // Extract the 64-bit message ID
+          paramPtr = strstr(paramPtr, "FDEV="); // Find the FDEV
+          if (paramPtr != NULL)
           {
-            rssi = (int16_t)rssi_i;
-            snr = (int16_t)snr_i;
-            fdev = (int16_t)fdev_i;
-
-            // Extract the 64-bit message ID
-            paramPtr = strstr(paramPtr, "FDEV="); // Find the FDEV
+            paramPtr = strchr(paramPtr, ','); // Find the comma after the FDEV
             if (paramPtr != NULL)
             {
-              paramPtr = strchr(paramPtr, ','); // Find the comma after the FDEV
-              if (paramPtr != NULL)
+              paramPtr++; // Point to the first message ID character
+
+              while (paramPtr < eventEnd) // Add each character to id
+              {
+                msg_id *= 10;
+                msg_id += (uint64_t)((*paramPtr) - '0');
+                paramPtr++;
+              }
+
+              _transmitSentCount++;
+
+              if (_txLedger != NULL)
+                _txLedger->markSent(msg_id, rssi, snr, fdev, getUnixTime());
+
+              if (_swarmTransmitDataCallback != NULL)
               {
-                paramPtr++; // Point to the first message ID character
-
-                while (paramPtr < eventEnd) // Add each character to id
-                {
-                  msg_id *= 10;
-                  msg_id += (uint64_t)((*paramPtr) - '0');
-                  paramPtr++;
-                }
-
-                if (_swarmTransmitDataCallback != NULL)
-                {
-                  _swarmTransmitDataCallback((const int16_t *)&rssi, (const int16_t *)&snr,
-                                             (const int16_t *)&fdev, (const uint64_t *)&msg_id); // Call the callback
-                }
-
-                return (true);
+                _swarmTransmitDataCallback((const int16_t *)&rssi, (const int16_t *)&snr,
+                                           (const int16_t *)&fdev, (const uint64_t *)&msg_id); // Call the callback
               }
+
+              if (_swarmTransmitDataContextCallback != NULL)
+                _swarmTransmitDataContextCallback(rssi, snr, fdev, msg_id, _swarmTransmitDataContext);
+
+              return (true);
             }
           }
         }
       }
     }
   }
-  return false;
-} // /processUnsolicitedEvent
+  return (false);
+}
 
 /**************************************************************************/
 /*!
@@ -974,29 +2139,20 @@ bool SWARM_M138::processUnsolicitedEvent(const char *event)
 // but an unsolicited receive data message could arrive while we are waiting for the response...
 Swarm_M138_Error_e SWARM_M138::getConfigurationSettings(char *settings)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_CONFIGURATION) + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_CONFIGURATION) + 5); // Clear it
-  sprintf(command, "%s*", SWARM_M138_COMMAND_CONFIGURATION); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_CONFIGURATION, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$CS DI=0x", "$CS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$CS DI=0x", "$CS ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1005,8 +2161,7 @@ Swarm_M138_Error_e SWARM_M138::getConfigurationSettings(char *settings)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1018,8 +2173,7 @@ Swarm_M138_Error_e SWARM_M138::getConfigurationSettings(char *settings)
     settings[responseEnd - responseStart] = 0;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1033,35 +2187,25 @@ Swarm_M138_Error_e SWARM_M138::getConfigurationSettings(char *settings)
             SWARM_M138_ERROR_ERROR if unsuccessful
 */
 /**************************************************************************/
-// Only ~25 bytes are needed to store the reply,
-// but an unsolicited receive data message _could_ arrive while we are waiting for the response...
-// So we need to allocate the full _RxBuffSize for the response.
+// Only ~25 bytes are needed to store the reply. Any unsolicited message (e.g. $RD) which arrives
+// while we are waiting for the response goes into the backlog, not the response.
 Swarm_M138_Error_e SWARM_M138::getDeviceID(uint32_t *id)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
   uint32_t dev_ID = 0;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_CONFIGURATION) + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_CONFIGURATION) + 5); // Clear it
-  sprintf(command, "%s*", SWARM_M138_COMMAND_CONFIGURATION); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_CONFIGURATION, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$CS DI=0x", "$CS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$CS DI=0x", "$CS ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1070,8 +2214,7 @@ Swarm_M138_Error_e SWARM_M138::getDeviceID(uint32_t *id)
       responseEnd = strchr(responseStart, ','); // Stop at the comma
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1090,7 +2233,7 @@ Swarm_M138_Error_e SWARM_M138::getDeviceID(uint32_t *id)
       responseStart++;
     }
 
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
     {
       _debugPort->print(F("getDeviceID: dev_ID is 0x"));
       _debugPort->println(dev_ID, HEX);
@@ -1099,8 +2242,7 @@ Swarm_M138_Error_e SWARM_M138::getDeviceID(uint32_t *id)
     *id = dev_ID; // Copy the extracted ID into id
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1116,69 +2258,57 @@ Swarm_M138_Error_e SWARM_M138::getDeviceID(uint32_t *id)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getDateTime(Swarm_M138_DateTimeData_t *dateTime)
 {
-  char *command;
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_DATE_TIME_STAT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_DATE_TIME_STAT_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$DT ", "$DT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$DT ", "$DT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$DT ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 20))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the Date, Time and flag
-    int year, month, day, hour, minute, second;
-    char valid;
-
-    int ret = sscanf(responseStart, "$DT %4d%2d%2d%2d%2d%2d,%c*", &year, &month, &day, &hour, &minute, &second, &valid);
-
-    if (ret < 7)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    dateTime->YYYY = (uint16_t)year;
-    dateTime->MM = (uint8_t)month;
-    dateTime->DD = (uint8_t)day;
-    dateTime->hh = (uint8_t)hour;
-    dateTime->mm = (uint8_t)minute;
-    dateTime->ss = (uint8_t)second;
-    dateTime->valid = valid == 'V' ? 1 : 0;
+    if ((responseStart == NULL) || (swarm_m138_parse_date_time(responseStart, dateTime) == false))
+      err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Get the cached $DT message if it is no older than maxAge, otherwise get the most recent.
+            Note: the cached date and time is not advanced. It can be up to maxAge old
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  dateTime
+            A pointer to a Swarm_M138_DateTimeData_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getDateTime(Swarm_M138_DateTimeData_t *dateTime, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_DT, maxAge))
+  {
+    memcpy(dateTime, &_cachedDateTime, sizeof(Swarm_M138_DateTimeData_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getDateTime(dateTime));
+}
+
 /**************************************************************************/
 /*!
     @brief  Query the current $DT rate
@@ -1191,29 +2321,20 @@ Swarm_M138_Error_e SWARM_M138::getDateTime(Swarm_M138_DateTimeData_t *dateTime)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getDateTimeRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_DATE_TIME_STAT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_DATE_TIME_STAT_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$DT ", "$DT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$DT ", "$DT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1222,8 +2343,7 @@ Swarm_M138_Error_e SWARM_M138::getDateTimeRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1250,8 +2370,7 @@ Swarm_M138_Error_e SWARM_M138::getDateTimeRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1280,29 +2399,28 @@ Swarm_M138_Error_e SWARM_M138::setDateTimeRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_DATE_TIME_STAT) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_DATE_TIME_STAT, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_DATE_TIME_STAT, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_DATE_TIME_STAT); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$DT OK*", "$DT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$DT OK*", "$DT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1320,29 +2438,20 @@ Swarm_M138_Error_e SWARM_M138::setDateTimeRate(uint32_t rate)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getFirmwareVersion(char *version)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_FIRMWARE_VER) + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_FIRMWARE_VER) + 5); // Clear it
-  sprintf(command, "%s*", SWARM_M138_COMMAND_FIRMWARE_VER); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_FIRMWARE_VER, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$FV ", "$FV ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$FV ", "$FV ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1351,8 +2460,7 @@ Swarm_M138_Error_e SWARM_M138::getFirmwareVersion(char *version)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1364,8 +2472,7 @@ Swarm_M138_Error_e SWARM_M138::getFirmwareVersion(char *version)
     version[responseEnd - responseStart] = 0;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1381,63 +2488,56 @@ Swarm_M138_Error_e SWARM_M138::getFirmwareVersion(char *version)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGpsJammingIndication(Swarm_M138_GPS_Jamming_Indication_t *jamming)
 {
-  char *command;
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_GPS_JAMMING); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPS_JAMMING_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GJ ", "$GJ ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GJ ", "$GJ ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$GJ ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 3))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the spoof_state and jamming_level
-    int spoof_state, jamming_level;
-
-    int ret = sscanf(responseStart, "$GJ %d,%d*", &spoof_state, &jamming_level);
-
-    if (ret < 2)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    jamming->spoof_state = (uint8_t)spoof_state;
-    jamming->jamming_level = (uint8_t)jamming_level;
+    if ((responseStart == NULL) || (swarm_m138_parse_gps_jamming(responseStart, jamming) == false))
+      err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Get the cached $GJ message if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  jamming
+            A pointer to a Swarm_M138_GPS_Jamming_Indication_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getGpsJammingIndication(Swarm_M138_GPS_Jamming_Indication_t *jamming, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_GJ, maxAge))
+  {
+    memcpy(jamming, &_cachedGpsJamming, sizeof(Swarm_M138_GPS_Jamming_Indication_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getGpsJammingIndication(jamming));
+}
+
 /**************************************************************************/
 /*!
     @brief  Query the current $GJ rate
@@ -1450,29 +2550,20 @@ Swarm_M138_Error_e SWARM_M138::getGpsJammingIndication(Swarm_M138_GPS_Jamming_In
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGpsJammingIndicationRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_GPS_JAMMING); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPS_JAMMING_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GJ ", "$GJ ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GJ ", "$GJ ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1481,8 +2572,7 @@ Swarm_M138_Error_e SWARM_M138::getGpsJammingIndicationRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1509,8 +2599,7 @@ Swarm_M138_Error_e SWARM_M138::getGpsJammingIndicationRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1539,29 +2628,28 @@ Swarm_M138_Error_e SWARM_M138::setGpsJammingIndicationRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_JAMMING) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_GPS_JAMMING, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_GPS_JAMMING, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_GPS_JAMMING); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GJ OK*", "$GJ ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GJ OK*", "$GJ ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1577,72 +2665,99 @@ Swarm_M138_Error_e SWARM_M138::setGpsJammingIndicationRate(uint32_t rate)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGeospatialInfo(Swarm_M138_GeospatialData_t *info)
 {
-  char *command;
+  Swarm_M138_GeospatialData_Fixed_t fixed;
+  Swarm_M138_Error_e err = getGeospatialInfo(&fixed);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+    swarm_m138_geospatial_to_float(&fixed, info);
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the most recent $GN message in fixed-point
+    @param  info
+            A pointer to a Swarm_M138_GeospatialData_Fixed_t struct which will hold the result.
+            lat and lon are in microdegrees
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getGeospatialInfo(Swarm_M138_GeospatialData_Fixed_t *info)
+{
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_GEOSPATIAL_INFO); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GEOSPATIAL_INFO_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$GN ", "$GN ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GN ", "$GN ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$GN ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 10))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the geospatial info
-    int latH, lonH, alt, course, speed;
-    char latL[8], lonL[8];
-
-    int ret = sscanf(responseStart, "$GN %d.%[^,],%d.%[^,],%d,%d,%d*",
-                     &latH, latL, &lonH, lonL, &alt, &course, &speed);
+    if ((responseStart == NULL) || (swarm_m138_parse_geospatial(responseStart, info) == false))
+      err = SWARM_M138_ERROR_ERROR;
+  }
 
-    if (ret < 7)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
+  swarm_m138_free_response(response);
+  return (err);
+}
 
-    if (latH >= 0)
-      info->lat = (float)latH + ((float)atol(latL) / pow(10, strlen(latL)));
-    else
-      info->lat = (float)latH - ((float)atol(latL) / pow(10, strlen(latL)));
-    if (lonH >= 0)
-      info->lon = (float)lonH + ((float)atol(lonL) / pow(10, strlen(lonL)));
-    else
-      info->lon = (float)lonH - ((float)atol(lonL) / pow(10, strlen(lonL)));
-    info->alt = (float)alt;
-    info->course = (float)course;
-    info->speed = (float)speed;
+/**************************************************************************/
+/*!
+    @brief  Get the cached $GN message if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  info
+            A pointer to a Swarm_M138_GeospatialData_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getGeospatialInfo(Swarm_M138_GeospatialData_t *info, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_GN, maxAge))
+  {
+    swarm_m138_geospatial_to_float(&_cachedGeospatial, info);
+    return (SWARM_M138_ERROR_SUCCESS);
   }
+  return (getGeospatialInfo(info));
+}
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
-  return (err);
+/**************************************************************************/
+/*!
+    @brief  Get the cached $GN message in fixed-point if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  info
+            A pointer to a Swarm_M138_GeospatialData_Fixed_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getGeospatialInfo(Swarm_M138_GeospatialData_Fixed_t *info, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_GN, maxAge))
+  {
+    memcpy(info, &_cachedGeospatial, sizeof(Swarm_M138_GeospatialData_Fixed_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getGeospatialInfo(info));
 }
 
 /**************************************************************************/
@@ -1657,29 +2772,20 @@ Swarm_M138_Error_e SWARM_M138::getGeospatialInfo(Swarm_M138_GeospatialData_t *in
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGeospatialInfoRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_GEOSPATIAL_INFO); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GEOSPATIAL_INFO_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GN ", "$GN ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GN ", "$GN ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1688,8 +2794,7 @@ Swarm_M138_Error_e SWARM_M138::getGeospatialInfoRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1716,8 +2821,7 @@ Swarm_M138_Error_e SWARM_M138::getGeospatialInfoRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1746,29 +2850,28 @@ Swarm_M138_Error_e SWARM_M138::setGeospatialInfoRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_GEOSPATIAL_INFO) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_GEOSPATIAL_INFO, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_GEOSPATIAL_INFO, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_GEOSPATIAL_INFO); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GN OK*", "$GN ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GN OK*", "$GN ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1784,29 +2887,20 @@ Swarm_M138_Error_e SWARM_M138::setGeospatialInfoRate(uint32_t rate)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGPIO1Mode(Swarm_M138_GPIO1_Mode_e *mode)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_GPIO1_CONTROL); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPIO1_CONTROL_GET_MODE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GP ", "$GP ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GP ", "$GP ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1815,8 +2909,7 @@ Swarm_M138_Error_e SWARM_M138::getGPIO1Mode(Swarm_M138_GPIO1_Mode_e *mode)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1826,16 +2919,14 @@ Swarm_M138_Error_e SWARM_M138::getGPIO1Mode(Swarm_M138_GPIO1_Mode_e *mode)
 
     if (ret < 1)
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
     *mode = (Swarm_M138_GPIO1_Mode_e)theMode; // Copy the extracted mode into mode
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1861,25 +2952,28 @@ Swarm_M138_Error_e SWARM_M138::setGPIO1Mode(Swarm_M138_GPIO1_Mode_e mode)
     return (SWARM_M138_ERROR_INVALID_MODE);
 
   // Allocate memory for the command, mode, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 1 + 2 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 1 + 2 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 1 + 2 + 5); // Clear it
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_GPIO1_CONTROL, (int)mode); // Copy the command, add the asterix
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_GPIO1_CONTROL); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, (uint32_t)mode); // Add the mode
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GP OK*", "$GP ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GP OK*", "$GP ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1898,29 +2992,20 @@ Swarm_M138_Error_e SWARM_M138::setGPIO1Mode(Swarm_M138_GPIO1_Mode_e mode)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::readGPIO1voltage(float *voltage)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, space, @, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 1 + 1 + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPIO1_CONTROL) + 1 + 1 + 5); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_GPIO1_CONTROL); // Copy the command, add the @ and asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
-
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPIO1_CONTROL_GET_VOLTAGE, buffer);
+
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GP ", "$GP ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GP ", "$GP ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -1929,8 +3014,7 @@ Swarm_M138_Error_e SWARM_M138::readGPIO1voltage(float *voltage)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 5))) // Check we have enough data
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -1953,16 +3037,13 @@ Swarm_M138_Error_e SWARM_M138::readGPIO1voltage(float *voltage)
       }
       else
       {
-        int volt;
-        char mVolt[5];
-
-        int ret = sscanf(responseStart, "$GP %d.%[^,]V*", &volt, mVolt);
+        int32_t millivolts;
+        const char *p = swarm_m138_parse_literal(responseStart, "$GP ");
+        p = swarm_m138_parse_fixed(p, 3, &millivolts);
+        p = swarm_m138_parse_literal(p, "V*");
 
-        if (ret == 2)
-        {
-          volts = (float)volt;
-          volts += (float)atol(mVolt) / pow(10, strlen(mVolt)); // Assumes voltage is always +ve!
-        }
+        if ((p != NULL) && (millivolts >= 0))
+          volts = (float)millivolts / 1000.0;
       }
     }
 
@@ -1972,8 +3053,7 @@ Swarm_M138_Error_e SWARM_M138::readGPIO1voltage(float *voltage)
       err = SWARM_M138_ERROR_INVALID_MODE;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -1989,86 +3069,56 @@ Swarm_M138_Error_e SWARM_M138::readGPIO1voltage(float *voltage)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGpsFixQuality(Swarm_M138_GPS_Fix_Quality_t *fixQuality)
 {
-  char *command;
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_GPS_FIX_QUAL); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPS_FIX_QUAL_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GS ", "$GS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GS ", "$GS ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$GS ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 11))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the GPS fix quality
-    int hdop, vdop, gnss_sats, unused;
-    char fix_type[3];
-
-    int ret = sscanf(responseStart, "$GS %d,%d,%d,%d,%c%c*", &hdop, &vdop, &gnss_sats, &unused, &fix_type[0], &fix_type[1]);
-
-    if (ret < 6)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    fixQuality->hdop = (uint16_t)hdop;
-    fixQuality->vdop = (uint16_t)vdop;
-    fixQuality->gnss_sats = (uint8_t)gnss_sats;
-    fixQuality->unused = (uint8_t)unused;
-
-    fix_type[2] = 0; // Null-terminate the fix type
-    if (strstr(fix_type, "NF") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_NF;
-    else if (strstr(fix_type, "DR") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_DR;
-    else if (strstr(fix_type, "G2") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_G2;
-    else if (strstr(fix_type, "G3") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_G3;
-    else if (strstr(fix_type, "D2") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_D2;
-    else if (strstr(fix_type, "D3") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_D3;
-    else if (strstr(fix_type, "RK") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_RK;
-    else if (strstr(fix_type, "TT") != NULL)
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_TT;
-    else
-      fixQuality->fix_type = SWARM_M138_GPS_FIX_TYPE_INVALID;
+    if ((responseStart == NULL) || (swarm_m138_parse_gps_fix_quality(responseStart, fixQuality) == false))
+      err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Get the cached $GS message if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  fixQuality
+            A pointer to a Swarm_M138_GPS_Fix_Quality_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getGpsFixQuality(Swarm_M138_GPS_Fix_Quality_t *fixQuality, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_GS, maxAge))
+  {
+    memcpy(fixQuality, &_cachedGpsFixQuality, sizeof(Swarm_M138_GPS_Fix_Quality_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getGpsFixQuality(fixQuality));
+}
+
 /**************************************************************************/
 /*!
     @brief  Query the current $GS rate
@@ -2081,29 +3131,20 @@ Swarm_M138_Error_e SWARM_M138::getGpsFixQuality(Swarm_M138_GPS_Fix_Quality_t *fi
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getGpsFixQualityRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_GPS_FIX_QUAL); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_GPS_FIX_QUAL_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GS ", "$GS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GS ", "$GS ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -2112,8 +3153,7 @@ Swarm_M138_Error_e SWARM_M138::getGpsFixQualityRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -2140,8 +3180,7 @@ Swarm_M138_Error_e SWARM_M138::getGpsFixQualityRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2170,29 +3209,28 @@ Swarm_M138_Error_e SWARM_M138::setGpsFixQualityRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_GPS_FIX_QUAL) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_GPS_FIX_QUAL, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_GPS_FIX_QUAL, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_GPS_FIX_QUAL); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$GS OK*", "$GS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$GS OK*", "$GS ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2207,30 +3245,20 @@ Swarm_M138_Error_e SWARM_M138::setGpsFixQualityRate(uint32_t rate)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::powerOff(void)
 {
-  char *command;
   char *response;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_POWER_OFF) + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_POWER_OFF) + 5); // Clear it
-  sprintf(command, "%s*", SWARM_M138_COMMAND_POWER_OFF); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_POWER_OFF, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$PO OK*", "$PO ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$PO OK*", "$PO ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2246,83 +3274,99 @@ Swarm_M138_Error_e SWARM_M138::powerOff(void)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getPowerStatus(Swarm_M138_Power_Status_t *powerStatus)
 {
-  char *command;
+  Swarm_M138_Power_Status_Fixed_t fixed;
+  Swarm_M138_Error_e err = getPowerStatus(&fixed);
+  if (err == SWARM_M138_ERROR_SUCCESS)
+    swarm_m138_power_status_to_float(&fixed, powerStatus);
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the most recent $PW message in fixed-point
+    @param  powerStatus
+            A pointer to a Swarm_M138_Power_Status_Fixed_t struct which will hold the result.
+            All values are in thousandths (mV, thousandths of a degree C)
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getPowerStatus(Swarm_M138_Power_Status_Fixed_t *powerStatus)
+{
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_POWER_STAT) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_POWER_STAT) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_POWER_STAT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_POWER_STAT_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$PW ", "$PW ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$PW ", "$PW ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$PW ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 10))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the power status
-    int unused1H, unused2H, unused3H, cpu_voltsH, tempH;
-    char unused1L[8], unused2L[8], unused3L[8], cpu_voltsL[8], tempL[8];
-
-    int ret = sscanf(responseStart, "$PW %d.%[^,],%d.%[^,],%d.%[^,],%d.%[^,],%d.%[^,]*",
-                     &cpu_voltsH, cpu_voltsL, &unused1H, unused1L,
-                     &unused2H, unused2L, &unused3H, unused3L,
-                     &tempH, tempL);
+    if ((responseStart == NULL) || (swarm_m138_parse_power_status(responseStart, powerStatus) == false))
+      err = SWARM_M138_ERROR_ERROR;
+  }
 
-    if (ret < 10)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
+  swarm_m138_free_response(response);
+  return (err);
+}
 
-    if (cpu_voltsH >= 0)
-      powerStatus->cpu_volts = (float)cpu_voltsH + ((float)atol(cpu_voltsL) / pow(10, strlen(cpu_voltsL)));
-    else
-      powerStatus->cpu_volts = (float)cpu_voltsH - ((float)atol(cpu_voltsL) / pow(10, strlen(cpu_voltsL)));
-    if (unused1H >= 0)
-      powerStatus->unused1 = (float)unused1H + ((float)atol(unused1L) / pow(10, strlen(unused1L)));
-    else
-      powerStatus->unused1 = (float)unused1H - ((float)atol(unused1L) / pow(10, strlen(unused1L)));
-    if (unused2H >= 0)
-      powerStatus->unused2 = (float)unused2H + ((float)atol(unused2L) / pow(10, strlen(unused2L)));
-    else
-      powerStatus->unused2 = (float)unused2H - ((float)atol(unused2L) / pow(10, strlen(unused2L)));
-    if (unused3H >= 0)
-      powerStatus->unused3 = (float)unused3H + ((float)atol(unused3L) / pow(10, strlen(unused3L)));
-    else
-      powerStatus->unused3 = (float)unused3H - ((float)atol(unused3L) / pow(10, strlen(unused3L)));
-    if (tempH >= 0)
-      powerStatus->temp = (float)tempH + ((float)atol(tempL) / pow(10, strlen(tempL)));
-    else
-      powerStatus->temp = (float)tempH - ((float)atol(tempL) / pow(10, strlen(tempL)));
+/**************************************************************************/
+/*!
+    @brief  Get the cached $PW message if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  powerStatus
+            A pointer to a Swarm_M138_Power_Status_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getPowerStatus(Swarm_M138_Power_Status_t *powerStatus, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_PW, maxAge))
+  {
+    swarm_m138_power_status_to_float(&_cachedPowerStatus, powerStatus);
+    return (SWARM_M138_ERROR_SUCCESS);
   }
+  return (getPowerStatus(powerStatus));
+}
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
-  return (err);
+/**************************************************************************/
+/*!
+    @brief  Get the cached $PW message in fixed-point if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  powerStatus
+            A pointer to a Swarm_M138_Power_Status_Fixed_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getPowerStatus(Swarm_M138_Power_Status_Fixed_t *powerStatus, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_PW, maxAge))
+  {
+    memcpy(powerStatus, &_cachedPowerStatus, sizeof(Swarm_M138_Power_Status_Fixed_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getPowerStatus(powerStatus));
 }
 
 /**************************************************************************/
@@ -2337,29 +3381,20 @@ Swarm_M138_Error_e SWARM_M138::getPowerStatus(Swarm_M138_Power_Status_t *powerSt
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getPowerStatusRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_POWER_STAT) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_POWER_STAT) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_POWER_STAT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_POWER_STAT_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$PW ", "$PW ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$PW ", "$PW ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -2368,8 +3403,7 @@ Swarm_M138_Error_e SWARM_M138::getPowerStatusRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -2396,8 +3430,7 @@ Swarm_M138_Error_e SWARM_M138::getPowerStatusRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2426,29 +3459,28 @@ Swarm_M138_Error_e SWARM_M138::setPowerStatusRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_POWER_STAT) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_POWER_STAT) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_POWER_STAT) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_POWER_STAT, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_POWER_STAT, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_POWER_STAT); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$PW OK*", "$PW ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$PW OK*", "$PW ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2464,11 +3496,10 @@ Swarm_M138_Error_e SWARM_M138::setPowerStatusRate(uint32_t rate)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getTemperature(float *temperature)
 {
-  Swarm_M138_Power_Status_t *powerStatus = new Swarm_M138_Power_Status_t;
-  Swarm_M138_Error_e err = getPowerStatus(powerStatus);
+  Swarm_M138_Power_Status_t powerStatus;
+  Swarm_M138_Error_e err = getPowerStatus(&powerStatus);
   if (err == SWARM_M138_ERROR_SUCCESS)
-    *temperature = powerStatus->temp;
-  delete powerStatus;
+    *temperature = powerStatus.temp;
   return (err);
 }
 
@@ -2484,11 +3515,10 @@ Swarm_M138_Error_e SWARM_M138::getTemperature(float *temperature)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getCPUvoltage(float *voltage)
 {
-  Swarm_M138_Power_Status_t *powerStatus = new Swarm_M138_Power_Status_t;
-  Swarm_M138_Error_e err = getPowerStatus(powerStatus);
+  Swarm_M138_Power_Status_t powerStatus;
+  Swarm_M138_Error_e err = getPowerStatus(&powerStatus);
   if (err == SWARM_M138_ERROR_SUCCESS)
-    *voltage = powerStatus->cpu_volts;
-  delete powerStatus;
+    *voltage = powerStatus.cpu_volts;
   return (err);
 }
 
@@ -2505,35 +3535,20 @@ Swarm_M138_Error_e SWARM_M138::getCPUvoltage(float *voltage)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::restartDevice(bool deletedb)
 {
-  char *command;
   char *response;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  size_t msgLen = strlen(SWARM_M138_COMMAND_RESTART) + 5;
-  if (deletedb) msgLen += 9; // space deletedb
-  command = swarm_m138_alloc_char(msgLen);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, msgLen); // Clear it
-  if (deletedb)
-    sprintf(command, "%s deletedb*", SWARM_M138_COMMAND_RESTART); // Copy the command, add the asterix
-  else
-    sprintf(command, "%s*", SWARM_M138_COMMAND_RESTART); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(deletedb ? SWARM_M138_CMD_RESTART_DELETEDB : SWARM_M138_CMD_RESTART, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$RS OK*", "$RS ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$RS OK*", "$RS ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2549,98 +3564,56 @@ Swarm_M138_Error_e SWARM_M138::restartDevice(bool deletedb)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getReceiveTest(Swarm_M138_Receive_Test_t *rxTest)
 {
-  char *command;
   char *response;
   char *responseStart;
-  char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_RX_TEST) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_RX_TEST) + 7); // Clear it
-  sprintf(command, "%s @*", SWARM_M138_COMMAND_RX_TEST); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_RX_TEST_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
 
-  err = sendCommandWithResponse(command, "$RT ", "$RT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$RT ", "$RT ERR", response, SWARM_M138_RESPONSE_SIZE_MEDIUM);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
     responseStart = strstr(response, "$RT ");
-    if (responseStart != NULL)
-      responseEnd = strchr(responseStart, '*'); // Stop at the asterix
-    if ((responseStart == NULL) || (responseEnd == NULL) || (responseEnd < (responseStart + 9))) // Check we have enough data
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
-      return (SWARM_M138_ERROR_ERROR);
-    }
-
-    // Extract the receive test info
-    int rssi_bg = 0, rssi_sat = 0, snr = 0, fdev = 0;
-    int YYYY = 0, MM = 0, DD = 0, hh = 0, mm = 0, ss = 0;
-    uint32_t sat_ID = 0;
-
-    int ret = sscanf(responseStart, "$RT RSSI=%d,SNR=%d,FDEV=%d,TS=%d-%d-%dT%d:%d:%d,DI=0x",
-                     &rssi_sat, &snr, &fdev, &YYYY, &MM, &DD, &hh, &mm, &ss);
-
-    if (ret == 9)
-    {
-      responseStart = strstr(response, "DI=0x"); // Find the start of the satellite ID
-
-      // Extract the ID
-      responseStart += 5; // Point at the first digit
-      while (responseStart < responseEnd)
-      {
-        sat_ID <<= 4; // Shuffle the existing value along by 4 bits
-        char c = *responseStart; // Get the digit
-        if ((c >= '0') && (c <= '9'))
-          sat_ID |= c - '0';
-        else if ((c >= 'a') && (c <= 'f'))
-          sat_ID |= c + 10 - 'a';
-        else if ((c >= 'A') && (c <= 'F'))
-          sat_ID |= c + 10 - 'A';
-        responseStart++;
-      }
-    }
-    else // Try to extract just rssi_background
-    {
-      ret = sscanf(responseStart, "$RT RSSI=%d*", &rssi_bg);
-    }
-
-    if ((ret == 9) || (ret == 1)) // Check if we got valid data
-    {
-      rxTest->background = ret == 1;
-      rxTest->rssi_background = (int16_t)rssi_bg;
-      rxTest->rssi_sat = (int16_t)rssi_sat;
-      rxTest->snr = (int16_t)snr;
-      rxTest->fdev = (int16_t)fdev;
-      rxTest->time.YYYY = YYYY;
-      rxTest->time.MM = MM;
-      rxTest->time.DD = DD;
-      rxTest->time.hh = hh;
-      rxTest->time.mm = mm;
-      rxTest->time.ss = ss;
-      rxTest->sat_id = sat_ID;
-    }
-    else
+    if ((responseStart == NULL) || (swarm_m138_parse_receive_test(responseStart, rxTest) == false))
       err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Get the cached $RT message if it is no older than maxAge, otherwise get the most recent
+            The cache is updated by every valid sentence: unsolicited or a response.
+            Call checkUnsolicitedMsg (or any command) regularly to keep it fresh
+    @param  rxTest
+            A pointer to a Swarm_M138_Receive_Test_t struct which will hold the result
+    @param  maxAge
+            The maximum age of the cached message in milliseconds.
+            If the cached message is older than this - or there is none - the modem is queried
+    @return SWARM_M138_ERROR_SUCCESS if successful
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getReceiveTest(Swarm_M138_Receive_Test_t *rxTest, unsigned long maxAge)
+{
+  if (telemetryFresh(SWARM_M138_TELEMETRY_RT, maxAge))
+  {
+    memcpy(rxTest, &_cachedReceiveTest, sizeof(Swarm_M138_Receive_Test_t));
+    return (SWARM_M138_ERROR_SUCCESS);
+  }
+  return (getReceiveTest(rxTest));
+}
+
 /**************************************************************************/
 /*!
     @brief  Query the current $RT rate
@@ -2653,29 +3626,20 @@ Swarm_M138_Error_e SWARM_M138::getReceiveTest(Swarm_M138_Receive_Test_t *rxTest)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getReceiveTestRate(uint32_t *rate)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_RX_TEST) + 7);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_RX_TEST) + 7); // Clear it
-  sprintf(command, "%s ?*", SWARM_M138_COMMAND_RX_TEST); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_RX_TEST_GET_RATE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$RT ", "$RT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$RT ", "$RT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -2684,8 +3648,7 @@ Swarm_M138_Error_e SWARM_M138::getReceiveTestRate(uint32_t *rate)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -2712,8 +3675,7 @@ Swarm_M138_Error_e SWARM_M138::getReceiveTestRate(uint32_t *rate)
       *rate = theRate;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2742,29 +3704,28 @@ Swarm_M138_Error_e SWARM_M138::setReceiveTestRate(uint32_t rate)
     return (SWARM_M138_ERROR_INVALID_RATE);
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_RX_TEST) + 1 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_RX_TEST) + 1 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_RX_TEST) + 1 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s %u*", SWARM_M138_COMMAND_RX_TEST, rate); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s %lu*", SWARM_M138_COMMAND_RX_TEST, rate); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_RX_TEST); // Copy the command
+  *p++ = ' ';
+  p = swarm_m138_print_uint32(p, rate); // Add the rate
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$RT OK*", "$RT ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$RT OK*", "$RT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2786,29 +3747,28 @@ Swarm_M138_Error_e SWARM_M138::sleepMode(uint32_t seconds)
   Swarm_M138_Error_e err;
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 10 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 10 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 10 + 5); // Clear it
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-  sprintf(command, "%s S=%d*", SWARM_M138_COMMAND_SLEEP, seconds); // Copy the command, add the asterix
-#else
-  sprintf(command, "%s S=%ld*", SWARM_M138_COMMAND_SLEEP, seconds); // Copy the command, add the asterix
-#endif
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_SLEEP); // Copy the command
+  p = swarm_m138_print_text(p, " S=");
+  p = swarm_m138_print_uint32(p, seconds); // Add the seconds
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$SL OK*", "$SL ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$SL OK*", "$SL ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2830,71 +3790,55 @@ Swarm_M138_Error_e SWARM_M138::sleepMode(Swarm_M138_DateTimeData_t sleepUntil, b
 {
   char *command;
   char *response;
-  char *scratchpad;
   Swarm_M138_Error_e err;
 
   // Allocate memory for the command, rate, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 19 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 19 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_SLEEP) + 3 + 19 + 5); // Clear it
 
-  scratchpad = swarm_m138_alloc_char(16); // Create a scratchpad to hold the date/time
-  if (scratchpad == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(scratchpad, 0, 16); // Clear it
-
-  sprintf(command, "%s U=", SWARM_M138_COMMAND_SLEEP); // Copy the command
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_SLEEP); // Copy the command
+  p = swarm_m138_print_text(p, " U=");
 
-  // Note: some platforms do not support sprintf "%02d" correctly. We need to add the preceding zero manually...
+  // Note: the preceding zeros are added manually
 
   if (dateAndTime) // Check if we need to include the date
   {
-    sprintf(scratchpad, "%d", sleepUntil.YYYY); // Add the year
-    strcat(command, scratchpad);
-    strcat(command, "-");
-    sprintf(scratchpad, "%d", sleepUntil.MM); // Add the month
-    if (sleepUntil.MM < 10) strcat(command, "0");
-    strcat(command, scratchpad);
-    strcat(command, "-");
-    sprintf(scratchpad, "%d", sleepUntil.DD); // Add the day of month
-    if (sleepUntil.DD < 10) strcat(command, "0");
-    strcat(command, scratchpad);
-    strcat(command, "T");
-  }
-
-  sprintf(scratchpad, "%d", sleepUntil.hh); // Add the hour
-  if (sleepUntil.hh < 10) strcat(command, "0");
-  strcat(command, scratchpad);
-  strcat(command, ":");
-  sprintf(scratchpad, "%d", sleepUntil.mm); // Add the minute
-  if (sleepUntil.mm < 10) strcat(command, "0");
-  strcat(command, scratchpad);
-  strcat(command, ":");
-  sprintf(scratchpad, "%d", sleepUntil.ss); // Add the second
-  if (sleepUntil.ss < 10) strcat(command, "0");
-  strcat(command, scratchpad);
-
-  strcat(command, "*"); // Add the asterix
+    p = swarm_m138_print_uint32(p, sleepUntil.YYYY); // Add the year
+    *p++ = '-';
+    if (sleepUntil.MM < 10) *p++ = '0';
+    p = swarm_m138_print_uint32(p, sleepUntil.MM); // Add the month
+    *p++ = '-';
+    if (sleepUntil.DD < 10) *p++ = '0';
+    p = swarm_m138_print_uint32(p, sleepUntil.DD); // Add the day of month
+    *p++ = 'T';
+  }
+
+  if (sleepUntil.hh < 10) *p++ = '0';
+  p = swarm_m138_print_uint32(p, sleepUntil.hh); // Add the hour
+  *p++ = ':';
+  if (sleepUntil.mm < 10) *p++ = '0';
+  p = swarm_m138_print_uint32(p, sleepUntil.mm); // Add the minute
+  *p++ = ':';
+  if (sleepUntil.ss < 10) *p++ = '0';
+  p = swarm_m138_print_uint32(p, sleepUntil.ss); // Add the second
+
+  *p = '*'; // Append the asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(scratchpad);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$SL OK*", "$SL ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$SL OK*", "$SL ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(scratchpad);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -2914,32 +3858,20 @@ Swarm_M138_Error_e SWARM_M138::sleepMode(Swarm_M138_DateTimeData_t sleepUntil, b
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getRxMessageCount(uint16_t *count, bool unread)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9); // Clear it
-  if (unread)
-    sprintf(command, "%s C=U*", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  else
-    sprintf(command, "%s C=**", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(unread ? SWARM_M138_CMD_MSG_RX_MGMT_COUNT_UNREAD : SWARM_M138_CMD_MSG_RX_MGMT_COUNT_ALL, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM ", "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MM ", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -2948,8 +3880,7 @@ Swarm_M138_Error_e SWARM_M138::getRxMessageCount(uint16_t *count, bool unread)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -2981,8 +3912,7 @@ Swarm_M138_Error_e SWARM_M138::getRxMessageCount(uint16_t *count, bool unread)
     }
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3001,78 +3931,33 @@ Swarm_M138_Error_e SWARM_M138::deleteRxMessage(uint64_t msg_id)
 {
   char *command;
   char *response;
-  char *fwd;
-  char *rev;
-  Swarm_M138_Error_e err;
-
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5); // Clear it
-
-  // Allocate memory for the scratchpads
-  fwd = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (fwd == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(fwd, 0, 21); // Clear it
-  rev = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (rev == NULL)
-  {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(rev, 0, 21); // Clear it
-
-  sprintf(command, "%s D=", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
-
-  // Add the 64-bit message ID
-  // Based on printLLNumber by robtillaart
-  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
-  unsigned int i = 0;
-  if (msg_id == 0ULL) // if msg_id is zero, set fwd to "0"
-  {
-    fwd[0] = '0';
-  }
-  else
-  {
-    while (msg_id > 0)
-    {
-      rev[i++] = (msg_id % 10) + '0'; // divide by 10, convert the remainder to char
-      msg_id /= 10; // divide by 10
-    }
-    unsigned int j = 0;
-    while (i > 0)
-    {
-      fwd[j++] = rev[--i]; // reverse the order
-    }
-  }
-  strcat(command, fwd);
+  Swarm_M138_Error_e err;
+
+  // Allocate memory for the command, asterix, checksum bytes, \n and \0
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
+  if (command == NULL)
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5); // Clear it
 
-  strcat(command, "*"); // Append the asterix
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, " D=");
+  p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+  *p = '*'; // Append the asterix
 
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    swarm_m138_free_char(rev);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM DELETED", "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MM DELETED", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(fwd);
-  swarm_m138_free_char(rev);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3090,7 +3975,6 @@ Swarm_M138_Error_e SWARM_M138::deleteRxMessage(uint64_t msg_id)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::deleteAllRxMessages(bool read)
 {
-  char *command;
   char *response;
   char *scratchpad;
   Swarm_M138_Error_e err;
@@ -3112,46 +3996,35 @@ Swarm_M138_Error_e SWARM_M138::deleteAllRxMessages(bool read)
   if (read)
     msgTotal -= unreadTotal;
 
-  if (_printDebug == true)
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
   {
     _debugPort->print(F("deleteAllRxMessages: msgTotal is "));
     _debugPort->println(msgTotal);
   }
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9); // Clear it
-  if (read)
-    sprintf(command, "%s D=R*", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  else
-    sprintf(command, "%s D=**", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(read ? SWARM_M138_CMD_MSG_RX_MGMT_DELETE_READ : SWARM_M138_CMD_MSG_RX_MGMT_DELETE_ALL, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
   scratchpad = swarm_m138_alloc_char(16); // Create a scratchpad to hold the expectedResponse
   if (scratchpad == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(response);
+    swarm_m138_free_response(response);
     return (SWARM_M138_ERROR_MEM_ALLOC);
   }
   memset(scratchpad, 0, 16); // Clear it
 
-  sprintf(scratchpad, "$MM %d*", msgTotal); // Create the expected response
+  char *p = swarm_m138_print_text(scratchpad, "$MM "); // Create the expected response
+  p = swarm_m138_print_uint32(p, msgTotal);
+  swarm_m138_print_text(p, "*");
 
-  err = sendCommandWithResponse(command, scratchpad, "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
+  err = sendCommandWithResponse(command, scratchpad, "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   swarm_m138_free_char(scratchpad);
   return (err);
 }
@@ -3171,78 +4044,33 @@ Swarm_M138_Error_e SWARM_M138::markRxMessage(uint64_t msg_id)
 {
   char *command;
   char *response;
-  char *fwd;
-  char *rev;
   Swarm_M138_Error_e err;
 
   // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5); // Clear it
 
-  // Allocate memory for the scratchpads
-  fwd = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (fwd == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(fwd, 0, 21); // Clear it
-  rev = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (rev == NULL)
-  {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(rev, 0, 21); // Clear it
-
-  sprintf(command, "%s M=", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
-
-  // Add the 64-bit message ID
-  // Based on printLLNumber by robtillaart
-  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
-  unsigned int i = 0;
-  if (msg_id == 0ULL) // if msg_id is zero, set fwd to "0"
-  {
-    fwd[0] = '0';
-  }
-  else
-  {
-    while (msg_id > 0)
-    {
-      rev[i++] = (msg_id % 10) + '0'; // divide by 10, convert the remainder to char
-      msg_id /= 10; // divide by 10
-    }
-    unsigned int j = 0;
-    while (i > 0)
-    {
-      fwd[j++] = rev[--i]; // reverse the order
-    }
-  }
-  strcat(command, fwd);
-
-  strcat(command, "*"); // Append the asterix
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, " M=");
+  p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+  *p = '*'; // Append the asterix
 
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    swarm_m138_free_char(rev);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM MARKED", "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MM MARKED", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(fwd);
-  swarm_m138_free_char(rev);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3257,7 +4085,6 @@ Swarm_M138_Error_e SWARM_M138::markRxMessage(uint64_t msg_id)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::markAllRxMessages(void)
 {
-  char *command;
   char *response;
   char *scratchpad;
   Swarm_M138_Error_e err;
@@ -3267,37 +4094,29 @@ Swarm_M138_Error_e SWARM_M138::markAllRxMessages(void)
   if (err != SWARM_M138_ERROR_SUCCESS)
     return (err);
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9); // Clear it
-  sprintf(command, "%s M=**", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_MSG_RX_MGMT_MARK_ALL, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
   scratchpad = swarm_m138_alloc_char(16); // Create a scratchpad to hold the expectedResponse
   if (scratchpad == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(response);
+    swarm_m138_free_response(response);
     return (SWARM_M138_ERROR_MEM_ALLOC);
   }
   memset(scratchpad, 0, 16); // Clear it
 
-  sprintf(scratchpad, "$MM %d*", msgTotal); // Create the expected response
+  char *p = swarm_m138_print_text(scratchpad, "$MM "); // Create the expected response
+  p = swarm_m138_print_uint32(p, msgTotal);
+  swarm_m138_print_text(p, "*");
 
-  err = sendCommandWithResponse(command, scratchpad, "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, scratchpad, "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   swarm_m138_free_char(scratchpad);
   return (err);
 }
@@ -3315,27 +4134,18 @@ Swarm_M138_Error_e SWARM_M138::markAllRxMessages(void)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getMessageNotifications(bool *enabled)
 {
-  char *command;
   char *response;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9); // Clear it
-  sprintf(command, "%s N=?*", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_GET, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM N=", "$MM ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$MM N=", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -3344,8 +4154,7 @@ Swarm_M138_Error_e SWARM_M138::getMessageNotifications(bool *enabled)
       *enabled = *(enabledPtr + 6) == 'E';
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3363,33 +4172,20 @@ Swarm_M138_Error_e SWARM_M138::getMessageNotifications(bool *enabled)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::setMessageNotifications(bool enable)
 {
-  char *command;
   char *response;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 9); // Clear it
-  if (enable)
-    sprintf(command, "%s N=E*", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  else
-    sprintf(command, "%s N=D*", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(enable ? SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_ENABLE : SWARM_M138_CMD_MSG_RX_MGMT_NOTIFY_DISABLE, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM OK*", "$MM ERR", response, _RxBuffSize);
+  err = sendCommandWithResponse(command, "$MM OK*", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3490,8 +4286,6 @@ Swarm_M138_Error_e SWARM_M138::readMessageInternal(const char mode, uint64_t msg
 {
   char *command;
   char *response;
-  char *fwd;
-  char *rev;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
@@ -3499,79 +4293,32 @@ Swarm_M138_Error_e SWARM_M138::readMessageInternal(const char mode, uint64_t msg
   memset(asciiHex, 0, len); // Clear the char array
 
   // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5); // Clear it
 
-  if (mode == 'L')
-    sprintf(command, "%s L=", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
-  else
-    sprintf(command, "%s R=", SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
-
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, (mode == 'L') ? " L=" : " R=");
   if ((mode == 'L') || (mode == 'R')) // L=msgID or R=msgID
-  {
-    // Allocate memory for the scratchpads
-    fwd = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-    if (fwd == NULL)
-    {
-      swarm_m138_free_char(command);
-      return (SWARM_M138_ERROR_MEM_ALLOC);
-    }
-    memset(fwd, 0, 21); // Clear it
-    rev = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-    if (rev == NULL)
-    {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(fwd);
-      return (SWARM_M138_ERROR_MEM_ALLOC);
-    }
-    memset(rev, 0, 21); // Clear it
-
-    // Add the 64-bit message ID
-    // Based on printLLNumber by robtillaart
-    // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
-    unsigned int i = 0;
-    if (msg_id_in == 0ULL) // if msg_id is zero, set fwd to "0"
-    {
-      fwd[0] = '0';
-    }
-    else
-    {
-      while (msg_id_in > 0)
-      {
-        rev[i++] = (msg_id_in % 10) + '0'; // divide by 10, convert the remainder to char
-        msg_id_in /= 10; // divide by 10
-      }
-      unsigned int j = 0;
-      while (i > 0)
-      {
-        fwd[j++] = rev[--i]; // reverse the order
-      }
-    }
-    strcat(command, fwd);
-
-    swarm_m138_free_char(fwd);
-    swarm_m138_free_char(rev);
-  }
+    p = swarm_m138_print_uint64(p, msg_id_in); // Add the 64-bit message ID
   else if (mode == 'O') // R=O (Oldest)
-    strcat(command, "O");
+    *p++ = 'O';
   else // if (mode == 'N') // R=N (Newest)
-    strcat(command, "N");
-
-  strcat(command, "*"); // Append the asterix
+    *p++ = 'N';
+  *p = '*'; // Append the asterix
 
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE); // Clear it
 
-  err = sendCommandWithResponse(command, "$MM AI=", "$MM ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MM AI=", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -3658,8 +4405,126 @@ Swarm_M138_Error_e SWARM_M138::readMessageInternal(const char mode, uint64_t msg
       err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
+  return (err);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read - and optionally delete - the unread messages, oldest first.
+            Each message is decoded from ASCII Hex to binary and passed to the callback.
+            The commands are sent back-to-back, reusing one command buffer and one response buffer.
+            Draining stops when there are no more unread messages, maxCount messages have been read, or a command fails.
+    @param  callback
+            The function to be called for each message. data is only valid during the callback
+    @param  maxCount
+            The maximum number of messages to read
+    @param  deleteAfterRead
+            If true (default): each message is deleted after the callback returns
+            If false: each message is left in the database, marked as read
+    @param  context
+            Passed to the callback. Can be NULL.
+    @param  count
+            Optional: a pointer to a uint16_t which will hold the number of messages read
+    @return SWARM_M138_ERROR_SUCCESS if successful - including when there were no messages to read
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_BUSY if an asynchronous command is in progress
+            SWARM_M138_ERROR_ERR if a command ERR is received - error is returned in commandError
+            SWARM_M138_ERROR_ERROR if unsuccessful
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::drainRxMessages(void (*callback)(const uint8_t *data, size_t len, const uint64_t *msg_id,
+                                                                const uint32_t *epoch, const uint16_t *appID, void *context),
+                                               uint16_t maxCount, bool deleteAfterRead, void *context, uint16_t *count)
+{
+  char *command;
+  char *response;
+  Swarm_M138_Error_e err = SWARM_M138_ERROR_SUCCESS;
+  uint16_t numRead = 0;
+  bool drain = true; // Drain the serial port before the first command only
+
+  if (count != NULL)
+    *count = 0;
+
+  if (_asyncPending == true) // The modem can only process one command at a time
+    return (SWARM_M138_ERROR_BUSY);
+
+  // Allocate memory for the command, asterix, checksum bytes, \n and \0. It is reused for every command
+  size_t cmdLen = strlen(SWARM_M138_COMMAND_MSG_RX_MGMT) + 3 + 20 + 5;
+  command = swarm_m138_alloc_command(cmdLen);
+  if (command == NULL)
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE); // Allocate memory for the response. It is reused for every command
+  if (response == NULL)
+  {
+    swarm_m138_free_command(command);
+    return(SWARM_M138_ERROR_MEM_ALLOC);
+  }
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("drainRxMessages: ====>"));
+
+  while ((numRead < maxCount) && (err == SWARM_M138_ERROR_SUCCESS))
+  {
+    // Read the oldest unread message. The command buffer is big enough to hold the constant command
+    memset(response, 0, SWARM_M138_RESPONSE_SIZE); // Clear it
+
+    sendCommand(swarm_m138_const_command(SWARM_M138_CMD_MSG_RX_MGMT_READ_OLDEST, command), drain);
+    drain = false;
+
+    err = waitForResponse("$MM AI=", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE, SWARM_M138_MESSAGE_READ_TIMEOUT);
+
+    if (err == SWARM_M138_ERROR_ERR)
+    {
+      if (strstr(commandError, "DBX_NOMORE") != NULL) // No more messages. We're done
+        err = SWARM_M138_ERROR_SUCCESS;
+      break;
+    }
+    if (err != SWARM_M138_ERROR_SUCCESS)
+      break;
+
+    uint16_t appID;
+    const uint8_t *data;
+    size_t len;
+    uint64_t msg_id;
+    uint32_t epoch;
+    char *responseStart = strstr(response, "$MM AI="); // Find the start of the response
+    if ((responseStart == NULL) || (swarm_m138_decode_rx_message(responseStart, &appID, &data, &len, &msg_id, &epoch) == false))
+    {
+      err = SWARM_M138_ERROR_ERROR;
+      break;
+    }
+
+    numRead++;
+    if (callback != NULL)
+      callback(data, len, &msg_id, &epoch, &appID, context);
+
+    if (deleteAfterRead == true)
+    {
+      memset(command, 0, cmdLen); // Clear it
+      char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_RX_MGMT); // Copy the command
+      p = swarm_m138_print_text(p, " D=");
+      p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+      *p = '*'; // Append the asterix
+      addChecksumLF(command); // Add the checksum bytes and line feed
+      memset(response, 0, SWARM_M138_RESPONSE_SIZE); // Clear it
+
+      sendCommand(command, false);
+
+      err = waitForResponse("$MM DELETED", "$MM ERR", response, SWARM_M138_RESPONSE_SIZE, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
+    }
+  }
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("drainRxMessages: <===="));
+
+  if (count != NULL)
+    *count = numRead;
+
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3676,29 +4541,20 @@ Swarm_M138_Error_e SWARM_M138::readMessageInternal(const char mode, uint64_t msg
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::getUnsentMessageCount(uint16_t *count)
 {
-  char *command;
   char *response;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9); // Clear it
-  sprintf(command, "%s C=U*", SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_MSG_TX_MGMT_COUNT_UNSENT, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$MT ", "$MT ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MT ", "$MT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -3707,8 +4563,7 @@ Swarm_M138_Error_e SWARM_M138::getUnsentMessageCount(uint16_t *count)
       responseEnd = strchr(responseStart, '*'); // Stop at the asterix
     if ((responseStart == NULL) || (responseEnd == NULL))
     {
-      swarm_m138_free_char(command);
-      swarm_m138_free_char(response);
+      swarm_m138_free_response(response);
       return (SWARM_M138_ERROR_ERROR);
     }
 
@@ -3740,8 +4595,7 @@ Swarm_M138_Error_e SWARM_M138::getUnsentMessageCount(uint16_t *count)
     }
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3760,78 +4614,36 @@ Swarm_M138_Error_e SWARM_M138::deleteTxMessage(uint64_t msg_id)
 {
   char *command;
   char *response;
-  char *fwd;
-  char *rev;
   Swarm_M138_Error_e err;
 
   // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5); // Clear it
 
-  // Allocate memory for the scratchpads
-  fwd = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (fwd == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(fwd, 0, 21); // Clear it
-  rev = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (rev == NULL)
-  {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(rev, 0, 21); // Clear it
-
-  sprintf(command, "%s D=", SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command
-
-  // Add the 64-bit message ID
-  // Based on printLLNumber by robtillaart
-  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
-  unsigned int i = 0;
-  if (msg_id == 0ULL) // if msg_id is zero, set fwd to "0"
-  {
-    fwd[0] = '0';
-  }
-  else
-  {
-    while (msg_id > 0)
-    {
-      rev[i++] = (msg_id % 10) + '0'; // divide by 10, convert the remainder to char
-      msg_id /= 10; // divide by 10
-    }
-    unsigned int j = 0;
-    while (i > 0)
-    {
-      fwd[j++] = rev[--i]; // reverse the order
-    }
-  }
-  strcat(command, fwd);
-
-  strcat(command, "*"); // Append the asterix
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, " D=");
+  p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+  *p = '*'; // Append the asterix
 
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    swarm_m138_free_char(rev);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
+
+  err = sendCommandWithResponse(command, "$MT DELETED", "$MT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
 
-  err = sendCommandWithResponse(command, "$MT DELETED", "$MT ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
+  if ((err == SWARM_M138_ERROR_SUCCESS) && (_txLedger != NULL))
+    _txLedger->markDeleted(msg_id);
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(fwd);
-  swarm_m138_free_char(rev);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -3846,7 +4658,6 @@ Swarm_M138_Error_e SWARM_M138::deleteTxMessage(uint64_t msg_id)
 /**************************************************************************/
 Swarm_M138_Error_e SWARM_M138::deleteAllTxMessages(void)
 {
-  char *command;
   char *response;
   char *scratchpad;
   Swarm_M138_Error_e err;
@@ -3856,43 +4667,38 @@ Swarm_M138_Error_e SWARM_M138::deleteAllTxMessages(void)
   if (err != SWARM_M138_ERROR_SUCCESS)
     return (err);
 
-  if (_printDebug == true)
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
   {
     _debugPort->print(F("deleteAllTxMessages: msgTotal is "));
     _debugPort->println(msgTotal);
   }
 
-  // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9); // Clear it
-  sprintf(command, "%s D=U*", SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command, add the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  const char *command = swarm_m138_const_command(SWARM_M138_CMD_MSG_TX_MGMT_DELETE_UNSENT, buffer);
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
   scratchpad = swarm_m138_alloc_char(16); // Create a scratchpad to hold the expectedResponse
   if (scratchpad == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(response);
+    swarm_m138_free_response(response);
     return (SWARM_M138_ERROR_MEM_ALLOC);
   }
   memset(scratchpad, 0, 16); // Clear it
 
-  sprintf(scratchpad, "$MT %d*", msgTotal); // Create the expected response
+  char *p = swarm_m138_print_text(scratchpad, "$MT "); // Create the expected response
+  p = swarm_m138_print_uint32(p, msgTotal);
+  swarm_m138_print_text(p, "*");
+
+  err = sendCommandWithResponse(command, scratchpad, "$MT ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
 
-  err = sendCommandWithResponse(command, scratchpad, "$MT ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_DELETE_TIMEOUT);
+  if ((err == SWARM_M138_ERROR_SUCCESS) && (_txLedger != NULL))
+    _txLedger->markAllDeleted();
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(response);
+  swarm_m138_free_response(response);
   swarm_m138_free_char(scratchpad);
   return (err);
 }
@@ -3920,8 +4726,6 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 {
   char *command;
   char *response;
-  char *fwd;
-  char *rev;
   char *responseStart;
   char *responseEnd = NULL;
   Swarm_M138_Error_e err;
@@ -3929,68 +4733,27 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
   memset(asciiHex, 0, len); // Clear the char array
 
   // Allocate memory for the command, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5);
+  command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 3 + 20 + 5); // Clear it
 
-  // Allocate memory for the scratchpads
-  fwd = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (fwd == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(fwd, 0, 21); // Clear it
-  rev = swarm_m138_alloc_char(21); // Up to 20 digits plus null
-  if (rev == NULL)
-  {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(rev, 0, 21); // Clear it
-
-  sprintf(command, "%s L=", SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command
-
-  // Add the 64-bit message ID
-  // Based on printLLNumber by robtillaart
-  // https://forum.arduino.cc/index.php?topic=143584.msg1519824#msg1519824
-  unsigned int i = 0;
-  if (msg_id == 0ULL) // if msg_id is zero, set fwd to "0"
-  {
-    fwd[0] = '0';
-  }
-  else
-  {
-    while (msg_id > 0)
-    {
-      rev[i++] = (msg_id % 10) + '0'; // divide by 10, convert the remainder to char
-      msg_id /= 10; // divide by 10
-    }
-    unsigned int j = 0;
-    while (i > 0)
-    {
-      fwd[j++] = rev[--i]; // reverse the order
-    }
-  }
-  strcat(command, fwd);
-
-  strcat(command, "*"); // Append the asterix
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_MSG_TX_MGMT); // Copy the command
+  p = swarm_m138_print_text(p, " L=");
+  p = swarm_m138_print_uint64(p, msg_id); // Add the 64-bit message ID
+  *p = '*'; // Append the asterix
 
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(fwd);
-    swarm_m138_free_char(rev);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE); // Clear it
 
-  err = sendCommandWithResponse(command, "$MT ", "$MT ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_READ_TIMEOUT);
+  err = sendCommandWithResponse(command, "$MT ", "$MT ERR", response, SWARM_M138_RESPONSE_SIZE, SWARM_M138_MESSAGE_READ_TIMEOUT);
 
   if (err == SWARM_M138_ERROR_SUCCESS)
   {
@@ -4066,10 +4829,8 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
       err = SWARM_M138_ERROR_ERROR;
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(fwd);
-  swarm_m138_free_char(rev);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -4130,7 +4891,7 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 //     return (SWARM_M138_ERROR_ERROR);
 
 //   // Allocate memory for the response
-//   response = swarm_m138_alloc_char(_RxBuffSize);
+//   response = swarm_m138_alloc_response(_RxBuffSize);
 //   if (response == NULL)
 //   {
 //     return(SWARM_M138_ERROR_MEM_ALLOC);
@@ -4138,10 +4899,10 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 //   memset(response, 0, _RxBuffSize); // Clear it
 
 //   // Allocate memory for the command, asterix, checksum bytes, \n and \0
-//   command = swarm_m138_alloc_char(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9);
+//   command = swarm_m138_alloc_command(strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9);
 //   if (command == NULL)
 //   {
-//     swarm_m138_free_char(response);
+//     swarm_m138_free_response(response);
 //     return (SWARM_M138_ERROR_MEM_ALLOC);
 //   }
 //   memset(command, 0, strlen(SWARM_M138_COMMAND_MSG_TX_MGMT) + 9); // Clear it
@@ -4156,7 +4917,7 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 
 //   sendCommand(command); // Send the command
 
-//   swarm_m138_free_char(command); // Free command now - we are done with it
+//   swarm_m138_free_command(command); // Free command now - we are done with it
 
 //   unsigned long startTime = millis();
 //   bool keepGoing = true;
@@ -4257,7 +5018,7 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 //           else // Response is full... We are stuck... And we are still in the for loop...
 //           {
 //             swarm_m138_free_char(rxBuff);
-//             swarm_m138_free_char(response);
+//             swarm_m138_free_response(response);
 //             return (SWARM_M138_ERROR_ERROR);
 //           }
 //         }
@@ -4273,7 +5034,7 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 //       delay(1);
 //   }
 
-//   swarm_m138_free_char(response);
+//   swarm_m138_free_response(response);
 
 //   // if (_printDebug == true)
 //   // {
@@ -4284,6 +5045,110 @@ Swarm_M138_Error_e SWARM_M138::listTxMessage(uint64_t msg_id, char *asciiHex, si
 //   return (err);
 // }
 
+/**************************************************************************/
+/*!
+    @brief  Read several - by default all - of the modem's status messages and message counts in one call:
+            $DT, $GN, $GS, $PW, $GJ and $RT, plus the received, unread and unsent message counts.
+            The queries are sent back to back: the serial port is drained once, before the first query,
+            and each query is sent as soon as the previous response arrives. All share one response buffer.
+            The responses also refresh the telemetry cache used by getDateTime(dateTime, maxAge) etc.
+    @param  snapshot
+            A pointer to a Swarm_M138_Modem_Snapshot_t struct which will hold the results.
+            snapshot->valid has a SWARM_M138_SNAPSHOT_ bit set for each field which was read successfully
+    @param  fields
+            The SWARM_M138_SNAPSHOT_ fields to be read. Default is SWARM_M138_SNAPSHOT_ALL
+    @return SWARM_M138_ERROR_SUCCESS if every field was read successfully - otherwise the first error
+            SWARM_M138_ERROR_BUSY if an asynchronous command is in progress
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_ERR if a command ERR is received - error is returned in commandError
+            SWARM_M138_ERROR_TIMEOUT if the modem stops responding. The remaining fields are not read
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::getModemSnapshot(Swarm_M138_Modem_Snapshot_t *snapshot, uint16_t fields)
+{
+  char *response;
+  char buffer[SWARM_M138_CONST_COMMAND_SIZE]; // Use the stack, not the heap
+  Swarm_M138_Error_e err = SWARM_M138_ERROR_SUCCESS;
+  Swarm_M138_Error_e firstErr = SWARM_M138_ERROR_SUCCESS;
+  bool drain = true; // Drain the serial port before the first query only
+
+  memset(snapshot, 0, sizeof(Swarm_M138_Modem_Snapshot_t)); // Clear it
+
+  if (_asyncPending == true) // The modem can only process one command at a time
+    return (SWARM_M138_ERROR_BUSY);
+
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_MEDIUM); // Allocate memory for the response. It is reused for every query
+  if (response == NULL)
+    return (SWARM_M138_ERROR_MEM_ALLOC);
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("getModemSnapshot: ====>"));
+
+  for (uint8_t i = 0; (i < SWARM_M138_SNAPSHOT_FIELDS) && (err != SWARM_M138_ERROR_TIMEOUT); i++)
+  {
+    uint16_t field = (uint16_t)(1 << i);
+    if ((fields & field) == 0)
+      continue;
+
+    const char *command;
+    const char *expectedResponseStart;
+    const char *expectedErrorStart;
+    unsigned long timeout = SWARM_M138_STANDARD_RESPONSE_TIMEOUT;
+
+    switch (field)
+    {
+    case SWARM_M138_SNAPSHOT_DATE_TIME: command = SWARM_M138_CMD_DATE_TIME_STAT_GET; expectedResponseStart = "$DT "; expectedErrorStart = "$DT ERR"; break;
+    case SWARM_M138_SNAPSHOT_GEOSPATIAL: command = SWARM_M138_CMD_GEOSPATIAL_INFO_GET; expectedResponseStart = "$GN "; expectedErrorStart = "$GN ERR"; break;
+    case SWARM_M138_SNAPSHOT_GPS_FIX_QUALITY: command = SWARM_M138_CMD_GPS_FIX_QUAL_GET; expectedResponseStart = "$GS "; expectedErrorStart = "$GS ERR"; break;
+    case SWARM_M138_SNAPSHOT_POWER_STATUS: command = SWARM_M138_CMD_POWER_STAT_GET; expectedResponseStart = "$PW "; expectedErrorStart = "$PW ERR"; break;
+    case SWARM_M138_SNAPSHOT_GPS_JAMMING: command = SWARM_M138_CMD_GPS_JAMMING_GET; expectedResponseStart = "$GJ "; expectedErrorStart = "$GJ ERR"; break;
+    case SWARM_M138_SNAPSHOT_RECEIVE_TEST: command = SWARM_M138_CMD_RX_TEST_GET; expectedResponseStart = "$RT "; expectedErrorStart = "$RT ERR"; break;
+    case SWARM_M138_SNAPSHOT_RX_COUNT: command = SWARM_M138_CMD_MSG_RX_MGMT_COUNT_ALL; expectedResponseStart = "$MM "; expectedErrorStart = "$MM ERR"; timeout = SWARM_M138_MESSAGE_READ_TIMEOUT; break;
+    case SWARM_M138_SNAPSHOT_RX_UNREAD_COUNT: command = SWARM_M138_CMD_MSG_RX_MGMT_COUNT_UNREAD; expectedResponseStart = "$MM "; expectedErrorStart = "$MM ERR"; timeout = SWARM_M138_MESSAGE_READ_TIMEOUT; break;
+    default: command = SWARM_M138_CMD_MSG_TX_MGMT_COUNT_UNSENT; expectedResponseStart = "$MT "; expectedErrorStart = "$MT ERR"; timeout = SWARM_M138_MESSAGE_READ_TIMEOUT; break; // SWARM_M138_SNAPSHOT_UNSENT_COUNT
+    }
+
+    memset(response, 0, SWARM_M138_RESPONSE_SIZE_MEDIUM); // Clear it
+
+    sendCommand(swarm_m138_const_command(command, buffer), drain);
+    drain = false;
+
+    err = waitForResponse(expectedResponseStart, expectedErrorStart, response, SWARM_M138_RESPONSE_SIZE_MEDIUM, timeout);
+
+    if (err == SWARM_M138_ERROR_SUCCESS)
+    {
+      const char *responseStart = strstr(response, expectedResponseStart); // The parsers pass a NULL straight through
+      bool parsed;
+      switch (field)
+      {
+      case SWARM_M138_SNAPSHOT_DATE_TIME: parsed = swarm_m138_parse_date_time(responseStart, &snapshot->dateTime); break;
+      case SWARM_M138_SNAPSHOT_GEOSPATIAL: parsed = swarm_m138_parse_geospatial(responseStart, &snapshot->geospatial); break;
+      case SWARM_M138_SNAPSHOT_GPS_FIX_QUALITY: parsed = swarm_m138_parse_gps_fix_quality(responseStart, &snapshot->gpsFixQuality); break;
+      case SWARM_M138_SNAPSHOT_POWER_STATUS: parsed = swarm_m138_parse_power_status(responseStart, &snapshot->powerStatus); break;
+      case SWARM_M138_SNAPSHOT_GPS_JAMMING: parsed = swarm_m138_parse_gps_jamming(responseStart, &snapshot->gpsJamming); break;
+      case SWARM_M138_SNAPSHOT_RECEIVE_TEST: parsed = swarm_m138_parse_receive_test(responseStart, &snapshot->receiveTest); break;
+      case SWARM_M138_SNAPSHOT_RX_COUNT: parsed = swarm_m138_parse_count(responseStart, "$MM ", &snapshot->rxCount); break;
+      case SWARM_M138_SNAPSHOT_RX_UNREAD_COUNT: parsed = swarm_m138_parse_count(responseStart, "$MM ", &snapshot->rxUnreadCount); break;
+      default: parsed = swarm_m138_parse_count(responseStart, "$MT ", &snapshot->unsentCount); break; // SWARM_M138_SNAPSHOT_UNSENT_COUNT
+      }
+
+      if (parsed)
+        snapshot->valid |= field;
+      else
+        err = SWARM_M138_ERROR_ERROR;
+    }
+
+    if ((err != SWARM_M138_ERROR_SUCCESS) && (firstErr == SWARM_M138_ERROR_SUCCESS))
+      firstErr = err; // Keep going: the other fields may still be readable
+  }
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("getModemSnapshot: <===="));
+
+  swarm_m138_free_response(response);
+  return (firstErr);
+}
+
 /**************************************************************************/
 /*!
     @brief  Queue a printable text message for transmission
@@ -4421,7 +5286,6 @@ Swarm_M138_Error_e SWARM_M138::transmitText(const char *data, uint64_t *msg_id,
 {
   char *command;
   char *response;
-  char *scratchpad;
   Swarm_M138_Error_e err;
 
   // Calculate the possible message length
@@ -4434,65 +5298,45 @@ Swarm_M138_Error_e SWARM_M138::transmitText(const char *data, uint64_t *msg_id,
   msgLen += 5; // asterix, checksum chars, line feed, null
 
   // Allocate memory for the command, message, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(msgLen);
+  command = swarm_m138_alloc_command(msgLen);
   if (command == NULL)
     return (SWARM_M138_ERROR_MEM_ALLOC);
   memset(command, 0, msgLen); // Clear it
 
-  // Allocate memory for the scratchpad
-  scratchpad = swarm_m138_alloc_char(16);
-  if (scratchpad == NULL)
-  {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(scratchpad, 0, 16); // Clear it
-
-  sprintf(command, "%s ", SWARM_M138_COMMAND_TX_DATA); // Copy the command. Append the space
+  char *p = swarm_m138_print_text(command, SWARM_M138_COMMAND_TX_DATA); // Copy the command
+  *p++ = ' '; // Append the space
   if (useAppID)
   {
-    strcat(command, "AI=");
-    sprintf(scratchpad, "%d", appID);
-    strcat(command, scratchpad);
-    strcat(command, ",");
+    p = swarm_m138_print_text(p, "AI=");
+    p = swarm_m138_print_uint32(p, appID);
+    *p++ = ',';
   }
   if (useHold)
   {
-    strcat(command, "HD=");
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-    sprintf(scratchpad, "%d", hold);
-#else
-    sprintf(scratchpad, "%ld", hold);
-#endif
-    strcat(command, scratchpad);
-    strcat(command, ",");
+    p = swarm_m138_print_text(p, "HD=");
+    p = swarm_m138_print_uint32(p, hold);
+    *p++ = ',';
   }
   if (useEpoch)
   {
-    strcat(command, "ET=");
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-    sprintf(scratchpad, "%d", epoch);
-#else
-    sprintf(scratchpad, "%ld", epoch);
-#endif
-    strcat(command, scratchpad);
-    strcat(command, ",");
+    p = swarm_m138_print_text(p, "ET=");
+    p = swarm_m138_print_uint32(p, epoch);
+    *p++ = ',';
   }
-  strcat(command, "\""); // Append the quote  
-  strcat(command, data); // Append the message
-  strcat(command, "\"*"); // Append the quote and asterix
+  *p++ = '\"'; // Append the quote
+  p = swarm_m138_print_text(p, data); // Append the message
+  swarm_m138_print_text(p, "\"*"); // Append the quote and asterix
   addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT); // Allocate memory for the response
   if (response == NULL)
   {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(scratchpad);
+    swarm_m138_free_command(command);
     return(SWARM_M138_ERROR_MEM_ALLOC);
   }
-  memset(response, 0, _RxBuffSize); // Clear it
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  err = sendCommandWithResponse(command, "$TD OK,", "$TD ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT);
+  err = sendCommandWithResponse(command, "$TD OK,", "$TD ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT);
 
   if (err == SWARM_M138_ERROR_SUCCESS) // Check if we got $TD OK
   {
@@ -4514,13 +5358,13 @@ Swarm_M138_Error_e SWARM_M138::transmitText(const char *data, uint64_t *msg_id,
         }
 
         *msg_id = theID;
+        ledgerQueued(theID, useAppID, appID, useHold, hold, useEpoch, epoch);
       }
     }
   }
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(scratchpad);
-  swarm_m138_free_char(response);
+  swarm_m138_free_command(command);
+  swarm_m138_free_response(response);
   return (err);
 }
 
@@ -4666,121 +5510,278 @@ Swarm_M138_Error_e SWARM_M138::transmitBinaryExpire(const uint8_t *data, size_t
   return (transmitBinary(data, len, msg_id, true, appID, false, 0, true, epoch));
 }
 
+/**************************************************************************/
+/*!
+    @brief  Queue a batch of binary messages for transmission.
+            The commands are sent back-to-back: each as soon as the previous $TD OK (or ERR) arrives.
+            One command buffer and one response buffer are used for the whole batch.
+            If the modem stops responding (timeout), the remaining messages are not sent.
+    @param  messages
+            A pointer to an array of Swarm_M138_Tx_Descriptor_t. A hold or epoch of zero is not used
+    @param  count
+            The number of messages
+    @param  msg_ids
+            Optional: a pointer to an array of count uint64_t which will hold the assigned message IDs
+    @param  status
+            Optional: a pointer to an array of count Swarm_M138_Error_e which will hold the result for each message.
+            Messages which were not sent are marked SWARM_M138_ERROR_ERROR
+    @return SWARM_M138_ERROR_SUCCESS if every message was queued - otherwise the first error
+            SWARM_M138_ERROR_MEM_ALLOC if the memory allocation fails
+            SWARM_M138_ERROR_BUSY if an asynchronous command is in progress
+*/
+/**************************************************************************/
+Swarm_M138_Error_e SWARM_M138::transmitBatch(const Swarm_M138_Tx_Descriptor_t *messages, size_t count, uint64_t *msg_ids,
+                                           Swarm_M138_Error_e *status)
+{
+  char *response;
+  Swarm_M138_Error_e err = SWARM_M138_ERROR_SUCCESS;
+  bool drain = true; // Drain the serial port before the first command only
+  bool timedOut = false;
+
+  if (_asyncPending == true) // The modem can only process one command at a time
+    return (SWARM_M138_ERROR_BUSY);
+
+  // The commands are streamed, so only the response buffer is needed. It is reused for every message
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT);
+  if (response == NULL)
+    return(SWARM_M138_ERROR_MEM_ALLOC);
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("transmitBatch: ====>"));
+
+  for (size_t i = 0; i < count; i++)
+  {
+    Swarm_M138_Error_e thisErr = SWARM_M138_ERROR_ERROR;
+    const Swarm_M138_Tx_Descriptor_t *message = &messages[i];
+
+    if ((timedOut == false) && (message->len <= SWARM_M138_MAX_PACKET_LENGTH_BYTES))
+    {
+      memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
+
+      if (drain == true)
+        rxWindowDrain();
+      drain = false;
+      sendTransmitBinaryCommand(message->data, message->len, message->useAppID, message->appID,
+                                message->hold > 0, message->hold, message->epoch > 0, message->epoch);
+
+      thisErr = waitForResponse("$TD OK,", "$TD ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT);
+
+      if (thisErr == SWARM_M138_ERROR_SUCCESS)
+      {
+        uint64_t theID = 0;
+        if (swarm_m138_parse_transmit_ok(response, &theID) == false)
+          thisErr = SWARM_M138_ERROR_ERROR;
+        else
+        {
+          if (msg_ids != NULL)
+            msg_ids[i] = theID;
+          ledgerQueued(theID, message->useAppID, message->appID, message->hold > 0, message->hold, message->epoch > 0, message->epoch);
+        }
+      }
+      else if (thisErr == SWARM_M138_ERROR_TIMEOUT)
+        timedOut = true; // Don't try the rest
+    }
+
+    if (status != NULL)
+      status[i] = thisErr;
+    if ((thisErr != SWARM_M138_ERROR_SUCCESS) && (err == SWARM_M138_ERROR_SUCCESS))
+      err = thisErr; // Record the first error
+  }
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("transmitBatch: <===="));
+
+  swarm_m138_free_response(response);
+  return (err);
+}
+
 // Queue a binary message for transmission
 // Return the allocated message ID in msg_id
 Swarm_M138_Error_e SWARM_M138::transmitBinary(const uint8_t *data, size_t len, uint64_t *msg_id, bool useAppID, uint16_t appID,
                                             bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch)
 {
-  char *command;
   char *response;
-  char *scratchpad;
   Swarm_M138_Error_e err;
 
-  // Calculate the possible message length
-  size_t msgLen = strlen(SWARM_M138_COMMAND_TX_DATA); // $TD
-  msgLen += 1; // Space
-  if (useAppID) msgLen += 3 + 5 + 1; // AI=65535,
-  if (useHold) msgLen += 3 + 8 + 1; // HD=34819200,
-  if (useEpoch) msgLen += 3 + 10 + 1; // ET=2147483647,
-  msgLen += 2 * len; // The message length in ASCII Hex
-  msgLen += 5; // asterix, checksum chars, line feed, null
+  if (_asyncPending == true) // The modem can only process one command at a time
+    return (SWARM_M138_ERROR_BUSY);
 
-  // Allocate memory for the command, message, asterix, checksum bytes, \n and \0
-  command = swarm_m138_alloc_char(msgLen);
-  if (command == NULL)
-    return (SWARM_M138_ERROR_MEM_ALLOC);
-  memset(command, 0, msgLen); // Clear it
+  // The command is streamed, so only the response buffer is needed
+  response = swarm_m138_alloc_response(SWARM_M138_RESPONSE_SIZE_SHORT);
+  if (response == NULL)
+    return(SWARM_M138_ERROR_MEM_ALLOC);
+  memset(response, 0, SWARM_M138_RESPONSE_SIZE_SHORT); // Clear it
 
-  // Allocate memory for the scratchpad
-  scratchpad = swarm_m138_alloc_char(16);
-  if (scratchpad == NULL)
+  rxWindowDrain(); // Sending the command needs to dump data to the backlog buffer as well
+  sendTransmitBinaryCommand(data, len, useAppID, appID, useHold, hold, useEpoch, epoch);
+
+  err = waitForResponse("$TD OK,", "$TD ERR", response, SWARM_M138_RESPONSE_SIZE_SHORT, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT);
+
+  if (err == SWARM_M138_ERROR_SUCCESS) // Check if we got $TD OK
   {
-    swarm_m138_free_char(command);
-    return (SWARM_M138_ERROR_MEM_ALLOC);
+    char *idStart = strstr(response, "$TD OK,");
+    if ((idStart != NULL) && (swarm_m138_parse_transmit_ok(idStart, msg_id)))
+      ledgerQueued(*msg_id, useAppID, appID, useHold, hold, useEpoch, epoch);
   }
-  memset(scratchpad, 0, 16); // Clear it
 
-  sprintf(command, "%s ", SWARM_M138_COMMAND_TX_DATA); // Copy the command. Append the space
+  swarm_m138_free_response(response);
+  return (err);
+}
+
+// Stream the $TD command for binary data, including the checksum bytes and line feed.
+// The data is converted to ASCII Hex in small chunks and the checksum is accumulated on the way,
+// so no buffer proportional to the message length is needed
+void SWARM_M138::sendTransmitBinaryCommand(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                                           bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch)
+{
+  char chunk[SWARM_M138_TX_CHUNK_SIZE]; // Use the stack, not the heap
+  char *p = chunk;
+
+  // Build the start of the command: $TD AI=65535,HD=34819200,ET=2147483647,
+  strcpy(chunk, SWARM_M138_COMMAND_TX_DATA); // Copy the command
+  p += strlen(chunk);
+  *p++ = ' '; // Append the space
   if (useAppID)
   {
-    strcat(command, "AI=");
-    sprintf(scratchpad, "%d", appID);
-    strcat(command, scratchpad);
-    strcat(command, ",");
+    memcpy(p, "AI=", 3);
+    p = swarm_m138_print_uint64(p + 3, appID);
+    *p++ = ',';
   }
   if (useHold)
   {
-    strcat(command, "HD=");
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-    sprintf(scratchpad, "%d", hold);
-#else
-    sprintf(scratchpad, "%ld", hold);
-#endif
-    strcat(command, scratchpad);
-    strcat(command, ",");
+    memcpy(p, "HD=", 3);
+    p = swarm_m138_print_uint64(p + 3, hold);
+    *p++ = ',';
   }
   if (useEpoch)
   {
-    strcat(command, "ET=");
-#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
-    sprintf(scratchpad, "%d", epoch);
-#else
-    sprintf(scratchpad, "%ld", epoch);
-#endif
-    strcat(command, scratchpad);
-    strcat(command, ",");
-  }
-  for (size_t i = 0; i < len; i++)
-  {
-    char c1 = (data[i] >> 4) + '0'; // Convert the MS nibble to ASCII
-    if (c1 >= ':') c1 = c1 + 'A' - ':';
-    char c2 = (data[i] & 0x0F) + '0'; // Convert the LS nibble to ASCII
-    if (c2 >= ':') c2 = c2 + 'A' - ':';
-    sprintf(scratchpad, "%c%c", c1, c2);
-    strcat(command, scratchpad); // Append each data byte as an ASCII Hex char pair
+    memcpy(p, "ET=", 3);
+    p = swarm_m138_print_uint64(p + 3, epoch);
+    *p++ = ',';
   }
-  strcat(command, "*"); // Append the asterix
-  addChecksumLF(command); // Add the checksum bytes and line feed
 
-  response = swarm_m138_alloc_char(_RxBuffSize); // Allocate memory for the response
-  if (response == NULL)
-  {
-    swarm_m138_free_char(command);
-    swarm_m138_free_char(scratchpad);
-    return(SWARM_M138_ERROR_MEM_ALLOC);
-  }
-  memset(response, 0, _RxBuffSize); // Clear it
+  uint8_t checksum = 0;
+  for (const char *c = chunk + 1; c < p; c++) // Checksum everything after the $
+    checksum ^= (uint8_t)*c;
 
-  err = sendCommandWithResponse(command, "$TD OK,", "$TD ERR", response, _RxBuffSize, SWARM_M138_MESSAGE_TRANSMIT_TIMEOUT);
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->print(F("sendTransmitBinaryCommand: Command: "));
 
-  if (err == SWARM_M138_ERROR_SUCCESS) // Check if we got $TD OK
+  // The total length is known up front: the start, the ASCII Hex, the asterix, the checksum chars and the line feed
+  hwWriteStreamBegin((size_t)(p - chunk) + (2 * len) + 4);
+
+  for (size_t i = 0; i < len; i++)
   {
-    char *idStart = strstr(response, "$TD OK,");
-    if (idStart != NULL)
+    if ((p - chunk) > (SWARM_M138_TX_CHUNK_SIZE - 6)) // Keep room for the next hex pair - and the asterix, checksum and line feed
     {
-      char *idEnd = strchr(idStart, '*'); // Look for the asterix
-      if (idEnd != NULL)
-      {
-        uint64_t theID = 0;
+      hwWriteStreamChunk(chunk, p - chunk);
+      p = chunk;
+    }
+    char c1 = swarm_m138_hex_upper[data[i] >> 4]; // Convert the MS nibble to ASCII
+    char c2 = swarm_m138_hex_upper[data[i] & 0x0F]; // Convert the LS nibble to ASCII
+    checksum ^= (uint8_t)c1 ^ (uint8_t)c2;
+    *p++ = c1;
+    *p++ = c2;
+  }
+
+  *p++ = '*'; // Append the asterix
+  *p++ = swarm_m138_hex_lower[checksum >> 4]; // Append the checksum bytes
+  *p++ = swarm_m138_hex_lower[checksum & 0x0F];
+  *p++ = '\n'; // Append the line feed
+  hwWriteStreamChunk(chunk, p - chunk);
+}
 
-        idStart += 7; // Point at the first digit of the ID
+/**************************************************************************/
+/*!
+    @brief  Enable or disable the event counters. While disabled, $TD and $SL messages are only
+            parsed if a callback is set (or, for $TD, a TX ledger is attached)
+    @param  enable
+            true to count every $TD SENT and $SL WAKE message
+*/
+/**************************************************************************/
+void SWARM_M138::enableEventCounting(bool enable)
+{
+  _eventCounting = enable;
+}
 
-        while (idStart < idEnd)
-        {
-          theID *= 10;
-          theID += (uint64_t)((*idStart) - '0'); // Add each digit to theID
-          idStart++;
-        }
+/**************************************************************************/
+/*!
+    @brief  Get the number of $TD SENT messages received - e.g. to see when a message has been delivered
+    @return The count
+*/
+/**************************************************************************/
+uint32_t SWARM_M138::getTransmitSentCount(void)
+{
+  return (_transmitSentCount);
+}
 
-        *msg_id = theID;
-      }
-    }
-  }
+/**************************************************************************/
+/*!
+    @brief  Get the number of $SL WAKE messages received - e.g. to see when the modem has woken up
+    @return The count
+*/
+/**************************************************************************/
+uint32_t SWARM_M138::getSleepWakeCount(void)
+{
+  return (_sleepWakeCount);
+}
 
-  swarm_m138_free_char(command);
-  swarm_m138_free_char(scratchpad);
-  swarm_m138_free_char(response);
-  return (err);
+/**************************************************************************/
+/*!
+    @brief  Attach a TX ledger. Every message queued from now on is recorded in it
+    @param  ledger
+            The ledger. NULL to detach it
+*/
+/**************************************************************************/
+void SWARM_M138::setTxLedger(SWARM_M138_Tx_Ledger *ledger)
+{
+  _txLedger = ledger;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the attached TX ledger
+    @return The ledger. NULL if setTxLedger has not been called
+*/
+/**************************************************************************/
+SWARM_M138_Tx_Ledger *SWARM_M138::getTxLedger(void)
+{
+  return (_txLedger);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the current Unix time - extrapolated from the cached $DT message. The modem is not queried:
+            call getDateTime, or set a $DT rate, to update the cache
+    @return The Unix time (seconds). 0 if there is no valid cached $DT message
+*/
+/**************************************************************************/
+uint32_t SWARM_M138::getUnixTime(void)
+{
+  // Don't call telemetryFresh: the ledger calls this from inside response and URC handlers - it would service the backlog
+  if (((_telemetryValid & (1 << SWARM_M138_TELEMETRY_DT)) == 0) || (!_cachedDateTime.valid))
+    return (0);
+
+  return (SWARM_M138_Pass_Predictor::dateTimeToUnix(&_cachedDateTime) + ((millis() - _telemetryMillis[SWARM_M138_TELEMETRY_DT]) / 1000));
+}
+
+// Record a queued message - and its expiry time, if it can be worked out
+void SWARM_M138::ledgerQueued(uint64_t msg_id, bool useAppID, uint16_t appID, bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch)
+{
+  if (_txLedger == NULL)
+    return;
+
+  uint32_t queued = getUnixTime();
+  uint32_t expires = 0;
+  if (useEpoch)
+    expires = epoch;
+  else if (queued > 0)
+    expires = queued + (useHold ? hold : SWARM_M138_TX_DEFAULT_HOLD);
+
+  if (queued > 0)
+    _txLedger->expire(queued); // Tidy up before adding - it may make room
+
+  _txLedger->add(msg_id, queued, useAppID, appID, expires);
 }
 
 /**************************************************************************/
@@ -4819,6 +5820,19 @@ void SWARM_M138::setGeospatialInfoCallback(void (*swarmGeospatialCallback)(const
   _swarmGeospatialCallback = swarmGeospatialCallback;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Set up the fixed-point callback for the $GN geospatial information message.
+            This can be used instead of, or as well as, the float callback
+    @param  swarmGeospatialFixedCallback
+            The address of the function to be called when an unsolicited $GN message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setGeospatialInfoFixedCallback(void (*swarmGeospatialFixedCallback)(const Swarm_M138_GeospatialData_Fixed_t *info))
+{
+  _swarmGeospatialFixedCallback = swarmGeospatialFixedCallback;
+}
+
 /**************************************************************************/
 /*!
     @brief  Set up the callback for the $GS GPS fix quality message
@@ -4845,64 +5859,258 @@ void SWARM_M138::setPowerStatusCallback(void (*swarmPowerStatusCallback)(const S
 
 /**************************************************************************/
 /*!
-    @brief  Set up the callback for the $RT receive test message
-    @param  swarmReceiveTestCallback
-            The address of the function to be called when an unsolicited $RT message arrives
+    @brief  Set up the fixed-point callback for the $PW power status message.
+            This can be used instead of, or as well as, the float callback
+    @param  swarmPowerStatusFixedCallback
+            The address of the function to be called when an unsolicited $PW message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setPowerStatusFixedCallback(void (*swarmPowerStatusFixedCallback)(const Swarm_M138_Power_Status_Fixed_t *power))
+{
+  _swarmPowerStatusFixedCallback = swarmPowerStatusFixedCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback for the $RT receive test message
+    @param  swarmReceiveTestCallback
+            The address of the function to be called when an unsolicited $RT message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setReceiveTestCallback(void (*swarmReceiveTestCallback)(const Swarm_M138_Receive_Test_t *rxTest))
+{
+  _swarmReceiveTestCallback = swarmReceiveTestCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback for the $M138 modem status messages
+    @param  swarmModemStatusCallback
+            The address of the function to be called when an unsolicited $M138 message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setModemStatusCallback(void (*swarmModemStatusCallback)(Swarm_M138_Modem_Status_e status, const char *debugOrError))
+{
+  _swarmModemStatusCallback = swarmModemStatusCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback for the $SL WAKE sleep mode messages
+    @param  swarmSleepWakeCallback
+            The address of the function to be called when an unsolicited $SL WAKE message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setSleepWakeCallback(void (*swarmSleepWakeCallback)(Swarm_M138_Wake_Cause_e cause))
+{
+  _swarmSleepWakeCallback = swarmSleepWakeCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback for the $RD receive data message
+    @param  swarmReceiveMessageCallback
+            The address of the function to be called when an unsolicited $RD message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setReceiveMessageCallback(void (*swarmReceiveMessageCallback)(const uint16_t *appID, const int16_t *rssi,
+                                           const int16_t *snr, const int16_t *fdev, const char *asciiHex))
+{
+  _swarmReceiveMessageCallback = swarmReceiveMessageCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback for $TD SENT messages
+    @param  swarmTransmitDataCallback
+            The address of the function to be called when an unsolicited $TD SENT message arrives
+*/
+/**************************************************************************/
+void SWARM_M138::setTransmitDataCallback(void (*swarmTransmitDataCallback)(const int16_t *rssi_sat, const int16_t *snr,
+                                         const int16_t *fdev, const uint64_t *id))
+{
+  _swarmTransmitDataCallback = swarmTransmitDataCallback;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $DT Date Time message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setDateTimeCallback(void (*callback)(const Swarm_M138_DateTimeData_t &dateTime, void *context), void *context)
+{
+  _swarmDateTimeContextCallback = callback;
+  _swarmDateTimeContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $GJ jamming indication message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setGpsJammingCallback(void (*callback)(const Swarm_M138_GPS_Jamming_Indication_t &jamming, void *context), void *context)
+{
+  _swarmGpsJammingContextCallback = callback;
+  _swarmGpsJammingContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $GN geospatial information message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setGeospatialInfoCallback(void (*callback)(const Swarm_M138_GeospatialData_t &info, void *context), void *context)
+{
+  _swarmGeospatialContextCallback = callback;
+  _swarmGeospatialContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $GN geospatial information (fixed-point) message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setGeospatialInfoFixedCallback(void (*callback)(const Swarm_M138_GeospatialData_Fixed_t &info, void *context), void *context)
+{
+  _swarmGeospatialFixedContextCallback = callback;
+  _swarmGeospatialFixedContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $GS GPS fix quality message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setGpsFixQualityCallback(void (*callback)(const Swarm_M138_GPS_Fix_Quality_t &fixQuality, void *context), void *context)
+{
+  _swarmGpsFixQualityContextCallback = callback;
+  _swarmGpsFixQualityContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $PW power status message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setPowerStatusCallback(void (*callback)(const Swarm_M138_Power_Status_t &status, void *context), void *context)
+{
+  _swarmPowerStatusContextCallback = callback;
+  _swarmPowerStatusContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $PW power status (fixed-point) message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
+*/
+/**************************************************************************/
+void SWARM_M138::setPowerStatusFixedCallback(void (*callback)(const Swarm_M138_Power_Status_Fixed_t &status, void *context), void *context)
+{
+  _swarmPowerStatusFixedContextCallback = callback;
+  _swarmPowerStatusFixedContext = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set up the callback - with a context - for the $RT receive test message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
 */
 /**************************************************************************/
-void SWARM_M138::setReceiveTestCallback(void (*swarmReceiveTestCallback)(const Swarm_M138_Receive_Test_t *rxTest))
+void SWARM_M138::setReceiveTestCallback(void (*callback)(const Swarm_M138_Receive_Test_t &rxTest, void *context), void *context)
 {
-  _swarmReceiveTestCallback = swarmReceiveTestCallback;
+  _swarmReceiveTestContextCallback = callback;
+  _swarmReceiveTestContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set up the callback for the $M138 modem status messages
-    @param  swarmModemStatusCallback
-            The address of the function to be called when an unsolicited $M138 message arrives
+    @brief  Set up the callback - with a context - for the $M138 modem status message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
 */
 /**************************************************************************/
-void SWARM_M138::setModemStatusCallback(void (*swarmModemStatusCallback)(Swarm_M138_Modem_Status_e status, const char *debugOrError))
+void SWARM_M138::setModemStatusCallback(void (*callback)(Swarm_M138_Modem_Status_e status, const char *data, void *context), void *context)
 {
-  _swarmModemStatusCallback = swarmModemStatusCallback;
+  _swarmModemStatusContextCallback = callback;
+  _swarmModemStatusContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set up the callback for the $SL WAKE sleep mode messages
-    @param  swarmSleepWakeCallback
-            The address of the function to be called when an unsolicited $SL WAKE message arrives
+    @brief  Set up the callback - with a context - for the $SL WAKE sleep mode message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
 */
 /**************************************************************************/
-void SWARM_M138::setSleepWakeCallback(void (*swarmSleepWakeCallback)(Swarm_M138_Wake_Cause_e cause))
+void SWARM_M138::setSleepWakeCallback(void (*callback)(Swarm_M138_Wake_Cause_e cause, void *context), void *context)
 {
-  _swarmSleepWakeCallback = swarmSleepWakeCallback;
+  _swarmSleepWakeContextCallback = callback;
+  _swarmSleepWakeContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set up the callback for the $RD receive data message
-    @param  swarmReceiveMessageCallback
-            The address of the function to be called when an unsolicited $RD message arrives
+    @brief  Set up the callback - with a context - for the $RD receive data message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback.
+            appID is only valid if hasAppID is true
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
 */
 /**************************************************************************/
-void SWARM_M138::setReceiveMessageCallback(void (*swarmReceiveMessageCallback)(const uint16_t *appID, const int16_t *rssi,
-                                           const int16_t *snr, const int16_t *fdev, const char *asciiHex))
+void SWARM_M138::setReceiveMessageCallback(void (*callback)(bool hasAppID, uint16_t appID, int16_t rssi, int16_t snr, int16_t fdev, const char *asciiHex, void *context), void *context)
 {
-  _swarmReceiveMessageCallback = swarmReceiveMessageCallback;
+  _swarmReceiveMessageContextCallback = callback;
+  _swarmReceiveMessageContext = context;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Set up the callback for $TD SENT messages
-    @param  swarmTransmitDataCallback
-            The address of the function to be called when an unsolicited $TD SENT message arrives
+    @brief  Set up the callback - with a context - for the $TD SENT message
+    @param  callback
+            The address of the function to be called when an unsolicited message arrives. NULL == no callback
+    @param  context
+            Passed to the callback - e.g. a pointer to the object which handles this modem
 */
 /**************************************************************************/
-void SWARM_M138::setTransmitDataCallback(void (*swarmTransmitDataCallback)(const int16_t *rssi_sat, const int16_t *snr,
-                                         const int16_t *fdev, const uint64_t *id))
+void SWARM_M138::setTransmitDataCallback(void (*callback)(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context), void *context)
 {
-  _swarmTransmitDataCallback = swarmTransmitDataCallback;
+  _swarmTransmitDataContextCallback = callback;
+  _swarmTransmitDataContext = context;
 }
 
 /**************************************************************************/
@@ -5001,6 +6209,15 @@ const char *SWARM_M138::modemErrorString(Swarm_M138_Error_e error)
     case SWARM_M138_ERROR_ERR:
       return "Command input error (ERR)";
       break;
+    case SWARM_M138_ERROR_BUSY:
+      return "An asynchronous command is still in progress";
+      break;
+    case SWARM_M138_ERROR_QUEUE_FULL:
+      return "The command queue is full";
+      break;
+    case SWARM_M138_ERROR_EXPIRED:
+      return "The message expired before it could be queued";
+      break;
   }
 
   return "UNKNOWN";
@@ -5065,6 +6282,7 @@ const char *SWARM_M138::commandErrorString(const char *ERR)
 /////////////
 
 // Add the two NMEA checksum bytes and line feed to a command
+// The checksum is accumulated in a single pass from the $ to the (last) asterix
 void SWARM_M138::addChecksumLF(char *command)
 {
   char *dollar = strchr(command, '$'); // Find the $
@@ -5072,23 +6290,23 @@ void SWARM_M138::addChecksumLF(char *command)
   if (dollar == NULL) // Return now if the $ was not found
     return;
 
-  char *asterix = strchr(dollar, '*'); // Find the *
+  char checksum = 0;
+  char *asterix = dollar + 1; // Point to the char after the $
+
+  while ((*asterix != '*') && (*asterix != 0)) // Calculate the checksum
+  {
+    checksum ^= *asterix;
+    asterix++;
+  }
 
-  if (asterix == NULL) // Return now if the * was not found
+  if (*asterix == 0) // Return now if the * was not found
     return;
 
   // Check for a second asterix ($MM C=**)
   if (*(asterix + 1) == '*')
-    asterix++;
-
-  char checksum = 0;
-
-  dollar++; // Point to the char after the $
-
-  while (dollar < asterix) // Calculate the checksum
   {
-    checksum ^= *dollar;
-    dollar++;
+    checksum ^= '*';
+    asterix++;
   }
 
   // Add the checksum bytes to the command
@@ -5106,449 +6324,874 @@ void SWARM_M138::addChecksumLF(char *command)
   *(asterix + 4) = 0;
 }
 
-// Check if the response / message checksum is valid
-Swarm_M138_Error_e SWARM_M138::checkChecksum(char *startPosition)
+// Extract the command error
+Swarm_M138_Error_e SWARM_M138::extractCommandError(char *startPosition)
 {
-  char *dollar = strchr(startPosition, '$'); // Find the $
+    memset(commandError, 0, SWARM_M138_MAX_CMD_ERROR_LEN); // Clear any existing error
 
-  if (dollar == NULL) // Return now if the $ was not found
-  {
-    if (_printDebug == true)
+    char *errorAt = strstr(startPosition, "ERR,"); // Find the ERR,
+
+    if (errorAt == NULL)
+      return (SWARM_M138_ERROR_ERROR);
+
+    errorAt += 4; // Point to the start of the actual error message
+
+    char *asterix = strchr(errorAt, '*'); // Find the *
+
+    if (asterix == NULL)
+      return (SWARM_M138_ERROR_ERROR);
+
+    int errorLen = 0;
+    while ((errorAt < asterix) && (errorLen < (SWARM_M138_MAX_CMD_ERROR_LEN - 1))) // Leave a NULL on the end
     {
-      _debugPort->println(F("checkChecksum: $ not found!"));
+      commandError[errorLen] = *errorAt;
+      errorAt++;
+      errorLen++;
     }
-    return (SWARM_M138_ERROR_INVALID_FORMAT);
-  }
 
-  char *asterix = strchr(dollar, '*'); // Find the *
+    return (SWARM_M138_ERROR_SUCCESS);
+}
+
+// Send a command. Check for a response.
+// Return true if expectedResponseStart is seen in the data followed by a \n
+Swarm_M138_Error_e SWARM_M138::sendCommandWithResponse(
+    const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
+    char *responseDest, size_t destSize, unsigned long commandTimeout)
+{
+  if (_asyncPending == true) // The modem can only process one command at a time
+    return (SWARM_M138_ERROR_BUSY);
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("sendCommandWithResponse: ====>"));
+
+  sendCommand(command); //Sending command needs to dump data to backlog buffer as well.
+
+  Swarm_M138_Error_e err = waitForResponse(expectedResponseStart, expectedErrorStart, responseDest, destSize, commandTimeout);
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->println(F("sendCommandWithResponse: <===="));
+
+  return (err);
+}
 
-  if (asterix == NULL) // Return now if the * was not found
+void SWARM_M138::sendCommand(const char *command, bool drain)
+{
+  //Copy any incoming serial data into the backlog - waiting up to _rxWindowMillis if a sentence is part-received
+  //(Not needed if we have only just finished waiting for the previous response)
+  if (drain == true)
+    rxWindowDrain();
+
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
   {
-    if (_printDebug == true)
-    {
-      _debugPort->println(F("checkChecksum: * not found!"));
-    }
-    return (SWARM_M138_ERROR_INVALID_FORMAT);
+    _debugPort->print(F("sendCommand: Command: "));
+    _debugPort->println(command);
   }
 
-  char checksum = 0;
+  //Now send the command
+  hwPrint(command);
+}
+
+// Copy any incoming serial data into the backlog.
+// If a sentence is part-received, spend up to _rxWindowMillis milliseconds waiting for the rest of it
+void SWARM_M138::rxWindowDrain(void)
+{
+  unsigned long window = rxWindow();
+  unsigned long timeIn = millis();
 
-  dollar++; // Point to the char after the $
+  backlogFill();
 
-  while (dollar < asterix) // Calculate the checksum
+  while (backlogMidSentence() && ((millis() - timeIn) < window))
   {
-    checksum ^= *dollar;
-    dollar++;
+    if (backlogFill() > 0)
+      timeIn = millis();
+    else
+      swarmDelay(1);
   }
+}
+
+// Return true if the framer is part way through a sentence
+bool SWARM_M138::backlogMidSentence(void)
+{
+  return (_framerState != SWARM_M138_FRAMER_IDLE);
+}
+
+// The idle window: zero if the transport does not need one
+unsigned long SWARM_M138::rxWindow(void)
+{
+  if ((_transport != NULL) && (_transport->needsRxWindow() == false))
+    return (0);
+  return (_rxWindowMillis);
+}
 
-  char expectedChecksum;
+Swarm_M138_Error_e SWARM_M138::waitForResponse(const char *expectedResponseStart, const char *expectedErrorStart,
+                                               char *responseDest, size_t destSize, unsigned long timeout)
+{
+  unsigned long timeIn;
+  Swarm_M138_Error_e err = SWARM_M138_ERROR_ERROR;
 
-  char checksumChar = *(asterix + 1); // Get the first checksum character
+  if ((_asyncPending == true) || (_responseDest != NULL)) // Only one response can be awaited at a time
+    return (SWARM_M138_ERROR_BUSY);
 
-  if ((checksumChar >= '0') && (checksumChar <= '9')) // Convert to binary
-    expectedChecksum = (checksumChar - '0') << 4;
-  else if ((checksumChar >= 'a') && (checksumChar <= 'f'))
-    expectedChecksum = (checksumChar + 10 - 'a') << 4;
-  else if ((checksumChar >= 'A') && (checksumChar <= 'F'))
-    expectedChecksum = (checksumChar + 10 - 'A') << 4;
-  else
+  responseExpect(expectedResponseStart, expectedErrorStart, responseDest, destSize);
+  bool prunePreviously = _backlogPrune;
+  _backlogPrune = true; // Don't add non-actionable URC's to the backlog while we wait
+
+  timeIn = millis();
+
+  while ((!_responseFound) && ((timeIn + timeout) > millis()))
   {
-    if (_printDebug == true)
-    {
-      _debugPort->println(F("checkChecksum: invalid checksum char 1"));
-    }
-    return (SWARM_M138_ERROR_INVALID_FORMAT);
+    if (backlogFill() == 0)
+      swarmDelay(1);
   }
 
-  checksumChar = *(asterix + 2); // Get the second checksum character
-
-  if ((checksumChar >= '0') && (checksumChar <= '9')) // Convert to binary
-    expectedChecksum |= (checksumChar - '0');
-  else if ((checksumChar >= 'a') && (checksumChar <= 'f'))
-    expectedChecksum |= (checksumChar + 10 - 'a');
-  else if ((checksumChar >= 'A') && (checksumChar <= 'F'))
-    expectedChecksum |= (checksumChar + 10 - 'A');
-  else
+  if (_responseFound == true)
   {
-    if (_printDebug == true)
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
     {
-      _debugPort->println(F("checkChecksum: invalid checksum char 2"));
+      _debugPort->print(F("waitForResponse: "));
+      _debugPort->print((const char *)responseDest);
     }
-    return (SWARM_M138_ERROR_INVALID_FORMAT);
+
+    err = responseResult();
   }
+  else
+    err = SWARM_M138_ERROR_TIMEOUT;
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  statsRecordCommand(_expectedTag, err, millis() - timeIn);
+#endif
+
+  responseClear();
+  _backlogPrune = prunePreviously;
+
+  return (err);
+}
 
-  if (checksum != expectedChecksum)
+// Tell backlogLineComplete what we are looking for.
+// Every line arriving while we wait is checked as soon as its \n arrives:
+// the response (or error) is copied into responseDest; any other line is added to the backlog - if it is actionable.
+void SWARM_M138::responseExpect(const char *expectedResponseStart, const char *expectedErrorStart, char *responseDest, size_t destSize)
+{
+  _expectedResponseStart = expectedResponseStart;
+  _expectedErrorStart = expectedErrorStart;
+  _responseDest = responseDest;
+  _responseDestSize = destSize;
+  _responseFound = false;
+  _responseIsError = false;
+  _responseResult = SWARM_M138_ERROR_ERROR;
+  _expectedTag = sentenceTag(expectedResponseStart); // Only sentences with this tag need to be compared
+}
+
+// Return the result for the response found by backlogLineComplete. Extract the command error - if there was one
+Swarm_M138_Error_e SWARM_M138::responseResult(void)
+{
+  Swarm_M138_Error_e err = _responseResult; // The framer has already checked the format and checksum
+  if (_responseIsError) // Error needs priority over response as response is often the beginning of error!
   {
-    if (_printDebug == true)
+    if (err == SWARM_M138_ERROR_SUCCESS)
     {
-      _debugPort->println(F("checkChecksum: invalid checksum"));
+      extractCommandError(_responseDest);
+      err = SWARM_M138_ERROR_ERR;
     }
-    return (SWARM_M138_ERROR_INVALID_CHECKSUM);
   }
+  return (err);
+}
 
-  return (SWARM_M138_ERROR_SUCCESS);
+// Stop looking for the response
+void SWARM_M138::responseClear(void)
+{
+  _expectedResponseStart = NULL;
+  _expectedErrorStart = NULL;
+  _responseDest = NULL;
+  _responseDestSize = 0;
 }
 
-// Extract the command error
-Swarm_M138_Error_e SWARM_M138::extractCommandError(char *startPosition)
+size_t SWARM_M138::hwPrint(const char *s)
 {
-    memset(commandError, 0, SWARM_M138_MAX_CMD_ERROR_LEN); // Clear any existing error
+  return (hwWriteData(s, strlen(s)));
+}
 
-    char *errorAt = strstr(startPosition, "ERR,"); // Find the ERR,
+size_t SWARM_M138::hwWriteData(const char *buff, int len)
+{
+  if (_transport != NULL)
+    return (_transport->write(buff, (size_t)len));
 
-    if (errorAt == NULL)
-      return (SWARM_M138_ERROR_ERROR);
+  return (size_t)0;
+}
 
-    errorAt += 4; // Point to the start of the actual error message
+// Start a streamed write of exactly len bytes. Follow with one or more calls to hwWriteStreamChunk.
+// On I2C, the chunks are packed into the same bus transactions (and checksum) as a single write
+void SWARM_M138::hwWriteStreamBegin(size_t len)
+{
+  if (_transport != NULL)
+    _transport->writeBegin(len);
+}
 
-    char *asterix = strchr(errorAt, '*'); // Find the *
+// Write the next chunk of a streamed write. Echo it to the debug port if debug is enabled
+size_t SWARM_M138::hwWriteStreamChunk(const char *buff, int len)
+{
+  if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_VERBOSE))
+    _debugPort->write((const uint8_t *)buff, len);
 
-    if (asterix == NULL)
-      return (SWARM_M138_ERROR_ERROR);
+  if (_transport != NULL)
+    return (_transport->writeStream(buff, (size_t)len));
 
-    int errorLen = 0;
-    while ((errorAt < asterix) && (errorLen < (SWARM_M138_MAX_CMD_ERROR_LEN - 1))) // Leave a NULL on the end
-    {
-      commandError[errorLen] = *errorAt;
-      errorAt++;
-      errorLen++;
-    }
+  return (size_t)0;
+}
 
-    return (SWARM_M138_ERROR_SUCCESS);
+size_t SWARM_M138::hwWrite(const char c)
+{
+  return (hwWriteData(&c, 1));
 }
 
-// Send a command. Check for a response.
-// Return true if expectedResponseStart is seen in the data followed by a \n
-Swarm_M138_Error_e SWARM_M138::sendCommandWithResponse(
-    const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
-    char *responseDest, size_t destSize, unsigned long commandTimeout)
+int SWARM_M138::hwAvailable(void)
 {
-  if (_printDebug == true)
-    _debugPort->println(F("sendCommandWithResponse: ====>"));
+  if (_transport != NULL)
+    return (_transport->available());
 
-  sendCommand(command); //Sending command needs to dump data to backlog buffer as well.
+  return -1;
+}
 
-  Swarm_M138_Error_e err = waitForResponse(expectedResponseStart, expectedErrorStart, responseDest, destSize, commandTimeout);
+// Read len chars from the appropriate port. Store in buf
+int SWARM_M138::hwReadChars(char *buf, int len)
+{
+  if (len <= 0)
+    return (len);
 
-  if (_printDebug == true)
-    _debugPort->println(F("sendCommandWithResponse: <===="));
+  if (buf == NULL)
+    return (-1);
 
-  return (err);
+  if (_transport != NULL)
+    return (_transport->read(buf, len));
+
+  return (-1);
 }
 
-void SWARM_M138::sendCommand(const char *command)
+void SWARM_M138::beginSerial(unsigned long baud)
 {
-  //Spend up to _rxWindowMillis milliseconds copying any incoming serial data into the backlog
-  unsigned long timeIn = millis();
-  int hwAvail = hwAvailable();
-  if (hwAvail > 0) //hwAvailable can return -1 if the serial port is NULL
+  if (_transport != NULL)
+    _transport->begin(baud);
+  swarmDelay(100);
+}
+
+// Use transport for all communication with the modem
+void SWARM_M138::attachTransport(SWARM_M138_Transport *transport)
+{
+  _transport = transport;
+  _transport->setDebugPort(_printDebug ? _debugPort : NULL);
+}
+
+// Allocate memory
+// In zero-heap mode, the scratchpads are served from a small pool of slots owned by the class
+char *SWARM_M138::swarm_m138_alloc_char(size_t num)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  if (num > SWARM_M138_SCRATCH_SLOT_SIZE)
+    return (NULL);
+  for (uint8_t i = 0; i < SWARM_M138_SCRATCH_SLOTS; i++)
   {
-    size_t backlogLength = strlen((const char *)_swarmBacklog);
-    while (((millis() - timeIn) < _rxWindowMillis) && ((backlogLength + hwAvail) < _RxBuffSize)) //May need to escape on newline?
+    if ((_scratchInUse & (1 << i)) == 0)
     {
-      if (hwAvail > 0) //hwAvailable can return -1 if the serial port is NULL
-      {
-        backlogLength += hwReadChars((char *)&_swarmBacklog[backlogLength], hwAvail);
-        timeIn = millis();
-      }
-      else
-        delay(1);
-      hwAvail = hwAvailable();
+      _scratchInUse |= (1 << i);
+      return (_scratchArena[i]);
     }
   }
+  return (NULL);
+#else
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  _stats.heapAllocations++;
+#endif
+  return ((char *)new char[num]);
+#endif
+}
+void SWARM_M138::swarm_m138_free_char(char *freeMe)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  for (uint8_t i = 0; i < SWARM_M138_SCRATCH_SLOTS; i++)
+  {
+    if (freeMe == _scratchArena[i])
+      _scratchInUse &= ~(1 << i);
+  }
+#else
+  delete[] freeMe;
+#endif
+}
+
+// Allocate memory for a command
+// In zero-heap mode, every command shares the command arena
+char *SWARM_M138::swarm_m138_alloc_command(size_t num)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  if ((num > SWARM_M138_COMMAND_ARENA_SIZE) || (_commandArenaInUse == true))
+    return (NULL);
+  _commandArenaInUse = true;
+  return (_commandArena);
+#else
+  return (swarm_m138_alloc_char(num));
+#endif
+}
+void SWARM_M138::swarm_m138_free_command(char *freeMe)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  if (freeMe == _commandArena)
+    _commandArenaInUse = false;
+#else
+  swarm_m138_free_char(freeMe);
+#endif
+}
+
+// Allocate memory for a command response
+// In zero-heap mode, every command shares the response arena
+char *SWARM_M138::swarm_m138_alloc_response(size_t num)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  if ((num > SWARM_M138_RESPONSE_SIZE) || (_responseArenaInUse == true))
+    return (NULL);
+  _responseArenaInUse = true;
+  return (_responseArena);
+#else
+  return (swarm_m138_alloc_char(num));
+#endif
+}
+void SWARM_M138::swarm_m138_free_response(char *freeMe)
+{
+#ifdef SWARM_M138_STATIC_BUFFERS
+  if (freeMe == _responseArena)
+    _responseArenaInUse = false;
+#else
+  swarm_m138_free_char(freeMe);
+#endif
+}
+
+// Backlog ring buffer and NMEA sentence framer
+//
+// All serial data from the modem arrives here, via backlogFill.
+// backlogAppend frames each "$...*hh\n" sentence as it arrives, one character at a time:
+// it extracts the talker tag and accumulates the checksum on the fly, so the sentence never needs to be rescanned.
+// Complete sentences are stored between _backlogHead and _backlogTail. _backlogUsed holds the number of bytes.
+// Each sentence is stored as: one byte holding the Swarm_M138_Sentence_Tag_e, then the sentence from the $ to the \n.
+// The (incomplete) sentence which is being received is stored after _backlogTail. _backlogPending holds its length.
+// When the \n arrives, backlogLineComplete decides what to do with the sentence.
+// If a sentence will not fit, it is dropped - and the bytes are counted in _backlogBytesDropped.
+
+// Clear the backlog
+void SWARM_M138::backlogClear(void)
+{
+  _backlogHead = 0;
+  _backlogTail = 0;
+  _backlogUsed = 0;
+  _backlogPending = 0;
+  _backlogLines = 0;
+  _backlogDiscarding = false;
+  _framerState = SWARM_M138_FRAMER_IDLE;
+}
 
-  if (_printDebug == true)
+// Read any serial data which is waiting and add it to the backlog. Return the number of bytes read
+size_t SWARM_M138::backlogFill(void)
+{
+  size_t bytesRead = 0;
+  char chunk[SWARM_M138_BACKLOG_FILL_CHUNK];
+
+  int hwAvail = hwAvailable();
+  while (hwAvail > 0) //hwAvailable can return -1 if the serial port is NULL
   {
-    _debugPort->print(F("sendCommand: Command: "));
-    _debugPort->println(command);
+    int toRead = hwAvail;
+    if (toRead > SWARM_M138_BACKLOG_FILL_CHUNK)
+      toRead = SWARM_M138_BACKLOG_FILL_CHUNK;
+    int charsRead = hwReadChars(chunk, toRead);
+    if (charsRead <= 0)
+      break;
+    for (int i = 0; i < charsRead; i++)
+      backlogAppend(chunk[i]);
+    bytesRead += charsRead;
+    hwAvail -= charsRead;
   }
 
-  //Now send the command
-  hwPrint(command);
+  return (bytesRead);
+}
+
+// Convert the (up to) four tag characters - packed into a uint32_t - into a Swarm_M138_Sentence_Tag_e
+static Swarm_M138_Sentence_Tag_e swarm_m138_sentence_tag(uint32_t packedTag)
+{
+#define SWARM_M138_PACK_TAG(a, b, c, d) ((((uint32_t)(a)) << 24) | (((uint32_t)(b)) << 16) | (((uint32_t)(c)) << 8) | ((uint32_t)(d)))
+  switch (packedTag)
+  {
+  case SWARM_M138_PACK_TAG('C', 'S', 0, 0): return (SWARM_M138_SENTENCE_TAG_CS);
+  case SWARM_M138_PACK_TAG('D', 'T', 0, 0): return (SWARM_M138_SENTENCE_TAG_DT);
+  case SWARM_M138_PACK_TAG('F', 'V', 0, 0): return (SWARM_M138_SENTENCE_TAG_FV);
+  case SWARM_M138_PACK_TAG('G', 'J', 0, 0): return (SWARM_M138_SENTENCE_TAG_GJ);
+  case SWARM_M138_PACK_TAG('G', 'N', 0, 0): return (SWARM_M138_SENTENCE_TAG_GN);
+  case SWARM_M138_PACK_TAG('G', 'P', 0, 0): return (SWARM_M138_SENTENCE_TAG_GP);
+  case SWARM_M138_PACK_TAG('G', 'S', 0, 0): return (SWARM_M138_SENTENCE_TAG_GS);
+  case SWARM_M138_PACK_TAG('M', 'M', 0, 0): return (SWARM_M138_SENTENCE_TAG_MM);
+  case SWARM_M138_PACK_TAG('M', 'T', 0, 0): return (SWARM_M138_SENTENCE_TAG_MT);
+  case SWARM_M138_PACK_TAG('P', 'O', 0, 0): return (SWARM_M138_SENTENCE_TAG_PO);
+  case SWARM_M138_PACK_TAG('P', 'W', 0, 0): return (SWARM_M138_SENTENCE_TAG_PW);
+  case SWARM_M138_PACK_TAG('R', 'D', 0, 0): return (SWARM_M138_SENTENCE_TAG_RD);
+  case SWARM_M138_PACK_TAG('R', 'S', 0, 0): return (SWARM_M138_SENTENCE_TAG_RS);
+  case SWARM_M138_PACK_TAG('R', 'T', 0, 0): return (SWARM_M138_SENTENCE_TAG_RT);
+  case SWARM_M138_PACK_TAG('S', 'L', 0, 0): return (SWARM_M138_SENTENCE_TAG_SL);
+  case SWARM_M138_PACK_TAG('M', '1', '3', '8'): return (SWARM_M138_SENTENCE_TAG_M138);
+  case SWARM_M138_PACK_TAG('T', 'D', 0, 0): return (SWARM_M138_SENTENCE_TAG_TD);
+  default: return (SWARM_M138_SENTENCE_TAG_UNKNOWN);
+  }
+#undef SWARM_M138_PACK_TAG
+}
+
+// Return the tag of a sentence or command: e.g. "$DT ..." returns SWARM_M138_SENTENCE_TAG_DT
+Swarm_M138_Sentence_Tag_e SWARM_M138::sentenceTag(const char *sentence)
+{
+  if ((sentence == NULL) || (*sentence != '$'))
+    return (SWARM_M138_SENTENCE_TAG_UNKNOWN);
+
+  uint32_t packedTag = 0;
+  sentence++; // Skip the $
+  for (uint8_t i = 0; (i < 4) && (*sentence != 0) && (*sentence != ' ') && (*sentence != ',') && (*sentence != '*'); i++)
+    packedTag |= ((uint32_t)*sentence++) << (24 - (8 * i));
+
+  return (swarm_m138_sentence_tag(packedTag));
 }
 
-Swarm_M138_Error_e SWARM_M138::waitForResponse(const char *expectedResponseStart, const char *expectedErrorStart,
-                                               char *responseDest, size_t destSize, unsigned long timeout)
+// Store a single character in the incomplete line. Return false if the backlog is full
+bool SWARM_M138::backlogStore(char c)
 {
-  unsigned long timeIn;
-  bool found = false;
-  size_t destIndex = 0;
-  bool responseStartSeen = false, errorStartSeen = false;
-  int responseIndex = 0, errorIndex = 0;
-  size_t responseStartedAt = 0, errorStartedAt = 0;
-  Swarm_M138_Error_e err = SWARM_M138_ERROR_ERROR;
+  if ((_backlogUsed + _backlogPending) >= SWARM_M138_BACKLOG_SIZE) // Is the backlog full?
+  {
+    if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
+      _debugPort->println(F("backlogAppend: Panic! _swarmBacklog is full! Dropping the line."));
+    // Drop the incomplete line - and the rest of it
+    _backlogBytesDropped += _backlogPending + 1;
+#ifdef SWARM_M138_ENABLE_STATISTICS
+    _stats.urcsDropped++;
+#endif
+    _backlogPending = 0;
+    _backlogDiscarding = (c != '\n');
+    _framerState = SWARM_M138_FRAMER_IDLE;
+    return (false);
+  }
+
+  size_t index = _backlogTail + _backlogPending;
+  if (index >= SWARM_M138_BACKLOG_SIZE)
+    index -= SWARM_M138_BACKLOG_SIZE;
+  _swarmBacklog[index] = c;
+  _backlogPending++;
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  if ((_backlogUsed + _backlogPending) > _stats.backlogHighWater)
+    _stats.backlogHighWater = _backlogUsed + _backlogPending;
+#endif
+  return (true);
+}
 
-  bool printedSomething = false;
+// Add a single character to the backlog - and frame the sentence
+void SWARM_M138::backlogAppend(char c)
+{
+  if (_swarmBacklog == NULL)
+    return;
 
-  timeIn = millis();
+  if (_backlogDiscarding) // Are we discarding the rest of a line which did not fit?
+  {
+    _backlogBytesDropped++;
+    if (c == '\n')
+      _backlogDiscarding = false;
+    return;
+  }
 
-  while ((!found) && ((timeIn + timeout) > millis()))
+  if (c == '$') // A $ always starts a new sentence
   {
-    size_t hwAvail = hwAvailable();
-    if (hwAvail > 0) //hwAvailable can return -1 if the serial port is NULL
+    if (_framerState != SWARM_M138_FRAMER_IDLE) // Discard any incomplete sentence
     {
-      if ((destIndex + hwAvail) < destSize) // Check there is room to store the response (with a null on the end!)
-      {
-        size_t bytesRead = hwReadChars((char *)&responseDest[destIndex], hwAvail);
-
-        if (_printDebug == true)
-        {
-          if (printedSomething == false)
-          {
-            _debugPort->print(F("waitForResponse: "));
-            printedSomething = true;
-          }
-          _debugPort->print((const char *)&responseDest[destIndex]);
-        }
-
-        // Check each character to see if it is the expected resonse or error
-        for (size_t chrPtr = destIndex; chrPtr < (destIndex + bytesRead); chrPtr++)
-        {
-          char c = responseDest[chrPtr]; // Check each character
-
-          if (c == expectedResponseStart[responseIndex])
-          {
-            if ((responseIndex == 0) && (responseStartSeen == false))
-              responseStartedAt = chrPtr; // Record where the (possible) response started
-            if (++responseIndex == (int)strlen(expectedResponseStart))
-            {
-              responseStartSeen = true;
-            }
-          }
-          else
-          {
-            responseIndex = 0;
-          }
-
-          if (expectedErrorStart != NULL)
-          {
-            if (c == expectedErrorStart[errorIndex])
-            {
-              if ((errorIndex == 0) && (errorStartSeen == false))
-                errorStartedAt = chrPtr; // Record where the (possible) error started
-              if (++errorIndex == (int)strlen(expectedErrorStart))
-              {
-                errorStartSeen = true;
-              }
-            }
-            else
-            {
-              errorIndex = 0;
-            }
-          }
+      if (SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
+        _debugPort->println(F("backlogAppend: incomplete sentence discarded"));
+      _backlogBytesDropped += _backlogPending;
+      _backlogPending = 0;
+    }
+    _framerChecksum = 0;
+    _framerPackedTag = 0;
+    _framerTagLength = 0;
+    _framerTag = SWARM_M138_SENTENCE_TAG_UNKNOWN;
+    _framerState = SWARM_M138_FRAMER_TAG;
+    if (backlogStore((char)SWARM_M138_SENTENCE_TAG_UNKNOWN)) // Placeholder for the tag
+      backlogStore(c);
+    return;
+  }
 
-          // Set found to true if we have seen expectedResponseStart or expectedErrorStart _and_ have received a \n
-          if ((responseStartSeen || errorStartSeen) && (c == '\n'))
-            found = true;
-        }
+  if (_framerState == SWARM_M138_FRAMER_IDLE) // Ignore anything outside of a sentence
+    return;
 
-        // Now also copy the response into the backlog, if there is room
-        // _swarmBacklog is a global array that holds the backlog of any events
-        // that came in while waiting for response. To be processed later within checkUnsolicitedMsg().
-        // Note: the expectedResponse or expectedError will also be added to the backlog.
-        // Everything in the backlog is 'printable'. So it is OK to use strlen - so long as there is a
-        // \0 at the end of the buffer!
-        size_t backlogLength = strlen((const char *)_swarmBacklog);
+  if ((_framerState == SWARM_M138_FRAMER_END) && (c == '\r')) // Ignore any CR after the checksum
+    return;
 
-        if ((backlogLength + bytesRead) < _RxBuffSize) // Is there room to store the new data?
-        {
-          memcpy((char *)&_swarmBacklog[backlogLength], (char *)&responseDest[destIndex], bytesRead);
-        }
-        else
-        {
-          if (_printDebug == true)
-          {
-            if (printedSomething == true)
-            {
-              _debugPort->println();
-              printedSomething = false;
-            }
-            _debugPort->println(F("waitForResponse: Panic! _swarmBacklog is full!"));
-          }
-        }
+  if (backlogStore(c) == false)
+    return;
 
-        destIndex += bytesRead; // Increment destIndex
-      }
-      else
-      {
-        if (_printDebug == true)
-        {
-          if (printedSomething == true)
-          {
-            _debugPort->println();
-            printedSomething = false;
-          }
-          _debugPort->println(F("waitForResponse: Panic! responseDest is full!"));
-        }
-      }
+  switch (_framerState)
+  {
+  case SWARM_M138_FRAMER_TAG:
+    if ((c == ' ') || (c == ',') || (c == '*') || (c == '\n') || (_framerTagLength == 4)) // End of the tag?
+    {
+      _framerTag = swarm_m138_sentence_tag(_framerPackedTag);
+      _framerState = SWARM_M138_FRAMER_BODY;
+    }
+    else
+    {
+      _framerPackedTag |= ((uint32_t)c) << (24 - (8 * _framerTagLength));
+      _framerTagLength++;
+      _framerChecksum ^= c;
+      break;
+    }
+    // Fall through - the tag is complete: process c as part of the body
+  case SWARM_M138_FRAMER_BODY:
+    if (c == '*')
+      _framerState = SWARM_M138_FRAMER_CHECKSUM1;
+    else if (c == '\n')
+      backlogLineComplete(SWARM_M138_ERROR_INVALID_FORMAT); // No asterix
+    else
+      _framerChecksum ^= c;
+    break;
+  case SWARM_M138_FRAMER_CHECKSUM1:
+  {
+    int value = swarm_m138_hex_value(c);
+    if (c == '*') // Double asterix ($MM C=**). Include the first asterix in the checksum
+      _framerChecksum ^= '*';
+    else if (value >= 0)
+    {
+      _framerExpectedChecksum = value << 4;
+      _framerState = SWARM_M138_FRAMER_CHECKSUM2;
     }
+    else if (c == '\n')
+      backlogLineComplete(SWARM_M138_ERROR_INVALID_FORMAT);
     else
-      delay(1);
+      _framerState = SWARM_M138_FRAMER_INVALID;
   }
-
-  if (_printDebug == true)
-    if (printedSomething)
-      _debugPort->println();
-
-  if (found == true)
+  break;
+  case SWARM_M138_FRAMER_CHECKSUM2:
   {
-    if (errorStartSeen) // Error needs priority over response as response is often the beginning of error!
+    int value = swarm_m138_hex_value(c);
+    if (value >= 0)
     {
-      // if (_printDebug == true)
-      // {
-      //   _debugPort->print(F("waitForResponse: errorStart: "));
-      //   _debugPort->println((char *)&responseDest[errorStartedAt]);
-      // }
-      err = checkChecksum((char *)&responseDest[errorStartedAt]);
-      if (err == SWARM_M138_ERROR_SUCCESS)
-      {
-        extractCommandError((char *)&responseDest[errorStartedAt]);
-        err = SWARM_M138_ERROR_ERR;
-      }
+      _framerExpectedChecksum |= value;
+      _framerState = SWARM_M138_FRAMER_END;
     }
-    else if (responseStartSeen)
+    else if (c == '\n')
+      backlogLineComplete(SWARM_M138_ERROR_INVALID_FORMAT);
+    else
+      _framerState = SWARM_M138_FRAMER_INVALID;
+  }
+  break;
+  case SWARM_M138_FRAMER_END:
+    if (c == '\n')
     {
-      // if (_printDebug == true)
-      // {
-      //   _debugPort->print(F("waitForResponse: responseStart: "));
-      //   _debugPort->println((char *)&responseDest[responseStartedAt]);
-      // }
-      err = checkChecksum((char *)&responseDest[responseStartedAt]);
+      if (_framerChecksum == _framerExpectedChecksum)
+        backlogLineComplete(SWARM_M138_ERROR_SUCCESS);
+      else
+        backlogLineComplete(SWARM_M138_ERROR_INVALID_CHECKSUM);
     }
+    else
+      _framerState = SWARM_M138_FRAMER_INVALID;
+    break;
+  default: // SWARM_M138_FRAMER_INVALID
+    if (c == '\n')
+      backlogLineComplete(SWARM_M138_ERROR_INVALID_FORMAT);
+    break;
   }
-  else
-    err = SWARM_M138_ERROR_TIMEOUT;
-
-  pruneBacklog(); // Prune any incoming non-actionable URC's and responses/errors from the backlog
+}
 
-  return (err);
+// Return the character at offset in the incomplete line
+char SWARM_M138::backlogPendingChar(size_t offset)
+{
+  size_t index = _backlogTail + offset;
+  if (index >= SWARM_M138_BACKLOG_SIZE)
+    index -= SWARM_M138_BACKLOG_SIZE;
+  return (_swarmBacklog[index]);
 }
 
-size_t SWARM_M138::hwPrint(const char *s)
+// Return true if the incomplete sentence starts with s
+bool SWARM_M138::backlogPendingStartsWith(const char *s)
 {
-  if (_hardSerial != NULL)
-  {
-    return _hardSerial->print(s);
-  }
-#ifdef SARA_R5_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
-  {
-    return _softSerial->print(s);
-  }
-#endif
-  else if (_i2cPort != NULL)
+  if (s == NULL)
+    return (false);
+
+  size_t offset = 1; // Skip the tag
+  while (*s != 0)
   {
-    return ((size_t)qwiicSwarmWriteChars(strlen(s), s));
+    if ((offset >= _backlogPending) || (backlogPendingChar(offset) != *s))
+      return (false);
+    offset++;
+    s++;
   }
+  return (true);
+}
 
-  return (size_t)0;
+// Copy the incomplete sentence (including the \n) into dest. Add a \0
+void SWARM_M138::backlogPendingCopy(char *dest, size_t destSize)
+{
+  if ((dest == NULL) || (destSize == 0))
+    return;
+
+  size_t destIndex = 0;
+  for (size_t offset = 1; (offset < _backlogPending) && (destIndex < (destSize - 1)); offset++) // Skip the tag
+    dest[destIndex++] = backlogPendingChar(offset);
+  dest[destIndex] = 0;
 }
 
-size_t SWARM_M138::hwWriteData(const char *buff, int len)
+// The incomplete sentence is now complete. result indicates if the sentence format and checksum are valid.
+// Check if it is the response we are waiting for.
+// If it is not, add it to the backlog - or prune it if it is invalid or not actionable.
+void SWARM_M138::backlogLineComplete(Swarm_M138_Error_e result)
 {
-  if (_hardSerial != NULL)
+  bool keep = (result == SWARM_M138_ERROR_SUCCESS); // Invalid sentences are never added to the backlog
+
+  if (result == SWARM_M138_ERROR_SUCCESS)
+    updateTelemetryCache(); // Cache the telemetry - even if it is pruned or it is a response
+
+  if ((_responseDest != NULL) && (_responseFound == false) && (_framerTag == _expectedTag)) // Are we waiting for this response?
   {
-    return _hardSerial->write((const uint8_t *)buff, len);
+    if (backlogPendingStartsWith(_expectedErrorStart)) // Error needs priority over response as response is often the beginning of error!
+    {
+      _responseFound = true;
+      _responseIsError = true;
+    }
+    else if (backlogPendingStartsWith(_expectedResponseStart))
+    {
+      _responseFound = true;
+    }
+
+    if (_responseFound)
+    {
+      backlogPendingCopy(_responseDest, _responseDestSize);
+      _responseResult = result;
+      keep = false; // The responses/errors are not added to the backlog
+    }
   }
-#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
+
+  if ((result != SWARM_M138_ERROR_SUCCESS) && (keep == false) && SWARM_M138_DEBUG(SWARM_M138_DEBUG_ERRORS))
+  {
+    _debugPort->print(F("backlogLineComplete: "));
+    _debugPort->println(modemErrorString(result));
+  }
+
+  // Prune any incoming non-actionable URC's.
+  // See issue #22. We only keep events which have a callback, otherwise the backlog
+  // fills up causing other problems.
+  if (keep && _backlogPrune)
   {
-    return _softSerial->write((const uint8_t *)buff, len);
+    keep = urcCallbackRegistered(_framerTag);
+#ifdef SWARM_M138_ENABLE_STATISTICS
+    if (keep == false)
+      _stats.urcsPruned++;
+#endif
   }
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  if (result != SWARM_M138_ERROR_SUCCESS)
+    _stats.invalidSentences++;
 #endif
-  else if (_i2cPort != NULL)
+
+  if (keep)
   {
-    return ((size_t)qwiicSwarmWriteChars(len, buff));
+    // Commit the sentence: store the tag in the first byte
+    _swarmBacklog[_backlogTail] = (char)_framerTag;
+    _backlogTail += _backlogPending;
+    if (_backlogTail >= SWARM_M138_BACKLOG_SIZE)
+      _backlogTail -= SWARM_M138_BACKLOG_SIZE;
+    _backlogUsed += _backlogPending;
+    _backlogLines++;
   }
 
-  return (size_t)0;
+  _backlogPending = 0;
+  _framerState = SWARM_M138_FRAMER_IDLE;
 }
 
-size_t SWARM_M138::hwWrite(const char c)
+// Pop the oldest complete sentence from the backlog. The \n is replaced with \0.
+// The sentence tag is returned in tag.
+// Return the length of the sentence. Return 0 if there are no complete sentences.
+size_t SWARM_M138::backlogPopLine(char *dest, size_t destSize, Swarm_M138_Sentence_Tag_e *tag)
 {
-  if (_hardSerial != NULL)
-  {
-    return _hardSerial->write(c);
-  }
-#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
-  {
-    return _softSerial->write(c);
-  }
-#endif
-  else if (_i2cPort != NULL)
-  {
-    return ((size_t)qwiicSwarmWriteChars((int)1, &c));
-  }
+  if ((_backlogLines == 0) || (dest == NULL) || (destSize == 0))
+    return (0);
 
-  return (size_t)0;
+  if (tag != NULL)
+    *tag = (Swarm_M138_Sentence_Tag_e)_swarmBacklog[_backlogHead];
+  _backlogHead++; // Skip the tag
+  if (_backlogHead >= SWARM_M138_BACKLOG_SIZE)
+    _backlogHead = 0;
+  _backlogUsed--;
+
+  size_t lineLen = 0;
+  bool endOfLine = false;
+  while ((endOfLine == false) && (_backlogUsed > 0))
+  {
+    char c = _swarmBacklog[_backlogHead++];
+    if (_backlogHead >= SWARM_M138_BACKLOG_SIZE)
+      _backlogHead = 0;
+    _backlogUsed--;
+    if (c == '\n')
+      endOfLine = true;
+    else if (lineLen < (destSize - 1))
+      dest[lineLen++] = c;
+  }
+  dest[lineLen] = 0;
+  _backlogLines--;
+
+  return (lineLen);
 }
 
-int SWARM_M138::hwAvailable(void)
+// Parse the incomplete line into the telemetry cache - if it is a valid $DT, $GJ, $GN, $GS, $PW or $RT
+// The rate responses ($DT 5*, $GN OK* etc.) and errors do not parse and are ignored
+void SWARM_M138::updateTelemetryCache(void)
 {
-  if (_hardSerial != NULL)
+  Swarm_M138_Telemetry_e entry;
+
+  switch (_framerTag)
   {
-    return ((int)_hardSerial->available());
+  case SWARM_M138_SENTENCE_TAG_DT: entry = SWARM_M138_TELEMETRY_DT; break;
+  case SWARM_M138_SENTENCE_TAG_GJ: entry = SWARM_M138_TELEMETRY_GJ; break;
+  case SWARM_M138_SENTENCE_TAG_GN: entry = SWARM_M138_TELEMETRY_GN; break;
+  case SWARM_M138_SENTENCE_TAG_GS: entry = SWARM_M138_TELEMETRY_GS; break;
+  case SWARM_M138_SENTENCE_TAG_PW: entry = SWARM_M138_TELEMETRY_PW; break;
+  case SWARM_M138_SENTENCE_TAG_RT: entry = SWARM_M138_TELEMETRY_RT; break;
+  default: return;
   }
-#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
+
+  char line[SWARM_M138_TELEMETRY_LINE_SIZE]; // Use the stack, not the heap
+  backlogPendingCopy(line, sizeof(line)); // The line may wrap around the end of the ring
+
+  bool parsed = false;
+  switch (entry)
   {
-    return ((int)_softSerial->available());
+  case SWARM_M138_TELEMETRY_DT: parsed = swarm_m138_parse_date_time(line, &_cachedDateTime); break;
+  case SWARM_M138_TELEMETRY_GJ: parsed = swarm_m138_parse_gps_jamming(line, &_cachedGpsJamming); break;
+  case SWARM_M138_TELEMETRY_GN: parsed = swarm_m138_parse_geospatial(line, &_cachedGeospatial); break;
+  case SWARM_M138_TELEMETRY_GS: parsed = swarm_m138_parse_gps_fix_quality(line, &_cachedGpsFixQuality); break;
+  case SWARM_M138_TELEMETRY_PW: parsed = swarm_m138_parse_power_status(line, &_cachedPowerStatus); break;
+  case SWARM_M138_TELEMETRY_RT: parsed = swarm_m138_parse_receive_test(line, &_cachedReceiveTest); break;
+  default: break;
   }
-#endif
-  else if (_i2cPort != NULL)
+
+  if (parsed)
   {
-    return (qwiicSwarmAvailable());
+    _telemetryMillis[entry] = millis();
+    _telemetryValid |= (uint8_t)(1 << entry);
   }
+}
 
-  return -1;
+// Check if the cache entry is valid and no older than maxAge millis
+// Any waiting serial data is framed first, so the freshest sentence is in the cache
+bool SWARM_M138::telemetryFresh(Swarm_M138_Telemetry_e entry, unsigned long maxAge)
+{
+  backlogFill();
+
+  if ((_telemetryValid & (1 << entry)) == 0)
+    return (false);
+
+  return ((millis() - _telemetryMillis[entry]) <= maxAge);
 }
 
-// Read len chars from the appropriate port. Store in buf
-int SWARM_M138::hwReadChars(char *buf, int len)
+////////////////
+// Transports //
+////////////////
+
+void SWARM_M138_HardwareSerial_Transport::begin(unsigned long baud)
 {
-  if (len <= 0)
-    return (len);
+  if (_serialPort != NULL)
+    _serialPort->begin(baud);
+}
 
-  if (buf == NULL)
+int SWARM_M138_HardwareSerial_Transport::available(void)
+{
+  if (_serialPort == NULL)
     return (-1);
+  return ((int)_serialPort->available());
+}
+
+// Read up to len bytes. readBytes lets the core copy in bulk where it can (e.g. ESP32 uartReadBytes)
+int SWARM_M138_HardwareSerial_Transport::read(char *dest, int len)
+{
+  if (_serialPort == NULL)
+    return (-1);
+  return ((int)_serialPort->readBytes(dest, (size_t)len));
+}
+
+size_t SWARM_M138_HardwareSerial_Transport::write(const char *buff, size_t len)
+{
+  if (_serialPort == NULL)
+    return (0);
+  return (_serialPort->write((const uint8_t *)buff, len));
+}
 
-  if (_hardSerial != NULL)
-  {
-    for (int i = 0; i < len; i++)
-    {
-      buf[i] = _hardSerial->read();
-    }
-    return (len);
-  }
 #ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
-  {
-    for (int i = 0; i < len; i++)
-    {
-      buf[i] = _softSerial->read();
-    }
-    return (len);
-  }
-#endif
-  else if (_i2cPort != NULL)
+void SWARM_M138_SoftwareSerial_Transport::begin(unsigned long baud)
+{
+  if (_serialPort != NULL)
   {
-    return (qwiicSwarmReadChars(len, buf));
+    _serialPort->end();
+    _serialPort->begin(baud);
   }
+}
 
-  return (-1);
+int SWARM_M138_SoftwareSerial_Transport::available(void)
+{
+  if (_serialPort == NULL)
+    return (-1);
+  return ((int)_serialPort->available());
+}
+
+int SWARM_M138_SoftwareSerial_Transport::read(char *dest, int len)
+{
+  if (_serialPort == NULL)
+    return (-1);
+  for (int i = 0; i < len; i++)
+    dest[i] = _serialPort->read();
+  return (len);
+}
 
+size_t SWARM_M138_SoftwareSerial_Transport::write(const char *buff, size_t len)
+{
+  if (_serialPort == NULL)
+    return (0);
+  return (_serialPort->write((const uint8_t *)buff, len));
 }
+#endif
 
 // I2C functions for Qwiic Swarm
 
+SWARM_M138_Qwiic_Transport::SWARM_M138_Qwiic_Transport(TwoWire *i2cPort, byte address)
+{
+  _i2cPort = i2cPort;
+  _address = address;
+  _lastI2cCheck = millis();
+  _burstMode = false;
+  _readChunk = QWIIC_SWARM_SER_PACKET_SIZE;
+  _pollInterval = QWIIC_SWARM_I2C_POLLING_WAIT_MS;
+  _writeRemaining = 0;
+  _writeCount = 0;
+  _writeChecksum = 0;
+}
+
+void SWARM_M138_Qwiic_Transport::setPort(TwoWire *i2cPort, byte address)
+{
+  _i2cPort = i2cPort;
+  _address = address;
+}
+
+// Burst mode: read in QWIIC_SWARM_BURST_PACKET_SIZE chunks and poll adaptively. See SWARM_M138::setQwiicBurstMode
+void SWARM_M138_Qwiic_Transport::setBurstMode(bool enable)
+{
+  _burstMode = enable;
+  _readChunk = enable ? QWIIC_SWARM_BURST_PACKET_SIZE : QWIIC_SWARM_SER_PACKET_SIZE;
+  _pollInterval = QWIIC_SWARM_I2C_POLLING_WAIT_MS;
+}
+
 // Check how many bytes Qwiic Swarm has available
-// Return -1 if it is less than QWIIC_SWARM_I2C_POLLING_WAIT_MS since the last check
-int SWARM_M138::qwiicSwarmAvailable(void)
+// Return -1 if it is less than _pollInterval since the last check
+int SWARM_M138_Qwiic_Transport::available(void)
 {
   int bytesAvailable = -1;
 
-  if (millis() - _lastI2cCheck >= QWIIC_SWARM_I2C_POLLING_WAIT_MS)
+  if (_i2cPort == NULL)
+    return (-1);
+
+  if (millis() - _lastI2cCheck >= _pollInterval)
   {
     //Check how many serial bytes are waiting to be read
     _i2cPort->beginTransmission((uint8_t)_address); // Talk to the I2C device
@@ -5563,19 +7206,29 @@ int SWARM_M138::qwiicSwarmAvailable(void)
 
     //Put off checking to avoid excessive I2C bus traffic - but only if zero bytes are available
     if (bytesAvailable == 0)
+    {
       _lastI2cCheck = millis();
+      if (_burstMode == true) // Back off while the modem is idle
+      {
+        _pollInterval *= 2;
+        if (_pollInterval > QWIIC_SWARM_I2C_POLLING_WAIT_MAX_MS)
+          _pollInterval = QWIIC_SWARM_I2C_POLLING_WAIT_MAX_MS;
+      }
+    }
+    else if (bytesAvailable > 0)
+      _pollInterval = QWIIC_SWARM_I2C_POLLING_WAIT_MS; // Data is flowing. Poll at the full rate
   }
 
   return (bytesAvailable);
 }
 
 // Read len bytes from Qwiic Swarm, store in dest
-int SWARM_M138::qwiicSwarmReadChars(int len, char *dest)
+int SWARM_M138_Qwiic_Transport::read(char *dest, int len)
 {
   if (len <= 0)
     return (len);
 
-  if (dest == NULL)
+  if ((dest == NULL) || (_i2cPort == NULL))
     return (0);
 
   int bytesRead = 0;
@@ -5585,15 +7238,15 @@ int SWARM_M138::qwiicSwarmReadChars(int len, char *dest)
   _i2cPort->beginTransmission((uint8_t)_address); // Talk to the I2C device
   _i2cPort->write(QWIIC_SWARM_DATA_REG); // Point to the serial buffer
   _i2cPort->endTransmission(); // Send data and release the bus (the 841 (WireS) doesn't like it if the Master holds the bus!)
-  while (len > QWIIC_SWARM_SER_PACKET_SIZE) // If there are _more_ than SER_PACKET_SIZE bytes to be read
+  while (len > (int)_readChunk) // If there are _more_ than _readChunk bytes to be read
   {
-    _i2cPort->requestFrom((uint8_t)_address, (uint8_t)QWIIC_SWARM_SER_PACKET_SIZE, (uint8_t)false); // Request SER_PACKET_SIZE bytes, don't release the bus
+    _i2cPort->requestFrom((uint8_t)_address, _readChunk, (uint8_t)false); // Request _readChunk bytes, don't release the bus
     while (_i2cPort->available())
     {
       dest[bytesRead] = _i2cPort->read(); // Read and store each byte
       bytesRead++;
     }
-    len -= QWIIC_SWARM_SER_PACKET_SIZE; // Decrease the number of bytes available by SER_PACKET_SIZE
+    len -= _readChunk; // Decrease the number of bytes available by _readChunk
   }
   _i2cPort->requestFrom((uint8_t)_address, (uint8_t)len); // Request remaining bytes, release the bus
   while (_i2cPort->available())
@@ -5606,121 +7259,170 @@ int SWARM_M138::qwiicSwarmReadChars(int len, char *dest)
 }
 
 // Write serial data to Qwiic Swarm
-int SWARM_M138::qwiicSwarmWriteChars(int len, const char *dest)
+size_t SWARM_M138_Qwiic_Transport::write(const char *buff, size_t len)
 {
-  if (len <= 0)
-    return (len);
+  if (len == 0)
+    return (0);
+
+  writeBegin(len);
+  return (writeStream(buff, len));
+}
+
+// Start a streamed write of exactly len bytes
+void SWARM_M138_Qwiic_Transport::writeBegin(size_t len)
+{
+  _writeRemaining = len;
+  _writeCount = 0;
+  _writeChecksum = 0;
+}
 
-  if (dest == NULL)
+// Write the next len bytes of a streamed write.
+// Each I2C transaction carries up to (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3) bytes.
+// The final transaction is followed by the checksum of all the bytes
+size_t SWARM_M138_Qwiic_Transport::writeStream(const char *buff, size_t len)
+{
+  if ((buff == NULL) || (_i2cPort == NULL))
     return (0);
 
   size_t i = 0;
-  size_t nexti;
-  uint16_t checksum = 0;
 
-  while (len > (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3)) // If there are too many bytes to send all in one go
+  while ((i < len) && (_writeRemaining > 0))
   {
-    nexti = i + (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3);
-    _i2cPort->beginTransmission((uint8_t)_address);
-    _i2cPort->write(QWIIC_SWARM_DATA_REG); // Point to the serial data 'register'
-    for (; i < nexti; i++)
+    if (_writeCount == 0) // Start the next transaction
     {
-        _i2cPort->write(dest[i]); // Write each byte
-        checksum += (uint16_t)dest[i]; // Update the checksum
+      _i2cPort->beginTransmission((uint8_t)_address);
+      _i2cPort->write(QWIIC_SWARM_DATA_REG); // Point to the serial data 'register'
     }
-    len -= (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3); // Decrease the number of bytes still to send
-    _i2cPort->endTransmission(); // Send data and release the bus (the 841 (WireS) doesn't like it if the Master holds the bus!)
-  }
 
-  // There are now <= (TINY_I2C_BUFFER_LENGTH - 3) bytes left to send, so send them and then release the bus
-  _i2cPort->beginTransmission((uint8_t)_address);
-  _i2cPort->write(QWIIC_SWARM_DATA_REG); // Point to the 'serial register'
-  while (len > 0)
-  {
-    _i2cPort->write(dest[i]);
-    checksum += (uint16_t)dest[i];
-    len--;
+    _i2cPort->write(buff[i]); // Write each byte
+    _writeChecksum += (uint16_t)buff[i]; // Update the checksum
+    _writeCount++;
+    _writeRemaining--;
     i++;
+
+    if ((_writeCount + _writeRemaining) <= (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3)) // Is this the final transaction?
+    {
+      if (_writeRemaining == 0)
+      {
+        _i2cPort->write((uint8_t)(_writeChecksum >> 8));
+        _i2cPort->write((uint8_t)(_writeChecksum & 0xFF));
+        if (_i2cPort->endTransmission() != 0) //Send data and release bus
+          if ((SWARM_M138_DEBUG_LEVEL >= SWARM_M138_DEBUG_ERRORS) && (_debugPort != NULL))
+            _debugPort->println(F("SWARM_M138_Qwiic_Transport::write: I2C write was not successful!"));
+        _writeCount = 0;
+        _pollInterval = QWIIC_SWARM_I2C_POLLING_WAIT_MS; // A response is likely. Poll at the full rate
+      }
+    }
+    else if (_writeCount == (QWIIC_SWARM_I2C_BUFFER_LENGTH - 3)) // Transaction is full. There is more to come
+    {
+      _i2cPort->endTransmission(); // Send data and release the bus (the 841 (WireS) doesn't like it if the Master holds the bus!)
+      _writeCount = 0;
+    }
   }
-  _i2cPort->write((uint8_t)(checksum >> 8));
-  _i2cPort->write((uint8_t)(checksum & 0xFF));
-  if (_i2cPort->endTransmission() != 0) //Send data and release bus
-    if (_printDebug == true)
-      _debugPort->println(F("qwiicSwarmWriteChars: I2C write was not successful!"));
 
-  return ((int)i);
+  return (i);
 }
 
-void SWARM_M138::beginSerial(unsigned long baud)
+// Ring buffer transport for data received by an ISR or DMA
+
+SWARM_M138_Ring_Transport::SWARM_M138_Ring_Transport(uint8_t *ring, size_t size, Print *txPort)
 {
-  if (_hardSerial != NULL)
-  {
-    _hardSerial->begin(baud);
-  }
-#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  else if (_softSerial != NULL)
+  _ring = ring;
+  _size = size;
+  _txPort = txPort;
+  _head = 0;
+  _tail = 0;
+  _overruns = 0;
+}
+
+// Producer: copy len bytes into the ring. One slot is always left empty, so a full ring can be told from an empty one
+size_t SWARM_M138_Ring_Transport::push(const uint8_t *data, size_t len)
+{
+  size_t head = _head;
+  size_t tail = _tail;
+  size_t stored = 0;
+
+  while (stored < len)
   {
-    _softSerial->end();
-    _softSerial->begin(baud);
+    size_t next = head + 1;
+    if (next >= _size)
+      next = 0;
+    if (next == tail) // Full
+    {
+      _overruns += len - stored;
+      break;
+    }
+    _ring[head] = data[stored++];
+    head = next;
   }
-#endif
-  delay(100);
+
+  _head = head; // Publish the new data
+  return (stored);
 }
 
-// Allocate memory
-char *SWARM_M138::swarm_m138_alloc_char(size_t num)
+// Producer (DMA): the ring has been written up to (but not including) head
+void SWARM_M138_Ring_Transport::setHead(size_t head)
 {
-  return ((char *)new char[num]);
+  if (head >= _size)
+    head = 0;
+  _head = head;
 }
-void SWARM_M138::swarm_m138_free_char(char *freeMe)
+
+uint32_t SWARM_M138_Ring_Transport::getOverruns(void)
 {
-  delete[] freeMe;
+  return (_overruns);
 }
 
-//This prunes the backlog of non-actionable events. If new actionable events are added, you must modify the if statement.
-void SWARM_M138::pruneBacklog()
+int SWARM_M138_Ring_Transport::available(void)
 {
-  char *event;
+#ifdef ARDUINO_ARCH_AVR
+  noInterrupts(); // size_t is 16 bits on AVR: it can't be read atomically
+  size_t head = _head;
+  interrupts();
+#else
+  size_t head = _head;
+#endif
+  size_t tail = _tail;
 
-  char *_pruneBuffer = swarm_m138_alloc_char(_RxBuffSize);
-  if (_pruneBuffer == NULL)
-  {
-    if (_printDebug == true)
-      _debugPort->println(F("pruneBacklog: not enough memory for _pruneBuffer! Clearing the backlog. Sorry!"));
-    memset(_swarmBacklog, 0, _RxBuffSize); //Clear out backlog buffer.
-    return;
-  }
-  memset(_pruneBuffer, 0, _RxBuffSize); // Clear the _pruneBuffer
-
-  char *preservedEvent;
-  event = strtok_r(_swarmBacklog, "\n", &preservedEvent); // Look for an 'event' - something ending in \n
-
-  while (event != NULL) //If event is actionable, add it to pruneBuffer.
-  {
-    // These are the events we want to keep so they can be processed by checkUnsolicitedMsg.
-    // See issue #22. We only keep events which have a callback, otherwise the backlog
-    // fills up causing other problems.
-    if (((strstr(event, "$DT ") != NULL) && (_swarmDateTimeCallback != NULL))
-        || ((strstr(event, "$GJ ") != NULL) && (_swarmGpsJammingCallback != NULL))
-        || ((strstr(event, "$GN ") != NULL) && (_swarmGeospatialCallback != NULL))
-        || ((strstr(event, "$GS ") != NULL) && (_swarmGpsFixQualityCallback != NULL))
-        || ((strstr(event, "$PW ") != NULL) && (_swarmPowerStatusCallback != NULL))
-        || ((strstr(event, "$RD ") != NULL) && (_swarmReceiveMessageCallback != NULL))
-        || ((strstr(event, "$RT ") != NULL) && (_swarmReceiveTestCallback != NULL))
-        || ((strstr(event, "$SL ") != NULL) && (_swarmSleepWakeCallback != NULL))
-        || ((strstr(event, "$M138 ") != NULL) && (_swarmModemStatusCallback != NULL))
-        || ((strstr(event, "$TD ") != NULL) && (_swarmTransmitDataCallback != NULL)))
-    {
-      strcat(_pruneBuffer, event); // The URCs are all readable text so using strcat is OK
-      strcat(_pruneBuffer, "\n"); // strtok blows away delimiter, but we want that for later.
-    }
+  if (head >= tail)
+    return ((int)(head - tail));
+  return ((int)(_size - tail + head));
+}
 
-    event = strtok_r(NULL, "\n", &preservedEvent); // Walk though any remaining events
-  }
+// Copy up to len bytes out of the ring - as (at most) two contiguous spans
+int SWARM_M138_Ring_Transport::read(char *dest, int len)
+{
+  int avail = available();
+  if (len > avail)
+    len = avail;
+  if (len <= 0)
+    return (0);
+
+  size_t tail = _tail;
+  size_t span = _size - tail; // The bytes before the end of the ring
+  if (span > (size_t)len)
+    span = (size_t)len;
+  memcpy(dest, &_ring[tail], span);
+  if (span < (size_t)len) // Wrap around
+    memcpy(&dest[span], _ring, (size_t)len - span);
+
+  tail += (size_t)len;
+  if (tail >= _size)
+    tail -= _size;
+#ifdef ARDUINO_ARCH_AVR
+  noInterrupts(); // size_t is 16 bits on AVR: an ISR calling push must not see half of _tail
+  _tail = tail; // Release the space to the producer
+  interrupts();
+#else
+  _tail = tail; // Release the space to the producer
+#endif
 
-  memset(_swarmBacklog, 0, _RxBuffSize); //Clear out backlog buffer.
-  memcpy(_swarmBacklog, _pruneBuffer, strlen(_pruneBuffer)); //Copy the pruned buffer back into the backlog
+  return (len);
+}
 
-  swarm_m138_free_char(_pruneBuffer);
-  delete event;
+size_t SWARM_M138_Ring_Transport::write(const char *buff, size_t len)
+{
+  if (_txPort == NULL)
+    return (0);
+  return (_txPort->write((const uint8_t *)buff, len));
 }
@@ -82,6 +82,9 @@
 
 /** Modem Serial Baud Rate */
 #define SWARM_M138_SERIAL_BAUD_RATE 115200 ///< The modem serial baud rate is 115200 and cannot be changed
+#ifndef SWARM_M138_RX_WINDOW_MILLIS
+#define SWARM_M138_RX_WINDOW_MILLIS 12     ///< The default idle window: how long to wait for the rest of a part-received sentence
+#endif
 
 /** Default I2C address used by the Qwiic Swarm Breakout. Can be changed. */
 #define SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS 0x52 ///< The default I2C address for the SparkFun Qwiic Swarm Breakout
@@ -95,6 +98,76 @@
 #define SWARM_M138_MEM_ALLOC_FV 37  ///< E.g. 2021-12-14T21:27:41,v1.5.0-rc4 . Should be 31 but maybe each v# could be three digits?
 #define SWARM_M138_MEM_ALLOC_MS 128 ///< Allocate enough storage to hold the $M138 Modem Status debug or error text. GUESS! TO DO: confirm the true max length
 
+/** Buffer sizes
+ *
+ * Each of these can be overridden in your build flags, e.g. -DSWARM_M138_BACKLOG_SIZE=1024 for a deep backlog on a gateway,
+ * or -DSWARM_M138_BACKLOG_SIZE=256 -DSWARM_M138_RESPONSE_SIZE=256 for a lean AVR build which only sends and receives short messages.
+ * They change the size of the class (and the library), so they must be defined globally - not just in your sketch.
+ * Each command only allocates the space its own response needs: SHORT, MEDIUM or the full SWARM_M138_RESPONSE_SIZE.
+ * Unsolicited messages which arrive while a command is waiting go into the backlog, not the response.
+ */
+#ifndef SWARM_M138_BACKLOG_SIZE
+#define SWARM_M138_BACKLOG_SIZE 512 ///< The backlog ring buffer: holds the unsolicited messages until checkUnsolicitedMsg processes them
+#endif
+#ifndef SWARM_M138_RESPONSE_SIZE
+#define SWARM_M138_RESPONSE_SIZE 512 ///< The longest response: $MM AI= and $MT messages carry up to SWARM_M138_MAX_PACKET_LENGTH_HEX characters
+#endif
+#ifndef SWARM_M138_EVENT_SIZE
+#define SWARM_M138_EVENT_SIZE SWARM_M138_RESPONSE_SIZE ///< The longest unsolicited message: $RD carries up to SWARM_M138_MAX_PACKET_LENGTH_HEX characters
+#endif
+#ifndef SWARM_M138_RESPONSE_SIZE_SHORT
+#define SWARM_M138_RESPONSE_SIZE_SHORT 48 ///< OK, ERR, rates, counts, $DT, $GJ, $GP, $GS and $TD OK. "$TD ERR," + SWARM_M138_MAX_CMD_ERROR_LEN + "*cs" fits
+#endif
+#ifndef SWARM_M138_RESPONSE_SIZE_MEDIUM
+#define SWARM_M138_RESPONSE_SIZE_MEDIUM 96 ///< $CS, $FV, $GN, $PW and $RT
+#endif
+#ifndef SWARM_M138_ASYNC_RESPONSE_SIZE
+#define SWARM_M138_ASYNC_RESPONSE_SIZE 64 ///< Enough for $DT, $TD OK and $MM DELETED responses - and their errors
+#endif
+#ifndef SWARM_M138_COMMAND_QUEUE_LENGTH
+#define SWARM_M138_COMMAND_QUEUE_LENGTH 8 ///< The maximum number of queued commands
+#endif
+#if (SWARM_M138_RESPONSE_SIZE < SWARM_M138_RESPONSE_SIZE_MEDIUM) || (SWARM_M138_RESPONSE_SIZE_MEDIUM < SWARM_M138_RESPONSE_SIZE_SHORT)
+#error SWARM_M138_RESPONSE_SIZE must be at least SWARM_M138_RESPONSE_SIZE_MEDIUM, which must be at least SWARM_M138_RESPONSE_SIZE_SHORT
+#endif
+#if (SWARM_M138_EVENT_SIZE > SWARM_M138_BACKLOG_SIZE)
+#error SWARM_M138_BACKLOG_SIZE must be at least SWARM_M138_EVENT_SIZE: the backlog must be able to hold the longest unsolicited message
+#endif
+
+/** Zero-heap mode
+ *
+ * By default, each command allocates (new) and frees (delete) its own command and response buffers.
+ * On small processors (SAMD21, AVR) this can fragment the heap over time, leading to SWARM_M138_ERROR_MEM_ALLOC.
+ *
+ * Uncomment the next line (or add -DSWARM_M138_STATIC_BUFFERS to your build flags) and the SWARM_M138 class
+ * will own one command arena and one response arena instead, shared by all commands. There is no heap activity after begin().
+ * The option changes the size of the class, so it must be defined globally - not just in your sketch.
+ *
+ * Worst-case RAM footprint of the buffers (per SWARM_M138 object) in zero-heap mode:
+ *   Backlog             SWARM_M138_BACKLOG_SIZE       512 bytes
+ *   checkUnsolicitedMsg SWARM_M138_EVENT_SIZE         512 bytes
+ *   Response arena      SWARM_M138_RESPONSE_SIZE      512 bytes
+ *   Command arena       SWARM_M138_COMMAND_ARENA_SIZE 238 bytes
+ *   commandError        SWARM_M138_MAX_CMD_ERROR_LEN   32 bytes
+ *   Scratchpads         2 * 21                         42 bytes
+ *   Async response      SWARM_M138_ASYNC_RESPONSE_SIZE 64 bytes (in both modes)
+ *   Command queue       8 * 76 (on 32-bit processors) 608 bytes
+ *   Total                                            2520 bytes (plus a few bytes of flags) - with the default buffer sizes
+ * In the default (heap) mode, the same buffers are allocated on demand: begin() allocates the backlog and commandError;
+ * checkUnsolicitedMsg and each command allocate the rest for the duration of the call. The command queue is allocated on first use.
+ */
+//#define SWARM_M138_STATIC_BUFFERS
+
+#define SWARM_M138_COMMAND_ARENA_SIZE (4 + 9 + 12 + 14 + 2 + SWARM_M138_MAX_PACKET_LENGTH_BYTES + 5) ///< The longest command: $TD AI=65535,HD=34819200,ET=2147483647,"(192 chars)"*cs\n\0 . Binary $TD commands are streamed
+#ifndef SWARM_M138_TX_CHUNK_SIZE
+#define SWARM_M138_TX_CHUNK_SIZE 48     ///< Binary $TD commands are converted to ASCII Hex and written in chunks of this size. Must be >= 48
+#endif
+#if (SWARM_M138_TX_CHUNK_SIZE < 48)
+#error SWARM_M138_TX_CHUNK_SIZE must be at least 48: the command header is written as one chunk
+#endif
+#define SWARM_M138_SCRATCH_SLOTS 2      ///< Zero-heap mode: the maximum number of scratchpads in use at any one time (fwd and rev)
+#define SWARM_M138_SCRATCH_SLOT_SIZE 21 ///< Zero-heap mode: the size of each scratchpad. Up to 20 digits plus null
+
 /** Suported Commands */
 const char SWARM_M138_COMMAND_CONFIGURATION[] = "$CS";   ///< Configuration Settings
 const char SWARM_M138_COMMAND_DATE_TIME_STAT[] = "$DT";  ///< Date/Time Status
@@ -114,6 +187,80 @@ const char SWARM_M138_COMMAND_SLEEP[] = "$SL";           ///< Sleep Mode
 const char SWARM_M138_COMMAND_MODEM_STAT[] = "$M138";    ///< Modem Status
 const char SWARM_M138_COMMAND_TX_DATA[] = "$TD";         ///< Transmit Data
 
+/** An enum defining the sentence (talker) tags. The framer extracts these from each sentence as it arrives */
+typedef enum
+{
+  SWARM_M138_SENTENCE_TAG_UNKNOWN = 0, ///< Not a recognised tag
+  SWARM_M138_SENTENCE_TAG_CS,          ///< $CS Configuration Settings
+  SWARM_M138_SENTENCE_TAG_DT,          ///< $DT Date/Time Status
+  SWARM_M138_SENTENCE_TAG_FV,          ///< $FV Firmware Version
+  SWARM_M138_SENTENCE_TAG_GJ,          ///< $GJ GPS Jamming/Spoofing Indication
+  SWARM_M138_SENTENCE_TAG_GN,          ///< $GN Geospatial Information
+  SWARM_M138_SENTENCE_TAG_GP,          ///< $GP GPIO1 Control
+  SWARM_M138_SENTENCE_TAG_GS,          ///< $GS GPS Fix Quality
+  SWARM_M138_SENTENCE_TAG_MM,          ///< $MM Messages Received Management
+  SWARM_M138_SENTENCE_TAG_MT,          ///< $MT Messages to Transmit Management
+  SWARM_M138_SENTENCE_TAG_PO,          ///< $PO Power Off
+  SWARM_M138_SENTENCE_TAG_PW,          ///< $PW Power Status
+  SWARM_M138_SENTENCE_TAG_RD,          ///< $RD Receive Data Message
+  SWARM_M138_SENTENCE_TAG_RS,          ///< $RS Restart Device
+  SWARM_M138_SENTENCE_TAG_RT,          ///< $RT Receive Test
+  SWARM_M138_SENTENCE_TAG_SL,          ///< $SL Sleep Mode
+  SWARM_M138_SENTENCE_TAG_M138,        ///< $M138 Modem Status
+  SWARM_M138_SENTENCE_TAG_TD,          ///< $TD Transmit Data
+  SWARM_M138_SENTENCE_TAG_MAX          ///< The number of tags
+} Swarm_M138_Sentence_Tag_e;
+
+/** Statistics
+ *
+ * Uncomment the next line (or add -DSWARM_M138_ENABLE_STATISTICS to your build flags) and the SWARM_M138 class
+ * will count every command's round-trip time and result, plus the backlog and delay() activity. Read them with getStats().
+ * Without it, the statistics compile out completely. The option changes the size of the class (by ~530 bytes),
+ * so it must be defined globally - not just in your sketch.
+ */
+//#define SWARM_M138_ENABLE_STATISTICS
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+/** A struct to hold the statistics for one command tag */
+typedef struct
+{
+  uint32_t count;          // The number of commands which have completed: with a response, an ERR or a timeout
+  uint32_t timeouts;       // The number of SWARM_M138_ERROR_TIMEOUT
+  uint32_t checksumErrors; // The number of SWARM_M138_ERROR_INVALID_CHECKSUM (and INVALID_FORMAT) responses
+  uint32_t errors;         // The number of SWARM_M138_ERROR_ERR responses
+  uint32_t minMillis;      // The shortest round-trip time in milliseconds (timeouts are not included)
+  uint32_t maxMillis;      // The longest round-trip time in milliseconds (timeouts are not included)
+  uint32_t totalMillis;    // The sum of the round-trip times. mean = totalMillis / (count - timeouts)
+} Swarm_M138_Command_Stats_t;
+
+/** A struct to hold the statistics - see getStats */
+typedef struct
+{
+  Swarm_M138_Command_Stats_t commands[SWARM_M138_SENTENCE_TAG_MAX]; // Indexed by Swarm_M138_Sentence_Tag_e
+  uint32_t backlogHighWater;    // The most bytes ever held in the backlog
+  uint32_t backlogBytesDropped; // The number of bytes dropped because they did not fit in the backlog
+  uint32_t urcsDropped;         // The number of sentences dropped because they did not fit in the backlog
+  uint32_t urcsPruned;          // The number of non-actionable (no callback) unsolicited sentences pruned while waiting for a response
+  uint32_t invalidSentences;    // The number of sentences with an invalid format or checksum
+  uint32_t delayMillis;         // The time spent blocked in delay() in milliseconds
+  uint32_t heapAllocations;     // The number of heap allocations made by the commands and checkUnsolicitedMsg. Always zero in zero-heap mode
+} Swarm_M138_Stats_t;
+#endif
+
+/** Debug level
+ *
+ * Selects which debug messages are compiled in. enableDebugging / disableDebugging still turn them on and off at run time.
+ *   0 : none. The debug code and its F() strings are removed completely - saving flash and a test per event
+ *   1 : errors only: memory allocation failures, backlog overflows, invalid sentences and I2C write failures
+ *   2 : everything (the default): the errors plus every command, response and event
+ * Add e.g. -DSWARM_M138_DEBUG_LEVEL=0 to your build flags. It must be defined globally, so the library is compiled with it.
+ */
+#ifndef SWARM_M138_DEBUG_LEVEL
+#define SWARM_M138_DEBUG_LEVEL 2
+#endif
+#define SWARM_M138_DEBUG_ERRORS 1  ///< Debug level: errors only
+#define SWARM_M138_DEBUG_VERBOSE 2 ///< Debug level: everything
+
 /** An enum defining the command result */
 typedef enum
 {
@@ -125,7 +272,10 @@ typedef enum
   SWARM_M138_ERROR_INVALID_CHECKSUM, ///< Indicates the command response checksum was invalid
   SWARM_M138_ERROR_INVALID_RATE,     ///< Indicates the message rate was invalid
   SWARM_M138_ERROR_INVALID_MODE,     ///< Indicates the GPIO1 pin mode was invalid
-  SWARM_M138_ERROR_ERR               ///< Command input error (ERR) - the error is copied into commandError
+  SWARM_M138_ERROR_ERR,              ///< Command input error (ERR) - the error is copied into commandError
+  SWARM_M138_ERROR_BUSY,             ///< An asynchronous command is still in progress
+  SWARM_M138_ERROR_QUEUE_FULL,       ///< The command queue is full - or the command is too long to be queued
+  SWARM_M138_ERROR_EXPIRED           ///< The message expired before it could be queued
 } Swarm_M138_Error_e;
 #define SWARM_M138_SUCCESS SWARM_M138_ERROR_SUCCESS ///< Hey, it worked!
 
@@ -164,6 +314,16 @@ typedef struct
   float speed;  // km/h
 } Swarm_M138_GeospatialData_t;
 
+/** A fixed-point version of Swarm_M138_GeospatialData_t. No floats are involved in parsing or storing it */
+typedef struct
+{
+  int32_t lat;    // Microdegrees: +/- 90000000
+  int32_t lon;    // Microdegrees: +/- 180000000
+  int32_t alt;    // m
+  int32_t course; // Degrees: 0..359 : 0=north, 90=east, 180=south, and 270=west
+  int32_t speed;  // km/h
+} Swarm_M138_GeospatialData_Fixed_t;
+
 /** Enum for the GPIO1 pin modes */
 typedef enum
 {
@@ -219,6 +379,27 @@ typedef struct
   float temp;      // CPU Temperature in degrees C to one decimal point
 } Swarm_M138_Power_Status_t;
 
+/** A fixed-point version of Swarm_M138_Power_Status_t. All values are scaled by 1000 */
+typedef struct
+{
+  int32_t cpu_millivolts; // Voltage measured at input to the CPU in mV
+  int32_t unused1;
+  int32_t unused2;
+  int32_t unused3;
+  int32_t temp_millidegrees; // CPU Temperature in thousandths of a degree C
+} Swarm_M138_Power_Status_Fixed_t;
+
+/** A struct to describe one message in a transmitBatch */
+typedef struct
+{
+  const uint8_t *data; // The binary data
+  size_t len;          // The length of the data. Max is SWARM_M138_MAX_PACKET_LENGTH_BYTES
+  bool useAppID;       // If true, appID is included in the command
+  uint16_t appID;      // The application ID: 0 to 64999
+  uint32_t hold;       // Hold for up to this many seconds. 0 == no hold
+  uint32_t epoch;      // Expire the message at this epoch. 0 == no expiry
+} Swarm_M138_Tx_Descriptor_t;
+
 /** A struct to hold the receive test results */
 typedef struct
 {
@@ -231,6 +412,34 @@ typedef struct
   uint32_t sat_id;                // Device ID of satellite heard (hexadecimal)
 } Swarm_M138_Receive_Test_t;
 
+// The Swarm_M138_Modem_Snapshot_t fields. getModemSnapshot reads them in this order
+#define SWARM_M138_SNAPSHOT_DATE_TIME 0x0001       ///< $DT @
+#define SWARM_M138_SNAPSHOT_GEOSPATIAL 0x0002      ///< $GN @
+#define SWARM_M138_SNAPSHOT_GPS_FIX_QUALITY 0x0004 ///< $GS @
+#define SWARM_M138_SNAPSHOT_POWER_STATUS 0x0008    ///< $PW @
+#define SWARM_M138_SNAPSHOT_GPS_JAMMING 0x0010     ///< $GJ @
+#define SWARM_M138_SNAPSHOT_RECEIVE_TEST 0x0020    ///< $RT @
+#define SWARM_M138_SNAPSHOT_RX_COUNT 0x0040        ///< $MM C=**
+#define SWARM_M138_SNAPSHOT_RX_UNREAD_COUNT 0x0080 ///< $MM C=U
+#define SWARM_M138_SNAPSHOT_UNSENT_COUNT 0x0100    ///< $MT C=U
+#define SWARM_M138_SNAPSHOT_ALL 0x01FF             ///< Every field
+#define SWARM_M138_SNAPSHOT_FIELDS 9               ///< The number of fields
+
+/** A struct to hold the state of the modem - as read by getModemSnapshot */
+typedef struct
+{
+  uint16_t valid;                                  // One SWARM_M138_SNAPSHOT_ bit for each field which was read successfully
+  Swarm_M138_DateTimeData_t dateTime;              // $DT
+  Swarm_M138_GeospatialData_Fixed_t geospatial;    // $GN
+  Swarm_M138_GPS_Fix_Quality_t gpsFixQuality;      // $GS
+  Swarm_M138_Power_Status_Fixed_t powerStatus;     // $PW
+  Swarm_M138_GPS_Jamming_Indication_t gpsJamming;  // $GJ
+  Swarm_M138_Receive_Test_t receiveTest;           // $RT
+  uint16_t rxCount;                                // The count of all received messages
+  uint16_t rxUnreadCount;                          // The count of the unread received messages
+  uint16_t unsentCount;                            // The count of the unsent messages
+} Swarm_M138_Modem_Snapshot_t;
+
 /** An enum for the sleep mode wake cause */
 typedef enum
 {
@@ -259,6 +468,155 @@ typedef enum
   SWARM_M138_MODEM_STATUS_INVALID
 } Swarm_M138_Modem_Status_e;
 
+/** The transport: how the SWARM_M138 class talks to the modem
+ *
+ * Implementations are provided for HardwareSerial, SoftwareSerial and Qwiic Swarm (I2C).
+ * SWARM_M138_Ring_Transport takes its receive data from a ring buffer filled by an ISR or DMA.
+ * Pass any of these - or your own - to SWARM_M138::begin(SWARM_M138_Transport &transport).
+ */
+class SWARM_M138_Transport
+{
+public:
+  SWARM_M138_Transport(void) { _debugPort = NULL; }
+  virtual ~SWARM_M138_Transport(void) {}
+
+  virtual void begin(unsigned long baud) { (void)baud; } // Begin the port - if the transport owns it
+  virtual int available(void) = 0;                         // Return the number of bytes waiting to be read. -1 if the port is not available
+  virtual int read(char *dest, int len) = 0;               // Read up to len bytes into dest. Return the number of bytes read
+  virtual size_t write(const char *buff, size_t len) = 0;  // Write len bytes
+  virtual void writeBegin(size_t len) { (void)len; }      // Start a streamed write of exactly len bytes
+  virtual size_t writeStream(const char *buff, size_t len) { return (write(buff, len)); } // Write the next chunk of a streamed write
+  virtual bool needsRxWindow(void) { return (true); }     // Return false if available() is always up to date: no idle window is needed
+  virtual TwoWire *getI2cPort(void) { return (NULL); }     // Return the I2C (Wire) port - if the transport uses I2C
+  virtual byte getI2cAddress(void) { return (0); }         // Return the I2C address - if the transport uses I2C
+
+  void setDebugPort(Stream *debugPort) { _debugPort = debugPort; } // NULL disables debug messages
+
+protected:
+  Stream *_debugPort; // The stream to send debug messages to. NULL if debug is disabled
+};
+
+/** Transport for a HardwareSerial port */
+class SWARM_M138_HardwareSerial_Transport : public SWARM_M138_Transport
+{
+public:
+  SWARM_M138_HardwareSerial_Transport(HardwareSerial *serialPort = NULL) { _serialPort = serialPort; }
+  void setPort(HardwareSerial *serialPort) { _serialPort = serialPort; }
+
+  void begin(unsigned long baud);
+  int available(void);
+  int read(char *dest, int len);
+  size_t write(const char *buff, size_t len);
+
+private:
+  HardwareSerial *_serialPort;
+};
+
+#ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
+/** Transport for a SoftwareSerial port */
+class SWARM_M138_SoftwareSerial_Transport : public SWARM_M138_Transport
+{
+public:
+  SWARM_M138_SoftwareSerial_Transport(SoftwareSerial *serialPort = NULL) { _serialPort = serialPort; }
+  void setPort(SoftwareSerial *serialPort) { _serialPort = serialPort; }
+
+  void begin(unsigned long baud);
+  int available(void);
+  int read(char *dest, int len);
+  size_t write(const char *buff, size_t len);
+
+private:
+  SoftwareSerial *_serialPort;
+};
+#endif
+
+// Support for Qwiic Swarm
+#define QWIIC_SWARM_I2C_POLLING_WAIT_MS 2 // Avoid pounding the I2C bus. Wait at least 2ms between calls to available
+#define QWIIC_SWARM_I2C_POLLING_WAIT_MAX_MS 8 // Burst mode: back off to this when idle. The ATtiny841 buffers the serial data meanwhile
+// Define the I2C 'registers'
+#define QWIIC_SWARM_LEN_REG 0xFD  // The serial length regsiter: 2 bytes (MSB, LSB) indicating how many serial characters are available to be read
+#define QWIIC_SWARM_DATA_REG 0xFF // The serial data register: used to read and write serial data from/to the modem
+// Define the maximum number of serial bytes to be requested from the ATtiny841
+#define QWIIC_SWARM_SER_PACKET_SIZE 8
+// Qwiic Iridium ATtiny841 I2C buffer length
+#define QWIIC_SWARM_I2C_BUFFER_LENGTH 32
+// The host Wire buffer length. Each core names it differently
+#if defined(I2C_BUFFER_LENGTH)
+#define QWIIC_SWARM_HOST_I2C_BUFFER_LENGTH I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define QWIIC_SWARM_HOST_I2C_BUFFER_LENGTH BUFFER_LENGTH
+#else
+#define QWIIC_SWARM_HOST_I2C_BUFFER_LENGTH 32
+#endif
+// Burst mode: request the largest chunk both buffers can handle
+#if (QWIIC_SWARM_HOST_I2C_BUFFER_LENGTH < QWIIC_SWARM_I2C_BUFFER_LENGTH)
+#define QWIIC_SWARM_BURST_PACKET_SIZE QWIIC_SWARM_HOST_I2C_BUFFER_LENGTH
+#else
+#define QWIIC_SWARM_BURST_PACKET_SIZE QWIIC_SWARM_I2C_BUFFER_LENGTH
+#endif
+
+/** Transport for the Qwiic Swarm (I2C) */
+class SWARM_M138_Qwiic_Transport : public SWARM_M138_Transport
+{
+public:
+  SWARM_M138_Qwiic_Transport(TwoWire *i2cPort = NULL, byte address = SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS);
+  void setPort(TwoWire *i2cPort, byte address = SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS);
+  void setBurstMode(bool enable = true); // Read in larger I2C chunks and poll adaptively
+
+  int available(void);                              // Check how many serial bytes Qwiic Swarm has in its buffer
+  int read(char *dest, int len);                    // Read bytes from Qwiic Swarm
+  size_t write(const char *buff, size_t len);       // Write bytes to Qwiic Swarm
+  void writeBegin(size_t len);                      // Start a streamed write of exactly len bytes
+  size_t writeStream(const char *buff, size_t len); // Write the next bytes of a streamed write
+  TwoWire *getI2cPort(void) { return (_i2cPort); }
+  byte getI2cAddress(void) { return (_address); }
+
+private:
+  TwoWire *_i2cPort;                 // The I2C (Wire) port for the Qwiic Swarm
+  byte _address;                     // I2C address of the Qwiic Swarm
+  unsigned long _lastI2cCheck;
+  bool _burstMode;                   // Burst mode: read in QWIIC_SWARM_BURST_PACKET_SIZE chunks and poll adaptively
+  uint8_t _readChunk;                // The number of serial bytes to request from the ATtiny841 in each requestFrom
+  unsigned long _pollInterval;       // The current minimum interval between calls to available
+  size_t _writeRemaining;            // Streamed write: the number of bytes still to be written
+  size_t _writeCount;                // Streamed write: the number of bytes in the current I2C transaction
+  uint16_t _writeChecksum;           // Streamed write: the checksum of the bytes written so far
+};
+
+/** Transport for serial data received by an ISR or DMA into a ring buffer
+ *
+ * The ring has a single producer and a single consumer (the SWARM_M138 class). Either:
+ *   the producer (e.g. a UART interrupt, or an ESP32 UART event task) copies the data in with push(); or
+ *   the ring is itself a DMA circular buffer and the producer calls setHead() with the DMA write position
+ *   (e.g. size - __HAL_DMA_GET_COUNTER on STM32). The DMA must not lap the consumer: size the ring generously.
+ * available() is always up to date, so no idle window is needed when sending commands.
+ * Commands are written to txPort.
+ */
+class SWARM_M138_Ring_Transport : public SWARM_M138_Transport
+{
+public:
+  SWARM_M138_Ring_Transport(uint8_t *ring, size_t size, Print *txPort);
+
+  size_t push(const uint8_t *data, size_t len); // Producer: copy len bytes into the ring. Return the number stored
+  void setHead(size_t head);                    // Producer (DMA): the ring has been written up to (but not including) head
+  uint32_t getOverruns(void);                   // The number of bytes push could not store because the ring was full
+
+  int available(void);
+  int read(char *dest, int len); // Copy up to len bytes out of the ring - as (at most) two contiguous spans
+  size_t write(const char *buff, size_t len);
+  bool needsRxWindow(void) { return (false); }
+
+private:
+  uint8_t *_ring;
+  size_t _size;
+  Print *_txPort;
+  volatile size_t _head; // Written by the producer
+  volatile size_t _tail; // Written by the consumer
+  volatile uint32_t _overruns;
+};
+
+class SWARM_M138_Tx_Ledger; // See SparkFun_Swarm_M138_Tx_Ledger.h
+
 /** Communication interface for the Swarm M138 satellite modem. */
 class SWARM_M138
 {
@@ -276,11 +634,22 @@ public:
 #endif
   bool begin(HardwareSerial &hardSerial);
   bool begin(byte deviceAddress = SFE_QWIIC_SWARM_DEFAULT_I2C_ADDRESS, TwoWire &wirePort = Wire);
+  bool begin(SWARM_M138_Transport &transport); // Use any transport. E.g. a SWARM_M138_Ring_Transport
 
   /** Debug prints */
   void enableDebugging(Stream &debugPort = Serial); // Turn on debug printing. If user doesn't specify then Serial will be used.
   void disableDebugging(void);                      // Turn off debug printing
 
+  /** Transport */
+  void setQwiicBurstMode(bool enable = true); // Read in larger I2C chunks and poll adaptively
+  void setRxWindowMillis(unsigned long window = SWARM_M138_RX_WINDOW_MILLIS); // Set how long to wait for the rest of a part-received sentence
+  unsigned long getRxWindowMillis(void);
+  SWARM_M138_Transport *getTransport(void); // Return the transport. NULL if begin has not been called
+
+  /** Telemetry cache */
+  void clearTelemetryCache(void); // Forget the cached $DT, $GJ, $GN, $GS, $PW and $RT messages
+  uint32_t getUnixTime(void);     // The current Unix time - extrapolated from the cached $DT message. 0 if it is not known
+
   /** Commands */
 
   /** Configuration Settings */
@@ -290,6 +659,7 @@ public:
 
   /** Date/Time */
   Swarm_M138_Error_e getDateTime(Swarm_M138_DateTimeData_t *dateTime); // Get the most recent $DT message
+  Swarm_M138_Error_e getDateTime(Swarm_M138_DateTimeData_t *dateTime, unsigned long maxAge); // Use the cached $DT message if it is no older than maxAge millis
   Swarm_M138_Error_e getDateTimeRate(uint32_t *rate);                  // Query the current $DT rate
   Swarm_M138_Error_e setDateTimeRate(uint32_t rate);                   // Set the rate of $DT messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
 
@@ -298,11 +668,15 @@ public:
 
   /** GPS Jamming/Spoofing Indication */
   Swarm_M138_Error_e getGpsJammingIndication(Swarm_M138_GPS_Jamming_Indication_t *jamming); // Get the most recent $GJ message
+  Swarm_M138_Error_e getGpsJammingIndication(Swarm_M138_GPS_Jamming_Indication_t *jamming, unsigned long maxAge); // Use the cached $GJ message if it is no older than maxAge millis
   Swarm_M138_Error_e getGpsJammingIndicationRate(uint32_t *rate);                           // Query the current $GJ rate
   Swarm_M138_Error_e setGpsJammingIndicationRate(uint32_t rate);                            // Set the rate of $GJ messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
 
   /** Geospatial information */
   Swarm_M138_Error_e getGeospatialInfo(Swarm_M138_GeospatialData_t *info); // Get the most recent $GN message
+  Swarm_M138_Error_e getGeospatialInfo(Swarm_M138_GeospatialData_Fixed_t *info); // Get the most recent $GN message in fixed-point
+  Swarm_M138_Error_e getGeospatialInfo(Swarm_M138_GeospatialData_t *info, unsigned long maxAge); // Use the cached $GN message if it is no older than maxAge millis
+  Swarm_M138_Error_e getGeospatialInfo(Swarm_M138_GeospatialData_Fixed_t *info, unsigned long maxAge); // Use the cached $GN message if it is no older than maxAge millis
   Swarm_M138_Error_e getGeospatialInfoRate(uint32_t *rate);                // Query the current $GN rate
   Swarm_M138_Error_e setGeospatialInfoRate(uint32_t rate);                 // Set the rate of $GN messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
 
@@ -313,6 +687,7 @@ public:
 
   /** GPS fix quality */
   Swarm_M138_Error_e getGpsFixQuality(Swarm_M138_GPS_Fix_Quality_t *fixQuality); // Get the most recent $GS message
+  Swarm_M138_Error_e getGpsFixQuality(Swarm_M138_GPS_Fix_Quality_t *fixQuality, unsigned long maxAge); // Use the cached $GS message if it is no older than maxAge millis
   Swarm_M138_Error_e getGpsFixQualityRate(uint32_t *rate);                       // Query the current $GS rate
   Swarm_M138_Error_e setGpsFixQualityRate(uint32_t rate);                        // Set the rate of $GS messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
 
@@ -321,6 +696,9 @@ public:
 
   /** Power Status */
   Swarm_M138_Error_e getPowerStatus(Swarm_M138_Power_Status_t *powerStatus); // Get the most recent $PW message
+  Swarm_M138_Error_e getPowerStatus(Swarm_M138_Power_Status_Fixed_t *powerStatus); // Get the most recent $PW message in fixed-point
+  Swarm_M138_Error_e getPowerStatus(Swarm_M138_Power_Status_t *powerStatus, unsigned long maxAge); // Use the cached $PW message if it is no older than maxAge millis
+  Swarm_M138_Error_e getPowerStatus(Swarm_M138_Power_Status_Fixed_t *powerStatus, unsigned long maxAge); // Use the cached $PW message if it is no older than maxAge millis
   Swarm_M138_Error_e getPowerStatusRate(uint32_t *rate);                     // Query the current $PW rate
   Swarm_M138_Error_e setPowerStatusRate(uint32_t rate);                      // Set the rate of $PW messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
   Swarm_M138_Error_e getTemperature(float *temperature);                     // Get the most recent temperature
@@ -331,6 +709,7 @@ public:
 
   /** Receive Test */
   Swarm_M138_Error_e getReceiveTest(Swarm_M138_Receive_Test_t *rxTest); // Get the most recent $RT message
+  Swarm_M138_Error_e getReceiveTest(Swarm_M138_Receive_Test_t *rxTest, unsigned long maxAge); // Use the cached $RT message if it is no older than maxAge millis
   Swarm_M138_Error_e getReceiveTestRate(uint32_t *rate);                // Query the current $RT rate
   Swarm_M138_Error_e setReceiveTestRate(uint32_t rate);                 // Set the rate of $RT messages. 0 == Disable. Max is 2147483647 (2^31 - 1)
 
@@ -350,6 +729,10 @@ public:
   Swarm_M138_Error_e readMessage(uint64_t msg_id, char *asciiHex, size_t len, uint32_t *epoch = NULL, uint16_t *appID = NULL);        // Read the message with ID. Message contents are copied to asciiHex as ASCII Hex
   Swarm_M138_Error_e readOldestMessage(char *asciiHex, size_t len, uint64_t *msg_id, uint32_t *epoch = NULL, uint16_t *appID = NULL); // Read the oldest message. Message contents are copied to asciiHex. ID is copied to id.
   Swarm_M138_Error_e readNewestMessage(char *asciiHex, size_t len, uint64_t *msg_id, uint32_t *epoch = NULL, uint16_t *appID = NULL); // Read the oldest message. Message contents are copied to asciiHex. ID is copied to id.
+  Swarm_M138_Error_e drainRxMessages(void (*callback)(const uint8_t *data, size_t len, const uint64_t *msg_id,
+                                                      const uint32_t *epoch, const uint16_t *appID, void *context),
+                                     uint16_t maxCount = 0xFFFF, bool deleteAfterRead = true,
+                                     void *context = NULL, uint16_t *count = NULL); // Read (and delete) the unread messages, oldest first. Each is decoded to binary and passed to callback
 
   /** Messages To Transmit Management */
   Swarm_M138_Error_e getUnsentMessageCount(uint16_t *count);                                                                     // Return count of all unsent messages
@@ -357,6 +740,12 @@ public:
   Swarm_M138_Error_e deleteAllTxMessages(void);                                                                                  // Delete all unsent messages
   Swarm_M138_Error_e listTxMessage(uint64_t msg_id, char *asciiHex, size_t len, uint32_t *epoch = NULL, uint16_t *appID = NULL); // List unsent message with ID
   //Swarm_M138_Error_e listTxMessagesIDs(uint64_t *ids, uint16_t maxCount); // List the IDs of all unsent messages. ** Not supported with modem firmware >= v2.0.0 **
+  void setTxLedger(SWARM_M138_Tx_Ledger *ledger); // Record every queued message - and its delivery - in ledger. NULL disables the ledger
+  SWARM_M138_Tx_Ledger *getTxLedger(void);
+
+  /** Modem Snapshot */
+  // Read several (by default all) of the above in one call. The queries are sent back to back, sharing one response buffer
+  Swarm_M138_Error_e getModemSnapshot(Swarm_M138_Modem_Snapshot_t *snapshot, uint16_t fields = SWARM_M138_SNAPSHOT_ALL);
 
   /** Transmit Data */
   // The application ID is optional. Valid appID's are: 0 to 64999. Swarm reserves use of 65000 - 65535.
@@ -372,22 +761,87 @@ public:
   Swarm_M138_Error_e transmitBinaryHold(const uint8_t *data, size_t len, uint64_t *msg_id, uint32_t hold, uint16_t appID);    // Send binary data. Assigned message ID is returned in id. Hold for up to hold seconds
   Swarm_M138_Error_e transmitBinaryExpire(const uint8_t *data, size_t len, uint64_t *msg_id, uint32_t epoch);                 // Send binary data. Assigned message ID is returned in id. Expire message at epoch
   Swarm_M138_Error_e transmitBinaryExpire(const uint8_t *data, size_t len, uint64_t *msg_id, uint32_t epoch, uint16_t appID); // Send binary data. Assigned message ID is returned in id. Expire message at epoch
+  Swarm_M138_Error_e transmitBatch(const Swarm_M138_Tx_Descriptor_t *messages, size_t count, uint64_t *msg_ids,
+                                   Swarm_M138_Error_e *status = NULL);                                                        // Send a batch of binary messages back-to-back. Assigned message IDs are returned in msg_ids
 
   /**  Process unsolicited messages from the modem. Call the callbacks if required */
   bool checkUnsolicitedMsg(void);
+  uint32_t getBacklogBytesDropped(void); // Return the number of serial bytes dropped because they did not fit in the backlog
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  /** Statistics */
+  void getStats(Swarm_M138_Stats_t *stats); // Copy the statistics into stats
+  void resetStats(void);                    // Clear the statistics
+#endif
+
+  /** Asynchronous (non-blocking) commands
+   *  Only one command can be in progress at a time. Call poll() regularly (from loop()) to move it forward.
+   *  The callback is called from poll() (or checkUnsolicitedMsg) when the response arrives, or the command times out.
+   *  The blocking methods return SWARM_M138_ERROR_BUSY while an asynchronous command is in progress.
+   */
+  Swarm_M138_Error_e sendCommandAsync(const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
+                                      void (*callback)(Swarm_M138_Error_e err, const char *response, void *context), void *context = NULL,
+                                      char *responseDest = NULL, size_t destSize = 0,
+                                      unsigned long timeout = SWARM_M138_STANDARD_RESPONSE_TIMEOUT);                                // Send a command, e.g. "$RT @". The asterix and checksum are added
+  Swarm_M138_Error_e getDateTimeAsync(void (*callback)(Swarm_M138_Error_e err, const Swarm_M138_DateTimeData_t *dateTime, void *context),
+                                      void *context = NULL);                                                                        // Get the most recent $DT message
+  Swarm_M138_Error_e deleteRxMessageAsync(uint64_t msg_id, void (*callback)(Swarm_M138_Error_e err, void *context), void *context = NULL); // Delete RX message with ID
+  Swarm_M138_Error_e transmitBinaryAsync(const uint8_t *data, size_t len,
+                                         void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context),
+                                         void *context = NULL);                                                                     // Send binary data. Assigned message ID is passed to the callback
+  Swarm_M138_Error_e transmitBinaryAsync(const uint8_t *data, size_t len, uint16_t appID,
+                                         void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context),
+                                         void *context = NULL);                                                                     // Send binary data. Assigned message ID is passed to the callback
+  bool poll(void);   // Non-blocking: process any received data. Complete the asynchronous command. Call the callbacks
+  bool isBusy(void); // Return true if an asynchronous command is in progress
+
+  /** The command queue
+   *  Commands are formatted and checksummed when they are queued. poll() sends each in turn - as soon as the previous one
+   *  completes - using the asynchronous command engine. The queue holds SWARM_M138_COMMAND_QUEUE_LENGTH commands.
+   */
+  Swarm_M138_Error_e queueCommand(const char *command, const char *expectedResponseStart,
+                                  void (*callback)(Swarm_M138_Error_e err, const char *response, void *context) = NULL, void *context = NULL,
+                                  unsigned long timeout = SWARM_M138_STANDARD_RESPONSE_TIMEOUT); // Queue a command, e.g. "$FV". The asterix and checksum are added
+  Swarm_M138_Error_e queueSetRate(const char *command, uint32_t rate,
+                                  void (*callback)(Swarm_M138_Error_e err, const char *response, void *context) = NULL,
+                                  void *context = NULL);            // Queue a rate command, e.g. queueSetRate(SWARM_M138_COMMAND_DATE_TIME_STAT, 5)
+  Swarm_M138_Error_e flushCommandQueue(void);                       // Blocking: wait until every queued command has completed. Return the first error
+  uint8_t getCommandQueueCount(void);                               // Return the number of commands waiting in the queue
+
+  /** Event counters: incremented by checkUnsolicitedMsg (and poll) while counting is enabled - whether or not a callback is set */
+  void enableEventCounting(bool enable = true); // Parse $TD and $SL messages even when no callback is set, so they are counted
+  uint32_t getTransmitSentCount(void); // The number of $TD SENT messages received
+  uint32_t getSleepWakeCount(void);    // The number of $SL WAKE messages received
 
   /** Callbacks (called by checkUnsolicitedMsg) */
   void setDateTimeCallback(void (*swarmDateTimeCallback)(const Swarm_M138_DateTimeData_t *dateTime));                                                                             // Set callback for $DT
   void setGpsJammingCallback(void (*swarmGpsJammingCallback)(const Swarm_M138_GPS_Jamming_Indication_t *jamming));                                                                // Set callback for $GJ
   void setGeospatialInfoCallback(void (*swarmGeospatialCallback)(const Swarm_M138_GeospatialData_t *info));                                                                       // Set callback for $GN
+  void setGeospatialInfoFixedCallback(void (*swarmGeospatialFixedCallback)(const Swarm_M138_GeospatialData_Fixed_t *info));                                                  // Set fixed-point callback for $GN
   void setGpsFixQualityCallback(void (*swarmGpsFixQualityCallback)(const Swarm_M138_GPS_Fix_Quality_t *fixQuality));                                                              // Set callback for $GS
   void setPowerStatusCallback(void (*swarmPowerStatusCallback)(const Swarm_M138_Power_Status_t *status));                                                                         // Set callback for $PW
+  void setPowerStatusFixedCallback(void (*swarmPowerStatusFixedCallback)(const Swarm_M138_Power_Status_Fixed_t *status));                                                      // Set fixed-point callback for $PW
   void setReceiveMessageCallback(void (*swarmReceiveMessageCallback)(const uint16_t *appID, const int16_t *rssi, const int16_t *snr, const int16_t *fdev, const char *asciiHex)); // Set callback for $RD
   void setReceiveTestCallback(void (*swarmReceiveTestCallback)(const Swarm_M138_Receive_Test_t *rxTest));                                                                         // Set callback for $RT
   void setSleepWakeCallback(void (*swarmSleepWakeCallback)(Swarm_M138_Wake_Cause_e cause));                                                                                       // Set callback for $SL WAKE
   void setModemStatusCallback(void (*swarmModemStatusCallback)(Swarm_M138_Modem_Status_e status, const char *data));                                                              // Set callback for $M138. data could be NULL for messages like BOOT_RUNNING
   void setTransmitDataCallback(void (*swarmTransmitDataCallback)(const int16_t *rssi_sat, const int16_t *snr, const int16_t *fdev, const uint64_t *msg_id));                      // Set callback for $TD SENT
 
+  /** Callbacks with a context (called by checkUnsolicitedMsg) - e.g. a pointer to the object which handles this modem.
+   *  These can be used instead of, or as well as, the callbacks above. NULL == no callback */
+  void setDateTimeCallback(void (*callback)(const Swarm_M138_DateTimeData_t &dateTime, void *context), void *context);
+  void setGpsJammingCallback(void (*callback)(const Swarm_M138_GPS_Jamming_Indication_t &jamming, void *context), void *context);
+  void setGeospatialInfoCallback(void (*callback)(const Swarm_M138_GeospatialData_t &info, void *context), void *context);
+  void setGeospatialInfoFixedCallback(void (*callback)(const Swarm_M138_GeospatialData_Fixed_t &info, void *context), void *context);
+  void setGpsFixQualityCallback(void (*callback)(const Swarm_M138_GPS_Fix_Quality_t &fixQuality, void *context), void *context);
+  void setPowerStatusCallback(void (*callback)(const Swarm_M138_Power_Status_t &status, void *context), void *context);
+  void setPowerStatusFixedCallback(void (*callback)(const Swarm_M138_Power_Status_Fixed_t &status, void *context), void *context);
+  void setReceiveMessageCallback(void (*callback)(bool hasAppID, uint16_t appID, int16_t rssi, int16_t snr, int16_t fdev, const char *asciiHex, void *context), void *context);
+  void setReceiveTestCallback(void (*callback)(const Swarm_M138_Receive_Test_t &rxTest, void *context), void *context);
+  void setSleepWakeCallback(void (*callback)(Swarm_M138_Wake_Cause_e cause, void *context), void *context);
+  void setModemStatusCallback(void (*callback)(Swarm_M138_Modem_Status_e status, const char *data, void *context), void *context);
+  void setTransmitDataCallback(void (*callback)(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context), void *context);
+
   /** Convert modem status enum etc. into printable text */
   const char *modemStatusString(Swarm_M138_Modem_Status_e status);
   const char *modemErrorString(Swarm_M138_Error_e error);
@@ -398,10 +852,13 @@ public:
   char *commandError;
 
 private:
-  HardwareSerial *_hardSerial;
+  SWARM_M138_Transport *_transport; // The transport in use. NULL until begin is called
+  SWARM_M138_HardwareSerial_Transport _hardSerialTransport;
 #ifdef SWARM_M138_SOFTWARE_SERIAL_ENABLED
-  SoftwareSerial *_softSerial;
+  SWARM_M138_SoftwareSerial_Transport _softSerialTransport;
 #endif
+  SWARM_M138_Qwiic_Transport _qwiicTransport;
+  void attachTransport(SWARM_M138_Transport *transport);
 
   unsigned long _baud; // Baud rate for serial communication with the modem
 
@@ -410,32 +867,176 @@ private:
 
   bool _checkUnsolicitedMsgReentrant; // Prevent reentry of checkUnsolicitedMsg - just in case it gets called from a callback
 
-#define _RxBuffSize 512
-  // Wait for this many millis for any more serial characters to arrive.
+  // If a sentence is part-received, wait for this many millis for any more serial characters to arrive.
   // On ESP32, Serial.available only provides an update every ~120 bytes during the reception of long messages...
   // We need to set _rxWindowMillis to slightly longer than (120 * 10 / 115200)
   // https://gitter.im/espressif/arduino-esp32?at=5e25d6370a1cf54144909c85
-  const unsigned long _rxWindowMillis = 12;
-  char *_swarmBacklog;                     // Allocated in SWARM_M138::begin
+  // The window is skipped for transports whose available() is always up to date (SWARM_M138_Ring_Transport)
+  unsigned long _rxWindowMillis;
+  char *_swarmBacklog;                     // Allocated in SWARM_M138::begin. Used as a ring buffer
+
+  // The backlog ring buffer: see backlogAppend for details
+  size_t _backlogHead;            // Index of the first character of the oldest complete line
+  size_t _backlogTail;            // Index of the first character of the incomplete line
+  size_t _backlogUsed;            // Number of characters in the complete lines
+  size_t _backlogPending;         // Number of characters in the incomplete line
+  size_t _backlogLines;           // Number of complete lines
+  bool _backlogDiscarding;        // True if we are discarding the rest of a line which did not fit
+  bool _backlogPrune;             // True if non-actionable lines should be pruned (not added to the backlog)
+  uint32_t _backlogBytesDropped;  // Count of the bytes dropped because they did not fit
+#define SWARM_M138_BACKLOG_FILL_CHUNK 32 // backlogFill reads the serial data in chunks of this size
+
+  // The NMEA sentence framer - see backlogAppend
+  typedef enum
+  {
+    SWARM_M138_FRAMER_IDLE = 0,  // Waiting for a $
+    SWARM_M138_FRAMER_TAG,       // Receiving the tag
+    SWARM_M138_FRAMER_BODY,      // Receiving the body. Waiting for the *
+    SWARM_M138_FRAMER_CHECKSUM1, // Waiting for the first checksum character
+    SWARM_M138_FRAMER_CHECKSUM2, // Waiting for the second checksum character
+    SWARM_M138_FRAMER_END,       // Waiting for the \n
+    SWARM_M138_FRAMER_INVALID    // The sentence is invalid. Waiting for the \n
+  } Swarm_M138_Framer_State_e;
+  Swarm_M138_Framer_State_e _framerState;
+  uint8_t _framerChecksum;         // The checksum - accumulated as each character arrives
+  uint8_t _framerExpectedChecksum; // The checksum from the two checksum characters
+  uint32_t _framerPackedTag;       // The tag characters - packed into a uint32_t
+  uint8_t _framerTagLength;        // The number of tag characters
+  Swarm_M138_Sentence_Tag_e _framerTag;
+
+  // The response we are waiting for - see waitForResponse and backlogLineComplete
+  const char *_expectedResponseStart;
+  const char *_expectedErrorStart;
+  char *_responseDest;
+  size_t _responseDestSize;
+  bool _responseFound;
+  bool _responseIsError;
+  Swarm_M138_Error_e _responseResult;  // The framer result for the response: format and checksum
+  Swarm_M138_Sentence_Tag_e _expectedTag;
+
+  // The asynchronous command - see sendCommandAsync and pollAsyncCommand
+  bool _asyncPending;
+  unsigned long _asyncStart;
+  unsigned long _asyncTimeout;
+  char _asyncResponse[SWARM_M138_ASYNC_RESPONSE_SIZE]; // Used when the user does not provide a responseDest
+  void (SWARM_M138::*_asyncComplete)(Swarm_M138_Error_e err, const char *response); // Parses the response and calls the user's callback
+  void *_asyncContext;
+  void (*_asyncCommandCallback)(Swarm_M138_Error_e err, const char *response, void *context);
+  void (*_asyncDateTimeCallback)(Swarm_M138_Error_e err, const Swarm_M138_DateTimeData_t *dateTime, void *context);
+  void (*_asyncMsgIdCallback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context);
+  void (*_asyncStatusCallback)(Swarm_M138_Error_e err, void *context);
+  bool _asyncTxHasAppID; // The appID of the pending transmitBinaryAsync - for the ledger
+  uint16_t _asyncTxAppID;
+
+  // The command queue - see queueCommand
+#define SWARM_M138_QUEUED_COMMAND_SIZE 32       // Enough for $MM D=18446744073709551615*cs\n\0
+#define SWARM_M138_QUEUED_RESPONSE_START_SIZE 16 // Enough for $MM DELETED
+  typedef struct
+  {
+    char command[SWARM_M138_QUEUED_COMMAND_SIZE]; // The formatted command: including the checksum and line feed
+    char expectedResponseStart[SWARM_M138_QUEUED_RESPONSE_START_SIZE];
+    char expectedErrorStart[SWARM_M138_QUEUED_RESPONSE_START_SIZE];
+    unsigned long timeout;
+    void (*callback)(Swarm_M138_Error_e err, const char *response, void *context);
+    void *context;
+  } Swarm_M138_Queued_Command_t;
+  Swarm_M138_Queued_Command_t *_commandQueue; // A ring of SWARM_M138_COMMAND_QUEUE_LENGTH commands. Allocated on first use
+  uint8_t _commandQueueHead;                  // Index of the oldest queued command
+  uint8_t _commandQueueCount;                 // The number of queued commands - including the one in progress
+  bool _commandQueueSending;                  // True if the oldest queued command has been sent
+  Swarm_M138_Error_e _commandQueueError;      // The first error since the queue was last empty
+
+  // The telemetry cache - see updateTelemetryCache
+  // The most recent valid $DT, $GJ, $GN, $GS, $PW and $RT sentences - unsolicited or responses - plus the millis when they arrived
+#define SWARM_M138_TELEMETRY_LINE_SIZE 96 // Enough for the longest $RT sentence
+  typedef enum
+  {
+    SWARM_M138_TELEMETRY_DT = 0,
+    SWARM_M138_TELEMETRY_GJ,
+    SWARM_M138_TELEMETRY_GN,
+    SWARM_M138_TELEMETRY_GS,
+    SWARM_M138_TELEMETRY_PW,
+    SWARM_M138_TELEMETRY_RT,
+    SWARM_M138_TELEMETRY_MAX
+  } Swarm_M138_Telemetry_e;
+  Swarm_M138_DateTimeData_t _cachedDateTime;
+  Swarm_M138_GPS_Jamming_Indication_t _cachedGpsJamming;
+  Swarm_M138_GeospatialData_Fixed_t _cachedGeospatial;
+  Swarm_M138_GPS_Fix_Quality_t _cachedGpsFixQuality;
+  Swarm_M138_Power_Status_Fixed_t _cachedPowerStatus;
+  Swarm_M138_Receive_Test_t _cachedReceiveTest;
+  unsigned long _telemetryMillis[SWARM_M138_TELEMETRY_MAX];
+  uint8_t _telemetryValid; // One bit per Swarm_M138_Telemetry_e
+
+#ifdef SWARM_M138_ENABLE_STATISTICS
+  // The statistics - see getStats
+  Swarm_M138_Stats_t _stats;
+  uint32_t _statsBytesDroppedBase; // _backlogBytesDropped when the statistics were reset
+  void statsRecordCommand(Swarm_M138_Sentence_Tag_e tag, Swarm_M138_Error_e err, unsigned long elapsed); // Record a completed command
+#endif
+  void swarmDelay(unsigned long ms); // delay - counted in the statistics
+
+#ifdef SWARM_M138_STATIC_BUFFERS
+  // Zero-heap mode: the buffers are owned by the class
+  char _swarmBacklogArena[SWARM_M138_BACKLOG_SIZE];                           // _swarmBacklog points here
+  char _swarmRxArena[SWARM_M138_EVENT_SIZE];                                  // Used by checkUnsolicitedMsg
+  char _responseArena[SWARM_M138_RESPONSE_SIZE];                              // Shared by all command responses
+  char _commandArena[SWARM_M138_COMMAND_ARENA_SIZE];                          // Shared by all commands
+  char _scratchArena[SWARM_M138_SCRATCH_SLOTS][SWARM_M138_SCRATCH_SLOT_SIZE]; // Scratchpads (fwd, rev etc.)
+  char _commandErrorArena[SWARM_M138_MAX_CMD_ERROR_LEN];                      // commandError points here
+  Swarm_M138_Queued_Command_t _commandQueueArena[SWARM_M138_COMMAND_QUEUE_LENGTH]; // _commandQueue points here
+  bool _commandArenaInUse;
+  bool _responseArenaInUse;
+  uint8_t _scratchInUse; // One bit per scratchpad
+#endif
 
   // Callbacks for unsolicited messages
   void (*_swarmDateTimeCallback)(const Swarm_M138_DateTimeData_t *dateTime);
   void (*_swarmGpsJammingCallback)(const Swarm_M138_GPS_Jamming_Indication_t *jamming);
   void (*_swarmGeospatialCallback)(const Swarm_M138_GeospatialData_t *info);
+  void (*_swarmGeospatialFixedCallback)(const Swarm_M138_GeospatialData_Fixed_t *info);
   void (*_swarmGpsFixQualityCallback)(const Swarm_M138_GPS_Fix_Quality_t *fixQuality);
   void (*_swarmPowerStatusCallback)(const Swarm_M138_Power_Status_t *status);
+  void (*_swarmPowerStatusFixedCallback)(const Swarm_M138_Power_Status_Fixed_t *status);
   void (*_swarmReceiveMessageCallback)(const uint16_t *appID, const int16_t *rssi, const int16_t *snr, const int16_t *fdev, const char *asciiHex);
   void (*_swarmReceiveTestCallback)(const Swarm_M138_Receive_Test_t *rxTest);
   void (*_swarmSleepWakeCallback)(Swarm_M138_Wake_Cause_e cause);
   void (*_swarmModemStatusCallback)(Swarm_M138_Modem_Status_e status, const char *data);
   void (*_swarmTransmitDataCallback)(const int16_t *rssi_sat, const int16_t *snr, const int16_t *fdev, const uint64_t *id);
 
+  // Callbacks with a context - and their contexts
+  void (*_swarmDateTimeContextCallback)(const Swarm_M138_DateTimeData_t &dateTime, void *context);
+  void *_swarmDateTimeContext;
+  void (*_swarmGpsJammingContextCallback)(const Swarm_M138_GPS_Jamming_Indication_t &jamming, void *context);
+  void *_swarmGpsJammingContext;
+  void (*_swarmGeospatialContextCallback)(const Swarm_M138_GeospatialData_t &info, void *context);
+  void *_swarmGeospatialContext;
+  void (*_swarmGeospatialFixedContextCallback)(const Swarm_M138_GeospatialData_Fixed_t &info, void *context);
+  void *_swarmGeospatialFixedContext;
+  void (*_swarmGpsFixQualityContextCallback)(const Swarm_M138_GPS_Fix_Quality_t &fixQuality, void *context);
+  void *_swarmGpsFixQualityContext;
+  void (*_swarmPowerStatusContextCallback)(const Swarm_M138_Power_Status_t &status, void *context);
+  void *_swarmPowerStatusContext;
+  void (*_swarmPowerStatusFixedContextCallback)(const Swarm_M138_Power_Status_Fixed_t &status, void *context);
+  void *_swarmPowerStatusFixedContext;
+  void (*_swarmReceiveMessageContextCallback)(bool hasAppID, uint16_t appID, int16_t rssi, int16_t snr, int16_t fdev, const char *asciiHex, void *context);
+  void *_swarmReceiveMessageContext;
+  void (*_swarmReceiveTestContextCallback)(const Swarm_M138_Receive_Test_t &rxTest, void *context);
+  void *_swarmReceiveTestContext;
+  void (*_swarmSleepWakeContextCallback)(Swarm_M138_Wake_Cause_e cause, void *context);
+  void *_swarmSleepWakeContext;
+  void (*_swarmModemStatusContextCallback)(Swarm_M138_Modem_Status_e status, const char *data, void *context);
+  void *_swarmModemStatusContext;
+  void (*_swarmTransmitDataContextCallback)(int16_t rssi_sat, int16_t snr, int16_t fdev, uint64_t msg_id, void *context);
+  void *_swarmTransmitDataContext;
+  uint32_t _transmitSentCount; // The number of $TD SENT messages
+  SWARM_M138_Tx_Ledger *_txLedger; // Records the queued messages. NULL if not required
+  uint32_t _sleepWakeCount;    // The number of $SL WAKE messages
+  bool _eventCounting;         // Parse $TD and $SL messages even when no callback is set
+
   // Add the two NMEA checksum bytes and line feed to a command
   void addChecksumLF(char *command);
 
-  // Check if the response / message format and checksum is valid
-  Swarm_M138_Error_e checkChecksum(char *startPosition);
-
   // Extract the error from the command response
   Swarm_M138_Error_e extractCommandError(char *startPosition);
 
@@ -443,13 +1044,41 @@ private:
   Swarm_M138_Error_e sendCommandWithResponse(const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
                                              char *responseDest, size_t destSize, unsigned long commandTimeout = SWARM_M138_STANDARD_RESPONSE_TIMEOUT);
 
-  // Send a command (don't wait for a response)
-  void sendCommand(const char *command);
+  // Send a command (don't wait for a response). Optionally skip draining the serial port first
+  void sendCommand(const char *command, bool drain = true);
+  void rxWindowDrain(void); // Copy any incoming serial data into the backlog before sending a command
+  unsigned long rxWindow(void); // The idle window: zero if the transport does not need one
+  bool backlogMidSentence(void); // Return true if a sentence is part-received
 
   // Wait for an expected response or error (don't send a command)
   Swarm_M138_Error_e waitForResponse(const char *expectedResponseStart, const char *expectedErrorStart,
                                      char *responseDest, size_t destSize, unsigned long timeout = SWARM_M138_STANDARD_RESPONSE_TIMEOUT);
 
+  // Tell backlogLineComplete which response to look for. Get the result once it has been found. Stop looking
+  void responseExpect(const char *expectedResponseStart, const char *expectedErrorStart, char *responseDest, size_t destSize);
+  Swarm_M138_Error_e responseResult(void);
+  void responseClear(void);
+
+  // The asynchronous command engine
+  Swarm_M138_Error_e startAsyncCommand(const char *command, const char *expectedResponseStart, const char *expectedErrorStart,
+                                       char *responseDest, size_t destSize, unsigned long timeout,
+                                       void (SWARM_M138::*complete)(Swarm_M138_Error_e err, const char *response));
+  Swarm_M138_Error_e startAsyncResponse(const char *expectedResponseStart, const char *expectedErrorStart,
+                                        char *responseDest, size_t destSize, unsigned long timeout,
+                                        void (SWARM_M138::*complete)(Swarm_M138_Error_e err, const char *response));
+  bool pollAsyncCommand(void);
+  void completeAsyncCommand(Swarm_M138_Error_e err, const char *response);
+  void completeAsyncDateTime(Swarm_M138_Error_e err, const char *response);
+  void completeAsyncMsgId(Swarm_M138_Error_e err, const char *response);
+  void completeAsyncStatus(Swarm_M138_Error_e err, const char *response);
+  void completeQueuedCommand(Swarm_M138_Error_e err, const char *response);
+  bool pollCommandQueue(void);
+  Swarm_M138_Error_e transmitBinaryAsync(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                                         void (*callback)(Swarm_M138_Error_e err, const uint64_t *msg_id, void *context), void *context);
+
+  // Pop and process each complete event in the backlog
+  bool processBacklogEvents(char *event, bool *printedEvents);
+
   // Queue a text message for transmission
   Swarm_M138_Error_e transmitText(const char *data, uint64_t *msg_id, bool useAppID, uint16_t appID,
                                   bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch);
@@ -458,39 +1087,79 @@ private:
   Swarm_M138_Error_e transmitBinary(const uint8_t *data, size_t len, uint64_t *msg_id, bool useAppID, uint16_t appID,
                                     bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch);
 
+  // Stream the $TD command for binary data - in SWARM_M138_TX_CHUNK_SIZE chunks - including the asterix, checksum and line feed
+  void sendTransmitBinaryCommand(const uint8_t *data, size_t len, bool useAppID, uint16_t appID,
+                                 bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch);
+
   // Common code for readMessage / readOldestMessage / readNewestMessage
   Swarm_M138_Error_e readMessageInternal(const char mode, uint64_t msg_id_in, char *asciiHex, size_t len, uint64_t *msg_id_out, uint32_t *epoch, uint16_t *appID);
 
   bool initializeBuffers(void);
-  bool processUnsolicitedEvent(const char *event);
-  void pruneBacklog(void);
-
-  // Support for Qwiic Swarm
-
-  TwoWire *_i2cPort;                                   // The I2C (Wire) port for the Qwiic Swarm
-  byte _address;                                       // I2C address of the Qwiic Swarm
-  int qwiicSwarmAvailable(void);                       // Check how many serial bytes Qwiic Sawrm has in its buffer
-  int qwiicSwarmReadChars(int len, char *dest);        // Read bytes from Qwiic Swarm
-  int qwiicSwarmWriteChars(int len, const char *dest); // Write bytes to Qwiic Swarm
-  unsigned long _lastI2cCheck;
-#define QWIIC_SWARM_I2C_POLLING_WAIT_MS 2 // Avoid pounding the I2C bus. Wait at least 2ms between calls to qwiicSwarmAvailable
-// Define the I2C 'registers'
-#define QWIIC_SWARM_LEN_REG 0xFD  // The serial length regsiter: 2 bytes (MSB, LSB) indicating how many serial characters are available to be read
-#define QWIIC_SWARM_DATA_REG 0xFF // The serial data register: used to read and write serial data from/to the modem
-// Define the maximum number of serial bytes to be requested from the ATtiny841
-#define QWIIC_SWARM_SER_PACKET_SIZE 8
-// Qwiic Iridium ATtiny841 I2C buffer length
-#define QWIIC_SWARM_I2C_BUFFER_LENGTH 32
+  bool processUnsolicitedEvent(const char *event, Swarm_M138_Sentence_Tag_e tag);
+
+  // The TX ledger
+  void ledgerQueued(uint64_t msg_id, bool useAppID, uint16_t appID, bool useHold, uint32_t hold, bool useEpoch, uint32_t epoch); // Record a queued message
+
+  // The URC dispatch table - see processUnsolicitedEvent
+  typedef struct
+  {
+    bool (SWARM_M138::*registered)(void);         // Returns true if a callback is registered
+    bool (SWARM_M138::*parse)(const char *event); // Parses the event and calls the callback
+  } Swarm_M138_URC_Dispatch_t;
+  static const Swarm_M138_URC_Dispatch_t _urcDispatch[SWARM_M138_SENTENCE_TAG_MAX];
+  bool urcCallbackRegistered(Swarm_M138_Sentence_Tag_e tag);
+  bool dateTimeCallbackRegistered(void);
+  bool gpsJammingCallbackRegistered(void);
+  bool geospatialCallbackRegistered(void);
+  bool gpsFixQualityCallbackRegistered(void);
+  bool powerStatusCallbackRegistered(void);
+  bool receiveMessageCallbackRegistered(void);
+  bool receiveTestCallbackRegistered(void);
+  bool sleepWakeCallbackRegistered(void);
+  bool modemStatusCallbackRegistered(void);
+  bool transmitDataCallbackRegistered(void);
+  bool processDateTimeEvent(const char *event);
+  bool processGpsJammingEvent(const char *event);
+  bool processGeospatialEvent(const char *event);
+  bool processGpsFixQualityEvent(const char *event);
+  bool processPowerStatusEvent(const char *event);
+  bool processReceiveMessageEvent(const char *event);
+  bool processReceiveTestEvent(const char *event);
+  bool processSleepWakeEvent(const char *event);
+  bool processModemStatusEvent(const char *event);
+  bool processTransmitDataEvent(const char *event);
+
+  // The backlog ring buffer
+  void backlogClear(void);
+  size_t backlogFill(void);                           // Read any waiting serial data into the backlog
+  void backlogAppend(char c);                         // Add one character to the backlog. Frame the sentence
+  bool backlogStore(char c);                          // Store one character in the incomplete line
+  Swarm_M138_Sentence_Tag_e sentenceTag(const char *sentence); // Return the tag of a sentence or command
+  char backlogPendingChar(size_t offset);              // Return a character from the incomplete line
+  bool backlogPendingStartsWith(const char *s);        // Check if the incomplete line starts with s
+  void backlogPendingCopy(char *dest, size_t destSize); // Copy the incomplete line into dest
+  void backlogLineComplete(Swarm_M138_Error_e result); // Called when the \n arrives
+
+  // The telemetry cache
+  void updateTelemetryCache(void);                                          // Parse the incomplete line into the cache - if it is telemetry
+  bool telemetryFresh(Swarm_M138_Telemetry_e entry, unsigned long maxAge); // Check if the cache entry is valid and no older than maxAge
+  size_t backlogPopLine(char *dest, size_t destSize, Swarm_M138_Sentence_Tag_e *tag); // Pop the oldest complete sentence
 
   // Memory allocation
 
   char *swarm_m138_alloc_char(size_t num);
   void swarm_m138_free_char(char *freeMe);
+  char *swarm_m138_alloc_command(size_t num); // Uses the command arena in zero-heap mode
+  void swarm_m138_free_command(char *freeMe);
+  char *swarm_m138_alloc_response(size_t num); // Uses the response arena in zero-heap mode
+  void swarm_m138_free_response(char *freeMe);
 
   // UART / I2C Functions
   size_t hwPrint(const char *s);
   size_t hwWriteData(const char *buff, int len);
   size_t hwWrite(const char c);
+  void hwWriteStreamBegin(size_t len);
+  size_t hwWriteStreamChunk(const char *buff, int len);
   int hwAvailable(void);
   int hwReadChars(char *buf, int len);
 